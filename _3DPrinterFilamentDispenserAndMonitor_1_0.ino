@@ -14,21 +14,47 @@
  *  Licensed under GNU LGPL 3.0
 */
 
+#include "hal.h"
 #include "filament.h"
 #include "filamentweight.h"
+#include "spoolchannel.h"
 #include "commands.h"
-#ifdef _USE_MOTOR
-#include "motorcontrol.h"
-#endif
+#include "serialline.h"
+#include "telemetry.h"
+#include "scheduler.h"
+#include "perf.h"
 
+//! The spool channels (see channels.h)
+spoolChannel spools[SPOOL_CHANNELS];
+//! Channel the commands are addressed to by default
+int selectedChannel;
+//! Channel of the command being executed
+spoolChannel* spool = &spools[0];
+//! First channel serviced by the next sensor task
+int firstChannel;
+
+//! Main loop tasks
+Scheduler scheduler;
 #ifdef _USE_MOTOR
-MotorControl motor;
-//! operating mode
-boolean modeAuto;
+//! Automatic feed task, signalled by the new readings
+int feedTask;
 #endif
 
-//! The weight control class
-FilamentWeight scale;
+//! Serial commands assembler
+SerialLine serialLine;
+
+//! Binary telemetry stream
+Telemetry telemetry;
+//! Next channel sending its telemetry record, SPOOL_CHANNELS if none
+int telemetryChannel = SPOOL_CHANNELS;
+
+//! ms between two machine readable status streams, 0 if disabled
+unsigned long machinePeriod;
+//! halMillis() of the last machine readable status stream
+unsigned long machineLast;
+
+//! ms from the power on to the end of the initialisation
+unsigned long bootTime;
 
 // ==============================================
 // Initialisation
@@ -37,236 +63,925 @@ void setup() {
   // Serial is initialised at high speed. If your Arduino boards
   // loose characters or show unwanted/unexpected behavior
   // try with a lower communication speed
-  Serial.begin(38400);
+  halSerialBegin(38400);
+  serialLine.begin(halSerial);
+  telemetry.begin(halSerial);
+  telemetryChannel = SPOOL_CHANNELS;
 
   // Print the initialisation message
-  Serial.println(APP_TITLE);
+  halSerial.println(APP_TITLE);
+
+  // Initialize the weight and motor classes of every channel,
+  // the channel 0 initializes the shared motor driver
+  for(int j = 0; j < SPOOL_CHANNELS; j++) {
+    spools[j].scale.begin(j);
+    spools[j].loadPending = false;
+#ifdef _USE_MOTOR
+    spools[j].motor.begin(j);
+    spools[j].regulator.begin();
+    spools[j].modeAuto = false;
+    spools[j].newReading = false;
+    spools[j].plan.begin();
+#endif
+  }
+  selectedChannel = 0;
+  firstChannel = 0;
+  machinePeriod = 0;
 
-  // Initialize the weight class
-  scale.begin();
+  // The tasks of the main loop, by priority
+  scheduler.begin();
+  scheduler.add("sensor", taskSensor, TASK_SENSOR_PERIOD, TASK_SENSOR_PERIOD, 0);
 #ifdef _USE_MOTOR
-  // initialize the motor class
-  motor.begin();  
-  modeAuto = false;
+  scheduler.add("motion", taskMotion, TASK_MOTION_PERIOD, TASK_MOTION_PERIOD, 1);
+  feedTask = scheduler.add("feed", taskFeed, TASK_EVENT, TASK_FEED_DEADLINE, 2);
+  scheduler.add("diag", taskDiagnostics, DIAG_MIN_PERIOD, TASK_DIAG_DEADLINE, 3);
+#endif
+  scheduler.add("rx", taskSerialRx, TASK_RX_PERIOD, TASK_RX_PERIOD, 4);
+  scheduler.add("tx", taskSerialTx, TELEMETRY_TASK_PERIOD, TELEMETRY_TASK_PERIOD, 5);
+  scheduler.add("led", taskLED, LED_PERIOD, LED_PERIOD, 6);
+
+#ifdef _DEBUG_COMMANDS
+  checkCommandTable();
 #endif
+#ifdef _PERF
+  perf.begin();
+#endif
+  bootTime = halMillis();
 }
 
 // ==============================================
 // Main loop
 // ==============================================
 /** 
- * The main loop role is execturing the service functions; display update, 
- * calculations, button checking
- * The scale reading is done at a specific frequence and is interrupt-driven
+ * The main loop executes the released task with the highest priority.
+ * No task waits: the scale reading is interrupt-driven (or polled by the
+ * sensor task) and the motor motion is advanced step by step by the
+ * motion task, so no task blocks the others
  */
 void loop() {
-  scale.readScale();
+  scheduler.run();
+}
+
+// ==============================================
+// Tasks
+// ==============================================
+
+//! Filter the new samples of every channel, starting from a different
+//! channel every time so no channel waits for the others longer
+void taskSensor(void) {
+  int j;
 
-//  Serial.println(scale.lastRead);
-  
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    spoolChannel& ch = spools[(firstChannel + j) % SPOOL_CHANNELS];
+#ifdef _USE_MOTOR
+    ch.scale.motorActive = ch.motor.internalStatus.isRunning;
+    ch.scale.filamentLoose = ch.modeAuto && (ch.regulator.relax == RELAX_LOOSE);
+#endif
+    if(!ch.scale.readScale())
+      continue;
+    // The load command shows the first reading made after it
+    if(ch.loadPending) {
+      ch.loadPending = false;
+      ch.scale.saveSettings();
+      ch.scale.showLoad();
+    }
 #ifdef _USE_MOTOR
-  // Check for the extruder request
-  if( (scale.statID == STAT_RUN) && (scale.currentStatus.filamentNeededFromExtruder == true) ) {
-    if(modeAuto) {
-      motor.feedExtruder(FEED_EXTRUDER_DELAY);
-      motor.tleDiagnostic();
+    if(ch.modeAuto) {
+      ch.newReading = true;
+      scheduler.signal(feedTask);
     }
+#endif
+  }
+  firstChannel = (firstChannel + 1) % SPOOL_CHANNELS;
+}
+
+#ifdef _USE_MOTOR
+//! Advance the motion engine of every channel
+void taskMotion(void) {
+  int j;
+
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    spools[j].motor.motorUpdate();
   }
+}
+
+//! In automatic mode the motor speed follows the consumption and the
+//! extruder tension at every new reading. The consumption is the demand
+//! scheduled by the host when available, otherwise the estimated one
+void taskFeed(void) {
+  int j;
+  measure_t demand;
+
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    spoolChannel& ch = spools[j];
+    if(!ch.newReading)
+      continue;
+    ch.newReading = false;
+
+    if(ch.scale.statID == STAT_RUN) {
+      demand = ch.plan.demand(halMillis());
+      ch.motor.motorSpeed(ch.regulator.update(ch.scale.tension, 
+                                              (demand >= 0) ? ch.scale.calcGgramsToCentimeters(demand) : ch.scale.feedRate()), 
+                          DIRECTION_FEED);
+    }
+    else if(ch.regulator.duty != 0) {
+      // Not printing anymore
+      ch.regulator.reset();
+      ch.motor.motorSpeed(0, DIRECTION_FEED);
+    }
+  }
+}
+
+//! Read the driver status at the poll rate, the new faults are shown
+//! as soon as they are read
+void taskDiagnostics(void) {
+  boolean running = false;
+  int j, newFaults;
+
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    running = running || spools[j].motor.internalStatus.isRunning;
+  }
+  newFaults = MotorControl::diagnostics.poll(running);
+  if(newFaults != HAL_DIAG_OK) {
+    MotorControl::diagnostics.show();
+    if(machinePeriod != 0)
+      sendFaultLine(newFaults);
+  }
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    spools[j].motor.checkFaults();
+  }
+}
 #endif
 
-  // Check if the motor is running to test the errors status
-  if(motor.internalStatus.isRunning) {
-    if(motor.tleCheckDiagnostic()) {
-      motor.tleDiagnostic();
+//! Execute the complete commands
+void taskSerialRx(void) {
+  int j;
+
+  // The short lines of a stream (e.g. the schedule bins) arrive faster
+  // than one a period, all the lines received are executed
+  for(j = 0; j < TASK_RX_LINES; j++) {
+    switch(serialLine.poll()) {
+      case SERIAL_LINE_READY:
+        parseCommand(serialLine.line());
+        break;
+      case SERIAL_LINE_OVERFLOW:
+        serialMessage(CMD_WRONGCMD, CMD_TOOLONG);
+        break;
+      default:
+        return;
     }
   }
+}
+
+//! Send the history a line at a time, the captured samples and the
+//! telemetry records
+void taskSerialTx(void) {
+  int j;
+  PERF_SCOPE(PERF_TX);
+
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    spools[j].scale.history.stream();
+    sendCaptured(j);
+    if(spools[j].scale.runout.alert())
+      sendRunoutWarning(j);
+  }
 
-  if(Serial.available() > 0){
-    parseCommand(Serial.readString());
-  } // serial available
+  // A record per pass: the records of all the channels would fill the
+  // transmit buffer and block the task
+  if(telemetry.due())
+    telemetryChannel = 0;
+  if(telemetryChannel < SPOOL_CHANNELS)
+    sendTelemetry(telemetryChannel++);
+
+  if( (machinePeriod != 0) && ((halMillis() - machineLast) >= machinePeriod) ) {
+    machineLast = halMillis();
+    for(j = 0; j < SPOOL_CHANNELS; j++) {
+      sendStatusLine(j);
+    }
+  }
 }
 
-//! Send a single line message to the serial
-void serialMessage(String title, String description) {
-    Serial.print(title);
-    Serial.print(" ");
-    Serial.println(description);
+//! Flash the status LED
+void taskLED(void) {
+  int j;
+
+  for(j = 0; j < SPOOL_CHANNELS; j++) {
+    spools[j].scale.updateLED();
+  }
 }
 
 /**
- * Parse the command string and echo the executing message or command unknown error.
+ * Send a telemetry record with the current status of a channel
  * 
- * \param commandString the string coming from the serial
+ * \param j the spool channel
  */
- void parseCommand(String commandString) {
-
-  // =========================================================
-  // Parameters settings
-  // =========================================================
-
-  // Set PLA material and recalculate the material characteristics
-  // Flag is set to display an update nesxt loop cycle
-  if(commandString.equals(SET_PLA)) {
-    scale.materialID = PLA;
-    scale.calcMaterialCharacteristics();
-    scale.showInfo();
-  }
-  // Set ABS material and recalculate the material characteristics
-  // Flag is set to display an update nesxt loop cycle
-  else if(commandString.equals(SET_ABS)) {
-    scale.materialID = ABS;
-    scale.calcMaterialCharacteristics();
-    scale.showInfo();
-  }
-  // Set 1.75 mm filament diameter and recalculate the material characteristics
-  // Flag is set to display an update nesxt loop cycle
-  else if(commandString.equals(SET_175)) {
-    scale.diameterID = DIAM_175;
-    scale.calcMaterialCharacteristics();
-    scale.showInfo();
-  }
-  // Set 3.00 mm filament diameter and recalculate the material characteristics
-  // Flag is set to display an update nesxt loop cycle
-  else if(commandString.equals(SET_300)) {
-    scale.diameterID = DIAM_300;
-    scale.calcMaterialCharacteristics();
-    scale.showInfo();
-  }
-  // Set 1kg filament spool and recalculate the material characteristics
-  // Flag is set to display an update next loop cycle
-  else if(commandString.equals(SET_1KG)) {
-    scale.wID = ROLL1KG;
-    scale.calcMaterialCharacteristics();
-    scale.showInfo();
-  }
-  // Set 2kg filament spool and recalculate the material characteristics
-  // Flag is set to display an update nesxt loop cycle
-  else if(commandString.equals(SET_2KG)) {
-    scale.wID = ROLL2KG;
-    scale.calcMaterialCharacteristics();
-    scale.showInfo();
-  }
-  // Set units in grams
-  else if(commandString.equals(SET_WEIGHT)) {
-    serialMessage(CMD_UNITS, commandString);
-    scale.filamentUnits = _GR;
-  }
-  // Set units in cm
-  else if(commandString.equals(SET_CENTIMETERS)) {
-    serialMessage(CMD_UNITS, commandString);
-    scale.filamentUnits = _CM;
-  }
-
-  // =========================================================
-  // Change current functional status
-  // =========================================================
-
-  // Send a reset command and restore the parameters to the defaults
-  // The tare is not recalculated to avoid wrong measure (if the spool
-  // is already on the scale platform
-  // This command had mandatory executi9on and ignore the previous state
-  // The flag is set to show an update nextg loop cycle
-  else if(commandString.equals(S_RESET)) {
-    scale.reset();
-    scale.stat = SYS_READY;
-    scale.statID = STAT_READY;
-//    scale.flashLED();
-    scale.showInfo();
-  }
-  // Send a load command status setting
-  // Should be executed after the filament roll has been set 
-  // and placed on the scale base or after a reset command
-  // The flag is set to show an update nextg loop cycle
-  else if(commandString.equals(S_LOAD)) {
-    scale.stat = SYS_LOAD;
-    scale.statID = STAT_LOAD;
-    scale.initialWeight = 0;
-    scale.readScale();
-    scale.showLoad();
-  }
-  // Send a run command status setting
-  // Should be sent when a print job is started
-  else if(commandString.equals(S_RUN)) {
-    scale.stat = SYS_RUN;
-    scale.statID = STAT_RUN;
-    scale.initialWeight = scale.lastRead - scale.rollTare;
-    scale.prevRead = scale.lastRead;
-    scale.lastConsumedGrams = 0;
-    scale.showStat();
-  }
-  // Send a default command status setting
-  // Should be used to reset the system to the default values 
-  // of the material without changing any setting in the weight
-  // tare and calculations but the current status is not changed.
-  // Use this commmand to reset the material to the internal conditions
-  else if(commandString.equals(S_DEFAULT)) {
-    scale.setDefaults();
-    scale.showInfo();
-  }  
-
-  // =========================================================
-  // Informative commands
-  // =========================================================
-
-  else if(commandString.equals(SHOW_INFO)) {
-    scale.showInfo();
-  }
-  else if(commandString.equals(SHOW_STATUS)) {
-    scale.showLoad();
-    scale.showStat();
-  }
-  else if(commandString.equals(SHOW_DUMP)) {
-    scale.showConfig();
-  }
-  else if(commandString.equals(SHOW_WEIGHT)) {
-    Serial.print(CMD_WEIGHT);
-    Serial.print(scale.getWeight());
-    Serial.println(UNITS_GR);
-  }
-
-  // =========================================================
-  // Motor control
-  // =========================================================
+void sendTelemetry(int j) {
+  telemetrySample record;
+  spoolChannel& ch = spools[j];
 
+  record.type = TELEMETRY_SAMPLE;
+  record.timestamp = halMillis();
+  record.raw = ch.scale.lastRaw;
+  record.weight = MEASURE_MILLI(ch.scale.sensorRead);
+  record.statID = (j << 4) | ch.scale.statID;
 #ifdef _USE_MOTOR
-  else if(commandString.equals(MOTOR_FEED)) {
-    serialMessage(CMD_EXEC, commandString);
-    motor.feedExtruder(FEED_EXTRUDER_DELAY);
-    motor.tleDiagnostic();
+  record.duty = ch.motor.internalStatus.isRunning ? ch.motor.internalStatus.currentDC : 0;
+  record.motion = (ch.motor.internalStatus.motorDirection << 4) | ch.motor.internalStatus.motionState;
+  record.diagnosis = ch.motor.diagnostics.faults;
+#else
+  record.duty = 0;
+  record.motion = 0;
+  record.diagnosis = 0;
+#endif
+  telemetry.send(&record, sizeof(record));
+}
+
+/**
+ * Send a capture record for every raw sample captured by a channel.
+ * The motor state is the one at the transmission, at most
+ * TELEMETRY_TASK_PERIOD ms after the sample
+ * 
+ * \param j the spool channel
+ */
+void sendCaptured(int j) {
+  telemetryCapture record;
+  scaleSample sample;
+  spoolChannel& ch = spools[j];
+
+  while(ch.scale.capture.read(sample)) {
+    record.type = TELEMETRY_CAPTURE;
+    record.timestamp = sample.timestamp;
+    record.raw = sample.raw;
+    record.statID = (j << 4) | ch.scale.statID;
+#ifdef _USE_MOTOR
+    record.duty = ch.motor.internalStatus.isRunning ? ch.motor.internalStatus.currentDC : 0;
+    record.motion = (ch.motor.internalStatus.motorDirection << 4) | ch.motor.internalStatus.motionState;
+#else
+    record.duty = 0;
+    record.motion = 0;
+#endif
+    telemetry.send(&record, sizeof(record));
   }
-  else if(commandString.equals(MOTOR_PULL)) {
-    serialMessage(CMD_EXEC, commandString);
-    motor.filamentLoad(FEED_EXTRUDER_DELAY);
-    motor.tleDiagnostic();
+}
+
+/**
+ * Send the machine readable status line of a channel:\n
+ * \@stat ch=<channel> t=<ms> <FilamentWeight::showMachine() fields>
+ * duty=<motor duty> motion=<motion state> faults=<HAL_DIAG_* hex>
+ * 
+ * \param j the spool channel
+ */
+void sendStatusLine(int j) {
+  spoolChannel& ch = spools[j];
+
+  halSerial.print(MSTAT_STATUS);
+  halSerial.print(" ch=");
+  halSerial.print(j);
+  halSerial.print(" t=");
+  halSerial.print(halMillis());
+  ch.scale.showMachine();
+#ifdef _USE_MOTOR
+  halSerial.print(" duty=");
+  halSerial.print(ch.motor.internalStatus.isRunning ? ch.motor.internalStatus.currentDC : 0);
+  halSerial.print(" motion=");
+  halSerial.print(ch.motor.internalStatus.motionState);
+  halSerial.print(" faults=");
+  halSerial.print(ch.motor.diagnostics.faults, HEX);
+#endif
+  halSerial.println("");
+}
+
+/**
+ * Show the runout warning of a channel and, if the machine readable
+ * stream is enabled, send its event:\n
+ * \@runout ch=<channel> t=<ms> tte=<s, -1 if not known>
+ * endleft=<gr, 0 if the job weight is not set>
+ * 
+ * \param j the spool channel
+ */
+void sendRunoutWarning(int j) {
+  RunoutForecaster& runout = spools[j].scale.runout;
+
+  halSerial.println(MSG_RUNOUT);
+  runout.show();
+  if(machinePeriod == 0)
+    return;
+  halSerial.print(MSTAT_RUNOUT);
+  halSerial.print(" ch=");
+  halSerial.print(j);
+  halSerial.print(" t=");
+  halSerial.print(halMillis());
+  halSerial.print(" tte=");
+  halSerial.print(runout.timeToEmpty());
+  halSerial.print(" endleft=");
+  halSerial.println(MEASURE_FLOAT((runout.job > 0) ? runout.leftAtEnd() : 0));
+}
+
+#ifdef _USE_MOTOR
+/**
+ * Send the machine readable event of the new driver faults:\n
+ * \@fault t=<ms> new=<HAL_DIAG_* hex> faults=<HAL_DIAG_* hex>
+ * 
+ * \param newFaults the fault bits not present at the previous read
+ */
+void sendFaultLine(int newFaults) {
+  halSerial.print(MSTAT_FAULT);
+  halSerial.print(" t=");
+  halSerial.print(halMillis());
+  halSerial.print(" new=");
+  halSerial.print(newFaults, HEX);
+  halSerial.print(" faults=");
+  halSerial.println(MotorControl::diagnostics.faults, HEX);
+}
+#endif
+
+//! Send a single line message to the serial
+void serialMessage(const char* title, const char* description) {
+    halSerial.print(title);
+    halSerial.print(" ");
+    halSerial.println(description);
+}
+
+// ==============================================
+// Commands
+// ==============================================
+
+// =========================================================
+// Parameters settings
+// =========================================================
+
+// Set units in grams
+void cmdSetWeight(const char* arg) {
+  serialMessage(CMD_UNITS, SET_WEIGHT);
+  spool->scale.filamentUnits = _GR;
+  spool->scale.saveSettings();
+}
+
+// Set units in cm
+void cmdSetCentimeters(const char* arg) {
+  serialMessage(CMD_UNITS, SET_CENTIMETERS);
+  spool->scale.filamentUnits = _CM;
+  spool->scale.saveSettings();
+}
+
+// =========================================================
+// Scale calibration
+// =========================================================
+
+// Start a new calibration. Place the reference weights on the 
+// empty scale one at a time, the first can be 0 (no weight)
+void cmdCalibration(const char* arg) {
+  serialMessage(CMD_EXEC, MANUAL_CALIBRATION);
+  spool->scale.calibration.start();
+}
+
+// The argument is the reference weight in grams on the scale, the 
+// point is added when the samples have been averaged
+void cmdCalibrationPoint(const char* arg) {
+  if( (*arg == '\0') || !spool->scale.calibration.addPoint(atof(arg)) ) {
+    serialMessage(CMD_WRONGCMD, CAL_POINT);
   }
-  else if(commandString.equals(MOTOR_STOP)) {
-    serialMessage(CMD_EXEC, commandString);
-    motor.motorBrake();
-    motor.tleDiagnostic();
+  spool->scale.calibration.show();
+}
+
+// The optional argument is the model order, 1 (default) linear or 
+// 2 with the nonlinearity correction
+void cmdCalibrationEnd(const char* arg) {
+  if( (spool->scale.calibration.state != CAL_WAIT) || 
+      !spool->scale.applyCalibration((*arg != '\0') ? atoi(arg) : 1) ) {
+    serialMessage(CMD_WRONGCMD, CAL_FAILED);
+    return;
   }
-  else if(commandString.equals(MOTOR_FEED_CONT)) {
-    serialMessage(CMD_EXEC, commandString);
-    motor.filamentContFeed();
+  halSerial.print("Max error: ");
+  halSerial.print(spool->scale.calibration.maxError);
+  halSerial.println(UNITS_GR);
+  spool->scale.showConfig();
+}
+
+// =========================================================
+// Change current functional status
+// =========================================================
+
+// Send a reset command and restore the parameters to the defaults
+// The tare is not recalculated to avoid wrong measure (if the spool
+// is already on the scale platform
+// This command had mandatory executi9on and ignore the previous state
+void cmdReset(const char* arg) {
+  spool->scale.reset();
+  spool->scale.statID = STAT_READY;
+  spool->scale.saveSettings();
+  spool->scale.showInfo();
+}
+
+// Set the current weight as the zero of the scale
+// Should be executed with the scale platform empty. The zero is
+// saved when the sensor task has averaged the tare samples
+void cmdTare(const char* arg) {
+  serialMessage(CMD_EXEC, S_TARE);
+  spool->scale.tare();
+}
+
+// Send a load command status setting
+// Should be executed after the filament roll has been set 
+// and placed on the scale base or after a reset command.
+// The roll weight is shown by the sensor task with the next reading
+void cmdLoad(const char* arg) {
+  spool->scale.statID = STAT_LOAD;
+  spool->scale.initialWeight = 0;
+  spool->scale.runout.stop();
+  spool->loadPending = true;
+}
+
+// Send a run command status setting
+// Should be sent when a print job is started
+void cmdRun(const char* arg) {
+  spool->scale.statID = STAT_RUN;
+  spool->scale.initialWeight = spool->scale.lastRead - spool->scale.rollTare;
+  spool->scale.prevRead = spool->scale.lastRead;
+  spool->scale.setRestWeight(spool->scale.lastRead);
+  spool->scale.consumption.reset();
+  spool->scale.runout.reset(spool->scale.initialWeight, spool->scale.initialWeight, halMillis());
+  spool->scale.history.begin();
+  spool->scale.lastConsumedGrams = 0;
+  spool->scale.saveSettings();
+  spool->scale.showStat();
+}
+
+// Send a default command status setting
+// Should be used to reset the system to the default values 
+// of the material without changing any setting in the weight
+// tare and calculations but the current status is not changed.
+// Use this commmand to reset the material to the internal conditions
+void cmdDefault(const char* arg) {
+  spool->scale.setDefaults();
+  spool->scale.saveSettings();
+  spool->scale.showInfo();
+}
+
+// =========================================================
+// Informative commands
+// =========================================================
+
+void cmdShowInfo(const char* arg) {
+  spool->scale.showInfo();
+}
+
+void cmdShowStatus(const char* arg) {
+  spool->scale.showLoad();
+  spool->scale.showStat();
+}
+
+void cmdShowDump(const char* arg) {
+  spool->scale.showConfig();
+  halSerial.print("Boot: ");
+  halSerial.print(bootTime);
+  halSerial.println(" ms");
+}
+
+void cmdShowWeight(const char* arg) {
+  halSerial.print(CMD_WEIGHT);
+  halSerial.print(spool->scale.getWeight());
+  halSerial.println(UNITS_GR);
+}
+
+void cmdShowAcquisition(const char* arg) {
+  spool->scale.showAcquisition();
+}
+
+// The history is streamed by the main loop
+void cmdShowHistory(const char* arg) {
+  spool->scale.history.dump();
+}
+
+void cmdShowTasks(const char* arg) {
+  scheduler.show();
+}
+
+#ifdef _PERF
+// Show the probes and counters since the last perf command
+void cmdShowPerf(const char* arg) {
+  perf.show();
+}
+#endif
+
+// The optional argument is the period in ms, 0 stops the stream
+void cmdTelemetry(const char* arg) {
+  telemetry.setPeriod((*arg != '\0') ? atol(arg) : TELEMETRY_DEFAULT_PERIOD);
+}
+
+// The optional argument is the filament needed by the job in grams,
+// 0 if not known, then the runout forecast is shown
+void cmdJob(const char* arg) {
+  if(*arg != '\0')
+    spool->scale.runout.setJob(MEASURE(atof(arg)));
+  spool->scale.runout.show();
+}
+
+// Without argument send the status lines once, the optional argument
+// is the period in ms of the stream, 0 stops it
+void cmdShowMachine(const char* arg) {
+  int j;
+
+  if(*arg == '\0') {
+    for(j = 0; j < SPOOL_CHANNELS; j++) {
+      sendStatusLine(j);
+    }
+    return;
+  }
+  machinePeriod = atol(arg);
+  if( (machinePeriod != 0) && (machinePeriod < MSTAT_MIN_PERIOD) )
+    machinePeriod = MSTAT_MIN_PERIOD;
+  machineLast = halMillis();
+}
+
+// The optional argument starts (not 0) or stops (0) the capture of
+// the raw samples, then the capture counters are shown
+void cmdCapture(const char* arg) {
+  if(*arg != '\0') {
+    if(atoi(arg) != 0)
+      spool->scale.capture.start();
+    else
+      spool->scale.capture.stop();
   }
-  else if(commandString.equals(MOTOR_PULL_CONT)) {
-    serialMessage(CMD_EXEC, commandString);
-    motor.filamentContLoad();
+  spool->scale.capture.show();
+}
+
+// The optional argument selects the channel of the commands
+// without the "<channel>:" prefix
+void cmdChannel(const char* arg) {
+  if(*arg != '\0') {
+    if( (atoi(arg) < 0) || (atoi(arg) >= SPOOL_CHANNELS) ) {
+      serialMessage(CMD_WRONGCMD, arg);
+      return;
+    }
+    selectedChannel = atoi(arg);
   }
+  halSerial.print(CMD_CHANNEL);
+  halSerial.print(selectedChannel);
+  halSerial.print("/");
+  halSerial.println(SPOOL_CHANNELS);
+}
+
+void cmdHelp(const char* arg) {
+  showHelp();
+}
+
+// =========================================================
+// Motor control
+// =========================================================
+
+#ifdef _USE_MOTOR
+// The optional argument is the feed duration in ms
+void cmdMotorFeed(const char* arg) {
+  serialMessage(CMD_EXEC, MOTOR_FEED);
+  spool->motor.feedExtruder((*arg != '\0') ? atol(arg) : FEED_EXTRUDER_DELAY);
+}
+
+// The optional argument is the load duration in ms
+void cmdMotorPull(const char* arg) {
+  serialMessage(CMD_EXEC, MOTOR_PULL);
+  spool->motor.filamentLoad((*arg != '\0') ? atol(arg) : FEED_EXTRUDER_DELAY);
+}
+
+void cmdMotorStop(const char* arg) {
+  serialMessage(CMD_EXEC, MOTOR_STOP);
+  spool->motor.motorBrake();
+}
+
+void cmdMotorFeedCont(const char* arg) {
+  serialMessage(CMD_EXEC, MOTOR_FEED_CONT);
+  spool->motor.filamentContFeed();
+}
+
+void cmdMotorPullCont(const char* arg) {
+  serialMessage(CMD_EXEC, MOTOR_PULL_CONT);
+  spool->motor.filamentContLoad();
+}
+
+// The optional argument is the driver status poll period in ms
+void cmdDiagnostics(const char* arg) {
+  if(*arg != '\0') {
+    spool->motor.diagnostics.period = constrain(atol(arg), DIAG_MIN_PERIOD, DIAG_IDLE_PERIOD);
+  }
+  spool->motor.diagnostics.show();
+  spool->motor.diagnostics.showCounters();
+}
+
+// =========================================================
+// Change behaviour mode
+// =========================================================
+
+void cmdModeAuto(const char* arg) {
+  serialMessage(CMD_MODE, MODE_AUTO);
+  spool->regulator.reset();
+  spool->modeAuto = true;
+}
+
+void cmdModeManual(const char* arg) {
+  serialMessage(CMD_MODE, MODE_MANUAL);
+  // Stop the feeding started by the regulator
+  if(spool->modeAuto && (spool->regulator.duty != 0)) {
+    spool->motor.motorSpeed(0, DIRECTION_FEED);
+  }
+  spool->regulator.reset();
+  spool->modeAuto = false;
+}
+
+// =========================================================
+// Tension regulator tuning
+// =========================================================
+
+// The optional argument is the proportional gain
+void cmdTuneKp(const char* arg) {
+  if(*arg != '\0')
+    spool->regulator.kp = MEASURE(atof(arg));
+  spool->regulator.showTuning();
+}
+
+// The optional argument is the integral gain
+void cmdTuneKi(const char* arg) {
+  if(*arg != '\0') {
+    spool->regulator.ki = MEASURE(atof(arg));
+    spool->regulator.integral = 0;
+  }
+  spool->regulator.showTuning();
+}
+
+// The optional argument is the filament demand in mg of the next
+// schedule bin, 0 ... PLAN_MAX_DEMAND, without it the schedule status
+// is shown
+void cmdPlan(const char* arg) {
+  long mg;
+
+  if(*arg != '\0') {
+    // Longer numbers are out of range, atol() would overflow
+    mg = (strlen(arg) <= 5) ? atol(arg) : -1;
+    if( (mg < 0) || (mg > PLAN_MAX_DEMAND) )
+      serialMessage(CMD_WRONGCMD, arg);
+    else if(!spool->plan.add(mg))
+      serialMessage(CMD_WRONGCMD, CMD_PLANFULL);
+    return;
+  }
+  spool->plan.show();
+}
+
+// The optional argument is the ms of a bin, the schedule is followed
+// from now; 0 stops the schedule and clears the queue
+void cmdPlanStart(const char* arg) {
+  // The bin time is an unsigned int
+  if( (*arg == '-') || (strlen(arg) > 5) || (atol(arg) > 0xFFFF) ) {
+    serialMessage(CMD_WRONGCMD, arg);
+    return;
+  }
+  if(*arg == '\0')
+    spool->plan.start(PLAN_BIN_TIME);
+  else if(atol(arg) != 0)
+    spool->plan.start(atol(arg));
+  else
+    spool->plan.begin();
+  spool->plan.show();
+}
+
+// The optional argument is the tension setpoint in grams
+void cmdTuneTension(const char* arg) {
+  if(*arg != '\0')
+    spool->regulator.setpoint = MEASURE(atof(arg));
+  spool->regulator.showTuning();
+}
 #endif
 
-  // =========================================================
-  // Change behaviour mode
-  // =========================================================
+//! Commands table. The entries must be sorted by name (strcmp order) 
+//! as the commands are searched with a binary search
+const command commandTable[] = {
+  { SHOW_ACQUISITION, cmdShowAcquisition, ARG_NONE, STAT_NONE, "sensor acquisition rate" },
+#ifdef _USE_MOTOR
+  { MODE_AUTO,        cmdModeAuto,        ARG_NONE, STAT_NONE, "automatic feed mode" },
+#endif
+  { CAL_POINT,        cmdCalibrationPoint, ARG_FLOAT, STAT_NONE, "calibration weight <gr>" },
+  { CAL_END,          cmdCalibrationEnd,  ARG_INT,  STAT_NONE, "fit and apply [1 linear, 2 quadratic]" },
+  { MANUAL_CALIBRATION, cmdCalibration,   ARG_NONE, STAT_NONE, "start the calibration" },
+  { CAPTURE,          cmdCapture,         ARG_INT,  STAT_NONE, "raw samples stream [1 starts, 0 stops]" },
+  { SELECT_CHANNEL,   cmdChannel,         ARG_INT,  STAT_NONE, "default spool channel [n]" },
+  { SET_CENTIMETERS,  cmdSetCentimeters,  ARG_NONE, STAT_NONE, "show length in cm" },
+  { SHOW_DUMP,        cmdShowDump,        ARG_NONE, STAT_NONE, "dump the settings" },
+  { S_DEFAULT,        cmdDefault,         ARG_NONE, STAT_NONE, "restore the default material" },
+#ifdef _USE_MOTOR
+  { SHOW_DIAGNOSTICS, cmdDiagnostics,     ARG_INT,  STAT_NONE, "driver faults [poll ms]" },
+#endif
+#ifdef _USE_MOTOR
+  { MOTOR_FEED,       cmdMotorFeed,       ARG_INT,  STAT_NONE, "feed filament [ms]" },
+  { MOTOR_FEED_CONT,  cmdMotorFeedCont,   ARG_NONE, STAT_NONE, "feed continuously" },
+#endif
+  { SET_WEIGHT,       cmdSetWeight,       ARG_NONE, STAT_NONE, "show weight in grams" },
+  { SHOW_HELP,        cmdHelp,            ARG_NONE, STAT_NONE, "this list" },
+  { SHOW_HISTORY,     cmdShowHistory,     ARG_NONE, STAT_NONE, "consumption history of the job" },
+  { SHOW_INFO,        cmdShowInfo,        ARG_NONE, STAT_NONE, "roll info" },
+  { JOB_WEIGHT,       cmdJob,             ARG_FLOAT, STAT_NONE, "job filament [gr], runout forecast" },
+#ifdef _USE_MOTOR
+  { TUNE_KI,          cmdTuneKi,          ARG_FLOAT, STAT_NONE, "tension integral gain [value]" },
+  { TUNE_KP,          cmdTuneKp,          ARG_FLOAT, STAT_NONE, "tension proportional gain [value]" },
+#endif
+  { S_LOAD,           cmdLoad,            ARG_NONE, STAT_NONE, "roll loaded" },
+#ifdef _USE_MOTOR
+  { MODE_MANUAL,      cmdModeManual,      ARG_NONE, STAT_NONE, "manual feed mode" },
+#endif
+  { SHOW_MACHINE,     cmdShowMachine,     ARG_INT,  STAT_NONE, "machine readable status [ms], 0 stops" },
+#ifdef _PERF
+  { SHOW_PERF,        cmdShowPerf,        ARG_NONE, STAT_NONE, "timing histograms and counters" },
+#endif
+#ifdef _USE_MOTOR
+  { PLAN_BIN,         cmdPlan,            ARG_INT,  STAT_NONE, "queue a schedule bin [mg]" },
+  { PLAN_START,       cmdPlanStart,       ARG_INT,  STAT_NONE, "follow the schedule [ms/bin], 0 stops" },
+  { MOTOR_PULL,       cmdMotorPull,       ARG_INT,  STAT_NONE, "pull back filament [ms]" },
+  { MOTOR_PULL_CONT,  cmdMotorPullCont,   ARG_NONE, STAT_NONE, "pull back continuously" },
+#endif
+  { S_RESET,          cmdReset,           ARG_NONE, STAT_NONE, "reset keeping the tare" },
+  { S_RUN,            cmdRun,             ARG_NONE, STAT_LOAD, "print job started" },
+  { SHOW_STATUS,      cmdShowStatus,      ARG_NONE, STAT_NONE, "weight status" },
+#ifdef _USE_MOTOR
+  { MOTOR_STOP,       cmdMotorStop,       ARG_NONE, STAT_NONE, "stop the motor" },
+#endif
+  { S_TARE,           cmdTare,            ARG_NONE, STAT_NONE, "zero the empty scale" },
+  { SHOW_TASKS,       cmdShowTasks,       ARG_NONE, STAT_NONE, "tasks timing and deadline misses" },
+  { TELEMETRY,        cmdTelemetry,       ARG_INT,  STAT_NONE, "binary stream [ms], 0 stops" },
+#ifdef _USE_MOTOR
+  { TUNE_TENSION,     cmdTuneTension,     ARG_FLOAT, STAT_NONE, "tension setpoint [gr]" },
+#endif
+  { SHOW_WEIGHT,      cmdShowWeight,      ARG_NONE, STAT_NONE, "current weight" }
+};
+
+//! Number of commands in the table
+#define COMMANDS_NUM (sizeof(commandTable) / sizeof(commandTable[0]))
+
+/**
+ * Search a command in the table
+ * 
+ * \param name the command name
+ * \return the command entry or NULL if not found
+ */
+const command* findCommand(const char* name) {
+  int low = 0;
+  int high = COMMANDS_NUM - 1;
+  int mid, cmp;
+
+  while(low <= high) {
+    mid = (low + high) / 2;
+    cmp = strcmp(name, commandTable[mid].name);
+    if(cmp == 0)
+      return &commandTable[mid];
+    else if(cmp < 0)
+      high = mid - 1;
+    else
+      low = mid + 1;
+  }
+  return NULL;
+}
+
+/**
+ * Check if a command argument is a valid number
+ * 
+ * \param arg the argument string
+ * \param decimal true if a decimal point is accepted
+ * \return true if the argument is a number
+ */
+boolean isNumber(const char* arg, boolean decimal) {
+  boolean digits = false;
+
+  if(*arg == '-')
+    arg++;
+  while(*arg != '\0') {
+    if( (*arg == '.') && decimal )
+      decimal = false;
+    else if( (*arg < '0') || (*arg > '9') )
+      return false;
+    else
+      digits = true;
+    arg++;
+  }
+  return digits;
+}
+
+//! List the available commands from the commands table and the catalogue
+void showHelp(void) {
+  int j;
+
+  for(j = 0; j < (int)COMMANDS_NUM; j++) {
+    halSerial.print(commandTable[j].name);
+    halSerial.print("\t");
+    halSerial.println(commandTable[j].help);
+  }
 
-  else if(commandString.equals(MODE_AUTO)) {
-    serialMessage(CMD_MODE, commandString);
-    modeAuto = true;
+  halSerial.print(CATALOGUE_MATERIALS);
+  for(j = 0; j < MATERIALS; j++) {
+    halSerial.print(" ");
+    halSerial.print(materialTable[j].name);
   }
-  else if(commandString.equals(MODE_MANUAL)) {
-    serialMessage(CMD_MODE, commandString);
-    modeAuto = false;
+  halSerial.println("");
+  halSerial.print(CATALOGUE_DIAMETERS);
+  for(j = 0; j < DIAMETERS; j++) {
+    halSerial.print(" ");
+    halSerial.print(diameterTable[j].name);
   }
+  halSerial.println("");
+  halSerial.print(CATALOGUE_SPOOLS);
+  for(j = 0; j < SPOOLS; j++) {
+    halSerial.print(" ");
+    halSerial.print(spoolTable[j].name);
+  }
+  halSerial.println("\n");
+}
+
+/**
+ * Select a material, diameter or spool of the catalogue by name
+ * then recalculate the material characteristics
+ * 
+ * \param name the catalogue entry name
+ * \return false if the name is not in the catalogue
+ */
+boolean selectCatalogue(const char* name) {
+  int id;
+
+  if((id = findMaterial(name)) >= 0)
+    spool->scale.materialID = id;
+  else if((id = findDiameter(name)) >= 0)
+    spool->scale.diameterID = id;
+  else if((id = findSpool(name)) >= 0)
+    spool->scale.wID = id;
   else
-    serialMessage(CMD_WRONGCMD, commandString);
- }
+    return false;
 
+  spool->scale.calcMaterialCharacteristics();
+  spool->scale.saveSettings();
+  spool->scale.showInfo();
+  return true;
+}
+
+#ifdef _DEBUG_COMMANDS
+//! Check the commands table order needed by the binary search
+void checkCommandTable(void) {
+  unsigned int j;
+
+  for(j = 1; j < COMMANDS_NUM; j++) {
+    if(strcmp(commandTable[j - 1].name, commandTable[j].name) >= 0)
+      serialMessage(CMD_UNSORTED, commandTable[j].name);
+  }
+}
+#endif
+
+/**
+ * Parse the command string and echo the executing message or command unknown error.
+ * The command name can be followed by an argument separated by a space.
+ * The "<channel>:" prefix addresses the command to a spool channel,
+ * without prefix the command is addressed to the selected channel
+ * 
+ * \param commandString the string coming from the serial
+ */
+void parseCommand(const char* commandString) {
+  char name[SERIAL_LINE_SIZE];
+  const char* arg;
+  const command* cmd;
+  int j;
+  PERF_SCOPE(PERF_COMMAND);
+  PERF_COUNT(PERF_COMMANDS);
+
+  // Channel prefix
+  spool = &spools[selectedChannel];
+  if( (commandString[0] >= '0') && (commandString[0] <= '9') && (commandString[1] == ':') ) {
+    if((commandString[0] - '0') >= SPOOL_CHANNELS) {
+      serialMessage(CMD_WRONGCMD, commandString);
+      return;
+    }
+    spool = &spools[commandString[0] - '0'];
+    commandString += 2;
+  }
+
+  // Split the command name and the argument
+  for(j = 0; (commandString[j] != '\0') && (commandString[j] != ' ') && 
+             (j < (SERIAL_LINE_SIZE - 1)); j++)
+    name[j] = commandString[j];
+  name[j] = '\0';
+  arg = commandString + j;
+  while(*arg == ' ')
+    arg++;
+
+  cmd = findCommand(name);
+  if(cmd == NULL) {
+    // Not a command, can be a catalogue entry
+    if( (*arg != '\0') || !selectCatalogue(name) )
+      serialMessage(CMD_WRONGCMD, commandString);
+  }
+  // Check the argument
+  else if( ((cmd->argSpec == ARG_NONE) && (*arg != '\0')) ||
+           ((cmd->argSpec == ARG_INT) && (*arg != '\0') && !isNumber(arg, false)) ||
+           ((cmd->argSpec == ARG_FLOAT) && (*arg != '\0') && !isNumber(arg, true)) ) {
+    serialMessage(CMD_WRONGCMD, commandString);
+  }
+  // Check the status, the loaded state is reached with the roll weight
+  else if( (spool->scale.statID < cmd->requiredState) || 
+           ((cmd->requiredState == STAT_LOAD) && spool->loadPending) ) {
+    serialMessage(CMD_WRONGSTATE, spool->scale.statName());
+  }
+  else {
+    cmd->handler(arg);
+  }
+}
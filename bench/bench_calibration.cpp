@@ -0,0 +1,114 @@
+/**
+ *  \file bench_calibration.cpp
+ *  \brief Weight errors of the load cell with the calibration of the
+ *  first release and with the calibration commands of the firmware
+ *
+ *  The simulated cell has a gain different from SCALE_CALIBRATION and a
+ *  quadratic nonlinearity. The first run keeps the compiled factor, as
+ *  the first release did; the others calibrate with the reference
+ *  weights of calPoints (calibration, cal <gr>, calend [order]) and fit
+ *  a linear and a quadratic model. The error of every run is measured on
+ *  weights from 0 to BENCH_MAX_WEIGHT, also between and over the
+ *  reference weights, with the weight command.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Counts for one gram of the cell
+#define BENCH_CALIBRATION 452.0
+//! Quadratic error of the cell (1 / gram), 40 gr at 1400 gr
+#define BENCH_NONLINEARITY 2e-5
+//! Heaviest weight measured (gr)
+#define BENCH_MAX_WEIGHT 2000
+//! Step of the weights measured (gr)
+#define BENCH_STEP 100
+
+//! Reference weights of the calibration (gr)
+static const double calPoints[] = { 0, 200, 500, 1000, 1500 };
+
+//! The runs: no calibration, linear fit, quadratic fit
+enum { COMPILED, LINEAR, QUADRATIC, RUNS };
+
+//! Errors of a run
+struct calResult {
+  double maxError;    ///< Max error (gr)
+  double rmsError;    ///< RMS error (gr)
+  double maxRelative; ///< Max error of the weights over 100 gr (gr per gram)
+};
+
+static calResult* results;
+
+//! Place a weight on the scale and wait for the readings
+static void place(double grams, unsigned long ms) {
+  world.integrate(simNow);
+  world.spool[0].extra = grams;
+  simRun(ms);
+}
+
+static int runCalibration(void* arg) {
+  int run = (int)(long)arg;
+  calResult& r = results[run];
+  double sum2 = 0, error;
+  char line[32];
+  unsigned int j;
+  int n = 0, w;
+
+  world.hx711[0].calibration = BENCH_CALIBRATION;
+  world.hx711[0].nonlinearity = BENCH_NONLINEARITY;
+  simBoot();
+  simRun(1000);
+
+  if(run != COMPILED) {
+    simCommand("calibration");
+    for(j = 0; j < sizeof(calPoints) / sizeof(calPoints[0]); j++) {
+      place(calPoints[j], 500);
+      snprintf(line, sizeof(line), "cal %g", calPoints[j]);
+      // The samples are averaged in CAL_SAMPLES / SIM_HX711_SPS s
+      simCommand(line, 1000);
+    }
+    snprintf(line, sizeof(line), "calend %d", (run == LINEAR) ? 1 : 2);
+    simCommand(line, 200);
+  }
+
+  for(w = 0; w <= BENCH_MAX_WEIGHT; w += BENCH_STEP) {
+    place(w, 3000);
+    error = labelValue(simCommand("weight", 300), "Weight ") - w;
+    r.maxError = fmax(r.maxError, fabs(error));
+    if(w >= 100)
+      r.maxRelative = fmax(r.maxRelative, fabs(error) / w);
+    sum2 += error * error;
+    n++;
+  }
+  r.rmsError = sqrt(sum2 / n);
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "compiled", "linear", "quadratic" };
+  int j;
+
+  results = (calResult*)simShared(RUNS * sizeof(calResult));
+  for(j = 0; j < RUNS; j++)
+    CHECK(simSpawn(runCalibration, (void*)(long)j) == 0);
+
+  printf("%-10s %12s %12s %14s\n", "", "max err gr", "rms err gr", "max err gr/gr");
+  for(j = 0; j < RUNS; j++)
+    printf("%-10s %12.2f %12.2f %14.5f\n", names[j], results[j].maxError, results[j].rmsError,
+           results[j].maxRelative);
+
+  CHECK(results[LINEAR].maxError < results[COMPILED].maxError / 2);
+  CHECK(results[QUADRATIC].maxError < results[LINEAR].maxError / 4);
+  // The noise of the readings and the resolution remain
+  CHECK(results[QUADRATIC].maxError < 2);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,109 @@
+/**
+ *  \file bench_channels.cpp
+ *  \brief Latencies of every spool channel with the channels of the
+ *  firmware variant running a job
+ *
+ *  Every channel runs a job in automatic mode. For every channel the
+ *  benchmark measures the time from a conversion ready to its read (the
+ *  sampling), the conversions lost, the tension of the regulated
+ *  filament and the time from the end of a command addressed to the
+ *  channel to the first character of its answer. Built with one, two
+ *  and six channels: the latencies must not grow with the channels.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+#include "filament.h"
+#include "channels.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Seconds of job measured
+#define BENCH_SECONDS 60
+//! Commands timed for every channel
+#define BENCH_COMMANDS 20
+//! us to send a character at 38400 baud
+#define BYTE_TIME 260
+
+//! Time of the first answer character, 0 while waiting
+static unsigned long long answerTime;
+
+static void tapAnswer(uint8_t c, unsigned long long us) {
+  if(answerTime == 0)
+    answerTime = us - BYTE_TIME;
+}
+
+//! Mean and max ms from the end of a command to its answer
+static void commandLatency(int ch, double& mean, double& maxLatency) {
+  std::string line = channelCommand(ch, "weight") + "\n";
+  unsigned long long end;
+  double latency, sum = 0;
+  int j;
+
+  maxLatency = 0;
+  simSerialTap = tapAnswer;
+  for(j = 0; j < BENCH_COMMANDS; j++) {
+    // Commands at different phases of the tasks
+    simRun(97);
+    answerTime = 0;
+    end = simNow + line.size() * BYTE_TIME;
+    simSerialInput(line.c_str());
+    simRun(100);
+    latency = (answerTime - end) / 1000.0;
+    sum += latency;
+    maxLatency = fmax(maxLatency, latency);
+  }
+  simSerialTap = NULL;
+  mean = sum / BENCH_COMMANDS;
+}
+
+int main() {
+  double mean, maxCommand, worstCommand = 0, worstSample = 0, sampleMax, rms;
+  unsigned long lost = 0;
+  int ch;
+
+  simBoot();
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++) {
+    startJob(ch);
+    simCommand(channelCommand(ch, "auto").c_str());
+    world.setRate(ch, 0.03 / SIM_GR1CM);
+  }
+  simRun(5000);
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++) {
+    world.clearStats(ch);
+    world.hx711[ch].latencyMax = 0;
+    world.hx711[ch].lost = 0;
+  }
+  simRun(BENCH_SECONDS * 1000);
+
+  printf("%d channels\n", SPOOL_CHANNELS);
+  printf("%-4s %14s %6s %12s %12s %12s\n", "ch", "sample max ms", "lost", "tension gr",
+         "command ms", "max ms");
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++) {
+    world.integrate(simNow);
+    sampleMax = world.hx711[ch].latencyMax / 1000.0;
+    rms = sqrt(world.spool[ch].tension2Sum / world.spool[ch].time);
+    commandLatency(ch, mean, maxCommand);
+    printf("%-4d %14.2f %6lu %12.2f %12.2f %12.2f\n", ch, sampleMax, world.hx711[ch].lost,
+           rms, mean, maxCommand);
+    lost += world.hx711[ch].lost;
+    worstSample = fmax(worstSample, sampleMax);
+    worstCommand = fmax(worstCommand, maxCommand);
+  }
+  printf("worst: sample %.2f ms, command %.2f ms\n", worstSample, worstCommand);
+
+  CHECK(lost == 0);
+  // A conversion is read at the next sensor task, an answer starts
+  // at the next receive task
+  CHECK(worstSample < TASK_SENSOR_PERIOD + 1);
+  CHECK(worstCommand < TASK_RX_PERIOD + 2);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,134 @@
+/**
+ *  \file bench_diagnostics.cpp
+ *  \brief SPI frames and ramp timing of an extruder feed, with the
+ *  diagnostics service and with the diagnosis read at every ramp step
+ *  of the first release
+ *
+ *  The feed runs on a fresh board in manual mode with the feed command,
+ *  and with the blocking call of the first release (legacymotor.h). It
+ *  runs again with an open load reported by the driver for the first
+ *  second, as at the start of a motor: the first release showed and
+ *  cleared it at every step. The frames are counted by the driver model
+ *  for the whole motion, with the diagnosis polled by the service. The
+ *  ramp timing comes from the log of the duty cycle writes: the interval
+ *  between two steps, its deviation from the nominal step (jitter) and
+ *  the time to reach the regime duty cycle.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "motor.h"
+#include "diagnostics.h"
+#include "scenario.h"
+#include "check.h"
+#include "legacymotor.h"
+
+//! ms the feed command is observed, the feed lasts about 2.2 s
+#define FEED_TIME 2500
+//! Intervals longer than this are not ramp steps (us)
+#define STEP_MAX 100000
+
+//! The runs
+enum { ENGINE, LEGACY, ENGINE_OPEN, LEGACY_OPEN, RUNS };
+
+//! Results of a run
+struct feedResult {
+  unsigned long frames;     ///< SPI frames
+  unsigned long diagReads;  ///< Reads of the system diagnosis
+  unsigned long steps;      ///< Duty cycle writes of the ramps
+  double interval;          ///< Mean interval between two steps (ms)
+  double jitter;            ///< Max deviation from the nominal interval (ms)
+  double accelerate;        ///< Time to the regime duty cycle (ms)
+};
+
+static feedResult* results;
+
+//! Ramp statistics from the log of the duty cycle writes
+static void rampTiming(feedResult& r, double nominal) {
+  unsigned long long last = 0, start = 0, interval;
+  double sum = 0;
+  unsigned long j;
+  int duty = 0;
+
+  for(j = 0; j < tle94112.logged; j++) {
+    const tleWrite& w = tle94112.log[j];
+
+    if(w.reg != TLE_REG_PWM1_DC)
+      continue;
+    if(start == 0)
+      start = w.time;
+    if( (r.accelerate == 0) && (w.value >= DC_MAX_EXTRUDER) )
+      r.accelerate = (w.time - start) / 1000.0;
+    interval = w.time - last;
+    if( (last != 0) && (w.value != duty) && (interval < STEP_MAX) ) {
+      r.steps++;
+      sum += interval;
+      r.jitter = fmax(r.jitter, fabs(interval / 1000.0 - nominal));
+    }
+    last = w.time;
+    duty = w.value;
+  }
+  r.interval = (r.steps > 0) ? sum / r.steps / 1000.0 : 0;
+}
+
+//! Run a feed
+static int runFeed(void* arg) {
+  int run = (int)(long)arg;
+  feedResult& r = results[run];
+  LegacyMotorControl motor;
+
+  simBoot();
+  startJob();
+  simCommand("man");
+  tle94112.log = new tleWrite[TLE_LOG_SIZE];
+  tle94112.clearCounters();
+  if( (run == ENGINE_OPEN) || (run == LEGACY_OPEN) )
+    tle94112.inject(Tle94112::TLE_LOAD_ERROR, 1000000);
+
+  if( (run == ENGINE) || (run == ENGINE_OPEN) ) {
+    simSerialInput("feed\n");
+    simRun(FEED_TIME);
+  }
+  else {
+    motor.feedExtruder(FEED_EXTRUDER_DELAY);
+  }
+  r.frames = tle94112.frames;
+  r.diagReads = tle94112.reads[TLE_REG_SYS_DIAG];
+  rampTiming(r, ( (run == ENGINE) || (run == ENGINE_OPEN) ) ? RAMP_UPDATE_PERIOD :
+                ACCELERATION_DELAY);
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "engine", "first release", "engine, open", "first rel., open" };
+  int j;
+
+  results = (feedResult*)simShared(RUNS * sizeof(feedResult));
+  for(j = 0; j < RUNS; j++)
+    CHECK(simSpawn(runFeed, (void*)(long)j) == 0);
+
+  printf("%-17s %8s %10s %7s %12s %10s %14s\n", "", "frames", "diag reads", "steps",
+         "interval ms", "jitter ms", "accelerate ms");
+  for(j = 0; j < RUNS; j++) {
+    const feedResult& r = results[j];
+
+    printf("%-17s %8lu %10lu %7lu %12.2f %10.2f %14.1f\n", names[j], r.frames, r.diagReads,
+           r.steps, r.interval, r.jitter, r.accelerate);
+  }
+
+  // The diagnosis is read at the poll rate, not at every step
+  for(j = ENGINE; j < RUNS; j += 2) {
+    CHECK(results[j].diagReads <= FEED_TIME / DIAG_POLL_PERIOD + 2);
+    CHECK(results[j].frames * 3 < results[j + 1].frames);
+    // The steps are not delayed by the driver
+    CHECK(results[j].jitter < 1);
+  }
+  return CHECK_RESULT();
+}
@@ -0,0 +1,127 @@
+/**
+ *  \file bench_dispatch.cpp
+ *  \brief Host time to find a command in the commands table, and the
+ *  help listing built from the table
+ *
+ *  The names come from the help command, which lists the table: they
+ *  must be sorted for the binary search of findCommand() and every one
+ *  must find its own entry with the same description. Every name is
+ *  then searched with findCommand() and with a chain of comparisons in
+ *  the table order, as the first firmware compared the command with
+ *  every literal until the match. The unknown commands pay the whole
+ *  chain.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <vector>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "commands.h"
+#include "check.h"
+
+//! Searches timed for every name
+#define BENCH_LOOKUPS 1000000L
+
+//! Search of the firmware (sketch)
+const command* findCommand(const char* name);
+
+//! Names of the help listing
+static std::vector<std::string> names;
+
+//! Linear search in the table order
+static int chainSearch(const char* name) {
+  size_t j;
+
+  for(j = 0; j < names.size(); j++)
+    if(strcmp(name, names[j].c_str()) == 0)
+      return j;
+  return -1;
+}
+
+//! ns of a search
+static double timeSearch(const char* name, bool chain) {
+  struct timespec start, end;
+  long j;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(j = 0; j < BENCH_LOOKUPS; j++) {
+    if(chain) {
+      int found = chainSearch(name);
+      __asm__ volatile("" : : "g"(found));
+    }
+    else {
+      const command* found = findCommand(name);
+      __asm__ volatile("" : : "g"(found));
+    }
+    // The name can change, the search is repeated
+    __asm__ volatile("" : "+r"(name));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_LOOKUPS;
+}
+
+int main() {
+  std::vector<std::string> descriptions;
+  std::string help, line;
+  size_t pos, end, tab;
+  double table, chain, maxTable = 0, maxChain = 0, sumTable = 0, sumChain = 0;
+  const command* cmd;
+  size_t j;
+
+  simBoot();
+  simRun(1000);
+  help = simCommand("help");
+
+  // The help lines of the commands are "<name>\t<description>"
+  for(pos = 0; (end = help.find('\n', pos)) != std::string::npos; pos = end + 1) {
+    line = help.substr(pos, end - pos);
+    if( (line.size() > 0) && (line.back() == '\r') )
+      line.pop_back();
+    tab = line.find('\t');
+    if(tab == std::string::npos)
+      continue;
+    names.push_back(line.substr(0, tab));
+    descriptions.push_back(line.substr(tab + 1));
+  }
+  printf("%lu commands\n", (unsigned long)names.size());
+  CHECK(names.size() > 20);
+
+  for(j = 0; j < names.size(); j++) {
+    if(j > 0)
+      CHECK(strcmp(names[j - 1].c_str(), names[j].c_str()) < 0);
+    cmd = findCommand(names[j].c_str());
+    CHECK(cmd != NULL);
+    if(cmd != NULL) {
+      CHECK(names[j] == cmd->name);
+      CHECK(descriptions[j] == cmd->help);
+    }
+  }
+  CHECK(findCommand("nothing") == NULL);
+  CHECK(findCommand("") == NULL);
+
+  printf("%-12s %10s %10s\n", "", "table ns", "chain ns");
+  names.push_back("nothing");
+  for(j = 0; j < names.size(); j++) {
+    table = timeSearch(names[j].c_str(), false);
+    chain = timeSearch(names[j].c_str(), true);
+    printf("%-12s %10.1f %10.1f\n", names[j].c_str(), table, chain);
+    sumTable += table;
+    sumChain += chain;
+    maxTable = max(maxTable, table);
+    maxChain = max(maxChain, chain);
+  }
+  printf("%-12s %10.1f %10.1f\n", "mean", sumTable / names.size(), sumChain / names.size());
+  printf("%-12s %10.1f %10.1f\n", "max", maxTable, maxChain);
+
+  // Some comparisons instead of one for every command. The longest
+  // search is shown only, a single time is spoiled by the machine load
+  CHECK(sumTable < sumChain);
+  return CHECK_RESULT();
+}
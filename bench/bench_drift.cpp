@@ -0,0 +1,97 @@
+/**
+ *  \file bench_drift.cpp
+ *  \brief Weight and consumption errors with the load cell zero
+ *  drifting for hours, with and without the drift tracker
+ *
+ *  A full spool is loaded and waits BENCH_IDLE hours for the job, then
+ *  the job runs in automatic mode for BENCH_JOB hours. The HX711 zero
+ *  drifts at BENCH_DRIFT_RATE from the spool mount, as the load cell
+ *  creeps under the new load. While the spool waits the net weight of
+ *  the status line (mstat) is compared with the filament on the spool;
+ *  while the job runs the consumption is compared with the filament
+ *  taken from the spool. The drift learned before the job is
+ *  extrapolated while it runs, as the readings are not quiescent.\n
+ *  Built with the firmware as released and with the nodrift variant,
+ *  where the drift tracker makes no correction (DRIFT_MAX_RATE 0).
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "drifttracker.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Zero drift of the load cell (gr/h)
+#define BENCH_DRIFT_RATE 3.0
+//! Hours the loaded spool waits for the job
+#define BENCH_IDLE 2
+//! Hours of the job
+#define BENCH_JOB 1
+//! Minutes between two results
+#define BENCH_STEP 20
+//! Consumption of the job (gr/s)
+#define BENCH_RATE 0.02
+
+int main() {
+  const SimDispenser& d = world.spool[0];
+  double start, value, error, idleError = 0, jobError = 0;
+  int minutes;
+
+  simBoot();
+  simRun(500);
+  world.mount(0);
+  world.hx711[0].drift = -BENCH_DRIFT_RATE * simNow / 3.6e9;
+  world.hx711[0].driftRate = BENCH_DRIFT_RATE;
+  simRun(2000);
+  simCommand("load", 1500);
+  simCommand("mstat 1000");
+  // 1 ms loop passes, the runs are long
+  simLoopCost = 1000;
+
+  printf("%6s %8s %10s %10s %10s\n", "min", "", "value gr", "error gr", "drift gr");
+  for(minutes = BENCH_STEP; minutes <= BENCH_IDLE * 60; minutes += BENCH_STEP) {
+    simOutput.clear();
+    simRun(BENCH_STEP * 60000UL);
+    world.integrate(simNow);
+    value = statField(simOutput, 0, "net");
+    error = value - d.filament;
+    printf("%6d %8s %10.2f %10.2f %10.2f\n", minutes, "net", value, error,
+           statField(simOutput, 0, "drift"));
+    idleError = fmax(idleError, fabs(error));
+  }
+
+  simCommand("run", 500);
+  simCommand("auto");
+  world.integrate(simNow);
+  start = d.filament;
+  world.setRate(0, BENCH_RATE / SIM_GR1CM);
+  for(; minutes <= (BENCH_IDLE + BENCH_JOB) * 60; minutes += BENCH_STEP) {
+    simOutput.clear();
+    simRun(BENCH_STEP * 60000UL);
+    world.integrate(simNow);
+    value = statField(simOutput, 0, "used");
+    error = value - (start - d.filament);
+    printf("%6d %8s %10.2f %10.2f %10.2f\n", minutes, "used", value, error,
+           statField(simOutput, 0, "drift"));
+    jobError = fmax(jobError, fabs(error));
+  }
+  printf("max error: waiting %.2f gr (drift %.1f gr), job %.2f gr (drift %.1f gr)\n",
+         idleError, BENCH_DRIFT_RATE * BENCH_IDLE, jobError, BENCH_DRIFT_RATE * BENCH_JOB);
+
+#if DRIFT_MAX_RATE > 0
+  CHECK(idleError < 1);
+  CHECK(jobError < 0.75 * BENCH_DRIFT_RATE * BENCH_JOB);
+#else
+  // The errors are the drift
+  CHECK(idleError > 0.75 * BENCH_DRIFT_RATE * BENCH_IDLE);
+  CHECK(jobError > 0.75 * BENCH_DRIFT_RATE * BENCH_JOB);
+#endif
+  return CHECK_RESULT();
+}
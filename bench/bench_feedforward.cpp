@@ -0,0 +1,179 @@
+/**
+ *  \file bench_feedforward.cpp
+ *  \brief Extruder tension events per printed metre, with and without
+ *  the consumption rate as feed-forward of the regulator
+ *
+ *  The job of bench_tension runs in automatic mode with the rates as
+ *  they are, halved and at three quarters; then the regulator is
+ *  restarted RESTARTS times (manual mode for a second with the printer
+ *  paused, automatic mode for a minute with the extruder pulling at a
+ *  slow constant rate). A
+ *  tension event is a pull of the extruder over twice the tension
+ *  setpoint, counted until the tension is halved. Built with the
+ *  firmware as released and with the nofeedforward variant, where the
+ *  regulator has no feed-forward and its integral has to find the feed
+ *  rate. The benchmark with feed-forward runs the other one, given as
+ *  its argument, and checks that it has less events.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "filament.h"
+#include "motor.h"
+#include "scenario.h"
+#include "check.h"
+
+//! The print job: consumption changes and pauses
+static const jobSegment job[] = {
+  { 60, 0.02 }, { 20, 0 }, { 60, 0.05 }, { 60, 0.01 }, { 30, 0.08 },
+  { 20, 0 }, { 90, 0.03 }, { 30, 0.1 }, { 60, 0.02 }, { 10, 0 }
+};
+
+//! Rates of the runs, as factors of the job rates
+static const double scales[] = { 1, 0.5, 0.75 };
+//! Runs of the job
+#define RUNS (sizeof(scales) / sizeof(scales[0]))
+#ifdef _FEED_FORWARD
+#define FEED_FORWARD_NAME "with"
+#else
+#define FEED_FORWARD_NAME "without"
+#endif
+
+//! Restarts of the regulator after the job
+#define RESTARTS 10
+//! Consumption while the regulator restarts (gr/s)
+#define RESTART_RATE 0.05
+
+//! Events and filament of a part of a run
+struct feedResult {
+  unsigned long events;
+  double metres;
+};
+
+//! Job and restarts of every run
+static feedResult* results;
+
+//! Results since the previous part
+static void partResult(feedResult& r, unsigned long& events, double& consumed) {
+  const SimDispenser& d = world.spool[0];
+
+  world.integrate(simNow);
+  r.events = d.pulls - events;
+  r.metres = (d.consumed - consumed) / 100;
+  events = d.pulls;
+  consumed = d.consumed;
+}
+
+//! Run the job with the rates scaled, then restart the regulator
+static int runJob(void* arg) {
+  feedResult* r = results + 2 * (long)arg;
+  double scale = scales[(long)arg];
+  unsigned long events = 0;
+  double consumed = 0;
+  unsigned int j;
+
+  simBoot();
+  startJob();
+  simCommand("auto");
+  world.clearStats(0);
+  world.spool[0].pullLevel = 2 * TENSION_SETPOINT;
+
+  for(j = 0; j < sizeof(job) / sizeof(job[0]); j++) {
+    world.setRate(0, scale * job[j].rate / SIM_GR1CM);
+    simRun(job[j].seconds * 1000);
+  }
+  partResult(r[0], events, consumed);
+
+  // The printer pauses while the dispenser is in manual mode, the
+  // automatic mode starts the regulator again with the consumption rate
+  // estimated as the printer resumes
+  for(j = 0; j < RESTARTS; j++) {
+    world.integrate(simNow);
+    world.setRate(0, 0);
+    simCommand("man", 1000);
+    world.integrate(simNow);
+    world.setRate(0, scale * RESTART_RATE / SIM_GR1CM);
+    simCommand("auto", 59000);
+  }
+  partResult(r[1], events, consumed);
+  return 0;
+}
+
+/**
+ * Run the benchmark built without feed-forward and read its totals
+ *
+ * \param path the benchmark
+ * \param events the events of the job and of the restarts
+ * \param metres the filament of the job and of the restarts
+ * \return false if the totals have not been read
+ */
+static bool readReference(const char* path, unsigned long* events, double* metres) {
+  char line[256], part[16];
+  unsigned long count;
+  double length;
+  int found = 0, k;
+  FILE* output;
+
+  output = popen(path, "r");
+  if(output == NULL)
+    return false;
+  while(fgets(line, sizeof(line), output) != NULL) {
+    if(sscanf(line, "all %15s %lu %lf", part, &count, &length) != 3)
+      continue;
+    k = (strcmp(part, "job") == 0) ? 0 : 1;
+    events[k] = count;
+    metres[k] = length;
+    found++;
+  }
+  pclose(output);
+  return found == 2;
+}
+
+int main(int argc, char* argv[]) {
+  const char* parts[] = { "job", "restarts" };
+  unsigned long events[2] = { 0, 0 }, refEvents[2];
+  double metres[2] = { 0, 0 }, refMetres[2];
+  long j;
+  int k;
+
+  results = (feedResult*)simShared(2 * RUNS * sizeof(feedResult));
+  for(j = 0; j < (long)RUNS; j++)
+    CHECK(simSpawn(runJob, (void*)j) == 0);
+
+  printf("%s feed-forward\n", FEED_FORWARD_NAME);
+  printf("%-6s %-9s %8s %8s %10s\n", "rates", "", "events", "metres", "events/m");
+  for(j = 0; j < (long)RUNS; j++) {
+    for(k = 0; k < 2; k++) {
+      const feedResult& r = results[2 * j + k];
+
+      printf("x%-5.2f %-9s %8lu %8.2f %10.2f\n", scales[j], parts[k], r.events, r.metres,
+             r.events / r.metres);
+      events[k] += r.events;
+      metres[k] += r.metres;
+    }
+  }
+  for(k = 0; k < 2; k++) {
+    printf("%-6s %-9s %8lu %8.2f %10.2f\n", "all", parts[k], events[k], metres[k],
+           events[k] / metres[k]);
+    CHECK(metres[k] > 0);
+  }
+
+  // The reference without feed-forward, given as the argument
+  if(argc > 1) {
+    CHECK(readReference(argv[1], refEvents, refMetres));
+    printf("without feed-forward: job %.2f events/m, restarts %.2f events/m\n",
+           refEvents[0] / refMetres[0], refEvents[1] / refMetres[1]);
+    // The same filament is printed. The estimated rate restarts the
+    // motor as the printer resumes
+    CHECK( (fabs(refMetres[0] - metres[0]) < 0.01) && (fabs(refMetres[1] - metres[1]) < 0.01) );
+    CHECK(events[0] + events[1] < refEvents[0] + refEvents[1]);
+  }
+  return CHECK_RESULT();
+}
@@ -0,0 +1,190 @@
+/**
+ *  \file bench_filter.cpp
+ *  \brief Noise and delay of the filter stages of the readings
+ *
+ *  Synthetic raw samples with the noise of the simulated HX711 are
+ *  filtered by WeightFilter with the stages of every status and, as a
+ *  reference, averaged in blocks of SCALE_SAMPLES as the previous
+ *  firmware did. A reading is taken every SCALE_SAMPLES samples:
+ *  - noise: standard deviation of the readings with a constant weight;
+ *  - delay: time from a 50 gr step (an extruder pull) to the first
+ *    reading past 90% of the step;
+ *  - spike: max error of the readings after a single 100 gr sample (a
+ *    bump on the scale or a bit error on the HX711 line);
+ *  - cost: host ns for every sample, for comparison only.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include <chrono>
+#include "sim.h"
+#include "filament.h"
+#include "weightfilter.h"
+#include "check.h"
+
+//! Readings of the noise measure
+#define BENCH_READINGS 5000
+//! Steps of the delay measure
+#define BENCH_STEPS 200
+//! Step weight (gr)
+#define BENCH_STEP 50.0
+//! Spike weight (gr)
+#define BENCH_SPIKE 100.0
+//! Block average of the previous firmware
+#define STAGES_BLOCK -1
+
+//! Results of a set of stages
+struct filterResult {
+  double noise;   ///< Readings standard deviation (gr)
+  double delay;   ///< Average step delay (ms)
+  double spike;   ///< Max error after a spike (gr)
+  double cost;    ///< Host ns for every sample
+};
+
+//! Noise generator state
+static uint32_t rng = 0x9E3779B9u;
+
+//! Raw sample of a weight with the HX711 noise
+static long sample(double grams) {
+  double u, v;
+
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  u = (rng + 1.0) / 4294967297.0;
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  v = (rng + 1.0) / 4294967297.0;
+  grams += SIM_HX711_NOISE * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+  return SIM_HX711_OFFSET - (long)floor(SIM_HX711_CALIBRATION * grams + 0.5);
+}
+
+/**
+ * Stream of samples filtered by a set of stages, a reading every
+ * SCALE_SAMPLES samples
+ */
+struct filterStream {
+  WeightFilter filter;  ///< The filter
+  int stages;           ///< The filter stages or STAGES_BLOCK
+  long sum;             ///< Sum of the block samples
+  int count;            ///< Samples of the reading
+  double value;         ///< Last reading (gr)
+};
+
+/**
+ * Add a sample of a weight to a stream
+ *
+ * \param s the stream
+ * \param grams the weight
+ * \return true if a new reading is available
+ */
+static bool push(filterStream& s, double grams) {
+  long raw = sample(grams);
+
+  if(s.stages == STAGES_BLOCK)
+    s.sum += raw;
+  else
+    s.filter.update(raw);
+  if(++s.count < SCALE_SAMPLES)
+    return false;
+
+  if(s.stages == STAGES_BLOCK)
+    s.value = (SIM_HX711_OFFSET - (double)s.sum / SCALE_SAMPLES) / SIM_HX711_CALIBRATION;
+  else
+    s.value = (SIM_HX711_OFFSET - s.filter.value) / SIM_HX711_CALIBRATION;
+  s.sum = 0;
+  s.count = 0;
+  return true;
+}
+
+//! Measure a set of stages
+static filterResult measure(int stages) {
+  filterStream s;
+  filterResult result;
+  double sum = 0, sum2 = 0, weight = 1000;
+  long delays = 0;
+  int j, k, n = 0;
+
+  s.stages = stages;
+  s.sum = 0;
+  s.count = 0;
+  s.filter.begin((stages == STAGES_BLOCK) ? FILTER_NONE : stages,
+                 (long)(MAX_DELTA_WEIGHT_IN_RANGE * SIM_HX711_CALIBRATION));
+
+  auto start = std::chrono::steady_clock::now();
+  while(n < BENCH_READINGS) {
+    if(push(s, weight)) {
+      sum += s.value;
+      sum2 += s.value * s.value;
+      n++;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  result.noise = sqrt(sum2 / n - (sum / n) * (sum / n));
+  result.cost = std::chrono::duration<double, std::nano>(end - start).count() /
+                (BENCH_READINGS * SCALE_SAMPLES);
+
+  // The steps start at every phase of the readings
+  for(j = 0; j < BENCH_STEPS; j++) {
+    for(k = 0; k < 40 + j % SCALE_SAMPLES; k++)
+      push(s, weight);
+    for(k = 1; k < 100; k++) {
+      if(push(s, weight - BENCH_STEP) && (s.value < weight - 0.9 * BENCH_STEP))
+        break;
+    }
+    delays += k;
+    for(k = 0; k < 100; k++)
+      push(s, weight - BENCH_STEP);
+    for(k = 0; k < 100; k++)
+      push(s, weight);
+  }
+  result.delay = 1000.0 * delays / BENCH_STEPS / SIM_HX711_SPS;
+
+  // A single sample off at every phase of the readings
+  result.spike = 0;
+  for(j = 0; j < SCALE_SAMPLES; j++) {
+    for(k = 0; k < 100 + j; k++)
+      push(s, weight);
+    push(s, weight + BENCH_SPIKE);
+    for(k = 0; k < 50; k++) {
+      if(push(s, weight))
+        result.spike = max(result.spike, fabs(s.value - weight));
+    }
+  }
+  return result;
+}
+
+int main() {
+  static const struct { const char* name; int stages; } sets[] = {
+    { "block average", STAGES_BLOCK },
+    { "default", FILTER_STAGES_DEFAULT },
+    { "load", FILTER_STAGES_LOAD },
+    { "run", FILTER_STAGES_RUN },
+    { "median", FILTER_MEDIAN },
+  };
+  filterResult result[5];
+  int j;
+
+  printf("%-16s %9s %9s %9s %9s\n", "stages", "noise gr", "delay ms", "spike gr", "ns/smp");
+  for(j = 0; j < 5; j++) {
+    result[j] = measure(sets[j].stages);
+    printf("%-16s %9.3f %9.1f %9.2f %9.1f\n", sets[j].name, result[j].noise, result[j].delay,
+           result[j].spike, result[j].cost);
+  }
+
+  // While running the EMA removes part of the noise left by the median,
+  // the pulls are shown faster than with the block average and the
+  // spikes are still rejected
+  CHECK(result[3].noise < result[4].noise * 0.85);
+  CHECK(result[3].delay < result[0].delay);
+  CHECK(result[3].spike < result[0].spike / 4);
+
+  return CHECK_RESULT();
+}
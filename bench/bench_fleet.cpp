@@ -0,0 +1,421 @@
+/**
+ *  \file bench_fleet.cpp
+ *  \brief Load test of the fleet monitor with hundreds of simulated
+ *  dispensers on pseudo terminals
+ *
+ *  A board running a job in auto mode is forked in BENCH_DEVICES
+ *  processes, every one a dispenser with its own consumption rate on a
+ *  pseudo terminal. A device runs the firmware in real time: every
+ *  BENCH_STEP ms of virtual time its serial output is written to the
+ *  terminal and the characters received are sent to the board, then it
+ *  waits until the wall clock reaches the virtual time. The time of the
+ *  write of every status line of channel 0 is kept in shared memory. A
+ *  driver fault is injected in BENCH_FAULTY devices half way. The
+ *  devices run at a lower priority: the real ones do not share the
+ *  processor of the monitor.\n
+ *  The monitor (fleetmonitor.h) runs in its own process on the slave
+ *  side of the terminals, as on the real serial ports. The bench reads
+ *  the snapshot while the devices stream: the end-to-end latency of an
+ *  update is the time from the write of the status line to the update
+ *  of the snapshot by the monitor. At the end the query socket is read
+ *  and the monitor is stopped; its processor time divided by the
+ *  devices is the cost of a device.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "sim.h"
+#include "TLE94112.h"
+#include "scenario.h"
+#include "check.h"
+#include "fleetmonitor.h"
+
+//! Simulated dispensers
+#define BENCH_DEVICES 200
+//! ms of the status lines requested by the monitor
+#define BENCH_PERIOD 200
+//! s the devices stream while the snapshot is read
+#define BENCH_SECONDS 10
+//! ms of virtual time a device runs before writing its output
+#define BENCH_STEP 10
+//! Priority of the simulated devices below the monitor and the bench
+#define BENCH_NICE 10
+//! Devices with a driver fault
+#define BENCH_FAULTY 20
+//! Status lines of a device whose write time is kept
+#define BENCH_SENT 64
+//! ms between two reads of the snapshot
+#define BENCH_SCAN 5
+//! s the monitor has to create its snapshot
+#define BENCH_OPEN_TIME 5
+
+//! A status line written to the terminal
+struct sentLine {
+  uint32_t t;             ///< millis() of the board in the line
+  uint64_t sent;          ///< fleetNow() of the write
+};
+
+//! A device, shared with the bench
+struct benchDevice {
+  uint32_t head;          ///< Status lines written
+  sentLine ring[BENCH_SENT];  ///< The last ones
+  uint32_t dropped;       ///< Bytes not written, the terminal was full
+  uint32_t faults;        ///< Faults injected
+  uint32_t late;          ///< Steps ended after their wall clock time
+  double cpu;             ///< Processor time (s)
+};
+
+static benchDevice* devices;
+//! The snapshot and the query socket of the monitor, of this run
+static std::string snapshotName, socketPath;
+
+//! Elapsed processor time of a resource usage (s)
+static double cpuTime(const struct rusage& usage) {
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec +
+         usage.ru_stime.tv_usec / 1e6;
+}
+
+//! Wait until a CLOCK_MONOTONIC time (ns)
+static void waitUntil(unsigned long long ns) {
+  struct timespec until;
+
+  until.tv_sec = ns / 1000000000ULL;
+  until.tv_nsec = ns % 1000000000ULL;
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+    ;
+}
+
+/**
+ * Run a dispenser on the master side of a terminal
+ *
+ * \param j the device
+ * \param master the terminal
+ * \param end fleetNow() when the device stops
+ * \param fault fleetNow() of the fault injected, 0 for none
+ */
+static void runDevice(int j, int master, unsigned long long end, unsigned long long fault) {
+  benchDevice& b = devices[j];
+  unsigned long long start = fleetNow(), origin = simNow, now;
+  struct rusage usage;
+  const char* line;
+  char input[256];
+  ssize_t written, count;
+  bool streaming = false;
+
+  // Every device its own consumption, 0.02 ... 0.1 gr/s
+  world.integrate(simNow);
+  world.setRate(0, (0.02 + 0.08 * j / BENCH_DEVICES) / SIM_GR1CM);
+
+  while( (now = fleetNow()) < end ) {
+    if( (fault != 0) && (now >= fault) ) {
+      tle94112.inject(Tle94112::TLE_TEMP_WARNING);
+      b.faults++;
+      fault = 0;
+    }
+    simOutput.clear();
+    simRun(BENCH_STEP);
+
+    now = fleetNow();
+    for(line = strstr(simOutput.c_str(), "@stat ch=0 t="); line != NULL;
+        line = strstr(line + 1, "@stat ch=0 t=")) {
+      sentLine& s = b.ring[b.head % BENCH_SENT];
+
+      s.t = strtoul(line + 13, NULL, 10);
+      s.sent = now;
+      __atomic_store_n(&b.head, b.head + 1, __ATOMIC_RELEASE);
+    }
+    written = write(master, simOutput.data(), simOutput.size());
+    // The bytes lost before the monitor opens the port are not counted
+    if(streaming && (written < (ssize_t)simOutput.size()))
+      b.dropped += simOutput.size() - ((written > 0) ? written : 0);
+
+    while( (count = read(master, input, sizeof(input) - 1)) > 0 ) {
+      input[count] = 0;
+      simSerialInput(input);
+      streaming = true;
+    }
+
+    now = start + (simNow - origin) * 1000;
+    if(fleetNow() > now)
+      b.late++;
+    else
+      waitUntil(now);
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  b.cpu = cpuTime(usage);
+}
+
+/**
+ * Create a pseudo terminal in raw mode
+ *
+ * \param path the slave side
+ * \param slave the slave side opened, so the device does not see a hangup
+ * \return the master side, -1 on error
+ */
+static int openTerminal(std::string& path, int& slave) {
+  struct termios options;
+  int master;
+
+  master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if( (master < 0) || (grantpt(master) < 0) || (unlockpt(master) < 0) )
+    return -1;
+  path = ptsname(master);
+  slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+  if( (slave < 0) || (tcgetattr(slave, &options) < 0) )
+    return -1;
+  // The output of the board must not be echoed back to it
+  cfmakeraw(&options);
+  tcsetattr(slave, TCSANOW, &options);
+  return master;
+}
+
+/**
+ * Send a command to the query socket
+ *
+ * \param command the command
+ * \return the answer
+ */
+static std::string query(const char* command) {
+  struct sockaddr_un address;
+  std::string line = std::string(command) + "\n", answer;
+  char data[4096];
+  ssize_t count;
+  int fd;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if( (fd < 0) || (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) )
+    return answer;
+  if(write(fd, line.data(), line.size()) == (ssize_t)line.size()) {
+    while( (answer.find("\n\n") == std::string::npos) &&
+           ((count = read(fd, data, sizeof(data))) > 0) )
+      answer.append(data, count);
+  }
+  close(fd);
+  return answer;
+}
+
+//! Percentile of sorted values
+static double percentile(const std::vector<double>& values, double p) {
+  if(values.empty())
+    return 0;
+  return values[(size_t)(p * (values.size() - 1))];
+}
+
+/**
+ * Stop the monitor and the devices when the bench can not go on
+ *
+ * \param daemon the monitor
+ * \param pids the devices
+ */
+static void stopAll(pid_t daemon, const std::vector<pid_t>& pids) {
+  kill(daemon, SIGKILL);
+  waitpid(daemon, NULL, 0);
+  for(pid_t p : pids)
+    kill(p, SIGKILL);
+  for(pid_t p : pids)
+    waitpid(p, NULL, 0);
+  shm_unlink(snapshotName.c_str());
+  unlink(socketPath.c_str());
+}
+
+int main() {
+  std::vector<std::string> paths(BENCH_DEVICES);
+  std::vector<double> latency;
+  std::vector<uint64_t> updated(BENCH_DEVICES, 0);
+  std::vector<pid_t> pids;
+  unsigned long long start, end, streaming = 0, now, daemonStart;
+  unsigned long long lines = 0, errors = 0, dropped = 0, late = 0, retries = 0, unmatched = 0;
+  unsigned long faultEvents = 0, faultyDevices = 0;
+  double deviceCpu = 0, daemonCpu, daemonTime, seconds;
+  FleetSnapshot snapshot;
+  fleetTotals totals;
+  fleetDevice d;
+  struct rusage usage;
+  std::string answer;
+  pid_t daemon, pid;
+  unsigned int count;
+  int j, k, master, slave, status;
+
+  // Names of this run, the benchmarks can run in parallel
+  snapshotName = "/bench_fleet_" + std::to_string(getpid());
+  socketPath = (getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp") + std::string("/bench_fleet_") +
+               std::to_string(getpid()) + ".sock";
+  devices = (benchDevice*)simShared(BENCH_DEVICES * sizeof(benchDevice));
+  simBoot();
+  startJob();
+  // The consumption is shown after the first feeds
+  simCommand("auto");
+  world.setRate(0, 0.05 / SIM_GR1CM);
+  simRun(60000);
+
+  // The devices, streaming until the end of the bench. A fault is
+  // injected in the first ones half way
+  start = fleetNow();
+  end = start + (BENCH_SECONDS + 3) * 1000000000ULL;
+  fflush(stdout);
+  for(j = 0; j < BENCH_DEVICES; j++) {
+    master = openTerminal(paths[j], slave);
+    CHECK(master >= 0);
+    if(master < 0) {
+      for(pid_t p : pids)
+        kill(p, SIGKILL);
+      return CHECK_RESULT();
+    }
+    pid = fork();
+    if(pid == 0) {
+      // The real devices do not take the processor of the monitor
+      if(nice(BENCH_NICE) < 0)
+        _exit(1);
+      runDevice(j, master, end, (j < BENCH_FAULTY) ?
+                start + (1 + BENCH_SECONDS / 2) * 1000000000ULL + j * 10000000ULL : 0);
+      _exit(0);
+    }
+    pids.push_back(pid);
+    close(master);
+    close(slave);
+  }
+
+  // The monitor
+  daemonStart = fleetNow();
+  daemon = fork();
+  if(daemon == 0) {
+    FleetMonitor monitor;
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    if(!monitor.begin(paths, BENCH_PERIOD, snapshotName.c_str(), socketPath.c_str()))
+      _exit(1);
+    // SIGTERM is read between two polls
+    while(sigpending(&signals) == 0) {
+      if(sigismember(&signals, SIGTERM))
+        break;
+      monitor.poll();
+    }
+    monitor.end();
+    _exit(0);
+  }
+  while(!snapshot.open(snapshotName.c_str()) &&
+        (fleetNow() < daemonStart + BENCH_OPEN_TIME * 1000000000ULL))
+    usleep(1000);
+  CHECK(snapshot.devices == BENCH_DEVICES);
+  if(snapshot.devices != BENCH_DEVICES) {
+    stopAll(daemon, pids);
+    return CHECK_RESULT();
+  }
+
+  // The updates of the snapshot while the devices stream
+  start = fleetNow() + 1000000000ULL;
+  while( (now = fleetNow()) < start + BENCH_SECONDS * 1000000000ULL ) {
+    for(j = 0; j < (int)snapshot.devices; j++) {
+      snapshot.read(j, d, &count);
+      retries += count;
+      if( (d.channel[0].updated == updated[j]) || (d.channel[0].state < 0) )
+        continue;
+      updated[j] = d.channel[0].updated;
+      if(now < start)
+        continue;
+      const benchDevice& b = devices[j];
+      uint32_t head = __atomic_load_n(&b.head, __ATOMIC_ACQUIRE);
+
+      for(k = 1; (k < BENCH_SENT) && (k <= (int)head); k++) {
+        if(b.ring[(head - k) % BENCH_SENT].t == d.channel[0].t)
+          break;
+      }
+      if( (k < BENCH_SENT) && (k <= (int)head) )
+        latency.push_back((d.channel[0].updated - b.ring[(head - k) % BENCH_SENT].sent) / 1e6);
+      else
+        unmatched++;
+    }
+    usleep(BENCH_SCAN * 1000);
+  }
+  seconds = (fleetNow() - start) / 1e9;
+
+  // The totals, the devices and the query socket before stopping
+  snapshot.read(totals);
+  for(j = 0; j < (int)snapshot.devices; j++) {
+    snapshot.read(j, d);
+    lines += d.lines;
+    errors += d.errors;
+    if(d.state == FLEET_DEVICE_STREAMING)
+      streaming++;
+    if( (j < BENCH_FAULTY) && (d.faultEvents == 1) )
+      faultyDevices++;
+    faultEvents += d.faultEvents;
+  }
+  answer = query("totals");
+  printf("totals: %s", answer.c_str());
+  CHECK_CONTAINS(answer, ("streaming=" + std::to_string(BENCH_DEVICES) + " ").c_str());
+  answer = query("device 0");
+  CHECK_CONTAINS(answer, "ch=0 t=");
+
+  kill(daemon, SIGTERM);
+  CHECK(wait4(daemon, &status, 0, &usage) == daemon);
+  CHECK(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+  daemonCpu = cpuTime(usage);
+  daemonTime = (fleetNow() - daemonStart) / 1e9;
+  for(pid_t p : pids)
+    waitpid(p, NULL, 0);
+  for(j = 0; j < BENCH_DEVICES; j++) {
+    deviceCpu += devices[j].cpu;
+    dropped += devices[j].dropped;
+    late += devices[j].late;
+  }
+
+  std::sort(latency.begin(), latency.end());
+  printf("%d devices, status every %d ms, %.1f s: %llu lines, %llu not valid, %lu fault events\n",
+         BENCH_DEVICES, BENCH_PERIOD, seconds, lines, errors, faultEvents);
+  printf("used %.2f gr, rate %.4f gr/s, lowest spool %.1f%%, %u devices with faults\n",
+         totals.used, totals.rate, totals.minPct, totals.faulty);
+  printf("monitor: %.3f s of processor in %.1f s, %.4f%% of a processor for each device\n",
+         daemonCpu, daemonTime, 100 * daemonCpu / daemonTime / BENCH_DEVICES);
+  printf("simulated devices: %.1f%% of a processor each, %llu late steps, %llu bytes dropped\n",
+         100 * deviceCpu / (BENCH_SECONDS + 3) / BENCH_DEVICES, late, dropped);
+  printf("update latency over %lu updates (%llu not matched, %llu read retries): "
+         "p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", (unsigned long)latency.size(), unmatched,
+         retries, percentile(latency, 0.5), percentile(latency, 0.99),
+         percentile(latency, 1));
+
+  // Every device streams, every line is valid, every fault is seen once
+  CHECK(streaming == BENCH_DEVICES);
+  CHECK(errors == 0);
+  CHECK(dropped == 0);
+  CHECK(faultyDevices == BENCH_FAULTY);
+  CHECK(faultEvents == BENCH_FAULTY);
+  CHECK(totals.running == BENCH_DEVICES);
+  CHECK( (totals.used > 0) && (totals.rate > 0) && (totals.minPct < 100) );
+  // The updates read are most of the status lines sent
+  CHECK(latency.size() > 0.9 * BENCH_DEVICES * BENCH_SECONDS * 1000 / BENCH_PERIOD);
+  CHECK(unmatched == 0);
+  // The devices share the processors with the monitor
+  CHECK(percentile(latency, 0.5) < 5);
+  CHECK(percentile(latency, 0.99) < 50);
+  // A device costs the monitor little of a processor
+  CHECK(daemonCpu / daemonTime / BENCH_DEVICES < 0.001);
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,74 @@
+/**
+ *  \file bench_gcode.cpp
+ *  \brief Parsing speed of the G-code analyzer on a large file
+ *
+ *  A job of BENCH_FILE_MB MB is written to a temporary file by the
+ *  generator of gcodejob.h, then the analyzer maps and parses it. The
+ *  file has just been written, so it is read from the page cache: the
+ *  speed is the parser one, not the disk one. The speed depends on the
+ *  host and its load, it is only shown; the filament of the analysis
+ *  must be the one written by the generator.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "gcodeanalyzer.h"
+#include "gcodejob.h"
+#include "check.h"
+
+//! Size of the file (MB)
+#define BENCH_FILE_MB 256
+
+int main() {
+  char path[] = "/tmp/bench_gcodeXXXXXX";
+  struct timespec start, end;
+  unsigned long long written = 0;
+  std::string text;
+  gcodeJob job;
+  GcodeAnalyzer analyzer;
+  double seconds, demand = 0;
+  FILE* file;
+  int fd;
+
+  fd = mkstemp(path);
+  CHECK(fd >= 0);
+  if(fd < 0)
+    return CHECK_RESULT();
+  file = fdopen(fd, "w");
+  while(written < BENCH_FILE_MB * 1000000ULL) {
+    text.clear();
+    gcodeLayer(text, job);
+    fwrite(text.data(), 1, text.size(), file);
+    written += text.size();
+  }
+  fclose(file);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  CHECK(analyzer.parseFile(path));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  unlink(path);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  for(double mg : analyzer.bins)
+    demand += mg;
+  printf("%.0f MB, %lu lines, %lu moves, %d layers, %.1f h of job\n", written / 1e6,
+         analyzer.lines, analyzer.moves, job.layer, analyzer.time / 3600);
+  printf("parsed in %.3f s: %.0f MB/s, %.1f M lines/s\n", seconds, written / seconds / 1e6,
+         analyzer.lines / seconds / 1e6);
+  printf("filament %.1f m, written %.1f m, %zu bins %.1f kg\n", analyzer.filament / 1000,
+         job.filament / 1000, analyzer.bins.size(), demand / 1e6);
+
+  CHECK(analyzer.bytes == written);
+  CHECK(fabs(analyzer.filament - job.filament) < job.filament * 1e-6);
+  CHECK(fabs(demand - analyzer.filament * analyzer.mgPerMm) < demand * 1e-6);
+  return CHECK_RESULT();
+}
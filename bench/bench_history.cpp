@@ -0,0 +1,171 @@
+/**
+ *  \file bench_history.cpp
+ *  \brief Compression and cost of the consumption history
+ *
+ *  - job: 30 minutes of a job in automatic mode, the scale is not read
+ *    for 20 s in the middle. The history command output is decoded by
+ *    tools/historydecoder.h: the samples should follow the consumption,
+ *    the gap should be skipped and the other samples should be one
+ *    period apart;
+ *  - ring: 6 hours of synthetic readings with a gap every 10 minutes
+ *    wrap the ring, the decoded samples should be the readings at their
+ *    timestamps;
+ *  - cost: host ns for every reading and bytes for every sample against
+ *    8 bytes of a timestamp and a weight.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include <chrono>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+#include "history.h"
+#include "historydecoder.h"
+
+//! Minutes of the job
+#define BENCH_MINUTES 30
+//! Seconds without readings
+#define BENCH_GAP 20
+//! Job consumption (gr/s)
+#define BENCH_RATE 0.03
+//! ms between two synthetic readings
+#define BENCH_READING 125
+//! Hours of synthetic readings
+#define BENCH_HOURS 6
+
+//! Decode the serial output
+static void decodeOutput(HistoryDecoder& history, const std::string& text) {
+  size_t start = 0, end;
+
+  history.clear();
+  while( (end = text.find('\n', start)) != std::string::npos ) {
+    history.line(text.substr(start, end - start - ((end > start) && (text[end - 1] == '\r'))).c_str());
+    start = end + 1;
+  }
+}
+
+//! Max interval between two samples, and the number of intervals longer than a period
+static unsigned long longestInterval(const HistoryDecoder& history, int& longer) {
+  unsigned long longest = 0, interval;
+  size_t j;
+
+  longer = 0;
+  for(j = 1; j < history.samples.size(); j++) {
+    interval = history.samples[j].timestamp - history.samples[j - 1].timestamp;
+    longest = max(longest, interval);
+    if(interval != HISTORY_PERIOD)
+      longer++;
+  }
+  return longest;
+}
+
+//! Synthetic net weight (mg) at a time (ms)
+static long syntheticWeight(unsigned long timestamp) {
+  return 800000 - (long)(timestamp * BENCH_RATE) + (long)(300 * sin(timestamp * 0.0137));
+}
+
+int main() {
+  const SimDispenser& d = world.spool[0];
+  ConsumptionHistory ring;
+  HistoryDecoder history;
+  unsigned long t, readings = 0, gapStart = 0;
+  double start, net, rate, error = 0;
+  int longer, s;
+  size_t j;
+
+  // The job on the simulated board
+  simBoot();
+  startJob();
+  simCommand("auto");
+  world.setRate(0, BENCH_RATE / SIM_GR1CM);
+  world.integrate(simNow);
+  start = d.filament;
+  for(s = 0; s < BENCH_MINUTES * 60; s++) {
+    if(s == BENCH_MINUTES * 30) {
+      world.integrate(simNow);
+      world.hx711[0].next = simNow + BENCH_GAP * 1000000ULL;
+      gapStart = millis();
+    }
+    simRun(1000);
+  }
+  world.integrate(simNow);
+  decodeOutput(history, simCommand("history", 5000));
+
+  rate = 0;
+  if(history.samples.size() > 1) {
+    const historySample& a = history.samples.front();
+    const historySample& b = history.samples.back();
+    rate = (a.weight - b.weight) / (double)(b.timestamp - a.timestamp);
+    net = b.weight / 1000.0;
+    error = net - d.filament;
+  }
+  printf("job: %zu samples, %lu periods skipped, longest interval %lu ms, %.2f bytes/sample\n",
+         history.samples.size(), history.skipped, longestInterval(history, longer),
+         (double)history.bytes / history.samples.size());
+  printf("consumption %.4f gr/s (extruder %.4f), last sample %+.1f gr from the roll\n",
+         rate, (start - d.filament) / (BENCH_MINUTES * 60), error);
+  CHECK(history.complete && !history.failed);
+  CHECK(history.samples.size() == history.declared);
+  CHECK_NEAR(history.skipped, BENCH_GAP, 1);
+  CHECK(longer == 1);
+  CHECK_NEAR(longestInterval(history, longer), BENCH_GAP * HISTORY_PERIOD, HISTORY_PERIOD);
+  for(j = 0; j < history.samples.size(); j++) {
+    t = history.samples[j].timestamp;
+    CHECK( (t <= gapStart + HISTORY_PERIOD) || (t > gapStart + BENCH_GAP * 1000) );
+  }
+  CHECK_NEAR(rate, BENCH_RATE, BENCH_RATE * 0.05);
+  CHECK_NEAR(error, 0, 2);
+
+  // Hours of readings wrap the ring
+  ring.begin();
+  auto begin = std::chrono::steady_clock::now();
+  for(t = 0; t < BENCH_HOURS * 3600000UL; t += BENCH_READING) {
+    // No readings for BENCH_GAP s every 10 minutes
+    if((t % 600000) < BENCH_GAP * 1000)
+      continue;
+    ring.update(syntheticWeight(t), t);
+    readings++;
+  }
+  auto end = std::chrono::steady_clock::now();
+  simOutput.clear();
+  ring.dump();
+  for(s = 0; s < 1000; s++) {
+    simAdvance(HISTORY_LINE_PERIOD * 1000);
+    ring.stream();
+  }
+  decodeOutput(history, simOutput);
+
+  error = 0;
+  longer = 0;
+  for(j = 0; j < history.samples.size(); j++) {
+    t = history.samples[j].timestamp;
+    // No sample of a period without readings
+    if( ((t % 600000) >= HISTORY_PERIOD) && ((t % 600000) < BENCH_GAP * 1000) )
+      longer++;
+    // The sample is the average of the readings of the period ended at t
+    error = max(error, fabs(history.samples[j].weight - syntheticWeight(t - HISTORY_PERIOD / 2)) / 1000.0);
+  }
+  printf("ring: %zu samples of %lu, %lu periods skipped, %.2f bytes/sample, %.1f h in %d bytes, max error %.2f gr\n",
+         history.samples.size(), ring.samples, history.skipped,
+         (double)history.bytes / history.samples.size(),
+         history.samples.size() * HISTORY_PERIOD / 3.6e6, HISTORY_SIZE, error);
+  printf("cost: %.1f ns/reading, %.1fx smaller than 8 bytes samples\n",
+         std::chrono::duration<double, std::nano>(end - begin).count() / readings,
+         8.0 * history.samples.size() / history.bytes);
+  CHECK(history.complete && !history.failed);
+  CHECK(history.samples.size() == ring.samples);
+  CHECK(longer == 0);
+  CHECK(history.samples.back().timestamp > BENCH_HOURS * 3600000UL - 2 * HISTORY_PERIOD);
+  CHECK(error < 1.0);
+  // Hours of one second samples
+  CHECK(history.samples.size() * HISTORY_PERIOD > 2 * 3600000UL);
+
+  return CHECK_RESULT();
+}
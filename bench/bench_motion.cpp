@@ -0,0 +1,175 @@
+/**
+ *  \file bench_motion.cpp
+ *  \brief Loop stalls and command latency while the motor runs, with the
+ *  motion engine and with the blocking ramps of the first release
+ *
+ *  Every motion runs on a fresh board with a loaded spool in manual
+ *  mode: an extruder feed, a load, a continuous feed stopped after 2 s
+ *  and a feed reversed by a load while it is running. With the motion
+ *  engine the commands are sent on the serial port, the weight command
+ *  is sent every WEIGHT_PERIOD ms and the time to its answer is the
+ *  command latency. The first release (legacymotor.h) is called
+ *  directly, the weight command is sent when the motion starts: the
+ *  stall is the duration of the calls, as nothing else ran in the
+ *  meantime. The load cell conversions not read by the firmware are
+ *  counted by the HX711 model.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "motor.h"
+#include "commands.h"
+#include "scenario.h"
+#include "check.h"
+#include "legacymotor.h"
+
+//! ms between two weight commands while the motor runs
+#define WEIGHT_PERIOD 100
+//! ms observed for every motion
+#define MOTION_TIME 4000
+
+//! The motions
+enum { FEED, LOAD, CONTINUOUS, REVERSAL, MOTIONS };
+
+//! Results of a motion
+struct motionResult {
+  unsigned long long stall;   ///< Longest loop pass or blocking call (us)
+  unsigned long long latency; ///< Longest weight command latency (us)
+  unsigned long lost;         ///< Load cell conversions not read
+  double fed;                 ///< Filament released by the motor, negative if loaded (cm)
+};
+
+static motionResult* results;
+
+//! Send the weight command and run until the answer
+static unsigned long long weightLatency(void) {
+  unsigned long long start = simNow;
+
+  simOutput.clear();
+  simSerialInput("weight\n");
+  while(simOutput.find(CMD_WEIGHT) == std::string::npos)
+    simRun(1);
+  return simNow - start;
+}
+
+//! Boot, load the spool and select the manual mode
+static void prepare(void) {
+  simBoot();
+  startJob();
+  simCommand("man");
+  world.clearStats(0);
+}
+
+//! The motion on the motion engine
+static int runEngine(void* arg) {
+  int motion = (int)(long)arg;
+  motionResult& r = results[motion];
+  unsigned long long start;
+  unsigned long elapsed;
+
+  prepare();
+  start = simNow;
+  for(elapsed = 0; elapsed < MOTION_TIME; elapsed += WEIGHT_PERIOD) {
+    if(elapsed == 0)
+      simSerialInput( (motion == LOAD) ? "pull\n" : (motion == CONTINUOUS) ? "feedc\n" : "feed\n");
+    if( (motion == CONTINUOUS) && (elapsed == 2000) )
+      simSerialInput("stop\n");
+    if( (motion == REVERSAL) && (elapsed == 1000) )
+      simSerialInput("pull\n");
+    r.latency = max(r.latency, weightLatency());
+    if(simLoopMax > r.stall)
+      r.stall = simLoopMax;
+    simRun((start + (elapsed + WEIGHT_PERIOD) * 1000ULL - simNow) / 1000);
+    if(simLoopMax > r.stall)
+      r.stall = simLoopMax;
+  }
+  world.integrate(simNow);
+  r.lost = world.hx711[0].lost;
+  r.fed = world.spool[0].fed;
+  return 0;
+}
+
+//! The motion with the blocking calls
+static int runLegacy(void* arg) {
+  int motion = (int)(long)arg;
+  motionResult& r = results[MOTIONS + motion];
+  LegacyMotorControl motor;
+  unsigned long long start, call;
+
+  prepare();
+  motor.begin();
+  start = simNow;
+  simOutput.clear();
+  simSerialInput("weight\n");
+
+  call = simNow;
+  switch(motion) {
+    case FEED:
+      motor.feedExtruder(FEED_EXTRUDER_DELAY);
+      break;
+    case LOAD:
+      motor.filamentLoad(FEED_EXTRUDER_DELAY);
+      break;
+    case CONTINUOUS:
+      motor.filamentContFeed();
+      r.stall = simNow - call;
+      simRun(2000);
+      call = simNow;
+      motor.motorBrake();
+      break;
+    case REVERSAL:
+      // The load waits for the end of the feed
+      motor.feedExtruder(FEED_EXTRUDER_DELAY);
+      r.stall = simNow - call;
+      call = simNow;
+      motor.filamentLoad(FEED_EXTRUDER_DELAY);
+      break;
+  }
+  r.stall = max(r.stall, simNow - call);
+
+  while(simOutput.find(CMD_WEIGHT) == std::string::npos)
+    simRun(1);
+  r.latency = simNow - start;
+  world.integrate(simNow);
+  r.lost = world.hx711[0].lost;
+  r.fed = world.spool[0].fed;
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "feed", "load", "feedc + stop", "feed + pull" };
+  int j;
+
+  results = (motionResult*)simShared(2 * MOTIONS * sizeof(motionResult));
+  for(j = 0; j < MOTIONS; j++) {
+    CHECK(simSpawn(runEngine, (void*)(long)j) == 0);
+    CHECK(simSpawn(runLegacy, (void*)(long)j) == 0);
+  }
+
+  printf("%-14s %12s %12s %6s %12s %12s %6s\n", "", "stall ms", "latency ms", "lost",
+         "blocking ms", "latency ms", "lost");
+  for(j = 0; j < MOTIONS; j++) {
+    const motionResult& e = results[j];
+    const motionResult& l = results[MOTIONS + j];
+
+    printf("%-14s %12.1f %12.1f %6lu %12.1f %12.1f %6lu\n", names[j], e.stall / 1000.0,
+           e.latency / 1000.0, e.lost, l.stall / 1000.0, l.latency / 1000.0, l.lost);
+
+    // The motor moved the filament in both cases
+    CHECK(fabs(e.fed) > 1);
+    CHECK(fabs(l.fed) > 1);
+    // Milliseconds instead of seconds
+    CHECK(e.stall < 10000);
+    CHECK(e.latency < 20000);
+    CHECK(l.stall > 500000);
+    CHECK(e.lost == 0);
+  }
+  return CHECK_RESULT();
+}
@@ -0,0 +1,149 @@
+/**
+ *  \file bench_plan.cpp
+ *  \brief Extruder tension of a G-code job in automatic mode, reacting
+ *  to the tension only and following the demand schedule of the job
+ *
+ *  The job of gcodejob.h is analyzed twice: in BENCH_STEP ms bins for the
+ *  extruder of the simulated dispenser, which pulls the filament of
+ *  every bin at a constant rate, and in PLAN_BIN_TIME bins for the
+ *  schedule. With the schedule the host sends BENCH_AHEAD bins before
+ *  the job starts (plan), starts it with plango and then sends a bin for
+ *  every bin elapsed, as gcodeplan does. A tension event is a pull of the
+ *  extruder over twice the tension setpoint, counted until the tension
+ *  is halved.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <vector>
+#include <math.h>
+#include "gcodeanalyzer.h"
+#include "gcodejob.h"
+#include "sim.h"
+#include "motor.h"
+#include "feedplan.h"
+#include "spoolchannel.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Layers of the job, about 10 minutes
+#define BENCH_LAYERS 18
+//! ms of the extruder bins
+#define BENCH_STEP 100
+//! Bins the host keeps queued
+#define BENCH_AHEAD 30
+
+//! Extruder demand (mg per BENCH_STEP) and schedule (mg per PLAN_BIN_TIME)
+static std::vector<double> extruder;
+static std::vector<long> schedule;
+
+//! Results of a run
+struct planResult {
+  unsigned long events;
+  double metres;
+  double mean;
+  double rms;
+  double max;
+  unsigned long underruns;
+};
+
+static planResult* results;
+
+//! Send the next bin of the schedule
+static void sendBin(size_t& next) {
+  char line[32];
+
+  if(next >= schedule.size())
+    return;
+  snprintf(line, sizeof(line), "plan %ld\n", schedule[next++]);
+  simSerialInput(line);
+}
+
+static int runJob(void* arg) {
+  bool planned = (arg != NULL);
+  planResult& r = results[planned ? 1 : 0];
+  const SimDispenser& d = world.spool[0];
+  size_t j, next = 0;
+
+  simBoot();
+  startJob();
+  simCommand("auto");
+  world.spool[0].pullLevel = 2 * TENSION_SETPOINT;
+  if(planned) {
+    while(next < BENCH_AHEAD)
+      sendBin(next);
+    simRun(500);
+    simSerialInput("plango\n");
+  }
+  world.clearStats(0);
+
+  for(j = 0; j < extruder.size(); j++) {
+    if(planned && (j % (PLAN_BIN_TIME / BENCH_STEP) == 0) && (j > 0))
+      sendBin(next);
+    world.setRate(0, extruder[j] / 1000 / SIM_GR1CM * 1000 / BENCH_STEP);
+    simRun(BENCH_STEP);
+    // At the end the schedule ahead is not queued
+    if(j + PLAN_LEAD / BENCH_STEP + 1 == extruder.size())
+      r.underruns = spools[0].plan.underruns;
+  }
+  world.setRate(0, 0);
+  world.integrate(simNow);
+
+  r.events = d.pulls;
+  r.metres = d.consumed / 100;
+  r.mean = d.tensionSum / d.time;
+  r.rms = sqrt(d.tension2Sum / d.time);
+  r.max = d.maxTensionSeen;
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "reactive", "schedule" };
+  GcodeAnalyzer fine(BENCH_STEP), coarse(PLAN_BIN_TIME);
+  std::string text;
+  gcodeJob job;
+  double carry = 0;
+  long mg;
+  int j;
+
+  while(job.layer < BENCH_LAYERS)
+    gcodeLayer(text, job);
+  fine.parse(text.data(), text.size());
+  coarse.parse(text.data(), text.size());
+  extruder = fine.bins;
+  for(double demand : coarse.bins) {
+    carry += demand;
+    mg = (long)(carry + 0.5);
+    carry -= mg;
+    schedule.push_back(mg);
+  }
+  printf("job: %d layers, %.0f s, %.2f gr, %zu schedule bins\n", job.layer, fine.time,
+         fine.filament * fine.mgPerMm / 1000, schedule.size());
+
+  results = (planResult*)simShared(2 * sizeof(planResult));
+  for(j = 0; j < 2; j++)
+    CHECK(simSpawn(runJob, (void*)(long)j) == 0);
+
+  printf("%-10s %8s %10s %10s %9s %9s %10s\n", "", "events", "events/m", "mean gr", "rms gr",
+         "max gr", "underruns");
+  for(j = 0; j < 2; j++) {
+    const planResult& r = results[j];
+
+    printf("%-10s %8lu %10.2f %10.2f %9.2f %9.2f %10lu\n", names[j], r.events,
+           r.events / r.metres, r.mean, r.rms, r.max, r.underruns);
+  }
+  // The host keeps the schedule ahead
+  CHECK(results[1].underruns == 0);
+  for(j = 0; j < 2; j++) {
+    CHECK(results[j].events / results[j].metres < 2);
+    CHECK(results[j].rms < 2 * TENSION_SETPOINT);
+  }
+  // The roll unwinds before the extruder pulls
+  CHECK(results[1].max < results[0].max);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,74 @@
+/**
+ *  \file bench_probes.cpp
+ *  \brief Overhead of the performance probes
+ *
+ *  A job in automatic mode runs for 20 s with the probes compiled in
+ *  (_PERF). The perf command shows how many times every probe has been
+ *  timed and the cost of a probe, measured by PerfCounters::begin() on
+ *  the simulated clock: two halMicros() calls and the histogram update.
+ *  The probes should take a small fraction of the CPU and should not
+ *  change the task timing: no sample lost and no regulator deadline
+ *  missed.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+#include "perf.h"
+
+//! Seconds measured
+#define BENCH_SECONDS 20
+
+//! Value following a label in a line of a text
+static double lineValue(const std::string& text, const char* line, const char* label) {
+  size_t pos = text.find(std::string("\n") + line + " ");
+
+  if(pos == std::string::npos)
+    return 0;
+  return labelValue(text.substr(pos, text.find('\n', pos + 1) - pos), label);
+}
+
+int main() {
+  static const char* const probes[] = {
+    "loop", "readScale", "acquire", "motion", "diagnosis", "command", "tx"
+  };
+  std::string out, before, tasks;
+  double overhead, count, total = 0, cost;
+  unsigned int j;
+
+  simBoot();
+  startJob();
+  simCommand("auto");
+  world.setRate(0, 0.03 / SIM_GR1CM);
+  simRun(2000);
+  world.clearStats(0);
+  before = simCommand("tasks", 200);
+  simCommand("perf", 200);
+  simRun(BENCH_SECONDS * 1000);
+  out = simCommand("perf", 200);
+  tasks = simCommand("tasks", 500);
+  printf("%s", out.c_str());
+
+  overhead = labelValue(out, " s, probe ");
+  for(j = 0; j < sizeof(probes) / sizeof(probes[0]); j++) {
+    count = lineValue(out, probes[j], " n ");
+    total += count;
+    printf("%-10s %8.0f/s %6.2f%% of the CPU\n", probes[j], count / BENCH_SECONDS,
+           100 * count * overhead / 1e9 / BENCH_SECONDS);
+  }
+  cost = 100 * total * overhead / 1e9 / BENCH_SECONDS;
+  printf("probe %.0f ns, %.0f probes/s, %.2f%% of the CPU\n", overhead, total / BENCH_SECONDS, cost);
+  CHECK(overhead > 0);
+  CHECK(cost < 2);
+  CHECK(world.hx711[0].lost == 0);
+  CHECK(taskColumn(tasks, "feed", 6) == taskColumn(before, "feed", 6));
+
+  return CHECK_RESULT();
+}
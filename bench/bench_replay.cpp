@@ -0,0 +1,262 @@
+/**
+ *  \file bench_replay.cpp
+ *  \brief Record a job with the capture command, then replay it through
+ *  the firmware readings with a sweep of the reading parameters
+ *
+ *  The job runs in manual mode with the feed bursts of the previous
+ *  firmware, sent as soon as the tension reaches MIN_EXTRUDER_TENSION
+ *  (as bench_tension.cpp): the extruder pulls the filament until the
+ *  burst releases it. A few bumps on the scale change the weight for
+ *  a moment, with no pull. The raw samples streamed by "capture 1" are
+ *  decoded and written to a capture file by tools/capturefile.h, every
+ *  sample flagged with the pull state of the dispenser model.\n
+ *  The capture is replayed by tools/capturereplay.h with the firmware
+ *  parameters, then with every combination of MIN_EXTRUDER_TENSION and
+ *  SCALE_SAMPLES. The bench checks the pulls detected and the false
+ *  triggers of the firmware values, shows the best combination, the
+ *  consumption against the dispenser one and the replay speed; the
+ *  speed depends on the host load and is not checked.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sim.h"
+#include "EEPROM.h"
+#include "filament.h"
+#include "scenario.h"
+#include "check.h"
+#include "telemetrydecoder.h"
+#include "capturefile.h"
+#include "capturereplay.h"
+
+//! The capture written by the bench, in the temporary directory
+static std::string capturePath;
+//! Weight of a bump on the scale (gr)
+#define BENCH_BUMP 40.0
+//! Duration of a bump (ms)
+#define BENCH_BUMP_TIME 100
+
+//! The print job: consumption changes and pauses
+static const jobSegment job[] = {
+  { 30, 0.05 }, { 10, 0 }, { 30, 0.1 }, { 20, 0.03 }, { 30, 0.08 }
+};
+
+//! Seconds of the job with a bump on the scale
+static const int bumps[] = { 15, 37, 52, 88, 101 };
+
+//! Results of the recording
+struct recordResult {
+  unsigned long samples;    ///< Samples written
+  unsigned long errors;     ///< Frames not valid
+  unsigned long lost;       ///< Samples lost by the capture ring
+  unsigned long feeds;      ///< Feed bursts sent
+  unsigned long pulls;      ///< Pulls of the dispenser model
+  double consumed;          ///< Filament consumed by the extruder (gr)
+  double used;              ///< Consumption shown by the board (gr)
+  bool calibrated;          ///< The conf output has been read
+};
+
+static recordResult* recorded;
+
+//! Pull intervals of the dispenser model (simNow)
+static std::vector<unsigned long long> pullStart, pullEnd;
+
+//! Pull state of the dispenser when a sample has been read
+static uint8_t pullFlags(unsigned long timestamp) {
+  size_t j;
+
+  for(j = 0; j < pullStart.size(); j++) {
+    if( (timestamp >= pullStart[j]) && (timestamp < pullEnd[j]) )
+      return CAPTURE_FLAG_PULL;
+  }
+  return 0;
+}
+
+//! Run the job with the capture running and write the capture file
+static int recordJob(void*) {
+  recordResult& r = *recorded;
+  const SimDispenser& d = world.spool[0];
+  TelemetryDecoder decoder;
+  CaptureWriter writer;
+  std::string out;
+  unsigned int j, bump = 0;
+  double elapsed, time = 0;
+  bool pulling = false;
+
+  simBoot();
+  startJob();
+  simCommand("man");
+  simCommand("mstat 100");
+  // The calibration of the capture
+  out = simCommand("conf");
+  decoder.receive((const uint8_t*)out.data(), out.size());
+  simCommand("capture 1");
+  world.clearStats(0);
+
+  for(j = 0; j < sizeof(job) / sizeof(job[0]); j++) {
+    world.setRate(0, job[j].rate / SIM_GR1CM);
+    for(elapsed = 0; elapsed < job[j].seconds; elapsed += 0.01, time += 0.01) {
+      simOutput.clear();
+      if( (bump < sizeof(bumps) / sizeof(bumps[0])) && (time >= bumps[bump]) ) {
+        world.integrate(simNow);
+        world.spool[0].extra = BENCH_BUMP;
+        simRun(BENCH_BUMP_TIME);
+        world.integrate(simNow);
+        world.spool[0].extra = 0;
+        bump++;
+      }
+      else
+        simRun(10);
+      out = simOutput;
+      decoder.receive((const uint8_t*)out.data(), out.size());
+      if(d.pulling != pulling) {
+        if(d.pulling)
+          pullStart.push_back(simNow);
+        else
+          pullEnd.push_back(simNow);
+        pulling = d.pulling;
+      }
+      if( (d.tension >= MIN_EXTRUDER_TENSION) && (statField(out, 0, "duty") == 0) ) {
+        simSerialInput("feed\n");
+        r.feeds++;
+      }
+    }
+  }
+  if(pulling)
+    pullEnd.push_back(simNow);
+  simCommand("mstat 0");
+  out = simCommand("capture 0", 200);
+  decoder.receive((const uint8_t*)out.data(), out.size());
+  r.lost = labelValue(simCommand("capture"), " samples, ");
+  r.used = labelValue(simCommand("stat"), MSG_USED);
+
+  // The timestamps are micros() of the board, the job ends before they wrap
+  if(!writer.open(capturePath.c_str(), 0))
+    return 1;
+  writer.scanText(decoder.text);
+  for(const telemetryRecord& record : decoder.records)
+    writer.add(record, pullFlags(record.timestamp));
+  if(!writer.close())
+    return 1;
+
+  world.integrate(simNow);
+  r.samples = writer.samples;
+  r.errors = decoder.errors;
+  r.calibrated = writer.calibrated;
+  r.pulls = d.pulls;
+  r.consumed = d.consumed * d.gr1cm;
+  return 0;
+}
+
+//! Shows a replay
+static void show(const char* name, const double* tuning, const replayResult& r) {
+  printf("%-10s %8g %8g %8lu %8lu %5lu/%-3lu %6lu %9.2f\n", name, tuning[REPLAY_MIN_TENSION],
+         tuning[REPLAY_SAMPLES], r.readings, r.detections, r.detected,
+         r.pulls, r.falseTriggers, r.consumed);
+}
+
+int main() {
+  // The capture is taken while running: the gate stage of the filter,
+  // MAX_DELTA_WEIGHT_IN_RANGE, works only while loading the spool
+  static const double tensions[] = { 5, 10, 15, 20, 25, 30, 40, 50, 60, 80, 100, 150 };
+  static const double samples[] = { 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20 };
+  double firmware[REPLAY_PARAMETERS], seconds;
+  const double* best;
+  std::vector<double> tunings;
+  std::vector<replayResult> results;
+  CaptureFile capture;
+  CaptureReplay replay;
+  replayResult base, top;
+  unsigned long combinations, failed = 0, j;
+  unsigned int t, s;
+  int k;
+
+  capturePath = std::string(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp") +
+                "/bench_replay_" + std::to_string(getpid()) + ".cap";
+  recorded = (recordResult*)simShared(sizeof(recordResult));
+  CHECK(simSpawn(recordJob, NULL) == 0);
+  printf("recorded %lu samples, %lu frames not valid, %lu lost, %lu feed bursts, %lu pulls\n",
+         recorded->samples, recorded->errors, recorded->lost, recorded->feeds, recorded->pulls);
+  CHECK(recorded->calibrated);
+  CHECK(recorded->errors == 0);
+  CHECK(recorded->pulls > 10);
+
+  // The replay board does not restore the recorded job
+  EEPROM.erase();
+  CHECK(capture.open(capturePath.c_str()));
+  // The capture stays mapped until the end
+  unlink(capturePath.c_str());
+  CHECK(capture.count == recorded->samples);
+  CHECK(replay.begin(&capture));
+  CHECK(replay.referenced);
+
+  for(k = 0; k < REPLAY_PARAMETERS; k++)
+    firmware[k] = CaptureReplay::firmwareValue(k);
+  base = replay.run(firmware);
+
+  // The sweep, the best combination detects the most pulls with the
+  // least false triggers
+  for(t = 0; t < sizeof(tensions) / sizeof(tensions[0]); t++) {
+    for(s = 0; s < sizeof(samples) / sizeof(samples[0]); s++) {
+      tunings.insert(tunings.end(), firmware, firmware + REPLAY_PARAMETERS);
+      tunings[tunings.size() - REPLAY_PARAMETERS + REPLAY_MIN_TENSION] = tensions[t];
+      tunings[tunings.size() - REPLAY_PARAMETERS + REPLAY_SAMPLES] = samples[s];
+    }
+  }
+  combinations = tunings.size() / REPLAY_PARAMETERS;
+  results.resize(combinations);
+  auto start = std::chrono::steady_clock::now();
+  replay.sweep(tunings.data(), combinations, results.data());
+  auto end = std::chrono::steady_clock::now();
+  seconds = std::chrono::duration<double>(end - start).count();
+
+  top = base;
+  best = firmware;
+  for(j = 0; j < combinations; j++) {
+    if(results[j].readings == 0) {
+      failed++;
+      continue;
+    }
+    if( (long)results[j].detected - (long)results[j].falseTriggers >
+        (long)top.detected - (long)top.falseTriggers ) {
+      top = results[j];
+      best = &tunings[j * REPLAY_PARAMETERS];
+    }
+  }
+
+  printf("\n%-10s %8s %8s %8s %8s %9s %6s %9s\n", "", "tension", "samples", "readings",
+         "detect", "pulls", "false", "used gr");
+  show("firmware", firmware, base);
+  show("best", best, top);
+  printf("dispenser consumption %.2f gr, shown by the board %.2f gr\n", recorded->consumed,
+         recorded->used);
+  printf("%lu combinations of %.1f s in %.2f s: %.1f ms each, %.0fx real time\n", combinations,
+         replay.seconds, seconds, 1000 * seconds / combinations,
+         replay.seconds * combinations / seconds);
+
+  CHECK(failed == 0);
+  // The replay reads every sample of the capture
+  CHECK(base.lost == 0);
+  CHECK_NEAR(base.readings, capture.count / SCALE_SAMPLES, 2);
+  CHECK(base.pulls == recorded->pulls);
+  // The consumption of the replay is the one of the board
+  CHECK_NEAR(base.consumed, recorded->used, 0.1 * recorded->consumed);
+  // The firmware values detect the pulls, the bumps are not pulls
+  CHECK(base.detected >= 0.9 * base.pulls);
+  CHECK(base.falseTriggers <= sizeof(bumps) / sizeof(bumps[0]));
+  // The sweep includes the firmware values
+  CHECK(top.detected >= base.detected);
+  CHECK(top.falseTriggers <= 2 * sizeof(bumps) / sizeof(bumps[0]));
+
+  return CHECK_RESULT();
+}
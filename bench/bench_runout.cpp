@@ -0,0 +1,69 @@
+/**
+ *  \file bench_runout.cpp
+ *  \brief Accuracy of the spool runout forecast
+ *
+ *  A spool with little filament left runs a job at a constant rate, then
+ *  the rate doubles until the spool is empty. Every 10 s the time to
+ *  empty of the status line is compared with the real one, the filament
+ *  on the spool divided by the extruder rate. The error is averaged over
+ *  each segment once the forecast is valid; after the rate change the
+ *  bench measures the time the forecast takes to be again within 20%.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+
+//! The job: 30 gr at 0.05 gr/s, then 0.08 gr/s until the spool is empty
+static const jobSegment job[] = { { 600, 0.05 }, { 360, 0.08 } };
+
+int main() {
+  const SimDispenser& d = world.spool[0];
+  double error[2] = { 0, 0 }, tte, truth, settle = -1;
+  int samples[2] = { 0, 0 }, j, s;
+
+  simBoot();
+  simRun(500);
+  world.mount(0, 60);
+  simRun(2000);
+  simCommand("load", 1500);
+  simCommand("run", 500);
+  simCommand("auto");
+  simCommand("mstat 10000");
+
+  for(j = 0; j < 2; j++) {
+    world.setRate(0, job[j].rate / SIM_GR1CM);
+    for(s = 10; s <= job[j].seconds; s += 10) {
+      simOutput.clear();
+      simRun(10000);
+      tte = statField(simOutput, 0, "tte");
+      world.integrate(simNow);
+      truth = d.filament / job[j].rate;
+      if( isnan(tte) || (tte < 0) )
+        continue;
+      error[j] += fabs(tte - truth) / truth;
+      samples[j]++;
+      if( (j == 1) && (settle < 0) && (fabs(tte - truth) < 0.2 * truth) )
+        settle = s;
+    }
+  }
+
+  for(j = 0; j < 2; j++) {
+    error[j] = (samples[j] > 0) ? 100 * error[j] / samples[j] : NAN;
+    printf("%.2f gr/s: %d forecasts, mean error %.1f%%\n", job[j].rate, samples[j], error[j]);
+  }
+  printf("rate change: forecast within 20%% after %.0f s\n", settle);
+
+  CHECK(samples[0] > 0);
+  CHECK(error[0] < 10);
+  CHECK( (settle >= 0) && (settle <= 180) );
+  return CHECK_RESULT();
+}
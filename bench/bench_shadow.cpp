@@ -0,0 +1,131 @@
+/**
+ *  \file bench_shadow.cpp
+ *  \brief Driver register writes of the motor operations, with the
+ *  shadow registers of the HAL and with the first release
+ *
+ *  Every operation runs on a fresh board in manual mode: the startup,
+ *  an extruder feed, a load, the brake of a continuous feed and the
+ *  reversal of a continuous feed to a continuous load. The firmware
+ *  runs the commands, the first release (legacymotor.h) is called
+ *  directly. The driver model counts the writes of the control
+ *  registers (half bridges, PWM, free wheeling); the diagnosis reads and
+ *  clears are not part of the operations. The startup does not count the
+ *  reset values written by the library begin().
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "motor.h"
+#include "scenario.h"
+#include "check.h"
+#include "legacymotor.h"
+
+//! ms the firmware runs for an operation
+#define OPERATION_TIME 3500
+
+//! The operations
+enum { BEGIN, FEED, LOAD, BRAKE, REVERSAL, OPERATIONS };
+
+//! Writes of the firmware and of the first release for every operation
+static unsigned long* results;
+
+//! Writes of the control registers since the counters were cleared
+static unsigned long controlWrites(void) {
+  unsigned long n = 0;
+  int r;
+
+  for(r = TLE_REG_HB_ACT_1; r <= TLE_REG_FW_CTRL; r++)
+    n += tle94112.writes[r];
+  return n;
+}
+
+//! Writes of the library begin()
+static unsigned long libraryWrites(void) {
+  tle94112.clearCounters();
+  tle94112.begin();
+  return controlWrites();
+}
+
+//! An operation of the firmware
+static int runEngine(void* arg) {
+  int op = (int)(long)arg;
+  unsigned long library = libraryWrites();
+
+  tle94112.clearCounters();
+  simBoot();
+  if(op == BEGIN) {
+    results[op] = controlWrites() - library;
+    return 0;
+  }
+  startJob();
+  simCommand("man");
+  if( (op == BRAKE) || (op == REVERSAL) ) {
+    simCommand("feedc", 2000);
+    tle94112.clearCounters();
+    simCommand( (op == BRAKE) ? "stop" : "pullc", OPERATION_TIME);
+  }
+  else {
+    tle94112.clearCounters();
+    simCommand( (op == FEED) ? "feed" : "pull", OPERATION_TIME);
+  }
+  results[op] = controlWrites();
+  return 0;
+}
+
+//! An operation of the first release
+static int runLegacy(void* arg) {
+  int op = (int)(long)arg;
+  LegacyMotorControl motor;
+
+  simBoot();
+  startJob();
+  tle94112.clearCounters();
+  switch(op) {
+    case BEGIN:
+      motor.begin();
+      break;
+    case FEED:
+      motor.feedExtruder(FEED_EXTRUDER_DELAY);
+      break;
+    case LOAD:
+      motor.filamentLoad(FEED_EXTRUDER_DELAY);
+      break;
+    case BRAKE:
+    case REVERSAL:
+      motor.filamentContFeed();
+      tle94112.clearCounters();
+      if(op == BRAKE)
+        motor.motorBrake();
+      else
+        motor.filamentContLoad();
+      break;
+  }
+  results[OPERATIONS + op] = controlWrites();
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "begin", "feed", "load", "brake", "reversal" };
+  int j;
+
+  results = (unsigned long*)simShared(2 * OPERATIONS * sizeof(unsigned long));
+  for(j = 0; j < OPERATIONS; j++) {
+    CHECK(simSpawn(runEngine, (void*)(long)j) == 0);
+    CHECK(simSpawn(runLegacy, (void*)(long)j) == 0);
+  }
+
+  printf("%-10s %8s %14s\n", "", "shadow", "first release");
+  for(j = 0; j < OPERATIONS; j++) {
+    printf("%-10s %8lu %14lu\n", names[j], results[j], results[OPERATIONS + j]);
+    CHECK(results[j] < results[OPERATIONS + j] / 3);
+  }
+  // The reset state of the library is already the one of begin()
+  CHECK(results[BEGIN] == 0);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,149 @@
+/**
+ *  \file bench_startup.cpp
+ *  \brief Time from the power on to the first valid reading, and the
+ *  flash wear of the settings record
+ *
+ *  Three startups: the first one with the flash erased and the scale
+ *  empty, tared before the first reading; the power cycle of a running
+ *  job with the spool on the scale, restored from the flash without a
+ *  tare; the same with the flash erased, as the first release did at
+ *  every startup: the loaded scale is tared and the reading is wrong by
+ *  the whole spool. The board is ready at the first reading after the
+ *  tare, its error is the difference from the reading before the power
+ *  cycle (or from zero).\n
+ *  Then BENCH_JOBS jobs run on the same board: load, units change,
+ *  run, reset. The flash writes are counted by the emulated EEPROM, the
+ *  wear is the writes of the most written byte; without the slots
+ *  rotation every save would write the same record.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+#include "EEPROM.h"
+#include "filament.h"
+#include "spoolchannel.h"
+#include "settingsstore.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Jobs of the flash wear run
+#define BENCH_JOBS 20
+//! Longest startup waited (ms)
+#define BENCH_BOOT_MAX 5000
+//! Value of the reading before the first one after the boot
+#define NO_READING -10000
+
+//! The startups
+enum { COLD, RESTORED, RETARED, STARTUPS };
+
+//! Results of a startup
+struct startResult {
+  double ready;     ///< ms from the power on to the first reading
+  double error;     ///< Error of the first reading (gr)
+  unsigned long writes;  ///< Flash bytes written by the startup
+};
+
+static startResult* results;
+
+//! Boot and wait for the first reading after the tare
+static void boot(startResult& r, double expected) {
+  FilamentWeight& scale = spools[0].scale;
+  unsigned long long start = simNow;
+  unsigned long writes = EEPROM.writes();
+
+  simBoot();
+  scale.lastRead = MEASURE(NO_READING);
+  while( (scale.taring || (scale.lastRead == MEASURE(NO_READING))) &&
+         (simNow - start < BENCH_BOOT_MAX * 1000ULL) )
+    simRun(1);
+  r.ready = (simNow - start) / 1000.0;
+  r.error = MEASURE_FLOAT(scale.lastRead) - expected;
+  r.writes = EEPROM.writes() - writes;
+}
+
+//! A startup
+static int runStartup(void* arg) {
+  int run = (int)(long)arg;
+  double before;
+
+  EEPROM.erase();
+  if(run == COLD) {
+    boot(results[run], 0);
+    return 0;
+  }
+  // A job running for a minute, then the power cycle
+  simBoot();
+  startJob();
+  world.setRate(0, 0.03 / SIM_GR1CM);
+  simRun(60000);
+  world.setRate(0, 0);
+  simRun(2000);
+  before = MEASURE_FLOAT(spools[0].scale.lastRead);
+  if(run == RETARED)
+    EEPROM.erase();
+  boot(results[run], before);
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "first, empty", "restored", "no record" };
+  unsigned long saves = 0, wear = 0;
+  storedSettings record;
+  int j;
+
+  results = (startResult*)simShared(STARTUPS * sizeof(startResult));
+  for(j = 0; j < STARTUPS; j++)
+    CHECK(simSpawn(runStartup, (void*)(long)j) == 0);
+
+  printf("%-14s %10s %10s %14s\n", "startup", "ready ms", "error gr", "flash bytes");
+  for(j = 0; j < STARTUPS; j++)
+    printf("%-14s %10.1f %10.2f %14lu\n", names[j], results[j].ready, results[j].error,
+           results[j].writes);
+
+  // The restored startup does not tare: a reading of the samples
+  // after the boot
+  CHECK(results[RESTORED].ready < results[COLD].ready);
+  CHECK(results[RESTORED].ready < 2 * SCALE_SAMPLES * 1000.0 / SIM_HX711_SPS);
+  CHECK(fabs(results[RESTORED].error) < 2);
+  CHECK(results[RESTORED].writes == 0);
+  CHECK(fabs(results[COLD].error) < 2);
+  CHECK(fabs(results[RETARED].error) > SIM_SPOOL_NET / 2);
+
+  // The jobs
+  EEPROM.erase();
+  simBoot();
+  simRun(500);
+  world.mount(0);
+  for(j = 0; j < BENCH_JOBS; j++) {
+    simCommand("load", 1500);
+    simCommand( (j % 2) ? "gr" : "cm");
+    simCommand("run", 500);
+    world.setRate(0, 0.03 / SIM_GR1CM);
+    simRun(30000);
+    world.setRate(0, 0);
+    simCommand("reset", 500);
+  }
+  // The sequence of the newest record counts the saves
+  for(j = 0; j < STORE_SLOTS; j++) {
+    memcpy(&record, EEPROM.data() + STORE_BASE + j * sizeof(record), sizeof(record));
+    if(record.version == STORE_VERSION)
+      saves = max(saves, (unsigned long)record.sequence + 1);
+  }
+  for(j = 0; j < SIM_EEPROM_SIZE; j++)
+    wear = max(wear, EEPROM.writes(j));
+  printf("%d jobs: %lu saves, %lu bytes written, wear %lu writes of a byte\n", BENCH_JOBS,
+         saves, EEPROM.writes(), wear);
+  // Every save changes the sequence: with one slot its bytes would be
+  // written at every save
+  CHECK(saves >= 3 * BENCH_JOBS);
+  CHECK(wear <= saves / STORE_SLOTS + 1);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,132 @@
+/**
+ *  \file bench_telemetry.cpp
+ *  \brief Throughput of the telemetry stream with the spool channels of
+ *  the firmware variant
+ *
+ *  The stream is started with the shortest period, raised by the
+ *  firmware to TELEMETRY_MIN_PERIOD, and runs for 20 s with a job on
+ *  every channel. The bench shows the records sent for every channel,
+ *  the serial load, the time the firmware waited for the transmit buffer
+ *  and the deadline misses of the tasks: the stream should keep the
+ *  period without blocking the sensor task.\n
+ *  The output is decoded by tools/telemetrydecoder.h: every frame should
+ *  be a valid record. The bytes of a sample record are compared with the
+ *  text status lines (stat and the @stat line of mstat) and so the
+ *  samples per second the port can carry.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+#include "channels.h"
+#include "telemetry.h"
+#include "telemetrydecoder.h"
+
+//! Seconds of stream measured
+#define BENCH_SECONDS 20
+
+extern Telemetry telemetry;
+
+//! Samples per second carried by the serial port with a sample size
+static double portRate(double bytes) {
+  return 1e6 / TELEMETRY_BYTE_TIME / bytes;
+}
+
+int main() {
+  TelemetryDecoder decoder, mixed;
+  std::string out;
+  unsigned long long start, blocked, loopMax;
+  unsigned long period;
+  unsigned long frames, lost = 0, decoded[SPOOL_CHANNELS] = { 0 };
+  unsigned long last[SPOOL_CHANNELS] = { 0 }, interval[SPOOL_CHANNELS] = { 0 };
+  double records, load, binary, human, status;
+  int ch;
+
+  simBoot();
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++) {
+    startJob(ch);
+    simCommand(channelCommand(ch, "auto").c_str());
+    world.setRate(ch, 0.03 / SIM_GR1CM);
+  }
+  simCommand("telemetry 1");
+  simRun(1000);
+
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++)
+    world.clearStats(ch);
+  start = simNow;
+  blocked = simSerialBlocked;
+  frames = telemetry.frames;
+  simSerialBytes = 0;
+  simOutput.clear();
+  simRun(BENCH_SECONDS * 1000);
+  blocked = simSerialBlocked - blocked;
+  loopMax = simLoopMax;
+  period = telemetry.period;
+  frames = telemetry.frames - frames;
+  load = 100.0 * simSerialBytes * TELEMETRY_BYTE_TIME / (simNow - start);
+
+  records = frames / (double)SPOOL_CHANNELS / BENCH_SECONDS;
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++)
+    lost += world.hx711[ch].lost;
+
+  decoder.receive((const uint8_t*)simOutput.data(), simOutput.size());
+  for(const telemetryRecord& r : decoder.records) {
+    if( (r.type != TELEMETRY_DECODER_SAMPLE) || (r.channel >= SPOOL_CHANNELS) )
+      continue;
+    if(decoded[r.channel]++ > 0)
+      interval[r.channel] = max(interval[r.channel], r.timestamp - last[r.channel]);
+    last[r.channel] = r.timestamp;
+  }
+  binary = (double)decoder.frameBytes / decoder.records.size();
+
+  // The messages are received between the frames
+  out = simCommand("weight", 200);
+  mixed.receive((const uint8_t*)out.data(), out.size());
+  CHECK_CONTAINS(mixed.text, "Weight ");
+  CHECK(mixed.records.size() > 0);
+  CHECK(mixed.errors == 0);
+
+  // The same status as text, without the stream
+  simCommand("telemetry 0", 500);
+  human = simCommand("stat", 500).size();
+  simCommand("mstat 1000", 1100);
+  status = simOutput.size() / (double)SPOOL_CHANNELS;
+  simCommand("mstat 0");
+
+  printf("%d channels, period %lu ms\n", SPOOL_CHANNELS, period);
+  printf("%.1f records/s for every channel, serial load %.1f%%\n", records, load);
+  printf("%.2f ms/s waiting for the transmit buffer, longest loop pass %.2f ms, %lu samples lost\n",
+         blocked / 1000.0 / BENCH_SECONDS, loopMax / 1000.0, lost);
+
+  printf("%lu records decoded, %lu errors, %.1f bytes/sample: %.0f samples/s\n",
+         (unsigned long)decoder.records.size(), decoder.errors, binary, portRate(binary));
+  printf("text: stat %.0f bytes (%.0f samples/s), @stat %.0f bytes (%.0f samples/s)\n",
+         human, portRate(human), status, portRate(status));
+
+  CHECK(decoder.records.size() == frames);
+  CHECK(decoder.errors == 0);
+  CHECK(binary == TELEMETRY_SAMPLE_FRAME);
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++) {
+    CHECK_NEAR(decoded[ch], frames / (double)SPOOL_CHANNELS, 1);
+    CHECK(interval[ch] <= period + TELEMETRY_TASK_PERIOD);
+  }
+  // The records carry more than the text lines in less bytes
+  CHECK(binary * 3 < human);
+  CHECK(binary * 5 < status);
+  CHECK(period == TELEMETRY_MIN_PERIOD);
+  CHECK_NEAR(records, 1000.0 / TELEMETRY_MIN_PERIOD, 1000.0 / TELEMETRY_MIN_PERIOD * 0.05);
+  CHECK(load < 60);
+  CHECK(blocked == 0);
+  // No task delayed over the shortest deadline
+  CHECK(loopMax < 5000);
+  CHECK(lost == 0);
+
+  return CHECK_RESULT();
+}
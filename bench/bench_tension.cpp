@@ -0,0 +1,115 @@
+/**
+ *  \file bench_tension.cpp
+ *  \brief Extruder tension with the PI regulator of the automatic mode
+ *  and with the feed bursts of the previous firmware
+ *
+ *  The same print job runs twice on a fresh board. In automatic mode the
+ *  regulator drives the motor. The previous firmware fed a burst of
+ *  FEED_EXTRUDER_DELAY ms every time the extruder pull was detected: it
+ *  is reproduced in manual mode, the bench sends the feed command as
+ *  soon as the tension reaches MIN_EXTRUDER_TENSION with the motor
+ *  stopped. The detection is ideal, the firmware only saw the pulls
+ *  raising the weight by 100 gr between two readings.\n
+ *  The tension statistics come from the dispenser model: mean tension,
+ *  RMS error from the setpoint and max tension, the pulls over 100 gr and the average time
+ *  to halve them (latency), the filament dragged by the extruder.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "filament.h"
+#include "motor.h"
+#include "scenario.h"
+#include "check.h"
+
+//! The print job: consumption changes and pauses
+static const jobSegment job[] = {
+  { 60, 0.02 }, { 20, 0 }, { 60, 0.05 }, { 60, 0.01 }, { 30, 0.08 },
+  { 20, 0 }, { 90, 0.03 }, { 30, 0.1 }, { 60, 0.02 }, { 10, 0 }
+};
+
+//! Results of a run
+struct tensionResult {
+  double mean;
+  double error;
+  double max;
+  unsigned long pulls;
+  double latency;
+  double dragged;
+  double consumed;
+  unsigned long feeds;
+};
+
+static tensionResult* results;
+
+//! Run the job, in automatic mode or with the feed bursts
+static int runJob(void* arg) {
+  bool burst = (arg != NULL);
+  tensionResult& r = results[burst ? 1 : 0];
+  const SimDispenser& d = world.spool[0];
+  unsigned int j;
+  double elapsed;
+
+  simBoot();
+  startJob();
+  simCommand(burst ? "man" : "auto");
+  if(burst)
+    simCommand("mstat 100");
+  world.clearStats(0);
+
+  for(j = 0; j < sizeof(job) / sizeof(job[0]); j++) {
+    world.setRate(0, job[j].rate / SIM_GR1CM);
+    for(elapsed = 0; elapsed < job[j].seconds; elapsed += 0.1) {
+      simOutput.clear();
+      simRun(100);
+      if( burst && (d.tension >= MIN_EXTRUDER_TENSION) && (statField(simOutput, 0, "duty") == 0) ) {
+        simSerialInput("feed\n");
+        r.feeds++;
+      }
+    }
+  }
+
+  world.integrate(simNow);
+  r.mean = d.tensionSum / d.time;
+  // E[(T - s)^2] = E[T^2] - 2 s E[T] + s^2
+  r.error = sqrt(d.tension2Sum / d.time - 2 * TENSION_SETPOINT * r.mean +
+                 TENSION_SETPOINT * TENSION_SETPOINT);
+  r.max = d.maxTensionSeen;
+  r.pulls = d.pulls;
+  r.latency = (d.pulls > 0) ? d.pullTime / d.pulls : 0;
+  r.dragged = d.dragged;
+  r.consumed = d.consumed;
+  return 0;
+}
+
+int main() {
+  const char* names[] = { "PI regulator", "feed bursts" };
+  int j;
+
+  results = (tensionResult*)simShared(2 * sizeof(tensionResult));
+  CHECK(simSpawn(runJob, NULL) == 0);
+  CHECK(simSpawn(runJob, (void*)1) == 0);
+
+  printf("%-14s %8s %8s %8s %6s %10s %10s %7s\n", "", "mean gr", "rms err", "max gr", 
+         "pulls", "latency s", "dragged %", "feeds");
+  for(j = 0; j < 2; j++) {
+    printf("%-14s %8.1f %8.1f %8.1f %6lu %10.2f %10.1f %7lu\n", names[j], results[j].mean, 
+           results[j].error, results[j].max, results[j].pulls, results[j].latency,
+           100 * results[j].dragged / results[j].consumed, results[j].feeds);
+  }
+
+  // The regulator keeps the tension closer to the setpoint, with lower
+  // peaks and no drag
+  CHECK_NEAR(results[0].mean, TENSION_SETPOINT, 15);
+  CHECK(results[0].error < results[1].error);
+  CHECK(results[0].max < results[1].max);
+  CHECK(results[0].dragged < 0.01 * results[0].consumed);
+  return CHECK_RESULT();
+}
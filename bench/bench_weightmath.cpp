@@ -0,0 +1,101 @@
+/**
+ *  \file bench_weightmath.cpp
+ *  \brief Cost of the weight calculations of a reading, with the float
+ *  and with the fixed point (_FIXED_POINT) weights
+ *
+ *  Every reading is converted as the status line does: consumed grams,
+ *  their length and the remaining percentage. The host processor has a
+ *  floating point unit, its time is only shown. The XMC1100 (Cortex-M0,
+ *  no FPU, no 32x32->64 multiply) calls a libgcc routine for every
+ *  operation: the bench counts the operations of calcConsumedGrams(),
+ *  calcGgramsToCentimeters() and calcRemainingPerc() for both builds and
+ *  estimates the cycles of a reading from the cost of the routines.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <time.h>
+#include "sim.h"
+#include "spoolchannel.h"
+#include "check.h"
+
+//! Readings converted
+#define BENCH_READINGS 10000000L
+//! MCLK of the XMC1100 (MHz)
+#define BENCH_M0_MHZ 32
+
+//! Approximate Cortex-M0 cycles of an operation, call included, with
+//! the libgcc soft-float routines of ARMv6-M and normal operands
+struct m0Operation {
+  const char* name;   ///< The operation, libgcc routine
+  int cycles;         ///< Cycles of the operation
+  int floatCount;     ///< Operations of a reading, float build
+  int fixedCount;     ///< Operations of a reading, fixed point build
+};
+
+//! The operations of a reading: two subtractions of the consumed weight,
+//! the division by gr1cm or a Q16 product, the percentage as a product
+//! and a division or a Q16 product
+static const m0Operation m0Operations[] = {
+  { "__aeabi_fsub", 110, 2, 0 },
+  { "__aeabi_fmul", 160, 1, 0 },
+  { "__aeabi_fdiv", 460, 2, 0 },
+  { "subs (32 bit)", 1, 0, 2 },
+  { "__aeabi_lmul", 25, 0, 2 },
+  { ">> 16 (64 bit)", 6, 0, 2 }
+};
+
+int main() {
+  FilamentWeight& scale = spools[0].scale;
+  struct timespec start, end;
+  measure_t sum = 0, step = MEASURE(0.37);
+  double ns;
+  long j, floatCycles = 0, fixedCycles = 0;
+  unsigned int k;
+
+  simBoot();
+  simRun(1000);
+  scale.statID = STAT_LOAD;
+  scale.initialWeight = scale.rollWeight;
+  scale.lastRead = scale.rollTare + scale.rollWeight;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(j = 0; j < BENCH_READINGS; j++) {
+    measure_t used = scale.calcConsumedGrams();
+
+    sum += scale.calcGgramsToCentimeters(used) + scale.calcRemainingPerc(used);
+    scale.lastRead -= step;
+    if(scale.lastRead < scale.rollTare)
+      scale.lastRead = scale.rollTare + scale.rollWeight;
+    // The result is used, the loop is not removed by the compiler
+    __asm__ volatile("" : : "g"(sum));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_READINGS;
+#ifdef _FIXED_POINT
+  printf("fixed point: %.2f ns per reading on the host\n", ns);
+#else
+  printf("float: %.2f ns per reading on the host\n", ns);
+#endif
+
+  printf("\n%-16s %7s %6s %6s\n", "Cortex-M0", "cycles", "float", "fixed");
+  for(k = 0; k < sizeof(m0Operations) / sizeof(m0Operations[0]); k++) {
+    const m0Operation& op = m0Operations[k];
+
+    printf("%-16s %7d %6d %6d\n", op.name, op.cycles, op.floatCount, op.fixedCount);
+    floatCycles += (long)op.cycles * op.floatCount;
+    fixedCycles += (long)op.cycles * op.fixedCount;
+  }
+  printf("%-16s %7s %6ld %6ld\n", "per reading", "", floatCycles, fixedCycles);
+  printf("us at %d MHz %11s %6.1f %6.1f\n", BENCH_M0_MHZ, "", (double)floatCycles / BENCH_M0_MHZ,
+         (double)fixedCycles / BENCH_M0_MHZ);
+
+  CHECK(sum != 0);
+  return CHECK_RESULT();
+}
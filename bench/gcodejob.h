@@ -0,0 +1,132 @@
+/**
+ *  \file gcodejob.h
+ *  \brief G-code of a print job for the benchmarks of the demand
+ *  schedule, written as a slicer does
+ *
+ *  Every layer starts with G92 E0, a retraction, the layer change and
+ *  the travel to the island, then the perimeters at GCODE_PERIMETER_FEED
+ *  and the infill lines at GCODE_INFILL_FEED; every fifth layer ends
+ *  with a cooling pause. The size of the island changes pseudo-randomly
+ *  from layer to layer, and with it the consumption rate. E is absolute
+ *  (M82), 0.8 mm lines 0.4 mm high on 1.75 mm filament.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _GCODEJOB
+#define _GCODEJOB
+
+#include <string>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+//! Filament for one mm of line (mm): 0.8 x 0.4 mm on 1.75 mm filament
+#define GCODE_E_PER_MM 0.133
+//! Perimeters of a layer
+#define GCODE_PERIMETERS 4
+//! Distance of the perimeters and of the infill lines (mm)
+#define GCODE_LINE 0.8
+//! Feed rates (mm/min)
+#define GCODE_PERIMETER_FEED 2400
+#define GCODE_INFILL_FEED 6000
+#define GCODE_TRAVEL_FEED 9000
+#define GCODE_RETRACT_FEED 2400
+//! Retraction (mm)
+#define GCODE_RETRACT 1.0
+
+/**
+ * Job being written
+ */
+struct gcodeJob {
+  int layer;          ///< Next layer
+  double e;           ///< E position of the layer
+  double filament;    ///< Filament extruded by the layers written (mm)
+  uint32_t rng;       ///< Island sizes generator
+
+  gcodeJob() : layer(0), e(0), filament(0), rng(12345) { }
+};
+
+//! Append a line to the text
+static inline void gcodeLine(std::string& text, const char* format, double a, double b,
+                             double c) {
+  char line[80];
+
+  snprintf(line, sizeof(line), format, a, b, c);
+  text += line;
+}
+
+//! Append an extrusion to a point
+static inline void gcodeExtrude(std::string& text, gcodeJob& job, double& x, double& y,
+                                double toX, double toY) {
+  double length = sqrt((toX - x) * (toX - x) + (toY - y) * (toY - y));
+
+  job.e += length * GCODE_E_PER_MM;
+  job.filament += length * GCODE_E_PER_MM;
+  gcodeLine(text, "G1 X%.3f Y%.3f E%.5f\n", toX, toY, job.e);
+  x = toX;
+  y = toY;
+}
+
+/**
+ * Append the next layer of the job to a text
+ *
+ * \param text the G-code
+ * \param job the job
+ */
+static inline void gcodeLayer(std::string& text, gcodeJob& job) {
+  double side, x0, y0, x, y, inset, size;
+  int k, lines;
+
+  job.rng = job.rng * 1103515245u + 12345u;
+  side = 20 + (job.rng >> 16) % 40;
+  x0 = 100 - side / 2;
+  y0 = 100 - side / 2;
+
+  if(job.layer == 0)
+    text += "M82\nG21\nG90\n";
+  gcodeLine(text, ";LAYER:%.0f\nG92 E0\nG1 F%.0f E%.2f\n", job.layer, GCODE_RETRACT_FEED,
+            -GCODE_RETRACT);
+  gcodeLine(text, "G0 F%.0f Z%.2f\nG0 X%.3f", GCODE_TRAVEL_FEED, 0.4 * (job.layer + 1), x0);
+  gcodeLine(text, " Y%.3f\nG1 F%.0f E0\n", y0, GCODE_RETRACT_FEED, 0);
+  job.e = 0;
+  x = x0;
+  y = y0;
+
+  // Perimeters, from the outside
+  gcodeLine(text, "G1 F%.0f\n", GCODE_PERIMETER_FEED, 0, 0);
+  for(k = 0; k < GCODE_PERIMETERS; k++) {
+    inset = k * GCODE_LINE;
+    size = side - 2 * inset;
+    if(k > 0)
+      gcodeLine(text, "G0 X%.3f Y%.3f\n", x0 + inset, y0 + inset, 0);
+    x = x0 + inset;
+    y = y0 + inset;
+    gcodeExtrude(text, job, x, y, x + size, y);
+    gcodeExtrude(text, job, x, y, x, y + size);
+    gcodeExtrude(text, job, x, y, x - size, y);
+    gcodeExtrude(text, job, x, y, x, y - size);
+  }
+
+  // Infill lines, alternating direction
+  inset = GCODE_PERIMETERS * GCODE_LINE;
+  size = side - 2 * inset;
+  lines = (int)(size / GCODE_LINE);
+  gcodeLine(text, "G1 F%.0f\n", GCODE_INFILL_FEED, 0, 0);
+  for(k = 0; k < lines; k++) {
+    y = y0 + inset + k * GCODE_LINE;
+    x = (k % 2) ? x0 + inset + size : x0 + inset;
+    gcodeLine(text, "G0 X%.3f Y%.3f\n", x, y, 0);
+    gcodeExtrude(text, job, x, y, (k % 2) ? x0 + inset : x0 + inset + size, y);
+  }
+
+  if(job.layer % 5 == 4)
+    gcodeLine(text, "G4 P%.0f\n", 2000 + (job.rng >> 8) % 3000, 0, 0);
+  job.layer++;
+}
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ *  \file legacymotor.cpp
+ *  \brief The motor control of the first release (legacymotor.h)
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "legacymotor.h"
+
+LegacyMotorControl::LegacyMotorControl() {
+  isRunning = false;
+  minDC = maxDC = accdelay = 0;
+}
+
+void LegacyMotorControl::begin(void) {
+  tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB5, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB6, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB7, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB8, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB9, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB10, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB11, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB12, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
+}
+
+void LegacyMotorControl::feedExtruder(long duration) {
+  motorRun(DC_MIN_EXTRUDER, DC_MAX_EXTRUDER, ACCELERATION_DELAY, duration, DIRECTION_FEED);
+  motorBrake();
+}
+
+void LegacyMotorControl::filamentFeed(long duration) {
+  motorRun(DC_MIN_MANUAL_FFED, DC_MAX_MANUAL_FFED, ACCELERATION_DELAY, duration, DIRECTION_FEED);
+  motorBrake();
+}
+
+void LegacyMotorControl::filamentContFeed(void) {
+  motorStart(DC_MIN_MANUAL_FFED, DC_MAX_MANUAL_FFED, ACCELERATION_DELAY, DIRECTION_FEED);
+}
+
+void LegacyMotorControl::filamentLoad(long duration) {
+  motorRun(DC_MIN_MANUAL_LOAD, DC_MAX_MANUAL_LOAD, ACCELERATION_DELAY, duration, DIRECTION_LOAD);
+  motorBrake();
+}
+
+void LegacyMotorControl::filamentContLoad(void) {
+  motorStart(DC_MIN_MANUAL_FFED, DC_MAX_MANUAL_FFED, ACCELERATION_DELAY, DIRECTION_LOAD);
+}
+
+void LegacyMotorControl::motorRun(int minDC, int maxDC, int accdelay, long duration,
+                                  int motorDirection) {
+  int j;
+
+  if(isRunning)
+    motorBrake();
+  setDirection(motorDirection);
+
+  for(j = minDC; j <= maxDC; j++)
+    rampStep(j, accdelay);
+  // Regime speed for the requested time
+  rampStep(maxDC, 0);
+  delay(duration);
+  for(j = maxDC; j > minDC; j--)
+    rampStep(j, accdelay);
+}
+
+void LegacyMotorControl::motorStart(int minDC, int maxDC, int accdelay, int motorDirection) {
+  int j;
+
+  if(isRunning)
+    motorBrake();
+  isRunning = true;
+  this->minDC = minDC;
+  this->maxDC = maxDC;
+  this->accdelay = accdelay;
+  setDirection(motorDirection);
+
+  for(j = minDC; j <= maxDC; j++)
+    rampStep(j, accdelay);
+  tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, maxDC);
+}
+
+void LegacyMotorControl::motorBrake(void) {
+  int j;
+
+  if(isRunning) {
+    for(j = maxDC; j > minDC; j--)
+      rampStep(j, accdelay);
+    isRunning = false;
+  }
+  tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
+  tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
+  if(tleCheckDiagnostic())
+    tleDiagnostic();
+}
+
+void LegacyMotorControl::setDirection(int motorDirection) {
+  if(motorDirection == DIRECTION_FEED) {
+    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
+    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
+  }
+  else {
+    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
+    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
+  }
+}
+
+void LegacyMotorControl::rampStep(int dc, int accdelay) {
+  tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, dc);
+  if(tleCheckDiagnostic())
+    tleDiagnostic();
+  delay(accdelay);
+}
+
+boolean LegacyMotorControl::tleCheckDiagnostic(void) {
+  return tle94112.getSysDiagnosis() != tle94112.TLE_STATUS_OK;
+}
+
+void LegacyMotorControl::tleDiagnostic(void) {
+  if(tle94112.getSysDiagnosis() == tle94112.TLE_STATUS_OK) {
+    Serial.println(TLE_NOERROR);
+    return;
+  }
+  // Open load errors are ignored (_IGNORE_OPENLOAD)
+  if(!tle94112.getSysDiagnosis(tle94112.TLE_LOAD_ERROR)) {
+    Serial.println(TLE_ERROR_MSG);
+    if(tle94112.getSysDiagnosis(tle94112.TLE_SPI_ERROR))
+      Serial.println(TLE_SPIERROR);
+    if(tle94112.getSysDiagnosis(tle94112.TLE_UNDER_VOLTAGE))
+      Serial.println(TLE_UNDERVOLTAGE);
+    if(tle94112.getSysDiagnosis(tle94112.TLE_OVER_VOLTAGE))
+      Serial.println(TLE_OVERVOLTAGE);
+    if(tle94112.getSysDiagnosis(tle94112.TLE_POWER_ON_RESET))
+      Serial.println(TLE_POWERONRESET);
+    if(tle94112.getSysDiagnosis(tle94112.TLE_TEMP_SHUTDOWN))
+      Serial.println(TLE_TEMPSHUTDOWN);
+    if(tle94112.getSysDiagnosis(tle94112.TLE_TEMP_WARNING))
+      Serial.println(TLE_TEMPWARNING);
+    Serial.println("");
+  }
+  tle94112.clearErrors();
+}
@@ -0,0 +1,95 @@
+/**
+ *  \file legacymotor.h
+ *  \brief The motor control of the first release, kept for the benchmarks
+ *
+ *  The ramps step the duty cycle of the TLE94112 with delay() and check
+ *  the driver diagnosis at every step, so every call blocks until the
+ *  motion is done. The benchmarks call it on the simulated board to
+ *  compare the stalls and the driver traffic with the motion engine of
+ *  MotorControl. Low current mode only, the motor on HB1 and HB2.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _LEGACYMOTOR
+#define _LEGACYMOTOR
+
+#include <Arduino.h>
+#include <TLE94112.h>
+#include "motor.h"
+
+/**
+ * \brief The blocking motor control
+ */
+class LegacyMotorControl {
+  public:
+    LegacyMotorControl();
+
+    //! Float the unused half bridges, the driver has been started by
+    //! the firmware
+    void begin(void);
+
+    //! Feed FEED_EXTRUDER_DELAY or duration ms at the extruder speed,
+    //! then brake
+    void feedExtruder(long duration);
+
+    //! Feed duration ms at the manual speed, then brake
+    void filamentFeed(long duration);
+
+    //! Accelerate to the manual feed speed and keep running
+    void filamentContFeed(void);
+
+    //! Load duration ms at the manual speed, then brake
+    void filamentLoad(long duration);
+
+    //! Accelerate to the manual load speed and keep running
+    void filamentContLoad(void);
+
+    /**
+     * Accelerate, keep the regime speed, then decelerate
+     *
+     * \param minDC minimum duty cycle value
+     * \param maxDC maximum duty cycle value
+     * \param accdelay pause ms between the ramp steps
+     * \param duration ms at the regime speed
+     * \param motorDirection DIRECTION_FEED or DIRECTION_LOAD
+     */
+    void motorRun(int minDC, int maxDC, int accdelay, long duration, int motorDirection);
+
+    /**
+     * Accelerate and keep running
+     *
+     * \param minDC minimum duty cycle value
+     * \param maxDC maximum duty cycle value
+     * \param accdelay pause ms between the ramp steps
+     * \param motorDirection DIRECTION_FEED or DIRECTION_LOAD
+     */
+    void motorStart(int minDC, int maxDC, int accdelay, int motorDirection);
+
+    //! Decelerate if running, then brake keeping the half bridges high
+    void motorBrake(void);
+
+  private:
+    boolean isRunning;
+    int minDC;
+    int maxDC;
+    int accdelay;
+
+    //! Set the poles for a direction
+    void setDirection(int motorDirection);
+
+    //! Write a ramp step and check the driver
+    void rampStep(int dc, int accdelay);
+
+    //! true if the driver reports an error
+    boolean tleCheckDiagnostic(void);
+
+    //! Show the driver errors, then clear them
+    void tleDiagnostic(void);
+};
+
+#endif
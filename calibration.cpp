@@ -0,0 +1,159 @@
+/**
+ *  \file calibration.cpp
+ *  \brief Multi-point calibration of the load cell
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "calibration.h"
+
+void ScaleCalibration::start(void) {
+  state = CAL_WAIT;
+  points = 0;
+}
+
+void ScaleCalibration::stop(void) {
+  state = CAL_IDLE;
+}
+
+boolean ScaleCalibration::addPoint(float weight) {
+  if( (state == CAL_IDLE) || (points >= CAL_POINTS) )
+    return false;
+
+  grams[points] = weight;
+  sum = 0;
+  samples = 0;
+  state = CAL_SAMPLING;
+  return true;
+}
+
+boolean ScaleCalibration::addSample(long sample) {
+  if(state != CAL_SAMPLING)
+    return false;
+
+  sum += sample;
+  if(++samples < CAL_SAMPLES)
+    return false;
+
+  raw[points] = (double)sum / samples;
+  halSerial.print("Point ");
+  halSerial.print(points);
+  halSerial.print(": ");
+  halSerial.print(grams[points]);
+  halSerial.print(" gr = ");
+  halSerial.println((long)raw[points]);
+  points++;
+  state = CAL_WAIT;
+  return true;
+}
+
+boolean ScaleCalibration::fit(int order) {
+  // Normal equations of the polynomial fit, the raw values are centered
+  // and scaled to -1 ... 1 to keep the sums well conditioned
+  double m[3][4];
+  double p[3];
+  double rawMean = 0, rawScale = 0;
+  double u, f, d, u0, k;
+  int terms = order + 1;
+  int i, j, r, c;
+
+  if( (order < 1) || (order > 2) || (points < terms) )
+    return false;
+
+  for(i = 0; i < points; i++)
+    rawMean += raw[i];
+  rawMean /= points;
+  for(i = 0; i < points; i++) {
+    if(fabs(raw[i] - rawMean) > rawScale)
+      rawScale = fabs(raw[i] - rawMean);
+  }
+  if(rawScale == 0)
+    return false;
+
+  for(r = 0; r < terms; r++)
+    for(c = 0; c <= terms; c++)
+      m[r][c] = 0;
+  for(i = 0; i < points; i++) {
+    u = (raw[i] - rawMean) / rawScale;
+    for(r = 0; r < terms; r++) {
+      for(c = 0; c < terms; c++)
+        m[r][c] += pow(u, r + c);
+      m[r][terms] += grams[i] * pow(u, r);
+    }
+  }
+
+  // Gaussian elimination with partial pivoting
+  for(c = 0; c < terms; c++) {
+    j = c;
+    for(r = c + 1; r < terms; r++) {
+      if(fabs(m[r][c]) > fabs(m[j][c]))
+        j = r;
+    }
+    if(fabs(m[j][c]) < 1e-12)
+      return false;
+    for(i = 0; i <= terms; i++) {
+      f = m[c][i];
+      m[c][i] = m[j][i];
+      m[j][i] = f;
+    }
+    for(r = c + 1; r < terms; r++) {
+      f = m[r][c] / m[c][c];
+      for(i = c; i <= terms; i++)
+        m[r][i] -= f * m[c][i];
+    }
+  }
+  for(r = terms - 1; r >= 0; r--) {
+    f = m[r][terms];
+    for(c = r + 1; c < terms; c++)
+      f -= m[r][c] * p[c];
+    p[r] = f / m[r][r];
+  }
+  if(terms < 3)
+    p[2] = 0;
+  if(p[1] == 0)
+    return false;
+
+  // The zero of the polynomial nearest to the linear one is the offset,
+  // the slope there is the calibration
+  u0 = -p[0] / p[1];
+  for(i = 0; i < 8; i++) {
+    d = p[1] + 2 * p[2] * u0;
+    if(d == 0)
+      return false;
+    u0 -= (p[0] + p[1] * u0 + p[2] * u0 * u0) / d;
+  }
+  d = p[1] + 2 * p[2] * u0;
+  if(d == 0)
+    return false;
+
+  offset = (long)floor(rawMean + u0 * rawScale + 0.5);
+  calibration = -rawScale / d;
+  quadratic = p[2] / (d * d);
+
+  // Errors of the model on the points
+  maxError = 0;
+  for(i = 0; i < points; i++) {
+    k = (offset - raw[i]) / calibration;
+    f = fabs(k + quadratic * k * k - grams[i]);
+    if(f > maxError)
+      maxError = f;
+  }
+  return true;
+}
+
+void ScaleCalibration::show(void) {
+  halSerial.print("Calibration points: ");
+  halSerial.print(points);
+  halSerial.print("/");
+  halSerial.println(CAL_POINTS);
+  if(state == CAL_SAMPLING) {
+    halSerial.print("Sampling ");
+    halSerial.print(samples);
+    halSerial.print("/");
+    halSerial.println(CAL_SAMPLES);
+  }
+}
@@ -0,0 +1,106 @@
+/**
+ *  \file calibration.h
+ *  \brief Multi-point calibration of the load cell
+ *  
+ *  Reference weights are placed on the scale one at a time; for every
+ *  weight CAL_SAMPLES raw samples are averaged while the acquisition
+ *  continues. The least-squares fit of the points calculates the zero
+ *  offset, the counts per gram and optionally a quadratic term
+ *  correcting the load cell nonlinearity:
+ *  
+ *  w = L + quadratic * L^2, with L = (offset - raw) / calibration
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CALIBRATION
+#define _CALIBRATION
+
+#include "hal.h"
+
+//! Max number of reference weights
+#define CAL_POINTS 8
+//! Raw samples averaged for every reference weight
+#define CAL_SAMPLES 40
+
+#define CAL_IDLE 0        ///< No calibration in progress
+#define CAL_WAIT 1        ///< Waiting for a reference weight
+#define CAL_SAMPLING 2    ///< Averaging the samples of a reference weight
+
+/**
+ * Class collecting the calibration points and fitting the load cell model
+ */
+class ScaleCalibration {
+
+  public:
+    /**
+     * Start a new calibration discarding the collected points
+     */
+    void start(void);
+
+    /**
+     * Stop the calibration
+     */
+    void stop(void);
+
+    /**
+     * Start averaging the samples of a reference weight
+     * 
+     * \param weight the reference weight on the scale in grams
+     * \return false if no calibration is in progress or all the
+     * points have been collected
+     */
+    boolean addPoint(float weight);
+
+    /**
+     * Add a raw sample to the point being collected
+     * 
+     * \param sample the raw sensor value
+     * \return true if the point has been completed
+     */
+    boolean addSample(long sample);
+
+    /**
+     * Fit the model on the collected points. Two points are needed by
+     * the linear model, three by the quadratic one
+     * 
+     * \param order 1 linear, 2 with the quadratic term
+     * \return false if there are not enough points or they do not
+     * define a model
+     */
+    boolean fit(int order);
+
+    /**
+     * Show the collected points and the fit errors
+     */
+    void show(void);
+
+    //! CAL_IDLE, CAL_WAIT or CAL_SAMPLING
+    int state;
+    //! Collected points
+    int points;
+    //! Fitted raw value with no weight
+    long offset;
+    //! Fitted raw counts per gram
+    float calibration;
+    //! Fitted nonlinearity (1 / gram), 0 for the linear model
+    float quadratic;
+    //! Max error of the fitted model on the points in grams
+    float maxError;
+
+  private:
+    //! Reference weights
+    float grams[CAL_POINTS];
+    //! Average raw value of every reference weight
+    double raw[CAL_POINTS];
+    //! Sum of the samples of the point being collected
+    long long sum;
+    //! Samples of the point being collected
+    int samples;
+};
+
+#endif
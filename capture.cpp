@@ -0,0 +1,56 @@
+/**
+ *  \file capture.cpp
+ *  \brief Capture of the raw sensor samples for the offline replay
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "capture.h"
+
+void SampleCapture::start(void) {
+  head = 0;
+  tail = 0;
+  captured = 0;
+  lost = 0;
+  running = true;
+}
+
+void SampleCapture::stop(void) {
+  running = false;
+}
+
+void SampleCapture::add(const scaleSample& sample) {
+  if(!running)
+    return;
+
+  captured++;
+  // One slot is kept empty to tell a full ring from an empty one
+  if(((head + 1) & (CAPTURE_SAMPLES - 1)) == tail) {
+    lost++;
+    return;
+  }
+  ring[head] = sample;
+  head = (head + 1) & (CAPTURE_SAMPLES - 1);
+}
+
+boolean SampleCapture::read(scaleSample& sample) {
+  if(tail == head)
+    return false;
+
+  sample = ring[tail];
+  tail = (tail + 1) & (CAPTURE_SAMPLES - 1);
+  return true;
+}
+
+void SampleCapture::show(void) {
+  halSerial.print("Capture: ");
+  halSerial.print(running ? "on, " : "off, ");
+  halSerial.print(captured);
+  halSerial.print(" samples, ");
+  halSerial.print(lost);
+  halSerial.println(" lost");
+}
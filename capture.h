@@ -0,0 +1,81 @@
+/**
+ *  \file capture.h
+ *  \brief Capture of the raw sensor samples for the offline replay
+ *  
+ *  While the capture is running every raw HX711 sample filtered by
+ *  readScale() is copied in a small ring, then sent on the serial as
+ *  a telemetryCapture record by the transmission task. The records
+ *  keep the sample timestamp, so the host can replay the exact
+ *  sequence through the weight processing to tune its parameters.\n
+ *  The ring holds the samples of a few transmission periods: if the
+ *  serial can not keep the pace the newest samples are lost and counted.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CAPTURE
+#define _CAPTURE
+
+#include "hal.h"
+#include "scalesampler.h"
+
+//! Samples waiting to be sent, a power of 2
+#define CAPTURE_SAMPLES 16
+
+/**
+ * Class buffering the raw samples to be captured
+ */
+class SampleCapture {
+
+  public:
+    /**
+     * Clear the ring and the counters, then start capturing
+     */
+    void start(void);
+
+    /**
+     * Stop capturing, the samples in the ring are still sent
+     */
+    void stop(void);
+
+    /**
+     * Add a sample, ignored if the capture is not running
+     * 
+     * \param sample the raw sample
+     */
+    void add(const scaleSample& sample);
+
+    /**
+     * Extract the oldest sample not yet sent
+     * 
+     * \param sample the extracted sample
+     * \return false if the ring is empty
+     */
+    boolean read(scaleSample& sample);
+
+    /**
+     * Show the samples captured and lost since the start
+     */
+    void show(void);
+
+    //! The capture is running
+    boolean running;
+    //! Samples added since the start
+    unsigned long captured;
+    //! Samples lost as the ring was full
+    unsigned long lost;
+
+  private:
+    //! The samples not yet sent
+    scaleSample ring[CAPTURE_SAMPLES];
+    //! Index of the next sample to add
+    uint8_t head;
+    //! Index of the oldest sample
+    uint8_t tail;
+};
+
+#endif
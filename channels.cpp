@@ -0,0 +1,29 @@
+/**
+ *  \file channels.cpp
+ *  \brief Spool channels driven by the board
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "channels.h"
+
+// Only the pins 2 and 3 of the XMC1100 Boot Kit have the external
+// interrupt, the other HX711 are polled by the main loop
+const channelMap channelTable[CHANNELS_MAX] = {
+#ifdef _HIGHCURRENT
+  { 3, 4, 1, 3 },
+  { 2, 5, 5, 7 },
+  { 6, 7, 9, 11 }
+#else
+  { 3, 4, 1, 2 },
+  { 2, 5, 3, 4 },
+  { 6, 7, 5, 6 },
+  { 9, A0, 7, 8 },
+  { A1, A2, 9, 10 },
+  { A3, A4, 11, 12 }
+#endif
+};
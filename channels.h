@@ -0,0 +1,60 @@
+/**
+ *  \file channels.h
+ *  \brief Spool channels driven by the board
+ *  
+ *  Every channel is a complete dispenser: a load cell with its HX711 and
+ *  a motor connected to a pair of TLE94112 half bridges (two pairs in
+ *  _HIGHCURRENT mode). The TLE94112 has three PWM generators, the
+ *  channels n and n + 3 share the generator (n % 3) + 1 and their motors
+ *  run in turns (see MOTOR_PWM_SLICE).
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CHANNELS
+#define _CHANNELS
+
+#include "hal.h"
+#include "motor.h"
+
+//! Number of spools connected to the board, 1 ... CHANNELS_MAX
+#define SPOOL_CHANNELS 1
+
+#ifdef _HIGHCURRENT
+//! Every motor uses four half bridges
+#define CHANNEL_BRIDGES 4
+#else
+//! Every motor uses two half bridges
+#define CHANNEL_BRIDGES 2
+#endif
+//! Channels supported by the driver
+#define CHANNELS_MAX (HAL_BRIDGES / CHANNEL_BRIDGES)
+
+#if (SPOOL_CHANNELS < 1) || (SPOOL_CHANNELS > CHANNELS_MAX)
+#error "SPOOL_CHANNELS out of range"
+#endif
+
+/**
+ * Pins and half bridges of a channel
+ */
+struct channelMap {
+  //! HX711 data pin. Pins without external interrupt are polled
+  int dout;
+  //! HX711 clock pin
+  int clk;
+  //! Half bridge of the motor pole high when feeding
+  //! (with _HIGHCURRENT also the following one)
+  int feedHB;
+  //! Half bridge of the motor pole high when loading
+  //! (with _HIGHCURRENT also the following one)
+  int loadHB;
+};
+
+//! Channel pins and half bridges, indexed by the channel number
+extern const channelMap channelTable[CHANNELS_MAX];
+
+#endif
@@ -25,27 +25,37 @@
 #define CMD_WEIGHT "Weight "
 #define CMD_WRONGCMD "wrong value "
 #define CMD_EXTRUDERPULL "WARNING!!!"
+#define CMD_TOOLONG "(too long)"
+#define CMD_PLANFULL "(schedule full)"
+#define CMD_WRONGSTATE "not allowed in status"
+#define CMD_UNSORTED "commands table not sorted at"
+#define CMD_CHANNEL "Channel: "
 
-// Filament setup
-#define SET_PLA "PLA"
-#define SET_ABS "ABS"
-#define SET_175 "1.75"
-#define SET_300 "3.00"
-#define SET_1KG "1kg"
-#define SET_2KG "2kg"
+// Filament setup: the material, diameter and spool names of the
+// catalogue (materials.cpp) are commands selecting them
+#define CATALOGUE_MATERIALS "material"
+#define CATALOGUE_DIAMETERS "diameter"
+#define CATALOGUE_SPOOLS "spool"
 
 // Units settings
 #define SET_WEIGHT "gr"
 #define SET_CENTIMETERS "cm"
 
 // Calibration process
-#define MANUAL_CALIBRATION "calibration"
+#define MANUAL_CALIBRATION "calibration"  // Start the calibration
+#define CAL_POINT "cal"                   // Reference weight on the scale [gr]
+#define CAL_END "calend"                  // Fit [1 linear, 2 quadratic] and apply
+#define CAL_FAILED "not enough calibration points"
+
+// Spool channel of the commands without the "<channel>:" prefix
+#define SELECT_CHANNEL "channel"
 
 // Status change
 #define S_RESET "reset"        // Reset the system with the current filament setup
 #define S_LOAD "load"          // Filament roll has been loaded
 #define S_RUN "run"            // Print job is running
 #define S_DEFAULT "default"    // Reset the system with the default settings
+#define S_TARE "tare"          // Set the zero of the scale (no spool)
 
 // Running mode
 #define MODE_AUTO "auto"        // Run in automatic mode
@@ -58,12 +68,67 @@
 #define MOTOR_STOP "stop"       // Pull back a lenght unit
 #define MOTOR_FEED_CONT "feedc"    // Feed continuopusly
 #define MOTOR_PULL_CONT "pullc"    // Pull back continuously
+
+// Tension regulator tuning, without argument shows the current values
+#define TUNE_KP "kp"              // Proportional gain
+#define TUNE_KI "ki"              // Integral gain
+#define TUNE_TENSION "tension"    // Tension setpoint in grams
+
+// Driver faults and status poll period
+#define SHOW_DIAGNOSTICS "diag"
+
+// Filament demand schedule, see feedplan.h
+#define PLAN_BIN "plan"           // Queue the demand of the next bin [mg]
+#define PLAN_START "plango"       // Follow the schedule [ms per bin], 0 stops
 #endif
 
+// Filament needed by the running job [gr], shows the runout forecast
+#define JOB_WEIGHT "job"
+
 // Information commands
+#define SHOW_HELP "help"          // List the available commands
 #define SHOW_INFO "info"          // Shows roll current info
 #define SHOW_STATUS "stat"      // Shows weight status values
 #define SHOW_DUMP "conf"        // Dump the current settings
 #define SHOW_WEIGHT "weight"      // Show the current read weight
+#define SHOW_ACQUISITION "acq"    // Show the sensor acquisition rate and lost samples
+#define SHOW_HISTORY "history"    // Stream the consumption history of the job
+#define SHOW_TASKS "tasks"        // Tasks execution time and deadline misses
+#define SHOW_PERF "perf"          // Probes timing histograms and counters (_PERF)
+#define SHOW_MACHINE "mstat"      // Machine readable status lines every [ms], 0 stops
+
+// Machine readable lines: the prefix followed by key=value fields
+// separated by a space
+#define MSTAT_STATUS "@stat"      // Status of a channel
+#define MSTAT_FAULT "@fault"      // New driver faults
+#define MSTAT_RUNOUT "@runout"    // Spool runout forecast warning
+
+// Binary stream
+#define TELEMETRY "telemetry"     // Stream binary records every [ms], 0 stops
+#define CAPTURE "capture"         // Stream the raw samples [1 starts, 0 stops]
+
+// Commands argument specification
+#define ARG_NONE 0      ///< The command has no argument
+#define ARG_INT 1       ///< The command accepts an optional integer argument
+#define ARG_FLOAT 2     ///< The command accepts an optional decimal argument
+
+//! Command handler, the argument is an empty string if not present
+typedef void (*commandHandler)(const char* arg);
+
+/**
+ * Commands table entry
+ */
+struct command {
+  //! The command name as sent on the serial
+  const char* name;
+  //! Function executing the command
+  commandHandler handler;
+  //! Argument accepted (ARG_NONE, ARG_INT, ARG_FLOAT)
+  int argSpec;
+  //! Minimum status ID (STAT_NONE ... STAT_RUN) the command can be executed
+  int requiredState;
+  //! Short description shown by the help command
+  const char* help;
+};
 
 #endif
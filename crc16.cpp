@@ -0,0 +1,28 @@
+/**
+ *  \file crc16.cpp
+ *  \brief CRC-16/CCITT used by the telemetry frames and the stored settings
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "crc16.h"
+
+uint16_t crc16(const uint8_t* data, int length) {
+  uint16_t crc = 0xffff;
+  int j, k;
+
+  for(j = 0; j < length; j++) {
+    crc ^= (uint16_t)data[j] << 8;
+    for(k = 0; k < 8; k++) {
+      if(crc & 0x8000)
+        crc = (crc << 1) ^ 0x1021;
+      else
+        crc <<= 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,26 @@
+/**
+ *  \file crc16.h
+ *  \brief CRC-16/CCITT used by the telemetry frames and the stored settings
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CRC16
+#define _CRC16
+
+#include <stdint.h>
+
+/**
+ * Calculate the CRC-16/CCITT (polynomial 0x1021, init 0xFFFF)
+ * 
+ * \param data the bytes
+ * \param length the number of bytes
+ * \return the CRC
+ */
+uint16_t crc16(const uint8_t* data, int length);
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ *  \file diagnostics.cpp
+ *  \brief Cached diagnosis of the TLE94112 driver
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "diagnostics.h"
+#include "perf.h"
+
+//! Fault names, index is the HAL_DIAG_* bit position
+static const char* const faultNames[DIAG_FAULTS] = {
+  TLE_SPIERROR, TLE_LOADERROR, TLE_UNDERVOLTAGE, TLE_OVERVOLTAGE, 
+  TLE_POWERONRESET, TLE_TEMPSHUTDOWN, TLE_TEMPWARNING
+};
+
+void BridgeDiagnostics::begin(void) {
+  int j;
+
+  faults = HAL_DIAG_OK;
+  period = DIAG_POLL_PERIOD;
+  reads = 0;
+  for(j = 0; j < DIAG_FAULTS; j++)
+    counters[j] = 0;
+  lastPoll = halMillis();
+}
+
+int BridgeDiagnostics::poll(boolean running) {
+  int previous = faults;
+  int j;
+
+  if((halMillis() - lastPoll) < (running ? period : DIAG_IDLE_PERIOD))
+    return HAL_DIAG_OK;
+  lastPoll = halMillis();
+  PERF_SCOPE(PERF_DIAGNOSIS);
+
+  faults = halBridgeDiagnosis();
+  reads++;
+  if(faults == HAL_DIAG_OK)
+    return HAL_DIAG_OK;
+
+  // Count the faults appeared since the last read
+  if(faults & ~previous)
+    PERF_COUNT(PERF_FAULTS);
+  for(j = 0; j < DIAG_FAULTS; j++) {
+    if( (faults & ~previous) & (1 << j) )
+      counters[j]++;
+  }
+  // The errors are latched by the driver: clear them so the
+  // next read shows if they are still present
+  halBridgeClearErrors();
+
+  return faults & ~previous;
+}
+
+void BridgeDiagnostics::show(void) {
+  int j;
+
+  if(faults == HAL_DIAG_OK) {
+    halSerial.println(TLE_NOERROR);
+    return;
+  }
+#ifdef _IGNORE_OPENLOAD
+  // Open load error can be ignored
+  if(faults == HAL_DIAG_LOAD_ERROR)
+    return;
+#endif
+
+  halSerial.println(TLE_ERROR_MSG);
+  for(j = 0; j < DIAG_FAULTS; j++) {
+    if(faults & (1 << j))
+      halSerial.println(faultNames[j]);
+  }
+  halSerial.println("");
+}
+
+void BridgeDiagnostics::showCounters(void) {
+  int j;
+
+  for(j = 0; j < DIAG_FAULTS; j++) {
+    halSerial.print(faultNames[j]);
+    halSerial.print(": ");
+    halSerial.println(counters[j]);
+  }
+  halSerial.print("Status reads: ");
+  halSerial.print(reads);
+  halSerial.print(" every ");
+  halSerial.print(period);
+  halSerial.println(" ms");
+  halSerial.print("Driver accesses: ");
+  halSerial.println(halBridgeTransactions());
+  halSerial.println("");
+}
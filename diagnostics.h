@@ -0,0 +1,79 @@
+/**
+ *  \file diagnostics.h
+ *  \brief Cached diagnosis of the TLE94112 driver
+ *  
+ *  The driver status register is read at a fixed rate instead of after
+ *  every PWM update. The decoded fault bits are cached for the rest of
+ *  the application and every fault type has its occurrence counter.
+ *  Critical faults (DIAG_CRITICAL) are notified at the first read
+ *  showing them, so the motor can be stopped immediately.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _DIAGNOSTICS
+#define _DIAGNOSTICS
+
+#include "hal.h"
+#include "motor.h"
+
+//! Default ms between two status reads while the motor is running
+#define DIAG_POLL_PERIOD 50
+//! Min ms between two status reads
+#define DIAG_MIN_PERIOD 5
+//! ms between two status reads while the motor is stopped
+#define DIAG_IDLE_PERIOD 1000
+//! Faults stopping the motor immediately
+#define DIAG_CRITICAL (HAL_DIAG_TEMP_SHUTDOWN | HAL_DIAG_OVER_VOLTAGE)
+//! Number of fault types (HAL_DIAG_* bits)
+#define DIAG_FAULTS 7
+
+/**
+ * Class caching the driver diagnosis
+ */
+class BridgeDiagnostics {
+
+  public:
+    /**
+     * Clear the cached status and the counters
+     */
+    void begin(void);
+
+    /**
+     * Read the driver status if the poll period is elapsed
+     * 
+     * \param running true if the motor is running (DIAG_IDLE_PERIOD is
+     * used when stopped)
+     * \return the fault bits not present at the previous read
+     */
+    int poll(boolean running);
+
+    /**
+     * Show the cached status
+     */
+    void show(void);
+
+    /**
+     * Show the counters of every fault type and the driver accesses
+     */
+    void showCounters(void);
+
+    //! Fault bits of the last read (HAL_DIAG_*)
+    int faults;
+    //! ms between two reads while the motor is running
+    unsigned int period;
+    //! Status reads executed
+    unsigned long reads;
+    //! Occurrences of every fault type, index is the bit position
+    unsigned int counters[DIAG_FAULTS];
+
+  private:
+    //! halMillis() of the last read
+    unsigned long lastPoll;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ *  \file drifttracker.cpp
+ *  \brief Online zero drift and creep compensation of the load cell
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "drifttracker.h"
+
+void DriftTracker::reset(void) {
+  offset = 0;
+  rate = 0;
+  rateCarry = 0;
+  tracked = 0;
+  tracking = false;
+  still = false;
+  lastTime = halMillis();
+}
+
+void DriftTracker::update(long mg, boolean quiet, unsigned long timestamp) {
+  unsigned long elapsed = timestamp - lastTime;
+  long weight, residual, limit;
+
+  // The drift goes on also when it can not be observed
+  lastTime = timestamp;
+  rateCarry += (long long)rate * elapsed;
+  offset += (long)(rateCarry / 1000000);
+  rateCarry %= 1000000;
+  if(!tracking)
+    rate -= (long)((long long)rate * elapsed / DRIFT_RATE_DECAY);
+  weight = mg - offset / 1000;
+
+  // A real weight change ends the still period
+  if( still && (abs(weight - (tracking ? reference : settleSum / settleCount)) > DRIFT_STILL_BAND) )
+    still = false;
+  if(!quiet) {
+    still = false;
+    return;
+  }
+
+  if(!still) {
+    still = true;
+    tracking = false;
+    stillStart = timestamp;
+    settleSum = 0;
+    settleCount = 0;
+  }
+
+  // The readings after a change are not stable yet, their
+  // average is the weight to hold
+  if(!tracking) {
+    settleSum += weight;
+    settleCount++;
+    if((timestamp - stillStart) >= DRIFT_SETTLE) {
+      reference = settleSum / settleCount;
+      tracking = true;
+      rateOffset = offset;
+      rateTime = 0;
+    }
+    return;
+  }
+
+  // The weight has not changed, the residual is drift
+  residual = (mg - reference) * 1000 - offset;
+  limit = DRIFT_MAX_RATE * (long)elapsed / 1000;
+  offset += constrain(residual / DRIFT_ALPHA_DIV, -limit, limit);
+  tracked += elapsed;
+
+  // The rate is measured on a long interval, the short ones
+  // are dominated by the noise
+  rateTime += elapsed;
+  if(rateTime >= DRIFT_RATE_TIME) {
+    rate = constrain((long)((long long)(offset - rateOffset) * 1000000 / rateTime),
+                     -DRIFT_MAX_RATE * 1000L, DRIFT_MAX_RATE * 1000L);
+    rateOffset = offset;
+    rateTime = 0;
+  }
+}
+
+void DriftTracker::show(void) {
+  halSerial.print("Drift: ");
+  halSerial.print(offset / 1000000.0);
+  halSerial.print(" gr (");
+  halSerial.print(rate * 3.6 / 1000000.0);
+  halSerial.print(" gr/h, tracked ");
+  halSerial.print(tracked / 1000);
+  halSerial.println(" s)");
+}
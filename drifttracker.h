@@ -0,0 +1,104 @@
+/**
+ *  \file drifttracker.h
+ *  \brief Online zero drift and creep compensation of the load cell
+ *
+ *  The load cell zero moves with the temperature and creeps under the
+ *  constant load of the spool. When the scale is quiescent (no job
+ *  running, or motor idle and no extruder pull) the real weight does not
+ *  change, so the variation of the readings is drift.\n
+ *  After DRIFT_SETTLE ms of still readings their average becomes the
+ *  reference; while the readings stay inside DRIFT_STILL_BAND from it
+ *  the drift follows the residual and its rate is measured every
+ *  DRIFT_RATE_TIME ms. Outside the quiescent periods the drift is
+ *  extrapolated with the last rate, decaying as the creep does.\n
+ *  The corrections are bounded to DRIFT_MAX_RATE: a weight change
+ *  faster than the drift leaves the band and restarts the settling
+ *  instead of being learned.\n
+ *  The drift is integer in ug and its rate in ng/s, the corrections of
+ *  a reading are a fraction of a mg.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _DRIFTTRACKER
+#define _DRIFTTRACKER
+
+#include "hal.h"
+
+//! ms of still readings before the drift is tracked
+#define DRIFT_SETTLE 20000
+//! Max distance (mg) of the readings from the reference while still
+#define DRIFT_STILL_BAND 400
+//! Drift correction for every reading as 1 / DRIFT_ALPHA_DIV of the residual
+#define DRIFT_ALPHA_DIV 16
+//! ms of tracking the drift rate is measured on
+#define DRIFT_RATE_TIME 300000
+//! Time constant (ms) of the extrapolated rate decay, as the creep
+//! slows down exponentially
+#define DRIFT_RATE_DECAY 1800000
+//! Max drift rate (ug/s)
+#define DRIFT_MAX_RATE 1000
+//! Max consumption rate (gr/s) of a running job considered quiescent
+#define DRIFT_QUIET_RATE 0.003
+
+/**
+ * Class estimating the zero drift of the load cell
+ */
+class DriftTracker {
+
+  public:
+    /**
+     * Clear the drift, should be called when the zero is set again
+     * (tare or calibration)
+     */
+    void reset(void);
+
+    /**
+     * Update the estimation with a new reading
+     *
+     * \param mg the reading not compensated, in mg
+     * \param quiet true if the real weight is not expected to change
+     * \param timestamp halMillis() of the reading
+     */
+    void update(long mg, boolean quiet, unsigned long timestamp);
+
+    /**
+     * Show the drift, the rate and the time it has been tracked
+     */
+    void show(void);
+
+    //! Estimated drift (ug), to be subtracted from the readings
+    long offset;
+    //! Estimated drift rate (ng/s)
+    long rate;
+    //! ms of quiescent readings the drift has been learned from
+    unsigned long tracked;
+
+  private:
+    //! Compensated weight the readings should stay at (mg)
+    long reference;
+    //! Sum of the compensated readings while settling (mg)
+    long settleSum;
+    //! Readings while settling
+    int settleCount;
+    //! halMillis() of the first still reading
+    unsigned long stillStart;
+    //! Drift at the start of the rate measure (ug)
+    long rateOffset;
+    //! Drift extrapolated and not yet added to the offset (ng ms / s)
+    long long rateCarry;
+    //! ms of tracking since the start of the rate measure
+    unsigned long rateTime;
+    //! halMillis() of the last reading
+    unsigned long lastTime;
+    //! The reference is set and the drift is tracked
+    boolean tracking;
+    //! The readings are still, settling or tracking
+    boolean still;
+};
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ *  \file feedplan.cpp
+ *  \brief Filament demand schedule sent by the host
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "feedplan.h"
+
+void FeedPlan::begin(void) {
+  running = false;
+  head = 0;
+  tail = 0;
+  bins = 0;
+  underruns = 0;
+  underrun = false;
+  late = 0;
+  binTime = PLAN_BIN_TIME;
+}
+
+boolean FeedPlan::add(unsigned int mg) {
+  if(late > 0) {
+    late--;
+    return true;
+  }
+  // One slot is kept empty to tell a full queue from an empty one
+  if(((head + 1) & (PLAN_BINS - 1)) == tail)
+    return false;
+
+  queue[head] = min(mg, PLAN_MAX_DEMAND);
+  head = (head + 1) & (PLAN_BINS - 1);
+  return true;
+}
+
+void FeedPlan::start(unsigned int ms) {
+  binTime = max(ms, PLAN_MIN_BIN_TIME);
+  startTime = halMillis();
+  bins = 0;
+  late = 0;
+  underrun = false;
+  running = true;
+}
+
+measure_t FeedPlan::demand(unsigned long now) {
+  unsigned long current;
+
+  if(!running)
+    return -1;
+
+  // Drop the bins elapsed, the queue holds the current one first.
+  // The bins elapsed before being queued are dropped when they arrive
+  current = (now + PLAN_LEAD - startTime) / binTime;
+  while(bins < current) {
+    if(tail != head)
+      tail = (tail + 1) & (PLAN_BINS - 1);
+    else
+      late++;
+    bins++;
+  }
+
+  if(tail == head) {
+    if(!underrun)
+      underruns++;
+    underrun = true;
+    return -1;
+  }
+  underrun = false;
+  return MEASURE_FROM_MILLI((long)queue[tail] * 1000 / binTime);
+}
+
+void FeedPlan::show(void) {
+  halSerial.print("Plan: ");
+  halSerial.print(running ? "running, " : "stopped, ");
+  halSerial.print((head - tail) & (PLAN_BINS - 1));
+  halSerial.print(" bins queued, ");
+  halSerial.print(bins);
+  halSerial.print(" done, ");
+  halSerial.print(underruns);
+  halSerial.print(" underruns, ");
+  halSerial.print(binTime);
+  halSerial.println(" ms/bin");
+}
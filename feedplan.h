@@ -0,0 +1,107 @@
+/**
+ *  \file feedplan.h
+ *  \brief Filament demand schedule sent by the host
+ *  
+ *  The G-code of the job tells in advance how much filament every move
+ *  needs. The host sends the demand as a sequence of bins, written from
+ *  the G-code file by tools/gcodeplan: every bin is the filament (mg)
+ *  the extruder will pull in binTime ms. When the
+ *  schedule is started the bins are consumed at the printer pace and
+ *  the demand of the bin PLAN_LEAD ms ahead replaces the estimated
+ *  consumption as feed-forward of the tension regulator, so the roll
+ *  unwinds before the tension builds up. The regulator still corrects
+ *  the tension measured by the scale.\n
+ *  When the host is late and the bin is not yet queued the estimated
+ *  consumption is used again and an underrun is counted.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _FEEDPLAN
+#define _FEEDPLAN
+
+#include "hal.h"
+#include "fixedpoint.h"
+
+//! Bins queued, a power of 2
+#define PLAN_BINS 64
+//! Default ms of filament demand in a bin
+#define PLAN_BIN_TIME 1000
+//! Min ms of a bin
+#define PLAN_MIN_BIN_TIME 100
+//! ms the feed anticipates the demand, the motor acceleration time
+#define PLAN_LEAD 500
+//! Max demand of a bin (mg)
+#define PLAN_MAX_DEMAND 65535
+
+/**
+ * Class following the demand schedule
+ */
+class FeedPlan {
+
+  public:
+    /**
+     * Stop the schedule and clear the queue and the counters
+     */
+    void begin(void);
+
+    /**
+     * Queue the demand of the next bin
+     * 
+     * \param mg the filament pulled by the extruder in the bin
+     * \return false if the queue is full, a bin already elapsed is
+     * accepted and dropped
+     */
+    boolean add(unsigned int mg);
+
+    /**
+     * Start following the schedule, the first queued bin starts now
+     * 
+     * \param ms the bin time
+     */
+    void start(unsigned int ms);
+
+    /**
+     * Demand of the bin PLAN_LEAD ms ahead, the bins already elapsed
+     * are removed from the queue
+     * 
+     * \param now halMillis()
+     * \return the demand in weight per second, negative if the schedule
+     * is not running or the bin is not queued
+     */
+    measure_t demand(unsigned long now);
+
+    /**
+     * Show the schedule status
+     */
+    void show(void);
+
+    //! The schedule is followed
+    boolean running;
+    //! Bins consumed since the start
+    unsigned long bins;
+    //! Times the bin to follow was not queued
+    unsigned long underruns;
+
+  private:
+    //! Demand of the queued bins (mg)
+    uint16_t queue[PLAN_BINS];
+    //! Index of the next bin to add
+    uint8_t head;
+    //! Index of the current bin
+    uint8_t tail;
+    //! ms of a bin
+    unsigned int binTime;
+    //! halMillis() of the schedule start
+    unsigned long startTime;
+    //! Bins elapsed before being queued, to be dropped
+    unsigned long late;
+    //! The last bin requested was not queued
+    boolean underrun;
+};
+
+#endif
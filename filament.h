@@ -2,6 +2,9 @@
  *  \file filament.h
  *  \brief Filament material parameters
  *  
+ *  The supported materials, diameters and spools are listed in the
+ *  catalogue (materials.cpp), the notes below are for reference.
+ *  
  *  PLA
  *  Density: 1.25 g/cm^3
  *  Volume: 0.80 cm^3/g or 800 cm^3/kg
@@ -24,9 +27,15 @@
 #ifndef _FILAMENT
 #define _FILAMENT
 
+#include "materials.h"
+
 //! Define motor is using the automatic dispenser
 #define _USE_MOTOR
 
+//! Define to calculate weight, length and percentage in integer math
+//! (see fixedpoint.h). Suggested on micro controllers without FPU
+#undef _FIXED_POINT
+
 #undef _DEBUG_FILAMENT
 
 //! Application title shown on startup
@@ -34,43 +43,20 @@
 
 #define MSG_USED "used: "
 #define MSG_REMAINING "remain: "
-
-// Material type IDs
-#define PLA 0
-#define ABS 1
-
-// Diameter IDs
-#define DIAM_175 0
-#define DIAM_300 1
-
-// Material filament IDs (calculated during initialisation)
-#define PLA175 0
-#define PLA300 1
-#define ABS175 2
-#define ABS300 3
-
-// Roll tare (gr)
-#define ROLL1KG_TARE 225.0
-#define ROLL2KG_TARE 250.0 // Not real!!! Should be known
-
-// Roll kind ID
-#define ROLL1KG 0
-#define ROLL2KG 1
+#define MSG_RATE "rate: "
+#define MSG_RUNOUT "WARNING!!! Spool runout"
 
 #define SYS_READY "Ready"       // System ready
 #define SYS_RUN "Running"   // Filament in use
 #define SYS_LOAD "Load"         // Roll loaded
 #define SYS_STARTED "Started"   // Application started
 
-// Status codes
+// Status codes, index of the status names
 #define STAT_NONE 0
 #define STAT_READY 1
 #define STAT_LOAD 2
 #define STAT_RUN 3
 
-#define DIAMETER175 "1.75 mm"
-#define DIAMETER300 "3.00 mm"
-
 // How mamny centimeters in 1 meter (???)
 #define CENTIMETERS_PER_METER 100
 
@@ -79,31 +65,10 @@
 #define UNITS_CM "cm"
 #define UNITS_MT "m"
 #define UNITS_KG "Kg"
+#define UNITS_MM "mm"
+#define UNITS_PER_SEC "/s"
 #define FILAMENT_ROLL "Roll"
 
-#define PLA_MAT "PLA"
-#define ABS_MAT "ABS"
-
-//! Length in cm for 1 gr 1.75 mm PLA filament
-#define PLA175_1GR_CM 33.0
-// Weight in gr for 1 cm 1.75 mm PLA filament
-#define PLA175_1CM_GR 0.03
-
-//! Length in cm for 1 gr 3.00 mm PLA filament
-#define PLA300_1GR_CM 11.0
-// Weight in gr for 1 cm 3.00 mm PLA filament
-#define PLA300_1CM_GR 0.09
- 
-//! Length in cm for 1 gr 1.75 mm ABS filament
-#define ABS175_1GR_CM 40.0
-//! Weight in gr for 1 cm 1.75 mm ABS filament
-#define ABS175_1CM_GR 0.025
-
-//! Length in cm for 1 gr 3.00 mm ABS filament
-#define ABS300_1GR_CM 13.0
-//! Weight in gr for 1 cm 3.00 mm ABS filament
-#define ABS300_1CM_GR 0.076
-
 //! 1Kg Roll spool average weight in gr (tare)
 //! We assume that the plastic empty roll weight is
 //! the same for any kind but this parameter should
@@ -114,11 +79,36 @@
 #define MOTOR_WEIGHT 158.50
 
 //! This value is calculated empirycally and is the zero weight for the
-//! used 3D printed model
+//! used 3D printed model. It is used until the scale is calibrated with
+//! the calibration commands
 #define SCALE_CALIBRATION 434.50
 
-//! Numer of reading steps used by the three pass manual calibration
-#define CALIBRATION_STEPS 10
+//! Number of samples averaged by the tare
+#define SCALE_TARE_SAMPLES 10
+
+//! Max ms waiting for the tare samples
+#define SCALE_TARE_TIMEOUT 2000
+
+//! Main loop tasks period (ms), see setup()
+#define TASK_SENSOR_PERIOD 5
+#define TASK_MOTION_PERIOD 5
+#define TASK_RX_PERIOD 5
+//! Max lines executed by a pass of the receive task, more than the
+//! shortest lines arriving in TASK_RX_PERIOD ms
+#define TASK_RX_LINES 12
+//! Max ms from a new reading to the motor speed update
+#define TASK_FEED_DEADLINE 10
+//! Max ms from the diagnosis poll release to its completion
+#define TASK_DIAG_DEADLINE 10
+
+//! Min ms between two machine readable status streams, one line for
+//! every spool channel (see channels.h) takes ~30 ms at 38400 baud
+#define MSTAT_MIN_PERIOD (100 * SPOOL_CHANNELS)
+
+//! ms between two toggles of the status LED
+#define LED_PERIOD 100
+//! Toggles of the status LED on a status change (4 seconds)
+#define LED_TOGGLES 40
 
 //! Minimum weight difference between two updates in grams
 #define SCALE_RESOLUTION 1.50
@@ -132,10 +122,31 @@
 //! Multiple samples reading gives more stability to the measure
 #define SCALE_SAMPLES 10
 
-//! Minimum number of grams variation between two reading too high
+//! Filter stages applied to the samples depending on the status.
+//! While loading the roll the readings should be stable, while 
+//! running the extruder pull should be detected as soon as possible:
+//! the short EMA after the median removes part of its noise and still
+//! shows the pull faster than the block average. A longer EMA delays
+//! the tension regulation until the readings oscillate and the
+//! consumption rate is lost (see bench/bench_filter.cpp)
+#define FILTER_STAGES_DEFAULT (FILTER_MEDIAN | FILTER_EMA)
+#define FILTER_STAGES_LOAD (FILTER_MEDIAN | FILTER_GATE | FILTER_KALMAN)
+#define FILTER_STAGES_RUN (FILTER_MEDIAN | FILTER_EMA_FAST)
+
+//! Minimum number of grams of deviation from the roll weight too high
 //! to be considered weight change (tension by the Extruder)
 #define MIN_EXTRUDER_TENSION 100
 
+//! Max filament consumption (gr/s) expected from the printer
+#define MAX_CONSUMPTION_RATE 0.1
+
+//! Max grams the roll weight read with the filament released can be below
+//! the expected one, a larger difference means the filament was not loose
+#define RELEASE_TOLERANCE 10
+//! ms the consumption measured between two releases of the filament is
+//! used, then the readings slope is used again
+#define RELEASE_RATE_VALIDITY 150000
+
 //! Filament units IDs
 #define _GR 1
 #define _CM 2
@@ -10,66 +10,262 @@
  */
 
 #include "filamentweight.h"
+#include "perf.h"
 
-void FilamentWeight::begin(void) {
-  scaleSensor.begin(DOUT, CLK);
+//! Status names, indexed by the status ID
+static const char* const statusNames[] = { SYS_STARTED, SYS_READY, SYS_LOAD, SYS_RUN };
+
+void FilamentWeight::begin(int ch) {
+  channel = ch;
   // Assign the LED pint number and initialize the output  
   ledPin = 12;
-  pinMode(ledPin, OUTPUT);   // LED reading signal
+  halPinOutput(ledPin);   // LED reading signal
+  ledToggles = 0;
+  sensorRead = 0;
+  lastRaw = 0;
+  sampleCount = 0;
+  scaleOffset = 0;
   scaleCalibration = SCALE_CALIBRATION;
-  // Initialise the scale with the model calibration factor then set the initial weight to 0
-  scaleSensor.set_scale(scaleCalibration);
-  scaleSensor.tare();
-  // Initialised the default values for the default filament type
-  setDefaults();
+  quadratic = 0;
+  calibration.stop();
+  capture.stop();
+  runout.stop();
+  history.begin();
+  drift.reset();
+  motorActive = false;
+  filamentLoose = false;
+  taring = false;
+  // Start the interrupt-driven acquisition
+  sampler.begin(channelTable[channel].dout, channelTable[channel].clk);
+  // Restore the calibration, the tare and the filament settings
+  // of the last session; the scale is not tared again as the spool
+  // can be already loaded
+  if(!restoreSettings()) {
+    // Initialised the default values for the default filament type
+    // and set the initial weight to 0
+    setDefaults();
+    tare();
+    saveSettings();
+  }
+  // Noise readings are discarded while loading
+  filter.begin(FILTER_STAGES_DEFAULT, (long)(MAX_DELTA_WEIGHT_IN_RANGE * scaleCalibration));
+  filterStatID = STAT_NONE;
+  // Apply the model or the restored calibration factor
+  setCalibration();
   showInfo();
 }
 
 void FilamentWeight::reset(void) {
-  scaleSensor.set_scale(scaleCalibration);
-  scaleSensor.tare();
+  setCalibration();
   setDefaults();
 }
 
-void FilamentWeight::readScale(void) {
-  float tempPrevRead;
-  //! calculate the absolute delta as we don't know 
-  //! if the filament is pulled down or up
-  //! respect the scale base
-  float delta;
+boolean FilamentWeight::restoreSettings(void) {
+  storedSettings settings;
+
+  if(!store.begin(channel) || !store.load(settings))
+    return false;
+
+  setDefaults();
+  scaleCalibration = settings.scaleCalibration;
+  quadratic = settings.quadratic;
+  scaleOffset = settings.scaleOffset;
+  materialID = constrain(settings.materialID, 0, MATERIALS - 1);
+  diameterID = constrain(settings.diameterID, 0, DIAMETERS - 1);
+  wID = constrain(settings.wID, 0, SPOOLS - 1);
+  statID = constrain(settings.statID, STAT_NONE, STAT_RUN);
+  filamentUnits = (settings.units == _CM) ? _CM : _GR;
+  initialWeight = MEASURE_FROM_MILLI(settings.initialWeight);
+  lastConsumedGrams = MEASURE_FROM_MILLI(settings.lastConsumedGrams);
+  resumed = (statID == STAT_RUN);
+  calcMaterialCharacteristics();
+  return true;
+}
+
+void FilamentWeight::saveSettings(void) {
+  storedSettings settings;
+
+  memset(&settings, 0, sizeof(settings));
+  settings.scaleCalibration = scaleCalibration;
+  settings.quadratic = quadratic;
+  settings.scaleOffset = scaleOffset;
+  settings.materialID = materialID;
+  settings.diameterID = diameterID;
+  settings.wID = wID;
+  settings.statID = statID;
+  settings.units = (uint8_t)filamentUnits;
+  settings.initialWeight = MEASURE_MILLI(initialWeight);
+  settings.lastConsumedGrams = MEASURE_MILLI(lastConsumedGrams);
+  store.save(settings);
+}
+
+void FilamentWeight::tare(void) {
+  // Average the next samples acquired
+  sampler.flush();
+  tareSum = 0;
+  tareCount = 0;
+  tareStart = halMillis();
+  taring = true;
+}
+
+void FilamentWeight::updateTare(void) {
+  if( (tareCount < SCALE_TARE_SAMPLES) && ((halMillis() - tareStart) < SCALE_TARE_TIMEOUT) )
+    return;
+  taring = false;
+  if(tareCount > 0) {
+    scaleOffset = tareSum / tareCount;
+    drift.reset();
+    saveSettings();
+  }
+}
+
+void FilamentWeight::setRestWeight(measure_t w) {
+  restWeight = anchorWeight = w;
+  restTime = anchorTime = halMillis();
+  restCarry = 0;
+  restRate = -1;
+  looseSum = 0;
+  loosePoints = 0;
+}
+
+void FilamentWeight::releasedWeight(measure_t w) {
+  unsigned long elapsed = halMillis() - anchorTime;
+
+  looseSum = 0;
+  loosePoints = 0;
+  if(w < restWeight - MEASURE(RELEASE_TOLERANCE))
+    return;
+  // The regulator keeps the readings on the rest weight, so the rate
+  // is measured between two releases and not from the readings
+  if(elapsed > 0)
+    restRate = max(MEASURE_MILLI(anchorWeight - w), 0) * 1000 / (long)elapsed;
+  restWeight = anchorWeight = w;
+  restTime = anchorTime = halMillis();
+  restCarry = 0;
+}
+
+void FilamentWeight::setCalibration(void) {
+#ifdef _FIXED_POINT
+  mgPerCountQ16 = TO_Q16(MEASURE_SCALE / scaleCalibration);
+  quadPerMgQ48 = (long long)(quadratic / MEASURE_SCALE * (double)(1LL << 48));
+#endif
+}
+
+boolean FilamentWeight::applyCalibration(int order) {
+  if(!calibration.fit(order))
+    return false;
+
+  calibration.stop();
+  scaleOffset = calibration.offset;
+  scaleCalibration = calibration.calibration;
+  quadratic = calibration.quadratic;
+  setCalibration();
+  filter.setGate((long)(MAX_DELTA_WEIGHT_IN_RANGE * scaleCalibration));
+  drift.reset();
+  saveSettings();
+  return true;
+}
+
+measure_t FilamentWeight::countsToWeight(long raw) {
+  measure_t w;
+
+  // The load cell is mounted upside down
+#ifdef _FIXED_POINT
+  w = -MEASURE_MUL_Q16(raw - scaleOffset, mgPerCountQ16);
+  if(quadPerMgQ48 != 0)
+    w += (measure_t)(((((long long)w * w) >> 16) * quadPerMgQ48) >> 32);
+#else
+  w = (float)(raw - scaleOffset) / scaleCalibration * -1;
+  w += quadratic * w * w;
+#endif
+  return w;
+}
+
+boolean FilamentWeight::readScale(void) {
+  measure_t tempPrevRead;
+  scaleSample sample;
+  PERF_SCOPE(PERF_READSCALE);
+
+  sampler.poll();
+  sampler.updateRate();
+
+  updateFilterStages();
+
+  // Filter the samples already acquired
+  while( (sampleCount < SCALE_SAMPLES) && sampler.read(sample) ) {
+    lastRaw = sample.raw;
+    calibration.addSample(sample.raw);
+    capture.add(sample);
+    filter.update(sample.raw);
+    sampleCount++;
+    if(taring && (tareCount < SCALE_TARE_SAMPLES)) {
+      tareSum += sample.raw;
+      tareCount++;
+    }
+  }
+  if(taring)
+    updateTare();
+  // Not yet enough samples for a new reading
+  if(sampleCount < SCALE_SAMPLES)
+    return false;
+
+  // Convert the filtered value to the scale units
+  sensorRead = countsToWeight(filter.value);
+  sampleCount = 0;
 
   // Save the previous reading  
   tempPrevRead = lastRead;
 
   prevRead = lastRead; // ***
   
-  // Read the new scale value
-  lastRead = (scaleSensor.get_units(SCALE_SAMPLES) * - 1);
+  // Read the new scale value without the zero drift, learned when
+  // the weight is not expected to change: no job running, or the job
+  // paused with the motor idle and no extruder pull
+  if(statID != STAT_NONE) {
+    drift.update(MEASURE_MILLI(sensorRead), (statID != STAT_RUN) || 
+                 (!motorActive && !currentStatus.filamentNeededFromExtruder &&
+                  consumption.valid && (abs(consumption.slope) < MEASURE(DRIFT_QUIET_RATE))), 
+                 halMillis());
+  }
+  lastRead = sensorRead - MEASURE_FROM_MILLI(drift.offset / 1000);
 
   // Manage the readings depending on the state
   switch(statID) {
     case STAT_RUN:
     // System running
-    delta = abs(lastRead - prevRead);
-
-//    Serial.print("RUN delta = ");
-//    Serial.print(delta);
-//    Serial.print(" initialWeight = ");
-//    Serial.print(initialWeight);
-//    Serial.print(" lastRead = ");
-//    Serial.print(lastRead);
-//    Serial.print(" prevRead = ");
-//    Serial.print(prevRead);
-//    Serial.print(" tempPrevRead = ");
-//    Serial.println(tempPrevRead);
-    
-    if(delta >= MIN_EXTRUDER_TENSION) {
-      // Extruder pull
-      currentStatus.filamentNeededFromExtruder = true;
+    if(resumed) {
+      // First reading of a job restored at the startup
+      prevRead = lastRead;
+      setRestWeight(lastRead);
+      runout.reset(initialWeight, lastRead - rollTare, halMillis());
+      resumed = false;
     }
-    else {
-      currentStatus.filamentNeededFromExtruder = false;
+    // The roll weight decreases with the consumption estimated over the
+    // last minutes, independently of the tension; the tension is the
+    // deviation of the reading from the roll weight
+    restCarry += MEASURE_MILLI(consumptionRate()) * (long)(halMillis() - restTime);
+    restTime = halMillis();
+    restWeight -= MEASURE_FROM_MILLI(restCarry / 1000);
+    restCarry %= 1000;
+    // With the filament loose the readings are the roll weight
+    if(filamentLoose) {
+      looseSum += lastRead;
+      loosePoints++;
     }
+    else if(loosePoints > 0) {
+      releasedWeight(looseSum / loosePoints);
+    }
+    // The absolute deviation, as we don't know if the filament is
+    // pulled down or up respect the scale base
+    tension = abs(lastRead - restWeight);
+    // Extruder pull: the tension, not the change between two readings,
+    // a slow pull spreads over many readings
+    currentStatus.filamentNeededFromExtruder = (tension >= MEASURE(MIN_EXTRUDER_TENSION));
+    // The regulated tension is bounded, over the estimator window
+    // the readings slope is the consumption rate
+    consumption.update(lastRead, halMillis());
+    history.update(MEASURE_MILLI(restWeight - rollTare), halMillis());
+    runout.update(restWeight - rollTare, halMillis());
     break;
     
     case STAT_READY:
@@ -78,12 +274,8 @@ void FilamentWeight::readScale(void) {
     break;
     
     case STAT_LOAD:
-    if( (tempPrevRead - lastRead) > MAX_DELTA_WEIGHT_IN_RANGE) {
-      lastRead = tempPrevRead;
-    } // reading invalid
-    else {
-      prevRead = lastRead;
-     } // reading valid
+    // Readings out of range are discarded by the filter gate stage
+    prevRead = lastRead;
     break;
     
     case STAT_NONE:
@@ -91,23 +283,48 @@ void FilamentWeight::readScale(void) {
     lastRead = prevRead = 0;
     break;
   }
+
+  return true;
+}
+
+void FilamentWeight::updateFilterStages(void) {
+  if(statID == filterStatID)
+    return;
+
+  switch(statID) {
+    case STAT_LOAD:
+      filter.setStages(FILTER_STAGES_LOAD);
+      break;
+    case STAT_RUN:
+      filter.setStages(FILTER_STAGES_RUN);
+      break;
+    default:
+      filter.setStages(FILTER_STAGES_DEFAULT);
+      break;
+  }
+  filterStatID = statID;
 }
 
 void FilamentWeight::setDefaults(void) {
   // Initializes the parameters status
   currentStatus.weightStatus = STATUS_RESET;
 
-  stat = SYS_STARTED;
   statID = STAT_NONE;
   lastRead = 0;
   prevRead = 0;
+  setRestWeight(0);
+  tension = 0;
+  resumed = false;
+  consumption.reset();
+  runout.stop();
   filamentUnits = _GR;  // default filament units
   lastConsumedGrams = 0;
+  initialWeight = 0;
 
   // You can change these initialisation values to set
   // your defaults
   diameterID = DIAM_175;    // Diameter
-  materialID = PLA;         // Material
+  materialID = MAT_PLA;     // Material
   wID = ROLL1KG;            // Weight
 
   // Update the material IDs
@@ -115,70 +332,37 @@ void FilamentWeight::setDefaults(void) {
 }
 
 void FilamentWeight::calcMaterialCharacteristics(void) {
-  // Calculate the material + diameter ID
-  if(materialID == PLA) {
-    filament = PLA175 + diameterID; 
-  }
-  else if(materialID == ABS) {
-    filament = ABS175 + diameterID;
-  }
-
-  // Set the weight filament and tare for the supported
-  // roll types
-  switch(wID) {
-    case ROLL1KG:
-      rollWeight = 1000.0;
-      rollTare = ROLL1KG_TARE;
-      weight = "1";
-      break;
-    case ROLL2KG:
-      rollWeight = 2000.0;
-      rollTare = ROLL2KG_TARE;
-      weight = "2";
-      break;
-  }
+  // Set the weight filament and tare for the roll type
+  rollWeight = MEASURE(spoolTable[wID].net);
+  rollTare = MEASURE(spoolTable[wID].tare);
+  weight = spoolTable[wID].name;
 
 #ifdef _USE_MOTOR
   // Add the weight of the motor group to the tare
-  rollTare += MOTOR_WEIGHT;
+  rollTare += MEASURE(MOTOR_WEIGHT);
 #endif
 
   // Set the parameters depending on the filament
-  // characteristics. Strings for display updates.
-  switch(filament) {
-    case PLA175:
-      diameter = DIAMETER175;
-      material = PLA_MAT;
-      gr1cm = PLA175_1CM_GR;
-      length1gr = PLA175_1GR_CM;
-      break;
-    case PLA300:
-      diameter = DIAMETER300;
-      material = PLA_MAT;
-      gr1cm = PLA300_1CM_GR;
-      length1gr = PLA300_1GR_CM;
-      break;
-    case ABS175:
-      diameter = DIAMETER175;
-      material = ABS_MAT;
-      gr1cm = ABS175_1CM_GR;
-      length1gr = ABS175_1GR_CM;
-      break;
-    case ABS300:
-      diameter = DIAMETER300;
-      material = ABS_MAT;
-      gr1cm = ABS175_1CM_GR;
-      length1gr = ABS300_1GR_CM;
-      break;
-  }
+  // characteristics. Names for display updates.
+  diameter = diameterTable[diameterID].name;
+  material = materialTable[materialID].name;
+  gr1cm = filamentTable[materialID][diameterID].gr1cm;
+  length1gr = filamentTable[materialID][diameterID].length1gr;
+
+#ifdef _FIXED_POINT
+  // Reciprocals used by the conversions, calculated once
+  cmPerGrQ16 = TO_Q16(length1gr);
+  percPerGrQ16 = TO_Q16(100.0 / MEASURE_INT(rollWeight));
+#endif
 }
 
-float FilamentWeight::calcConsumedCentimeters(void) {
+measure_t FilamentWeight::calcConsumedCentimeters(void) {
   return calcGgramsToCentimeters(calcConsumedGrams());
 }
 
-float FilamentWeight::calcConsumedGrams(void) {
-  return initialWeight - (lastRead - rollTare);
+measure_t FilamentWeight::calcConsumedGrams(void) {
+  // While the job runs the readings are lowered by the extruder tension
+  return initialWeight - (((statID == STAT_RUN) ? restWeight : lastRead) - rollTare);
 }
 
 float FilamentWeight::valOptimizer(float value) {
@@ -188,73 +372,101 @@ float FilamentWeight::valOptimizer(float value) {
   return optimizer / 10;
 }
 
-float FilamentWeight::calcGgramsToCentimeters(float w) {
+measure_t FilamentWeight::calcGgramsToCentimeters(measure_t w) {
+#ifdef _FIXED_POINT
+  return MEASURE_MUL_Q16(w, cmPerGrQ16);
+#else
   return w / gr1cm;
+#endif
 }
 
-float FilamentWeight::calcRemainingPerc(float w) {
+measure_t FilamentWeight::calcRemainingPerc(measure_t w) {
+#ifdef _FIXED_POINT
+  return MEASURE_MUL_Q16(w, percPerGrQ16);
+#else
   return w * 100 / rollWeight;
+#endif
 }
 
 void FilamentWeight::showInfo(void) {
-  Serial.print(material);
-  Serial.print("\t");
-  Serial.print(diameter);
-  Serial.print("\t");
-  Serial.print(weight);
-  Serial.print(" ");
-  Serial.println(UNITS_KG);
-  Serial.print("State: ");
-  Serial.println(stat);
-  Serial.println("");
+  halSerial.print(material);
+  halSerial.print("\t");
+  halSerial.print(diameter);
+  halSerial.print(" ");
+  halSerial.print(UNITS_MM);
+  halSerial.print("\t");
+  halSerial.println(weight);
+  halSerial.print("State: ");
+  halSerial.println(statName());
+  halSerial.println("");
 }
 
 void FilamentWeight::showLoad(void) {
-  int netWeight = lastRead - rollTare;
+  measure_t netWeight = lastRead - rollTare;
 
   // until filament has not been loaded
   // no status value should be returned
   if(statID < STAT_LOAD) {
-    Serial.println("--");
+    halSerial.println("--");
   } else {
-    Serial.print(MSG_REMAINING);
-    Serial.print(netWeight);
-    Serial.print(" ");
-    Serial.print(UNITS_GR);
-    Serial.print("\t");
-    Serial.print(valOptimizer(calcGgramsToCentimeters(netWeight)/100));
-    Serial.print(" ");
-    Serial.print(UNITS_MT);
-    Serial.print(" (");
-    Serial.print(calcRemainingPerc(netWeight));
-    Serial.println("%)\n");
+    halSerial.print(MSG_REMAINING);
+    halSerial.print(MEASURE_INT(netWeight));
+    halSerial.print(" ");
+    halSerial.print(UNITS_GR);
+    halSerial.print("\t");
+    halSerial.print(valOptimizer(MEASURE_FLOAT(calcGgramsToCentimeters(netWeight))/100));
+    halSerial.print(" ");
+    halSerial.print(UNITS_MT);
+    halSerial.print(" (");
+    halSerial.print(MEASURE_FLOAT(calcRemainingPerc(netWeight)));
+    halSerial.println("%)\n");
   }
 }
 
 void FilamentWeight::showConfig(void) {
-    int netWeight = lastRead - rollTare;
+    measure_t netWeight = lastRead - rollTare;
 
   // Show load status
-  Serial.print(MSG_REMAINING);
-  Serial.print(calcRemainingPerc(netWeight));
-  Serial.println("%");
+  halSerial.print(MSG_REMAINING);
+  halSerial.print(MEASURE_FLOAT(calcRemainingPerc(netWeight)));
+  halSerial.println("%");
   // Show last and previous read values
-  Serial.print("Last read: ");
-  Serial.println(netWeight);
-  Serial.print("Previous read: ");
-  Serial.println(prevRead - rollTare);
+  halSerial.print("Last read: ");
+  halSerial.println(MEASURE_INT(netWeight));
+  halSerial.print("Previous read: ");
+  halSerial.println(MEASURE_FLOAT(prevRead - rollTare));
   // Show internal settings
-  Serial.print("Calib.: ");
-  Serial.print(scaleCalibration);
-  Serial.println("units/gr");
+  halSerial.print("Calib.: ");
+  halSerial.print(scaleCalibration);
+  halSerial.println("units/gr");
+  halSerial.print("Nonlinearity: ");
+  halSerial.print(quadratic * 1000000.0);
+  halSerial.println(" ppm/gr");
+  halSerial.print("Offset: ");
+  halSerial.println(scaleOffset);
+  drift.show();
+  store.show();
 }
 
 float FilamentWeight::getWeight(void) {
-  return scaleSensor.get_units(SCALE_SAMPLES) * -1;
+  return MEASURE_FLOAT(sensorRead);
+}
+
+void FilamentWeight::showAcquisition(void) {
+  halSerial.print("Rate: ");
+  halSerial.print(sampler.rate);
+  halSerial.println(" sps");
+  halSerial.print("Samples: ");
+  halSerial.println(sampler.acquired);
+  halSerial.print("Overruns: ");
+  halSerial.println(sampler.overruns);
+  halSerial.print("Acquisition: ");
+  halSerial.println(sampler.polled ? "polled" : "interrupt");
+  halSerial.println("");
 }
 
 void FilamentWeight::showStat(void) {
-  float consumedGrams;
+  measure_t consumedGrams;
 
   // If initialWeight is 0 run mode has not yet started
   if(initialWeight != 0 )
@@ -263,49 +475,108 @@ void FilamentWeight::showStat(void) {
     consumedGrams = 0;
 
   // Avoid negative values due to floating values (mostly vibrations)
-  if( (consumedGrams < 0) || (consumedGrams < SCALE_RESOLUTION) )
+  if( (consumedGrams < 0) || (consumedGrams < MEASURE(SCALE_RESOLUTION)) )
     consumedGrams = lastConsumedGrams;
   else
     lastConsumedGrams = consumedGrams;
 
   // Used material
-  Serial.print(MSG_USED);
+  halSerial.print(MSG_USED);
 
   // Select the representation uinit
   if(filamentUnits == _GR) {
-    Serial.print(valOptimizer(consumedGrams));
-    Serial.print(" ");
-    Serial.println(UNITS_GR);
+    halSerial.print(valOptimizer(MEASURE_FLOAT(consumedGrams)));
+    halSerial.print(" ");
+    halSerial.println(UNITS_GR);
   } // Units in weight
   else {
     // Show the length in centimeters until one meter then show in meters
-    float loadedCentimeters;
+    measure_t loadedCentimeters;
     // Convert the weight in length
     loadedCentimeters = calcGgramsToCentimeters(consumedGrams);
     // Select the length representation
-    if(loadedCentimeters > CENTIMETERS_PER_METER) {
-      Serial.print(loadedCentimeters/CENTIMETERS_PER_METER);
-      Serial.print(" ");
-      Serial.println(UNITS_MT);
+    if(loadedCentimeters > MEASURE(CENTIMETERS_PER_METER)) {
+      halSerial.print(MEASURE_FLOAT(loadedCentimeters)/CENTIMETERS_PER_METER);
+      halSerial.print(" ");
+      halSerial.println(UNITS_MT);
     } // ... in meters
     else {
-      Serial.print(valOptimizer(loadedCentimeters));
-      Serial.print(" ");
-      Serial.println(UNITS_CM);
+      halSerial.print(valOptimizer(MEASURE_FLOAT(loadedCentimeters)));
+      halSerial.print(" ");
+      halSerial.println(UNITS_CM);
     } // ... in centimeters
   } // Units in length
-  Serial.println("");
+
+  // Consumption rate
+  halSerial.print(MSG_RATE);
+  if(filamentUnits == _GR) {
+    halSerial.print(MEASURE_FLOAT(consumptionRate()), 3);
+    halSerial.print(" ");
+    halSerial.print(UNITS_GR);
+  }
+  else {
+    halSerial.print(MEASURE_FLOAT(feedRate()), 2);
+    halSerial.print(" ");
+    halSerial.print(UNITS_CM);
+  }
+  halSerial.println(UNITS_PER_SEC);
+  halSerial.println("");
 }
 
-void FilamentWeight::flashLED(void) {
-  int j;
-  
-  for(j = 0; j < 20; j++) {
-//    Serial.println("flashLED()");
-    digitalWrite(ledPin, HIGH);
-    delay(100);
-    digitalWrite(ledPin, LOW);
-    delay(100);
+void FilamentWeight::showMachine(void) {
+  measure_t netWeight = lastRead - rollTare;
+
+  halSerial.print(" state=");
+  halSerial.print(statID);
+  halSerial.print(" net=");
+  halSerial.print(MEASURE_FLOAT(netWeight));
+  halSerial.print(" used=");
+  halSerial.print((initialWeight != 0) ? MEASURE_FLOAT(calcConsumedGrams()) : 0.0);
+  halSerial.print(" pct=");
+  halSerial.print((statID >= STAT_LOAD) ? MEASURE_FLOAT(calcRemainingPerc(netWeight)) : 0.0);
+  halSerial.print(" rate=");
+  halSerial.print(MEASURE_FLOAT(consumptionRate()), 4);
+  halSerial.print(" pull=");
+  halSerial.print(currentStatus.filamentNeededFromExtruder ? 1 : 0);
+  halSerial.print(" drift=");
+  halSerial.print(drift.offset / 1000000.0);
+  halSerial.print(" tte=");
+  halSerial.print(runout.timeToEmpty());
+  if( runout.running && (runout.job > 0) ) {
+    halSerial.print(" endleft=");
+    halSerial.print(MEASURE_FLOAT(runout.leftAtEnd()));
   }
 }
 
+const char* FilamentWeight::statName(void) {
+  return statusNames[statID];
+}
+
+measure_t FilamentWeight::consumptionRate(void) {
+  if( (statID == STAT_RUN) && (restRate >= 0) && (halMillis() - anchorTime < RELEASE_RATE_VALIDITY) )
+    return min(MEASURE_FROM_MILLI(restRate), MEASURE(MAX_CONSUMPTION_RATE));
+  // The roll weight decreases while the filament is used
+  if(!consumption.valid || (consumption.slope > 0))
+    return 0;
+  // Faster variations are tension transients
+  if(-consumption.slope > MEASURE(MAX_CONSUMPTION_RATE))
+    return MEASURE(MAX_CONSUMPTION_RATE);
+  return -consumption.slope;
+}
+
+measure_t FilamentWeight::feedRate(void) {
+  return calcGgramsToCentimeters(consumptionRate());
+}
+
+void FilamentWeight::flashLED(void) {
+  ledToggles = LED_TOGGLES;
+}
+
+void FilamentWeight::updateLED(void) {
+  if(ledToggles == 0)
+    return;
+  ledToggles--;
+  // Odd toggles light the LED, the last one leaves it off
+  halPinWrite(ledPin, (ledToggles & 1) ? HIGH : LOW);
+}
+
@@ -12,12 +12,20 @@
 #ifndef _FILAMENTWEIGHT
 #define _FILAMENTWEIGHT
 
-#include <HX711.h>
+#include "hal.h"
 #include "filament.h"
+#include "fixedpoint.h"
 #include "commands.h"
-
-#define DOUT 3  // load sensor data pin
-#define CLK 4   // load sensor clock pin
+#include "scalesampler.h"
+#include "weightfilter.h"
+#include "rateestimator.h"
+#include "settingsstore.h"
+#include "calibration.h"
+#include "history.h"
+#include "drifttracker.h"
+#include "capture.h"
+#include "runout.h"
+#include "channels.h"
 
 #define STATUS_RESET 0      ///< After initialisation or reset
 #define STATUS_READY 1      ///< System ready
@@ -44,31 +52,100 @@ class FilamentWeight {
     int wID;            ///< Filament weight ID
     int diameterID;     ///< Roll diameter
     int materialID;     ///< Roll material
-    int filament;       ///< Filament type
     //! Last read value from the cell
-    float lastRead;
+    measure_t lastRead;
     //! Previous read value from the cell
-    float prevRead;
+    measure_t prevRead;
+    //! Roll weight without the extruder tension, decreases with the
+    //! estimated consumption and is read again when the filament is
+    //! loose (see setRestWeight())
+    measure_t restWeight;
+    //! Weight deviation caused by the extruder pulling the filament
+    measure_t tension;
+
+    //! Interrupt-driven sensor acquisition
+    ScaleSampler sampler;
+
+    //! Filter chain processing every sample
+    WeightFilter filter;
+
+    //! Consumption rate of the roll while the job is running
+    RateEstimator consumption;
+
+    //! Net weight samples of the running job
+    ConsumptionHistory history;
+
+    //! Zero drift of the load cell, subtracted from the readings
+    DriftTracker drift;
+
+    //! Raw samples captured for the offline replay
+    SampleCapture capture;
+
+    //! Time to empty and weight left at the end of the running job
+    RunoutForecaster runout;
+
+    //! The motor of the channel is running, set by the main loop.
+    //! The drift is not learned while the filament moves
+    boolean motorActive;
+
+    //! Tare in progress, see tare()
+    boolean taring;
 
-    //! Sensor library instance
-    HX711 scaleSensor;
+    //! The filament has been released and is loose, set by the main loop.
+    //! The readings are the roll weight without the extruder tension
+    boolean filamentLoose;
 
     //! The scale calibration value
     //! If is hardcoded on startup but can be further updated with the
-    //! calibrate command (not implemented here)
+    //! calibration commands
     float scaleCalibration;
 
+    //! Load cell nonlinearity correction (1 / gram), 0 if not calibrated
+    float quadratic;
+
+    //! Reference weights acquisition and model fit
+    ScaleCalibration calibration;
+
+    //! Raw sensor value with no weight on the scale (tare)
+    long scaleOffset;
+
+    //! Persistent copy of the calibration, tare and filament settings
+    SettingsStore store;
+
+    //! Spool channel of the scale
+    int channel;
+
     /**
-     * Initializes the sensor library and the initial default setup
+     * Initializes the sensor library and restores the saved settings.
+     * The tare and the default setup are executed only if no valid
+     * settings are stored
+     * 
+     * \param ch the spool channel, selects the sensor pins (channelTable)
+     * and the settings slots
      */
-    void begin(void);
+    void begin(int ch);
 
     /**
      * Full reset the systemn and reinitialize the default values.
-     * Should be used when the filament roll is changed during a job
+     * Should be used when the filament roll is changed during a job.
+     * The tare is kept as the spool can be already on the scale
      */
     void reset(void);
 
+    /**
+     * Save the calibration, the tare, the filament settings and the
+     * consumption status in the persistent storage
+     */
+    void saveSettings(void);
+
+    /**
+     * Fit the calibration points then apply and save the new calibration
+     * 
+     * \param order 1 linear, 2 with the nonlinearity correction
+     * \return false if the points do not define a calibration
+     */
+    boolean applyCalibration(int order);
+
     /** 
      * Set the gloabl values depending on the material and filament size parameters
      */
@@ -77,23 +154,48 @@ class FilamentWeight {
     /**
      * Exectues a scale series of readings without the plastic spool
      * (and any other extra weight that is not part of the measure)
+     * 
+     * The samples already acquired by the sampler are filtered one at a
+     * time without waiting for the sensor. Every SCALE_SAMPLES samples 
+     * the filtered value becomes a new reading.
+     * 
+     * \return true if a new reading is available
      */
-    void readScale(void);
+    boolean readScale(void);
+
+    /**
+     * Set the roll weight without the extruder tension, e.g. when the job
+     * starts. While the job runs the rest weight decreases with the
+     * estimated consumption and is read again when the regulator releases
+     * the filament, so the tension kept by the regulator does not move it
+     * 
+     * \param w the weight
+     */
+    void setRestWeight(measure_t w);
+
+    /**
+     * Start setting the current weight as the zero of the scale: the
+     * next SCALE_TARE_SAMPLES samples are averaged by readScale(), then
+     * the zero is saved. Without samples in SCALE_TARE_TIMEOUT ms the
+     * zero is set with the samples received, if any
+     */
+    void tare(void);
 
    /**
     * Calculate the consumed material after the roll loading in centimeters
     * 
     * `return the lenght in centimeters based on the weight
     */
-    float calcConsumedCentimeters(void);
+    measure_t calcConsumedCentimeters(void);
 
    /**
     * Calculate the consumed material after the roll loading in grams
-    * with the formula: initialWeight - lastRead - tare
+    * with the formula: initialWeight - (lastRead - tare), the rest
+    * weight replaces the reading while the job runs
     * 
     * \return the weight in grams
     */
-    float calcConsumedGrams(void);
+    measure_t calcConsumedGrams(void);
 
     /**
      * Optimizes the a floating value reducing the precision to one
@@ -112,7 +214,7 @@ class FilamentWeight {
      *  \param w weight in grams
      *  \return the length in centimeters
     */
-    float calcGgramsToCentimeters(float w);
+    measure_t calcGgramsToCentimeters(measure_t w);
     
     /**
      * Calculate the remaining weight percentage of filament
@@ -122,7 +224,7 @@ class FilamentWeight {
      *  \param w weight in grams
      *  \return the remaining weight in percentage
      */
-    float calcRemainingPerc(float w);
+    measure_t calcRemainingPerc(measure_t w);
 
     /** 
      * \brief Show the filament information preset
@@ -139,6 +241,16 @@ class FilamentWeight {
      */
     void showStat(void);
 
+    /**
+     * Show the status fields of the machine readable status line:
+     * state (STAT_NONE ... STAT_RUN), net weight, used grams, remaining
+     * percentage, consumption rate (gr/s), extruder pull (0, 1), zero
+     * drift (gr), time to empty (s, -1 if not known) and, if the job
+     * weight is set, the weight left at the job end (gr). The line
+     * prefix and the end of line are sent by the caller
+     */
+    void showMachine(void);
+
     /**
      * Show the configuration and system settings
      */
@@ -148,6 +260,32 @@ class FilamentWeight {
       * Return the last value read from the sensor
       */
      float getWeight(void);
+
+    /**
+     * Return the filament consumption rate in weight: the roll weight
+     * decrease between the last two releases of the filament or, without
+     * them, the readings slope
+     * 
+     * \return the weight per second, 0 until the estimation is available
+     */
+    measure_t consumptionRate(void);
+
+    /**
+     * Return the filament consumption rate in centimeters
+     * 
+     * \return the length per second, 0 until the estimation is available
+     */
+    measure_t feedRate(void);
+
+    /**
+     * Return the name of the current status
+     */
+    const char* statName(void);
+
+    /**
+     * Show the sensor acquisition rate and the lost samples
+     */
+    void showAcquisition(void);
      
     /**
      * Update the materials IDs and calculations 
@@ -155,36 +293,127 @@ class FilamentWeight {
     void calcMaterialCharacteristics(void);
 
     /**
-     * Flash the system LED for 2 seconds to notice the status change
+     * Flash the system LED for 4 seconds to notice the status change.
+     * The method returns immediately, the LED is toggled by updateLED()
     */
     void flashLED(void);
 
+    /**
+     * Toggle the system LED while flashing, should be called every
+     * LED_PERIOD ms
+     */
+    void updateLED(void);
+
     //! filament diameter (descriptive)
-    String diameter;
+    const char* diameter;
     //! material type (descriptive)
-    String material;
+    const char* material;
     //! roll weight (descriptive)
-    String weight;
-    //! system status
-    String stat;
-    //! Status ID
+    const char* weight;
+    //! Status ID (STAT_NONE ... STAT_RUN)
     int statID;
     //! grams for 1 cm material
     float gr1cm;
     //! centimeters for 1 gr material
     float length1gr;
     //! filament weight
-    float rollWeight;
+    measure_t rollWeight;
     //! roll tare
-    float rollTare;
+    measure_t rollTare;
     //! Initial read weight from last reset
-    float initialWeight;
+    measure_t initialWeight;
     //! Last reliable value for consumed grams
-    float lastConsumedGrams;
+    measure_t lastConsumedGrams;
     //! Units display flag. Decide if consume is in grams or cm
     float filamentUnits;
     //! Status change LED
     int ledPin;
+    //! LED toggles left to the end of the flashing
+    int ledToggles;
+    //! Last filtered sensor value before the status processing
+    measure_t sensorRead;
+    //! Last raw sample from the sensor
+    long lastRaw;
+
+  private:
+    //! Number of raw samples filtered for the next reading
+    int sampleCount;
+    //! Status the filter stages have been selected for
+    int filterStatID;
+    //! The running job has been restored, the rest weight is not known
+    boolean resumed;
+
+    /**
+     * Roll weight read with the filament released: the consumption rate
+     * is measured from the previous release
+     * 
+     * \param w the weight
+     */
+    void releasedWeight(measure_t w);
+
+    /**
+     * Set the zero when the tare samples have been collected or the
+     * time is over
+     */
+    void updateTare(void);
+
+    //! Sum of the tare samples
+    long tareSum;
+    //! Tare samples collected
+    int tareCount;
+    //! halMillis() of the tare start
+    unsigned long tareStart;
+    //! halMillis() of the last rest weight update
+    unsigned long restTime;
+    //! Consumption not yet subtracted from the rest weight (mg/s * ms)
+    long restCarry;
+    //! Sum of the readings with the filament loose
+    measure_t looseSum;
+    //! Readings with the filament loose
+    int loosePoints;
+    //! Roll weight of the last release or of the job start
+    measure_t anchorWeight;
+    //! halMillis() of anchorWeight
+    unsigned long anchorTime;
+    //! Roll weight decrease between the last two releases (mg/s),
+    //! -1 if not measured
+    long restRate;
+
+#ifdef _FIXED_POINT
+    //! Milligrams for one raw count (Q16)
+    long mgPerCountQ16;
+    //! Nonlinearity for one milligram (quadratic / 1000, Q48)
+    long long quadPerMgQ48;
+    //! Length for one weight unit (1 / gr1cm, Q16)
+    long cmPerGrQ16;
+    //! Percentage for one weight unit (100 / rollWeight, Q16)
+    long percPerGrQ16;
+#endif
+
+    /**
+     * Select the filter stages for the current status
+     */
+    void updateFilterStages(void);
+
+    /**
+     * Apply the scale calibration factor
+     */
+    void setCalibration(void);
+
+    /**
+     * Restore the saved settings
+     * 
+     * \return false if no valid settings are stored
+     */
+    boolean restoreSettings(void);
+
+    /**
+     * Convert a raw sensor value to weight
+     * 
+     * \param raw the raw sensor value
+     * \return the weight
+     */
+    measure_t countsToWeight(long raw);
 
 };
 
@@ -0,0 +1,65 @@
+/**
+ *  \file fixedpoint.h
+ *  \brief Numeric representation of the weight, length and percentage values
+ *  
+ *  With _FIXED_POINT defined (see filament.h) the values are integers in
+ *  thousandths of the unit: milligrams, 1/1000 cm and 1/1000 %. The
+ *  conversions use reciprocals in Q16 format precalculated when the
+ *  material or the calibration changes, so no division is executed for
+ *  every reading. The rates are values per second in the same
+ *  representation (mg/s, 1/1000 cm/s). This avoids the software floating
+ *  point emulation on micro controllers without FPU (XMC1100 Cortex-M0).\n
+ *  Without _FIXED_POINT the values are float in the unit.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _FIXEDPOINT
+#define _FIXEDPOINT
+
+#include "filament.h"
+
+//! Fractional bits of the Q16 reciprocals
+#define FIXED_SHIFT 16
+//! 1.0 in Q16 format
+#define FIXED_ONE (1L << FIXED_SHIFT)
+//! Thousandths in a unit
+#define MEASURE_SCALE 1000
+
+#ifdef _FIXED_POINT
+//! Weight (mg), length (1/1000 cm) or percentage (1/1000 %)
+typedef long measure_t;
+//! Sum of values or of their products, e.g. in a regression
+typedef long long measure_sum_t;
+//! Convert a constant in units to the internal representation
+#define MEASURE(x) ((measure_t)((x) * MEASURE_SCALE))
+//! Integer part in units of a value
+#define MEASURE_INT(m) ((m) / MEASURE_SCALE)
+//! Value in units as float, for display only
+#define MEASURE_FLOAT(m) ((float)(m) / MEASURE_SCALE)
+//! Value in thousandths of the unit
+#define MEASURE_MILLI(m) ((long)(m))
+//! Value from thousandths of the unit
+#define MEASURE_FROM_MILLI(l) ((measure_t)(l))
+//! Product of two values
+#define MEASURE_MUL(a, b) ((measure_t)(((long long)(a) * (b)) / MEASURE_SCALE))
+//! Multiply a value by a Q16 factor
+#define MEASURE_MUL_Q16(m, q) ((measure_t)(((long long)(m) * (q)) >> FIXED_SHIFT))
+//! Q16 representation of a (float) constant
+#define TO_Q16(x) ((long)((x) * FIXED_ONE))
+#else
+typedef float measure_t;
+typedef float measure_sum_t;
+#define MEASURE(x) ((measure_t)(x))
+#define MEASURE_INT(m) ((long)(m))
+#define MEASURE_FLOAT(m) ((float)(m))
+#define MEASURE_MILLI(m) ((long)((m) * MEASURE_SCALE))
+#define MEASURE_FROM_MILLI(l) ((measure_t)(l) / MEASURE_SCALE)
+#define MEASURE_MUL(a, b) ((measure_t)((a) * (b)))
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+/**
+ *  \file hal.cpp
+ *  \brief Hardware abstraction layer on the Arduino core and the
+ *  Infineon TLE94112 library
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "hal.h"
+#include <TLE94112.h>
+#include <EEPROM.h>
+
+// ==============================================
+// Clock
+// ==============================================
+
+unsigned long halMillis(void) {
+  return millis();
+}
+
+unsigned long halMicros(void) {
+  return micros();
+}
+
+void halDelay(unsigned long ms) {
+  delay(ms);
+}
+
+void halDelayMicros(unsigned int us) {
+  delayMicroseconds(us);
+}
+
+// ==============================================
+// Serial port
+// ==============================================
+
+Stream &halSerial = Serial;
+
+void halSerialBegin(unsigned long baud) {
+  Serial.begin(baud);
+}
+
+// ==============================================
+// GPIO
+// ==============================================
+
+void halPinOutput(int pin) {
+  pinMode(pin, OUTPUT);
+}
+
+void halPinInput(int pin) {
+  pinMode(pin, INPUT);
+}
+
+void halPinWrite(int pin, int level) {
+  digitalWrite(pin, level);
+}
+
+int halPinRead(int pin) {
+  return digitalRead(pin);
+}
+
+// ==============================================
+// Load cell ADC (HX711)
+// ==============================================
+
+boolean halAdcAttach(int pin, void (*isr)(void)) {
+  if(digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT)
+    return false;
+  attachInterrupt(digitalPinToInterrupt(pin), isr, FALLING);
+  return true;
+}
+
+void halAdcDetach(int pin) {
+  detachInterrupt(digitalPinToInterrupt(pin));
+}
+
+// ==============================================
+// Half bridges driver (TLE94112)
+// ==============================================
+
+//! Library half bridges by number
+static const Tle94112::HalfBridge bridges[HAL_BRIDGES] = {
+  tle94112.TLE_HB1, tle94112.TLE_HB2, tle94112.TLE_HB3, tle94112.TLE_HB4,
+  tle94112.TLE_HB5, tle94112.TLE_HB6, tle94112.TLE_HB7, tle94112.TLE_HB8,
+  tle94112.TLE_HB9, tle94112.TLE_HB10, tle94112.TLE_HB11, tle94112.TLE_HB12
+};
+
+//! Library half bridge states by HAL_HB_* value
+static const Tle94112::HBState bridgeStates[] = {
+  tle94112.TLE_FLOATING, tle94112.TLE_LOW, tle94112.TLE_HIGH
+};
+
+//! Library PWM channels by HAL_*PWM* value
+static const Tle94112::PWMChannel pwmChannels[] = {
+  tle94112.TLE_NOPWM, tle94112.TLE_PWM1, tle94112.TLE_PWM2, tle94112.TLE_PWM3
+};
+
+//! Library diagnosis bits and the corresponding HAL_DIAG_* bits
+static const uint8_t diagnosisBits[][2] = {
+  { tle94112.TLE_SPI_ERROR, HAL_DIAG_SPI_ERROR },
+  { tle94112.TLE_LOAD_ERROR, HAL_DIAG_LOAD_ERROR },
+  { tle94112.TLE_UNDER_VOLTAGE, HAL_DIAG_UNDER_VOLTAGE },
+  { tle94112.TLE_OVER_VOLTAGE, HAL_DIAG_OVER_VOLTAGE },
+  { tle94112.TLE_POWER_ON_RESET, HAL_DIAG_POWER_ON_RESET },
+  { tle94112.TLE_TEMP_SHUTDOWN, HAL_DIAG_TEMP_SHUTDOWN },
+  { tle94112.TLE_TEMP_WARNING, HAL_DIAG_TEMP_WARNING }
+};
+
+//! Driver accesses since the startup
+static unsigned long bridgeTransactions = 0;
+
+//! Shadow value of a register not known (always written)
+#define SHADOW_UNKNOWN -1
+
+//! Last configuration written to every half bridge (state << 2 | pwm)
+static int bridgeShadow[HAL_BRIDGES];
+//! Last duty cycle written to every PWM channel
+static int pwmShadow[HAL_PWM3 + 1];
+
+/**
+ * Set the shadow registers
+ * 
+ * \param bridge the half bridges value
+ * \param pwm the PWM channels value
+ */
+static void setShadow(int bridge, int pwm) {
+  int j;
+
+  for(j = 0; j < HAL_BRIDGES; j++)
+    bridgeShadow[j] = bridge;
+  for(j = 0; j <= HAL_PWM3; j++)
+    pwmShadow[j] = pwm;
+}
+
+void halBridgeBegin(void) {
+  // The library initialisation writes the registers reset values:
+  // half bridges floating and PWM channels off
+  tle94112.begin();
+  setShadow((HAL_HB_FLOATING << 2) | HAL_NOPWM, 0);
+}
+
+void halBridgeEnd(void) {
+  tle94112.end();
+}
+
+void halBridgeConfig(int hb, int state, int pwm) {
+  int config = (state << 2) | pwm;
+
+  // Write only if the configuration is changed
+  if(bridgeShadow[hb - 1] == config)
+    return;
+  bridgeShadow[hb - 1] = config;
+
+  tle94112.configHB(bridges[hb - 1], bridgeStates[state], pwmChannels[pwm]);
+  bridgeTransactions++;
+}
+
+void halBridgePWM(int pwm, int duty) {
+  // Write only if the duty cycle is changed
+  if(pwmShadow[pwm] == duty)
+    return;
+  pwmShadow[pwm] = duty;
+
+  tle94112.configPWM(pwmChannels[pwm], tle94112.TLE_FREQ200HZ, duty);
+  bridgeTransactions++;
+}
+
+int halBridgeDiagnosis(void) {
+  uint8_t diagnosis;
+  int bits = HAL_DIAG_OK;
+  unsigned int j;
+
+  // One register read, the single error bits are decoded locally
+  diagnosis = tle94112.getSysDiagnosis();
+  bridgeTransactions++;
+  if(diagnosis == tle94112.TLE_STATUS_OK)
+    return HAL_DIAG_OK;
+
+  for(j = 0; j < sizeof(diagnosisBits) / sizeof(diagnosisBits[0]); j++) {
+    if(diagnosis & diagnosisBits[j][0])
+      bits |= diagnosisBits[j][1];
+  }
+
+  // After a driver reset the registers content is not the shadow one
+  if(bits & HAL_DIAG_POWER_ON_RESET)
+    setShadow(SHADOW_UNKNOWN, SHADOW_UNKNOWN);
+
+  return bits;
+}
+
+void halBridgeClearErrors(void) {
+  tle94112.clearErrors();
+  bridgeTransactions++;
+}
+
+unsigned long halBridgeTransactions(void) {
+  return bridgeTransactions;
+}
+
+// ==============================================
+// Persistent storage
+// ==============================================
+
+int halStorageSize(void) {
+  return EEPROM.length();
+}
+
+void halStorageRead(int address, void* data, int length) {
+  uint8_t* bytes = (uint8_t*)data;
+  int j;
+
+  for(j = 0; j < length; j++)
+    bytes[j] = EEPROM.read(address + j);
+}
+
+int halStorageWrite(int address, const void* data, int length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  int written = 0;
+  int j;
+
+  for(j = 0; j < length; j++) {
+    if(EEPROM.read(address + j) != bytes[j]) {
+      EEPROM.write(address + j, bytes[j]);
+      written++;
+    }
+  }
+  return written;
+}
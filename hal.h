@@ -0,0 +1,175 @@
+/**
+ *  \file hal.h
+ *  \brief Hardware abstraction layer
+ *  
+ *  The application classes access the hardware only through these
+ *  functions: clock, serial port, GPIO, the HX711 load cell ADC pins,
+ *  the TLE94112 half-bridge driver and the persistent storage. hal.cpp
+ *  implements them on the Arduino core, the Infineon TLE94112 and the
+ *  EEPROM libraries; a different 
+ *  implementation of this file (e.g. simulated clock, sensor and driver
+ *  on a PC) builds the application without changes.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _HAL
+#define _HAL
+
+#include <Arduino.h>
+
+// Half bridges states
+#define HAL_HB_FLOATING 0   ///< Both switches open
+#define HAL_HB_LOW 1        ///< Low side switch closed
+#define HAL_HB_HIGH 2       ///< High side switch closed
+
+// PWM channels
+#define HAL_NOPWM 0         ///< Half bridge not modulated
+#define HAL_PWM1 1          ///< PWM channel 1
+#define HAL_PWM2 2          ///< PWM channel 2
+#define HAL_PWM3 3          ///< PWM channel 3
+
+//! Number of half bridges of the driver
+#define HAL_BRIDGES 12
+
+// Driver diagnosis bits
+#define HAL_DIAG_OK 0x00              ///< No error
+#define HAL_DIAG_SPI_ERROR 0x01       ///< SPI communication error
+#define HAL_DIAG_LOAD_ERROR 0x02      ///< Open load
+#define HAL_DIAG_UNDER_VOLTAGE 0x04   ///< Supply under voltage
+#define HAL_DIAG_OVER_VOLTAGE 0x08    ///< Supply over voltage
+#define HAL_DIAG_POWER_ON_RESET 0x10  ///< Power on reset detected
+#define HAL_DIAG_TEMP_SHUTDOWN 0x20   ///< Shutdown for over temperature
+#define HAL_DIAG_TEMP_WARNING 0x40    ///< High temperature warning
+
+// ==============================================
+// Clock
+// ==============================================
+
+//! ms since the startup
+unsigned long halMillis(void);
+//! us since the startup
+unsigned long halMicros(void);
+//! Wait for the ms
+void halDelay(unsigned long ms);
+//! Wait for the us
+void halDelayMicros(unsigned int us);
+
+// ==============================================
+// Serial port
+// ==============================================
+
+//! The serial port used for the commands and the messages
+extern Stream &halSerial;
+//! Open the serial port
+void halSerialBegin(unsigned long baud);
+
+// ==============================================
+// GPIO
+// ==============================================
+
+//! Set a pin as output
+void halPinOutput(int pin);
+//! Set a pin as input
+void halPinInput(int pin);
+//! Set the level of an output pin
+void halPinWrite(int pin, int level);
+//! Read the level of an input pin
+int halPinRead(int pin);
+
+// ==============================================
+// Load cell ADC (HX711)
+// ==============================================
+
+/**
+ * Call the function on the falling edge of the HX711 data pin (data ready)
+ * 
+ * \param pin the data pin
+ * \param isr the function called from the interrupt
+ * \return false if the pin has no external interrupt
+ */
+boolean halAdcAttach(int pin, void (*isr)(void));
+
+/**
+ * Stop the data ready notifications
+ * 
+ * \param pin the data pin
+ */
+void halAdcDetach(int pin);
+
+// ==============================================
+// Half bridges driver (TLE94112)
+// ==============================================
+
+//! Initialize the driver
+void halBridgeBegin(void);
+//! Release the driver
+void halBridgeEnd(void);
+
+/**
+ * Configure a half bridge
+ * 
+ * The driver is accessed only if the configuration is different from the
+ * last one written (shadow registers)
+ * 
+ * \param hb the half bridge 1 ... HAL_BRIDGES
+ * \param state HAL_HB_FLOATING, HAL_HB_LOW or HAL_HB_HIGH
+ * \param pwm HAL_NOPWM or the PWM channel modulating the half bridge
+ */
+void halBridgeConfig(int hb, int state, int pwm);
+
+/**
+ * Set the duty cycle of a PWM channel at 200 Hz
+ * 
+ * The driver is accessed only if the duty cycle is changed
+ * 
+ * \param pwm the PWM channel
+ * \param duty the duty cycle 0 ... 255
+ */
+void halBridgePWM(int pwm, int duty);
+
+/**
+ * Read the driver system diagnosis
+ * 
+ * \return the HAL_DIAG_* error bits, HAL_DIAG_OK if no errors
+ */
+int halBridgeDiagnosis(void);
+
+//! Clear all the driver error conditions
+void halBridgeClearErrors(void);
+
+//! Number of driver accesses (SPI transactions) since the startup
+unsigned long halBridgeTransactions(void);
+
+// ==============================================
+// Persistent storage (EEPROM or emulated flash)
+// ==============================================
+
+//! Storage size in bytes
+int halStorageSize(void);
+
+/**
+ * Read from the storage
+ * 
+ * \param address the first byte
+ * \param data the destination buffer
+ * \param length the number of bytes
+ */
+void halStorageRead(int address, void* data, int length);
+
+/**
+ * Write to the storage. Only the bytes different from the stored
+ * ones are written
+ * 
+ * \param address the first byte
+ * \param data the bytes to write
+ * \param length the number of bytes
+ * \return the number of bytes actually written
+ */
+int halStorageWrite(int address, const void* data, int length);
+
+#endif
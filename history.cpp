@@ -0,0 +1,240 @@
+/**
+ *  \file history.cpp
+ *  \brief Consumption history of the running job
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "history.h"
+
+//! Max delta encoded, the token must fit an unsigned long
+#define HISTORY_MAX_DELTA (0x7fffffffL / HISTORY_RUN / 2)
+
+void ConsumptionHistory::begin(void) {
+  head = 0;
+  tail = 0;
+  used = 0;
+  samples = 0;
+  gap = 0;
+  open = false;
+  streaming = false;
+}
+
+void ConsumptionHistory::update(long value, unsigned long timestamp) {
+  unsigned long periods;
+
+  if(samples == 0) {
+    first = last = value / HISTORY_RESOLUTION;
+    firstTime = lastTime = timestamp;
+    samples = 1;
+    sum = 0;
+    count = 0;
+    gap = 0;
+    return;
+  }
+
+  // The readings are averaged over the period following the last one,
+  // the first reading past its end closes it. The periods ended
+  // without readings are skipped
+  if((timestamp - lastTime) > HISTORY_PERIOD) {
+    periods = (timestamp - lastTime - 1) / HISTORY_PERIOD;
+    lastTime += periods * HISTORY_PERIOD;
+    if(count > 0) {
+      record(sum / count);
+      periods--;
+    }
+    gap += periods;
+    sum = 0;
+    count = 0;
+  }
+  sum += value;
+  count++;
+}
+
+void ConsumptionHistory::record(long average) {
+  // Dead band of one unit around the last sample, the noise does not
+  // toggle the last digit
+  if(abs(average - last * HISTORY_RESOLUTION) < HISTORY_RESOLUTION)
+    average = last;
+  else
+    average /= HISTORY_RESOLUTION;
+  if(gap > 0) {
+    appendToken((gap << 1) | 1);
+    open = false;
+    gap = 0;
+  }
+  append(average - last);
+  last = average;
+  samples++;
+}
+
+void ConsumptionHistory::append(long delta) {
+  unsigned long zigzag, token;
+
+  delta = constrain(delta, -HISTORY_MAX_DELTA, HISTORY_MAX_DELTA);
+  zigzag = ((unsigned long)delta << 1) ^ (unsigned long)(delta >> 31);
+  token = (zigzag * HISTORY_RUN) << 1;
+
+  // Equal to the previous deltas, the repeat count is incremented.
+  // The token length does not change as 2 * HISTORY_RUN divides 128
+  if(open && (zigzag == lastDelta) && (lastRun < HISTORY_RUN)) {
+    lastRun++;
+    writeToken(lastPos, token + ((lastRun - 1) << 1), tokenLength(token));
+    return;
+  }
+
+  lastPos = appendToken(token);
+  open = true;
+  lastDelta = zigzag;
+  lastRun = 1;
+}
+
+int ConsumptionHistory::appendToken(unsigned long token) {
+  int pos, length = tokenLength(token);
+
+  while((HISTORY_SIZE - used) < length)
+    drop();
+  pos = head;
+  head = writeToken(head, token, length);
+  used += length;
+  return pos;
+}
+
+int ConsumptionHistory::writeToken(int pos, unsigned long token, int length) {
+  while(--length > 0) {
+    ring[pos] = (token & 0x7f) | 0x80;
+    pos = (pos + 1) % HISTORY_SIZE;
+    token >>= 7;
+  }
+  ring[pos] = token;
+  return (pos + 1) % HISTORY_SIZE;
+}
+
+unsigned long ConsumptionHistory::readToken(int pos, int& length) {
+  unsigned long token = 0;
+  uint8_t b;
+
+  length = 0;
+  do {
+    b = ring[pos];
+    pos = (pos + 1) % HISTORY_SIZE;
+    token |= (unsigned long)(b & 0x7f) << (7 * length);
+    length++;
+  } while(b & 0x80);
+  return token;
+}
+
+int ConsumptionHistory::tokenLength(unsigned long token) {
+  int length = 1;
+
+  while(token >= 0x80) {
+    token >>= 7;
+    length++;
+  }
+  return length;
+}
+
+void ConsumptionHistory::drop(void) {
+  unsigned long token;
+  long delta;
+  int run, length;
+  boolean skipped = false;
+
+  token = readToken(tail, length);
+  if(token & 1) {
+    firstTime += (token >> 1) * HISTORY_PERIOD;
+    release(length);
+    if(used == 0)
+      return;
+    token = readToken(tail, length);
+    skipped = true;
+  }
+
+  token >>= 1;
+  run = token % HISTORY_RUN + 1;
+  token /= HISTORY_RUN;
+  delta = (long)(token >> 1) ^ -(long)(token & 1);
+  if(skipped && (run > 1)) {
+    // The first sample after the skipped periods becomes the first one,
+    // the token keeps the others and its length
+    if(streaming && (remaining > 0) &&
+       (((cursor - tail + HISTORY_SIZE) % HISTORY_SIZE) < length)) {
+      streaming = false;
+      halSerial.println("history overrun");
+    }
+    writeToken(tail, (token * HISTORY_RUN + run - 2) << 1, length);
+    if(open && (lastPos == tail))
+      lastRun--;
+    run = 1;
+  }
+  else
+    release(length);
+  first += delta * run;
+  firstTime += (unsigned long)run * HISTORY_PERIOD;
+  samples -= run;
+}
+
+void ConsumptionHistory::release(int length) {
+  if(open && (lastPos == tail))
+    open = false;
+
+  while(length-- > 0) {
+    if(streaming && (remaining > 0) && (cursor == tail)) {
+      // The bytes not yet streamed are overwritten
+      streaming = false;
+      halSerial.println("history overrun");
+    }
+    tail = (tail + 1) % HISTORY_SIZE;
+    used--;
+  }
+}
+
+void ConsumptionHistory::dump(void) {
+  if(samples == 0) {
+    halSerial.println("history empty");
+    return;
+  }
+  halSerial.print("history ");
+  halSerial.print(samples);
+  halSerial.print(" ");
+  halSerial.print(HISTORY_PERIOD);
+  halSerial.print(" ");
+  halSerial.print(firstTime);
+  halSerial.print(" ");
+  halSerial.println(first);
+
+  // The newest token is not extended while it can be already streamed
+  open = false;
+  cursor = tail;
+  remaining = used;
+  streaming = true;
+  lastLine = halMillis() - HISTORY_LINE_PERIOD;
+}
+
+void ConsumptionHistory::stream(void) {
+  int j;
+
+  if(!streaming || ((halMillis() - lastLine) < HISTORY_LINE_PERIOD))
+    return;
+  lastLine = halMillis();
+
+  if(remaining == 0) {
+    halSerial.println("history end");
+    streaming = false;
+    return;
+  }
+
+  halSerial.print(":");
+  for(j = 0; (j < HISTORY_LINE_BYTES) && (remaining > 0); j++) {
+    if(ring[cursor] < 0x10)
+      halSerial.print("0");
+    halSerial.print(ring[cursor], HEX);
+    cursor = (cursor + 1) % HISTORY_SIZE;
+    remaining--;
+  }
+  halSerial.println("");
+}
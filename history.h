@@ -0,0 +1,184 @@
+/**
+ *  \file history.h
+ *  \brief Consumption history of the running job
+ *  
+ *  The average net weight of the roll, without the filament tension, of
+ *  every HISTORY_PERIOD ms is recorded in a RAM ring as the difference
+ *  from the previous sample. The sample
+ *  changes only when the weight moves more than one HISTORY_RESOLUTION
+ *  unit, so the reading noise does not toggle the last digit.\n
+ *  Every ring token is a varint (7 bits per byte, least significant
+ *  first, bit 7 set if another byte follows) of
+ *  (zigzag(delta) * HISTORY_RUN + (repeat - 1)) * 2: a sequence of up to
+ *  HISTORY_RUN equal deltas takes a single token, the slow consumption
+ *  of a job is mostly a single byte for HISTORY_RUN samples.\n
+ *  The samples are HISTORY_PERIOD ms apart. The periods without readings
+ *  (the scale not read, a stalled loop) have no sample: a token
+ *  periods * 2 + 1 before the next sample skips them, so the timestamp
+ *  of every sample is known. When the ring is full the oldest tokens
+ *  are dropped.
+ *  
+ *  The history command streams the ring a line at a time:\n
+ *  history <samples> <period ms> <first timestamp ms> <first weight>\n
+ *  :<ring bytes in hex>\n
+ *  history end\n
+ *  the first weight and timestamp are the sample before the ring tokens,
+ *  the weights are in HISTORY_RESOLUTION mg units. tools/historydecoder.h
+ *  decodes the stream on the host.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _HISTORY
+#define _HISTORY
+
+#include "hal.h"
+#include "channels.h"
+
+//! Ring size in bytes, the RAM available is divided between the channels
+#define HISTORY_SIZE (2048 / SPOOL_CHANNELS)
+//! ms between two samples
+#define HISTORY_PERIOD 1000
+//! Weight units of the samples in mg
+#define HISTORY_RESOLUTION 500
+//! Max number of equal deltas in a token
+#define HISTORY_RUN 16
+//! Ring bytes in a streamed line
+#define HISTORY_LINE_BYTES 16
+//! Min ms between two streamed lines (a line takes ~9 ms at 38400 baud)
+#define HISTORY_LINE_PERIOD 10
+
+/**
+ * Class recording the weight samples of the running job
+ */
+class ConsumptionHistory {
+
+  public:
+    /**
+     * Clear the history, the next sample is the first one
+     */
+    void begin(void);
+
+    /**
+     * Add a sample if the period is elapsed
+     * 
+     * \param value the net weight in mg
+     * \param timestamp halMillis() of the reading
+     */
+    void update(long value, unsigned long timestamp);
+
+    /**
+     * Start streaming the history
+     */
+    void dump(void);
+
+    /**
+     * Send the next line of the history being streamed, must be called
+     * every loop cycle
+     */
+    void stream(void);
+
+    //! Number of samples in the ring
+    unsigned long samples;
+    //! Bytes used in the ring
+    int used;
+
+  private:
+    //! Delta tokens
+    uint8_t ring[HISTORY_SIZE];
+    //! Next byte to be written
+    int head;
+    //! Oldest byte
+    int tail;
+    //! Oldest sample
+    long first;
+    //! halMillis() of the oldest sample
+    unsigned long firstTime;
+    //! Newest sample
+    long last;
+    //! halMillis() of the end of the last period, sampled or skipped
+    unsigned long lastTime;
+    //! Sum of the readings of the current period
+    long sum;
+    //! Readings of the current period
+    int count;
+    //! Periods without readings since the newest sample
+    unsigned long gap;
+    //! The newest token can be extended with equal deltas
+    boolean open;
+    //! Position of the newest token
+    int lastPos;
+    //! Zigzag delta of the newest token
+    unsigned long lastDelta;
+    //! Deltas in the newest token
+    int lastRun;
+    //! The history is being streamed
+    boolean streaming;
+    //! Next ring byte to be streamed
+    int cursor;
+    //! Bytes still to be streamed
+    int remaining;
+    //! halMillis() of the last streamed line
+    unsigned long lastLine;
+
+    /**
+     * Add the sample of a period, after the periods skipped
+     * 
+     * \param average the average of the period readings in mg
+     */
+    void record(long average);
+
+    /**
+     * Append a delta to the ring
+     */
+    void append(long delta);
+
+    /**
+     * Append a token, dropping the oldest ones if the ring is full
+     * 
+     * \return the position of the token
+     */
+    int appendToken(unsigned long token);
+
+    /**
+     * Write a token at a ring position
+     * 
+     * \param pos the position
+     * \param token the token
+     * \param length the bytes of the token, longer than needed if the
+     * token replaces a longer one
+     * \return the position following the token
+     */
+    int writeToken(int pos, unsigned long token, int length);
+
+    /**
+     * Read a token at a ring position
+     * 
+     * \param pos the position
+     * \param length set to the bytes of the token
+     * \return the token
+     */
+    unsigned long readToken(int pos, int& length);
+
+    //! Bytes of the shortest encoding of a token
+    int tokenLength(unsigned long token);
+
+    /**
+     * Drop the oldest token. A skip is dropped with the following
+     * sample, the first sample is always a reading
+     */
+    void drop(void);
+
+    /**
+     * Remove bytes from the tail of the ring
+     * 
+     * \param length the bytes
+     */
+    void release(int length);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ *  \file materials.cpp
+ *  \brief Catalogue of the supported materials, diameters and spools
+ *  
+ *  Densities are the typical values declared by the manufacturers.
+ *  The 2 kg spool tare is an estimate and should be verified.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string.h>
+#include "materials.h"
+
+constexpr materialSpec materialTable[MATERIALS] = {
+  { "PLA",   1.24 },
+  { "ABS",   1.04 },
+  { "PETG",  1.27 },
+  { "TPU",   1.21 },
+  { "ASA",   1.07 },
+  { "NYLON", 1.14 }
+};
+
+constexpr diameterSpec diameterTable[DIAMETERS] = {
+  { "1.75", 1.75 },
+  { "2.85", 2.85 },
+  { "3.00", 3.00 }
+};
+
+constexpr spoolSpec spoolTable[SPOOLS] = {
+  { "1kg", 1000.0, 225.0 },
+  { "2kg", 2000.0, 250.0 }
+};
+
+//! Filament section in cm^2 (the diameter is in mm)
+constexpr float filamentSection(int d) {
+  return 3.14159265 * (diameterTable[d].mm / 20) * (diameterTable[d].mm / 20);
+}
+
+//! Weight in gr of 1 cm of filament
+constexpr float filamentGr1cm(int m, int d) {
+  return materialTable[m].density * filamentSection(d);
+}
+
+//! Characteristics of a material and diameter
+#define FILAMENT(m, d) { filamentGr1cm(m, d), 1 / filamentGr1cm(m, d) }
+//! Characteristics of a material for all the diameters
+#define FILAMENT_ROW(m) { FILAMENT(m, DIAM_175), FILAMENT(m, DIAM_285), FILAMENT(m, DIAM_300) }
+
+constexpr filamentSpec filamentTable[MATERIALS][DIAMETERS] = {
+  FILAMENT_ROW(MAT_PLA),
+  FILAMENT_ROW(MAT_ABS),
+  FILAMENT_ROW(MAT_PETG),
+  FILAMENT_ROW(MAT_TPU),
+  FILAMENT_ROW(MAT_ASA),
+  FILAMENT_ROW(MAT_NYLON)
+};
+
+static_assert(DIAMETERS == 3, "FILAMENT_ROW should list all the diameters");
+static_assert(sizeof(filamentTable) / sizeof(filamentTable[0]) == MATERIALS, 
+              "filamentTable should list all the materials");
+
+int findMaterial(const char* name) {
+  int j;
+
+  for(j = 0; j < MATERIALS; j++) {
+    if(strcmp(name, materialTable[j].name) == 0)
+      return j;
+  }
+  return -1;
+}
+
+int findDiameter(const char* name) {
+  int j;
+
+  for(j = 0; j < DIAMETERS; j++) {
+    if(strcmp(name, diameterTable[j].name) == 0)
+      return j;
+  }
+  return -1;
+}
+
+int findSpool(const char* name) {
+  int j;
+
+  for(j = 0; j < SPOOLS; j++) {
+    if(strcmp(name, spoolTable[j].name) == 0)
+      return j;
+  }
+  return -1;
+}
@@ -0,0 +1,93 @@
+/**
+ *  \file materials.h
+ *  \brief Catalogue of the supported materials, diameters and spools
+ *  
+ *  The weight of 1 cm of filament and the length of 1 gr are derived
+ *  from the material density and the nominal diameter at compile time,
+ *  so adding a material or a diameter to the catalogue does not need
+ *  any new constant and the tables are stored in flash.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _MATERIALS
+#define _MATERIALS
+
+// Material IDs, index of materialTable
+#define MAT_PLA 0
+#define MAT_ABS 1
+#define MAT_PETG 2
+#define MAT_TPU 3
+#define MAT_ASA 4
+#define MAT_NYLON 5
+//! Number of materials in the catalogue
+#define MATERIALS 6
+
+// Diameter IDs, index of diameterTable
+#define DIAM_175 0
+#define DIAM_285 1
+#define DIAM_300 2
+//! Number of diameters in the catalogue
+#define DIAMETERS 3
+
+// Roll kind IDs, index of spoolTable
+#define ROLL1KG 0
+#define ROLL2KG 1
+//! Number of spools in the catalogue
+#define SPOOLS 2
+
+//! Material characteristics
+struct materialSpec {
+  //! Name, also the command selecting the material
+  const char* name;
+  //! Density (gr/cm^3)
+  float density;
+};
+
+//! Filament nominal diameter
+struct diameterSpec {
+  //! Diameter in mm as text, also the command selecting the diameter
+  const char* name;
+  //! Diameter (mm)
+  float mm;
+};
+
+//! Filament spool
+struct spoolSpec {
+  //! Name, also the command selecting the spool
+  const char* name;
+  //! Filament net weight (gr)
+  float net;
+  //! Empty spool weight (gr)
+  float tare;
+};
+
+//! Filament characteristics for a material and diameter
+struct filamentSpec {
+  //! Weight in gr for 1 cm of filament
+  float gr1cm;
+  //! Length in cm for 1 gr of filament
+  float length1gr;
+};
+
+extern const materialSpec materialTable[MATERIALS];
+extern const diameterSpec diameterTable[DIAMETERS];
+extern const spoolSpec spoolTable[SPOOLS];
+//! Derived characteristics, indexed by material and diameter ID
+extern const filamentSpec filamentTable[MATERIALS][DIAMETERS];
+
+/**
+ * Search a catalogue entry by name
+ * 
+ * \param name the entry name
+ * \return the ID or -1 if not found
+ */
+int findMaterial(const char* name);
+int findDiameter(const char* name);
+int findSpool(const char* name);
+
+#endif
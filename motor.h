@@ -13,8 +13,6 @@
 #ifndef _MOTOR
 #define _MOTOR
 
-#include <TLE94112.h>
-
 //! Duration in ms motor runs before reading for changes (sensor, serial)
 #define MOTOR_PULSESHORT 100 
 //! Duration in ms motor runs before reading for new command while motor
@@ -43,11 +41,52 @@
 
 #define INVERT_DIRECTION_DELAY 300  ///< Delay in ms when the motor should invert direction
 #define ACCELERATION_DELAY 5        ///< Delay between acceleration steps
+#define RAMP_UPDATE_PERIOD 20       ///< Min ms between two duty cycle writes while ramping (4 PWM periods)
 #define FEED_EXTRUDER_DELAY 1500    ///< Delay ms for an Extruder feed unit (time related to filament feed length)
 
+// Tension regulator defaults for the automatic feeding, can be changed at runtime
+#define TENSION_SETPOINT 30     ///< Extruder tension to keep (gr of weight deviation)
+#define TENSION_KP 2.0          ///< Proportional gain (duty cycle / gr)
+#define TENSION_KI 4.0          ///< Integral gain (duty cycle / gr / s)
+#define TENSION_MAX_SLEW 16     ///< Max duty cycle variation every regulator update
+#define TENSION_MAX_DUTY 224    ///< Max duty cycle of the regulator, above the fastest extruder
+
+// The tension is the deviation from the roll weight, which is not known
+// while the regulator keeps the filament stretched: it is measured again
+// releasing the filament periodically
+#define TENSION_RELAX_PERIOD 60000  ///< ms between two releases of the filament
+#define TENSION_RELAX_FEED 1000     ///< ms the motor feeds faster than the extruder
+#define TENSION_RELAX_TIME 2500     ///< ms of the release, the last part with the filament loose
+#define TENSION_RELAX_DUTY 48       ///< Duty cycle added to release the filament
+
+//! The consumption rate is added to the tension regulator output as
+//! feed-forward
+#define _FEED_FORWARD
+//! Filament released (cm/s) with the max duty cycle, depends on the motor
+//! and the roll diameter. Used to convert the consumption rate to duty cycle
+#define MOTOR_FEED_RATE 5.0
+//! Duty cycle below which the motor does not turn, depends on the motor
+#define MOTOR_DEAD_ZONE 48
+//! Max duty cycle value
+#define DC_FULL 255
+
 #define DIRECTION_FEED 1    ///< Motor rotates to release filament
 #define DIRECTION_LOAD 2    ///< Motor rotates to load filament
 
+// Motion engine states, advanced by MotorControl::motorUpdate() every loop cycle
+#define MOTION_IDLE 0         ///< Motor stopped, nothing to do
+#define MOTION_ACCELERATE 1   ///< Duty cycle ramping to the regime value
+#define MOTION_CRUISE 2       ///< Motor running at the regime duty cycle
+#define MOTION_DECELERATE 3   ///< Duty cycle ramping down to the minimum value
+#define MOTION_BRAKE 4        ///< Half bridges braked, waiting before the next motion
+#define MOTION_WAIT 5         ///< Motion waiting for the PWM generator used by another channel
+
+//! Max ms a motor keeps a PWM generator shared with a channel waiting for it
+#define MOTOR_PWM_SLICE 2000
+
+//! Duration value to keep the regime speed until the motor is stopped
+#define DURATION_CONTINUOUS -1
+
 #ifdef _HIGHCURRENT
 //! High current error title
 #define TLE_ERROR_MSG "TLE94112 HC Error"
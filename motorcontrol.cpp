@@ -10,51 +10,54 @@
  */
 
 #include "motorcontrol.h"
+#include "perf.h"
 
-void MotorControl::begin(void) {
-  // enable tle94112
-  tle94112.begin();
+//! Driver diagnosis shared by the channels
+BridgeDiagnostics MotorControl::diagnostics;
+
+//! Channel using every PWM generator, -1 if free
+static int pwmOwner[HAL_PWM3 + 1] = { -1, -1, -1, -1 };
+//! Channel waiting for every PWM generator, -1 if none
+static int pwmNext[HAL_PWM3 + 1] = { -1, -1, -1, -1 };
+//! halMillis() when every PWM generator has been taken
+static unsigned long pwmTaken[HAL_PWM3 + 1];
+
+void MotorControl::begin(int ch) {
+  int hb;
+
+  channel = ch;
+  pwm = HAL_PWM1 + (channel % HAL_PWM3);
 
   internalStatus.isRunning = false;
+  internalStatus.motionState = MOTION_IDLE;
+  internalStatus.currentDC = 0;
+  nextMotion.pending = false;
+  faultStop = false;
+  yielding = false;
+
+  if(channel == 0) {
+    // enable the TLE94112 driver
+    halBridgeBegin();
+    diagnostics.begin();
 
-  // Disable the unused half bridges
-  #ifdef _HIGHCURRENT
-    // High current mode, keep in use HB1&2, 3&4
-    tle94112.configHB(tle94112.TLE_HB5, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB6, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB7, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB8, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB9, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB10, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB11, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB12, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-  #else
-    // No High current mode use only HB1 & 2
-    tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB5, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB6, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB7, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB8, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB9, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB10, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB11, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB12, tle94112.TLE_FLOATING, tle94112.TLE_NOPWM);
-  #endif
+    // Disable the half bridges not used by any channel
+    // (in _HIGHCURRENT mode every motor pole uses two half bridges)
+    for(hb = SPOOL_CHANNELS * CHANNEL_BRIDGES + 1; hb <= HAL_BRIDGES; hb++)
+      halBridgeConfig(hb, HAL_HB_FLOATING, HAL_NOPWM);
+  }
 }
 
 void MotorControl::end(void) {
-  tle94112.end();
+  if(channel == 0)
+    halBridgeEnd();
 }
 
 void MotorControl::feedExtruder(long duration) {
   motorRun(DC_MIN_EXTRUDER, DC_MAX_EXTRUDER, ACCELERATION_DELAY, duration, DIRECTION_FEED);
-  motorBrake();
 }
 
 void MotorControl::filamentFeed(long duration) {
   motorRun(DC_MIN_MANUAL_FFED, DC_MAX_MANUAL_FFED, ACCELERATION_DELAY, duration, DIRECTION_FEED);
-  motorBrake();
 }
 
 void MotorControl::filamentContFeed(void) {
@@ -63,7 +66,6 @@ void MotorControl::filamentContFeed(void) {
 
 void MotorControl::filamentLoad(long duration) {
   motorRun(DC_MIN_MANUAL_LOAD, DC_MAX_MANUAL_LOAD, ACCELERATION_DELAY, duration, DIRECTION_LOAD);
-  motorBrake();
 }
 
 void MotorControl::filamentContLoad(void) {
@@ -71,198 +73,324 @@ void MotorControl::filamentContLoad(void) {
 }
 
 void MotorControl::motorRun(int minDC, int maxDC, int accdelay, long duration, int motorDirection) {
-  int j;
+  // Motor stopped by a critical driver fault
+  if(faultStop)
+    return;
 
-  // If the motor is already running it is stopped before starting again
-  if(internalStatus.isRunning)
-    motorBrake();
-  // Check for the direction
-  if(motorDirection == DIRECTION_FEED) {
-#ifdef _HIGHCURRENT
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-#else
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-#endif
+  // Waiting for the PWM generator or releasing it: the motion
+  // is started when the generator is available
+  if(yielding || (internalStatus.motionState == MOTION_WAIT)) {
+    queueMotion(minDC, maxDC, accdelay, duration, motorDirection);
+  }
+  // Motor idle or braked in the same direction: start immediately
+  else if( (internalStatus.motionState == MOTION_IDLE) || 
+      ((internalStatus.motionState == MOTION_BRAKE) && !nextMotion.pending &&
+       (internalStatus.motorDirection == motorDirection)) ) {
+    if(pwmAcquire()) {
+      startMotion(minDC, maxDC, accdelay, duration, motorDirection);
+    }
+    else {
+      queueMotion(minDC, maxDC, accdelay, duration, motorDirection);
+      internalStatus.motionState = MOTION_WAIT;
+    }
   }
+  // Same direction: change the regime speed without stopping
+  else if( (internalStatus.motorDirection == motorDirection) && 
+           (internalStatus.motionState != MOTION_BRAKE) ) {
+    internalStatus.minDC = minDC;
+    internalStatus.maxDC = maxDC;
+    internalStatus.accdelay = accdelay;
+    internalStatus.duration = duration;
+    internalStatus.motionState = MOTION_ACCELERATE;
+    internalStatus.stateTimer = halMillis();
+  }
+  // Opposite direction (or already inverting): brake first, then start
   else {
-#ifdef _HIGHCURRENT
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-#else
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-#endif
+    queueMotion(minDC, maxDC, accdelay, duration, motorDirection);
+    if(internalStatus.motionState != MOTION_BRAKE)
+      stopMotion();
   }
+}
+
+void MotorControl::queueMotion(int minDC, int maxDC, int accdelay, long duration, int motorDirection) {
+  nextMotion.pending = true;
+  nextMotion.minDC = minDC;
+  nextMotion.maxDC = maxDC;
+  nextMotion.accdelay = accdelay;
+  nextMotion.duration = duration;
+  nextMotion.motorDirection = motorDirection;
+}
 
-  // Acceleration loop  
-  for(j = minDC; j <= maxDC; j++) {
-    // Update the speed
-    tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, j);
-  //Check for error
-  if(tleCheckDiagnostic()) {
-    tleDiagnostic();
+void MotorControl::motorStart(int minDC, int maxDC, int accdelay, int motorDirection) {
+  motorRun(minDC, maxDC, accdelay, DURATION_CONTINUOUS, motorDirection);
+}
+
+void MotorControl::motorSpeed(int dc, int motorDirection) {
+  boolean moving = (internalStatus.motionState == MOTION_ACCELERATE) || 
+                   (internalStatus.motionState == MOTION_CRUISE);
+
+  if(dc == 0) {
+    if(moving || (internalStatus.motionState == MOTION_WAIT))
+      motorBrake();
   }
-    delay(accdelay);
+  // Do not restart the ramp if the regime speed is not changed
+  else if( !moving || (internalStatus.maxDC != dc) || 
+           (internalStatus.motorDirection != motorDirection) ||
+           (internalStatus.duration != DURATION_CONTINUOUS) ) {
+    motorRun(DC_MIN_EXTRUDER, dc, ACCELERATION_DELAY, DURATION_CONTINUOUS, motorDirection);
   }
+}
 
-  // Wait for the requeste number of ms at the regime speed
-  tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, maxDC);
-  //Check for error
-  if(tleCheckDiagnostic()) {
-    tleDiagnostic();
+void MotorControl::motorBrake(void) {
+  nextMotion.pending = false;
+  yielding = false;
+  if(internalStatus.motionState == MOTION_WAIT) {
+    // Not started, the generator is not needed anymore
+    if(pwmNext[pwm] == channel)
+      pwmNext[pwm] = -1;
+    internalStatus.motionState = MOTION_IDLE;
   }
-  delay(duration);
-
-  // Deceleration loop  
-  for(j = maxDC; j > minDC; j--) {
-    // Update the speed
-    tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, j);
-  //Check for error
-  if(tleCheckDiagnostic()) {
-    tleDiagnostic();
+  else {
+    stopMotion();
+  }
+}
+
+void MotorControl::checkFaults(void) {
+  // A critical fault stops the motors of all the channels
+  if(diagnostics.faults & DIAG_CRITICAL) {
+    if(!faultStop)
+      emergencyStop();
   }
-    delay(accdelay);
+  else {
+    faultStop = false;
   }
 }
 
-void MotorControl::motorStart(int minDC, int maxDC, int accdelay, int motorDirection) {
-  int j;
-  // If the motor is already running it is stopped before starting again
-  if(internalStatus.isRunning)
-    motorBrake();
+boolean MotorControl::motorUpdate(void) {
+  PERF_SCOPE(PERF_MOTION);
+
+  // Another channel is waiting for the PWM generator: stop at the end
+  // of the time slice and resume the motion later
+  if( ((internalStatus.motionState == MOTION_ACCELERATE) || 
+       (internalStatus.motionState == MOTION_CRUISE)) &&
+      (pwmNext[pwm] >= 0) && (pwmNext[pwm] != channel) &&
+      ((halMillis() - pwmTaken[pwm]) >= MOTOR_PWM_SLICE) ) {
+    long remaining = internalStatus.duration;
+    boolean resume = true;
+    // The time already spent at the regime speed is not repeated
+    if( (remaining != DURATION_CONTINUOUS) && (internalStatus.motionState == MOTION_CRUISE) ) {
+      remaining -= halMillis() - internalStatus.stateTimer;
+      resume = (remaining > 0);
+    }
+    if(resume) {
+      queueMotion(internalStatus.minDC, internalStatus.maxDC, internalStatus.accdelay, 
+                  remaining, internalStatus.motorDirection);
+      yielding = true;
+    }
+    stopMotion();
+  }
+
+  switch(internalStatus.motionState) {
+    case MOTION_ACCELERATE:
+      if(rampStep(internalStatus.maxDC)) {
+        internalStatus.motionState = MOTION_CRUISE;
+        internalStatus.stateTimer = halMillis();
+      }
+      break;
+
+    case MOTION_CRUISE:
+      // Continuous motion runs until a stop is requested
+      if( (internalStatus.duration != DURATION_CONTINUOUS) && 
+          ((long)(halMillis() - internalStatus.stateTimer) >= internalStatus.duration) ) {
+        internalStatus.motionState = MOTION_DECELERATE;
+        internalStatus.stateTimer = halMillis();
+      }
+      break;
+
+    case MOTION_DECELERATE:
+      if(rampStep(internalStatus.minDC)) {
+        brakeBridges();
+        internalStatus.motionState = MOTION_BRAKE;
+        internalStatus.stateTimer = halMillis();
+      }
+      break;
+
+    case MOTION_BRAKE:
+      if(yielding) {
+        // The generator has been released, wait for the next turn
+        yielding = false;
+        internalStatus.isRunning = false;
+        internalStatus.motionState = MOTION_WAIT;
+        pwmAcquire();
+      }
+      else if(nextMotion.pending) {
+        // Wait for the motor to stop before inverting the direction
+        if((halMillis() - internalStatus.stateTimer) >= INVERT_DIRECTION_DELAY) {
+          if(pwmAcquire()) {
+            nextMotion.pending = false;
+            startMotion(nextMotion.minDC, nextMotion.maxDC, nextMotion.accdelay, 
+                        nextMotion.duration, nextMotion.motorDirection);
+          }
+          else {
+            internalStatus.isRunning = false;
+            internalStatus.motionState = MOTION_WAIT;
+          }
+        }
+      }
+      else {
+        internalStatus.motionState = MOTION_IDLE;
+        internalStatus.isRunning = false;
+        return true;
+      }
+      break;
+
+    case MOTION_WAIT:
+      if(pwmAcquire()) {
+        nextMotion.pending = false;
+        startMotion(nextMotion.minDC, nextMotion.maxDC, nextMotion.accdelay, 
+                    nextMotion.duration, nextMotion.motorDirection);
+      }
+      break;
+
+    case MOTION_IDLE:
+      break;
+  }
+
+  return false;
+}
+
+void MotorControl::startMotion(int minDC, int maxDC, int accdelay, long duration, int motorDirection) {
+  PERF_COUNT(PERF_MOTIONS);
+
   // Set the motor status
   internalStatus.isRunning = true;
   internalStatus.minDC = minDC;
   internalStatus.maxDC = maxDC;
   internalStatus.accdelay = accdelay;
+  internalStatus.duration = duration;
   internalStatus.motorDirection = motorDirection;
 
   // Check for the direction
   if(motorDirection == DIRECTION_FEED) {
-#ifdef _HIGHCURRENT
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-#else
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-#endif
+    setPoles(HAL_HB_HIGH, pwm, HAL_HB_LOW, HAL_NOPWM);
   }
   else {
-#ifdef _HIGHCURRENT
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-    tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-#else
-    tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_LOW, tle94112.TLE_NOPWM);
-    tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_PWM1);
-#endif
+    setPoles(HAL_HB_LOW, HAL_NOPWM, HAL_HB_HIGH, pwm);
   }
 
-  // Acceleration loop  
-  for(j = minDC; j <= maxDC; j++) {
-    // Update the speed
-    tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, j);
-    //Check for error
-    if(tleCheckDiagnostic()) {
-      tleDiagnostic();
-    }
-    delay(accdelay);
-  }
-  tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, maxDC);
+  // First acceleration step at the minimum duty cycle
+  internalStatus.currentDC = minDC;
+  halBridgePWM(pwm, minDC);
+  internalStatus.motionState = MOTION_ACCELERATE;
+  internalStatus.stateTimer = halMillis();
 }
 
-void MotorControl::motorBrake(void) {
+void MotorControl::stopMotion(void) {
   // If motor is running then it decelerates before stop
-  if(internalStatus.isRunning) {
-    int j;
-    // Deceleration loop  
-    for(j = internalStatus.maxDC; j > internalStatus.minDC; j--) {
-      // Update the speed
-      tle94112.configPWM(tle94112.TLE_PWM1, tle94112.TLE_FREQ200HZ, j);
-    //Check for error
-    if(tleCheckDiagnostic()) {
-      tleDiagnostic();
-    }
-      delay(internalStatus.accdelay);
-    }
-    // Update the motor status
-    internalStatus.isRunning = false;
+  if( (internalStatus.motionState == MOTION_ACCELERATE) || 
+      (internalStatus.motionState == MOTION_CRUISE) ) {
+    internalStatus.motionState = MOTION_DECELERATE;
+    internalStatus.stateTimer = halMillis();
   }
+  else if(internalStatus.motionState != MOTION_DECELERATE) {
+    brakeBridges();
+    internalStatus.motionState = MOTION_BRAKE;
+    internalStatus.stateTimer = halMillis();
+  }
+}
+
+void MotorControl::setPoles(int feedState, int feedPwm, int loadState, int loadPwm) {
+  const channelMap& map = channelTable[channel];
+
+  halBridgeConfig(map.feedHB, feedState, feedPwm);
 #ifdef _HIGHCURRENT
-  // High current configuration, uses HB1&2 + 3&4
-  tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
-  tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
-  tle94112.configHB(tle94112.TLE_HB3, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
-  tle94112.configHB(tle94112.TLE_HB4, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
-#else
-  // No high current mode, use only HB1 & 2
-  tle94112.configHB(tle94112.TLE_HB1, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
-  tle94112.configHB(tle94112.TLE_HB2, tle94112.TLE_HIGH, tle94112.TLE_NOPWM);
+  // High current configuration, two half bridges every pole
+  halBridgeConfig(map.feedHB + 1, feedState, feedPwm);
+#endif
+  halBridgeConfig(map.loadHB, loadState, loadPwm);
+#ifdef _HIGHCURRENT
+  halBridgeConfig(map.loadHB + 1, loadState, loadPwm);
 #endif
-//Check for error
-  if(tleCheckDiagnostic()) {
-    tleDiagnostic();
-  }
 }
 
-boolean MotorControl:: tleCheckDiagnostic(void) {
-  if(tle94112.getSysDiagnosis() == tle94112.TLE_STATUS_OK)
-    return false;
-  else
-    return true;
+void MotorControl::brakeBridges(void) {
+  setPoles(HAL_HB_HIGH, HAL_NOPWM, HAL_HB_HIGH, HAL_NOPWM);
+  // The motor is not modulated anymore
+  pwmRelease();
 }
 
-void MotorControl::tleDiagnostic() {
-  int diagnosis = tle94112.getSysDiagnosis();
+void MotorControl::emergencyStop(void) {
+  nextMotion.pending = false;
+  yielding = false;
+  faultStop = true;
+  internalStatus.currentDC = 0;
+  if(pwmOwner[pwm] == channel)
+    halBridgePWM(pwm, 0);
+  if(pwmNext[pwm] == channel)
+    pwmNext[pwm] = -1;
+  brakeBridges();
+  internalStatus.motionState = MOTION_BRAKE;
+  internalStatus.stateTimer = halMillis();
+}
 
-  if(diagnosis == tle94112.TLE_STATUS_OK) {
-    Serial.println(TLE_NOERROR);
-  } // No errors
-  else {
-    // Open load error can be ignored
-    if(tle94112.getSysDiagnosis(tle94112.TLE_LOAD_ERROR)) {
-#ifndef _IGNORE_OPENLOAD
-      Serial.println(TLE_ERROR_MSG);
-      Serial.println(TLE_LOADERROR);
-      Serial.println("");
-#endif
-    } // Open load error
-    else {
-      Serial.println(TLE_ERROR_MSG);
-      if(tle94112.getSysDiagnosis(tle94112.TLE_SPI_ERROR)) {
-        Serial.println(TLE_SPIERROR);
-      }
-      if(tle94112.getSysDiagnosis(tle94112.TLE_UNDER_VOLTAGE)) {
-        Serial.println(TLE_UNDERVOLTAGE);
-      }
-      if(tle94112.getSysDiagnosis(tle94112.TLE_OVER_VOLTAGE)) {
-        Serial.println(TLE_OVERVOLTAGE);
-      }
-      if(tle94112.getSysDiagnosis(tle94112.TLE_POWER_ON_RESET)) {
-        Serial.println(TLE_POWERONRESET);
-      }
-      if(tle94112.getSysDiagnosis(tle94112.TLE_TEMP_SHUTDOWN)) {
-        Serial.println(TLE_TEMPSHUTDOWN);
-      }
-      if(tle94112.getSysDiagnosis(tle94112.TLE_TEMP_WARNING)) {
-        Serial.println(TLE_TEMPWARNING);
-      }
-      Serial.println("");
-    } // Any other error
-    // Clear all possible error conditions        
-    tle94112.clearErrors();
-  } // Error condition
+boolean MotorControl::pwmFree(void) {
+  return ((pwmOwner[pwm] < 0) || (pwmOwner[pwm] == channel)) &&
+         ((pwmNext[pwm] < 0) || (pwmNext[pwm] == channel));
+}
+
+boolean MotorControl::pwmAcquire(void) {
+  if(!pwmFree()) {
+    // First in the queue of the generator
+    if(pwmNext[pwm] < 0)
+      pwmNext[pwm] = channel;
+    return false;
+  }
+
+  if(pwmOwner[pwm] != channel) {
+    pwmOwner[pwm] = channel;
+    pwmTaken[pwm] = halMillis();
+  }
+  if(pwmNext[pwm] == channel)
+    pwmNext[pwm] = -1;
+  return true;
+}
+
+void MotorControl::pwmRelease(void) {
+  if(pwmOwner[pwm] == channel)
+    pwmOwner[pwm] = -1;
 }
 
+boolean MotorControl::rampStep(int target) {
+  long steps;
+  int remaining;
+
+  remaining = abs(target - internalStatus.currentDC);
+  if(remaining == 0)
+    return true;
+
+  // Number of steps elapsed since the last update. The steps are
+  // applied together every RAMP_UPDATE_PERIOD to reduce the driver writes
+  if(internalStatus.accdelay > 0) {
+    if((halMillis() - internalStatus.stateTimer) < RAMP_UPDATE_PERIOD)
+      return false;
+    steps = (halMillis() - internalStatus.stateTimer) / internalStatus.accdelay;
+    if(steps == 0)
+      return false;
+    internalStatus.stateTimer += steps * internalStatus.accdelay;
+  }
+  else {
+    steps = remaining;
+  }
 
+  if(steps > remaining)
+    steps = remaining;
+  if(target > internalStatus.currentDC)
+    internalStatus.currentDC += steps;
+  else
+    internalStatus.currentDC -= steps;
 
+  // Update the speed
+  halBridgePWM(pwm, internalStatus.currentDC);
 
+  return (internalStatus.currentDC == target);
+}
@@ -15,8 +15,10 @@
 
 #define _INFINEON_BOARD // "#undef" if not using Infineon XMC1100 Boot Arduino compatible board
 
-#include <TLE94112.h>
+#include "hal.h"
 #include "motor.h"
+#include "diagnostics.h"
+#include "channels.h"
 
 /**
  * Internal status of the motor
@@ -27,6 +29,26 @@ struct motorStatus {
   int maxDC;
   int accdelay;
   int motorDirection;
+  //! Motion engine state (MOTION_IDLE ... MOTION_BRAKE)
+  int motionState;
+  //! Duty cycle currently applied to the PWM channel
+  int currentDC;
+  //! ms at the regime speed, DURATION_CONTINUOUS runs until stopped
+  long duration;
+  //! millis() of the last ramp step or state change
+  unsigned long stateTimer;
+};
+
+/**
+ * Motion queued while the motor is braking before a direction inversion
+ */
+struct motionRequest {
+  boolean pending;
+  int minDC;
+  int maxDC;
+  int accdelay;
+  long duration;
+  int motorDirection;
 };
 
 /**
@@ -42,16 +64,28 @@ class MotorControl {
      * kind of geared motor it is used.\n
      * In _HIGHCURRENT mode every motor uses two half bridges couple together for every 
      * pole if more than 0.9A is needed (< 0.18)\n
-     * The standard usage mode is in low current mode with a single half bridge every motor pole
+     * The standard usage mode is in low current mode with a single half bridge every motor pole\n
+     * The first channel initializes the driver and disables the half bridges not
+     * used by any channel
+     * 
+     * \param ch the spool channel, selects the half bridges (channelTable) and
+     * the PWM generator
      */
-    void begin(void);
+    void begin(int ch);
 
     //! \brief stop the motor control
     void end(void);
 
+    //! Spool channel of the motor
+    int channel;
+
     //! Status of the motor updated when it runs outside of the control
     //! of the MotorControl class.
     motorStatus internalStatus;
+
+    //! Driver diagnosis, read at a fixed rate by the diagnostics task and
+    //! shared by all the channels
+    static BridgeDiagnostics diagnostics;
   
     /**
      * \brief Accelerates to the regime speed for filament release then 
@@ -60,7 +94,7 @@ class MotorControl {
      * 
      * \note The feedExtruder() speed is slower than the normal filamentFeed()
      * method. The typical duration for this method should be FEED_EXTRUDER_DELAY
-     * This method is uninterruptable as it uses internal delays
+     * The method returns immediately, the motion is executed by motorUpdate()
      * 
      * \param duration the numer of ms to feed at the regime speed
      */
@@ -72,7 +106,7 @@ class MotorControl {
      * to release a lenght of filament then decelerate until motor stop
      * 
      * \note The filamentFeed() speed is faster than the normal feedExtruder()
-     * method. This method is uninterruptable as it uses internal delays
+     * method. The method returns immediately, the motion is executed by motorUpdate()
      * 
      * \param duration the numer of ms to feed at the regime speed
      */
@@ -113,14 +147,17 @@ class MotorControl {
      * keep the regime speed for the needed number of milliseconds
      * then decelerate until motor stop
      * 
-     * \note This method is used by the uninterruptable methods feedExtruder().
-     * filamentFeed() and filamentLoad(). It is a public method for convenience
-     * but it is not expected to be used in the normal usage
+     * \note This method is used by feedExtruder(), filamentFeed() and
+     * filamentLoad(). It is a public method for convenience but it is not
+     * expected to be used in the normal usage.\n
+     * The motion is only scheduled here; if the motor is running in the same
+     * direction the new regime speed is reached from the current one, if it is
+     * running in the opposite direction it is braked before inverting.
      * 
      * \param minDC mnimumn duty cycle value
      * \param maxDC maximum duty cycle value
-     * \param accdelay pause ms during the acceleration/deceleration loops
-     * \param duration numer of ms at the regime speed
+     * \param accdelay pause ms between the acceleration/deceleration steps
+     * \param duration numer of ms at the regime speed or DURATION_CONTINUOUS
      */
     void motorRun(int minDC, int maxDC, int accdelay, long duration, int motorDirection);
 
@@ -130,32 +167,124 @@ class MotorControl {
      * 
      * \param minDC mnimumn duty cycle value
      * \param maxDC maximum duty cycle value
-     * \param accdelay pause ms during the acceleration/deceleration loops
+     * \param accdelay pause ms between the acceleration/deceleration steps
      */
     void motorStart(int minDC, int maxDC, int accdelay, int motorDirection);
 
     /**
-     * \brief Brake the motor keelping the half bridges high
+     * \brief Keep the motor running at the requested duty cycle
+     * 
+     * Used by the tension regulator to modulate the feeding speed. The new
+     * duty cycle is reached with the acceleration ramp without stopping.
+     * 
+     * \param dc the regime duty cycle, 0 decelerates and stops the motor
+     * \param motorDirection the motor direction
+     */
+    void motorSpeed(int dc, int motorDirection);
+
+    /**
+     * \brief Decelerates the motor (if running) then brake it keeping 
+     * the half bridges high. Any motion waiting for a direction inversion
+     * is discarded
      */
     void motorBrake();
 
     /**
-     * Check if an error occured.
+     * \brief Advance the motion engine state machine
      * 
-     * \note This method should be used for test the error condition only as it does not
+     * Must be called every few ms (motion task). The ramp steps are timed
+     * with millis() so a late call does not slow down the motion, the missed
+     * steps are applied at once.\n
+     * A motor sharing the PWM generator with a channel waiting for it is
+     * stopped after MOTOR_PWM_SLICE ms and restarted when the generator is
+     * available again.
      * 
-     * \return true if tehre is an error
+     * \return true when a motion sequence has been completed and the motor
+     * is idle again
      */
-    boolean tleCheckDiagnostic(void);
+    boolean motorUpdate(void);
 
     /**
-     * Check the error condition and detect the kind of error (if any) then reset it
+     * \brief Apply the last driver diagnosis to the motor
      * 
-     * \return The error string
-     * \todo Check the harfbridge generating the specific error 
+     * A critical fault brakes the motor immediately. No new motion is
+     * accepted until the critical fault disappears.
      */
-    void tleDiagnostic(void);
+    void checkFaults(void);
+
+  private:
+    //! Motion waiting for the brake before a direction inversion
+    motionRequest nextMotion;
+
+    //! The motor has been stopped by a critical fault
+    boolean faultStop;
+
+    //! PWM generator modulating the motor
+    int pwm;
+
+    //! The motor is stopping to release the PWM generator
+    boolean yielding;
 
+    /**
+     * Check if the PWM generator is not used by another channel
+     */
+    boolean pwmFree(void);
+
+    /**
+     * Take the PWM generator if it is not used by another channel
+     * 
+     * \return false if the generator is used by another channel, this
+     * channel is then the next one taking it
+     */
+    boolean pwmAcquire(void);
+
+    /**
+     * Release the PWM generator if it is used by this channel
+     */
+    void pwmRelease(void);
+
+    /**
+     * Queue a motion, it is started by motorUpdate()
+     */
+    void queueMotion(int minDC, int maxDC, int accdelay, long duration, int motorDirection);
+
+    /**
+     * Configure the half bridges of the two motor poles
+     * 
+     * \param feedState state of the pole high when feeding
+     * \param feedPwm PWM channel of the pole high when feeding
+     * \param loadState state of the pole high when loading
+     * \param loadPwm PWM channel of the pole high when loading
+     */
+    void setPoles(int feedState, int feedPwm, int loadState, int loadPwm);
+    /**
+     * Brake the motor immediately, without deceleration
+     */
+    void emergencyStop(void);
+
+    /**
+     * Configure the half bridges for the direction and start the acceleration
+     */
+    void startMotion(int minDC, int maxDC, int accdelay, long duration, int motorDirection);
+
+    /**
+     * Start the deceleration ramp or brake immediately if the motor is not running
+     */
+    void stopMotion(void);
+
+    /**
+     * Keep the motor half bridges high (brake)
+     */
+    void brakeBridges(void);
+
+    /**
+     * Move the duty cycle toward the target value by the ramp steps elapsed
+     * since the last update
+     * 
+     * \param target the duty cycle to reach
+     * \return true when the target has been reached
+     */
+    boolean rampStep(int target);
 };
 
 #endif
@@ -0,0 +1,116 @@
+/**
+ *  \file perf.cpp
+ *  \brief Performance probes and counters
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "perf.h"
+
+#ifdef _PERF
+
+PerfCounters perf;
+
+//! Probe names, indexed by the probe ID
+static const char* const probeNames[PERF_PROBES] =
+  { "loop", "readScale", "acquire", "motion", "diagnosis", "command", "tx" };
+//! Counter names, indexed by the counter ID
+static const char* const counterNames[PERF_COUNTERS] =
+  { "motions", "faults", "commands" };
+
+/**
+ * Histogram bucket of a time, a fixed sequence of comparisons as the
+ * Cortex-M0 has no count leading zeros instruction
+ *
+ * \param us the time in us
+ * \return floor(log2(us)), 0 ... PERF_BUCKETS - 1
+ */
+static int perfBucket(unsigned long us) {
+  int b = 0;
+
+  if(us >= (1UL << (PERF_BUCKETS - 1)))
+    return PERF_BUCKETS - 1;
+  if(us >= 0x100) { us >>= 8; b += 8; }
+  if(us >= 0x10) { us >>= 4; b += 4; }
+  if(us >= 0x4) { us >>= 2; b += 2; }
+  if(us >= 0x2) { b += 1; }
+  return b;
+}
+
+void PerfCounters::begin(void) {
+  unsigned long start;
+  int j;
+
+  // Time empty probes, their cost is included in every measure
+  clear();
+  start = halMicros();
+  for(j = 0; j < PERF_CALIBRATION; j++) {
+    PERF_SCOPE(PERF_LOOP);
+  }
+  overhead = (halMicros() - start) * 1000 / PERF_CALIBRATION;
+  clear();
+}
+
+void PerfCounters::clear(void) {
+  memset(probes, 0, sizeof(probes));
+  memset(counters, 0, sizeof(counters));
+  since = halMillis();
+}
+
+void PerfCounters::record(int id, unsigned long us) {
+  perfProbe& p = probes[id];
+  int b;
+
+  p.count++;
+  p.total += us;
+  if(us > p.max)
+    p.max = us;
+  // The acquire probe can be recorded by the interrupt while the
+  // main loop records it for a polled sensor: a count can be lost
+  b = perfBucket(us);
+  if(p.buckets[b] < 0xFFFF)
+    p.buckets[b]++;
+}
+
+void PerfCounters::show(void) {
+  int j, b;
+
+  halSerial.print("Perf: ");
+  halSerial.print((halMillis() - since) / 1000);
+  halSerial.print(" s, probe ");
+  halSerial.print(overhead);
+  halSerial.println(" ns");
+
+  for(j = 0; j < PERF_PROBES; j++) {
+    perfProbe& p = probes[j];
+    if(p.count == 0)
+      continue;
+    halSerial.print(probeNames[j]);
+    halSerial.print(" n ");
+    halSerial.print(p.count);
+    halSerial.print(" avg ");
+    halSerial.print((unsigned long)(p.total / p.count));
+    halSerial.print(" max ");
+    halSerial.print(p.max);
+    halSerial.print(" us |");
+    // Bucket n is 2^n us
+    for(b = 0; b < PERF_BUCKETS; b++) {
+      halSerial.print(" ");
+      halSerial.print(p.buckets[b]);
+    }
+    halSerial.println("");
+  }
+
+  for(j = 0; j < PERF_COUNTERS; j++) {
+    halSerial.print(counterNames[j]);
+    halSerial.print(" ");
+    halSerial.println(counters[j]);
+  }
+  clear();
+}
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ *  \file perf.h
+ *  \brief Performance probes and counters
+ *
+ *  PERF_SCOPE(id) measures the time from the declaration to the end of
+ *  the enclosing block with halMicros() and adds it to a log2 histogram:
+ *  bucket 0 counts the times under 2 us, bucket n the times from 2^n to
+ *  2^(n+1) - 1 us, the last bucket all the longer times. PERF_RECORD(id,
+ *  us) adds a time already measured by the caller. PERF_COUNT(id)
+ *  counts an event. The "perf" command shows and clears the results.\n
+ *  A probe costs two halMicros() calls, about 2 us on the XMC1100: the
+ *  probes should not be placed where the code runs tens of thousands
+ *  of times per second (see bench/bench_probes.cpp).\n
+ *  Without _PERF the macros are empty and no code or memory is used.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _PERFCOUNTERS
+#define _PERFCOUNTERS
+
+#include "hal.h"
+
+//! Define to compile the probes
+#undef _PERF
+
+//! Histogram buckets, the last one is for the times over 2^15 us
+#define PERF_BUCKETS 16
+//! Probes used to measure the overhead of a probe
+#define PERF_CALIBRATION 64
+
+// Timed probes
+#define PERF_LOOP 0         ///< Main loop cycle executing a task
+#define PERF_READSCALE 1    ///< FilamentWeight::readScale()
+#define PERF_ACQUIRE 2      ///< HX711 sample read (interrupt or polled)
+#define PERF_MOTION 3       ///< MotorControl::motorUpdate()
+#define PERF_DIAGNOSIS 4    ///< Driver status read
+#define PERF_COMMAND 5      ///< Command parsing and execution
+#define PERF_TX 6           ///< History and telemetry transmission
+#define PERF_PROBES 7
+
+// Event counters
+#define PERF_MOTIONS 0      ///< Motions started
+#define PERF_FAULTS 1       ///< New driver faults
+#define PERF_COMMANDS 2     ///< Commands received
+#define PERF_COUNTERS 3
+
+#ifdef _PERF
+
+/**
+ * Times measured by a probe
+ */
+struct perfProbe {
+  //! Number of measures
+  unsigned long count;
+  //! Sum of the times in us
+  unsigned long long total;
+  //! Longest time in us
+  unsigned long max;
+  //! log2 histogram of the times, saturated at 0xFFFF
+  uint16_t buckets[PERF_BUCKETS];
+};
+
+/**
+ * Class collecting the probes and counters
+ */
+class PerfCounters {
+
+  public:
+    /**
+     * Clear the results and measure the overhead of a probe
+     */
+    void begin(void);
+
+    /**
+     * Add a time to a probe
+     *
+     * \param id the probe
+     * \param us the time in us
+     */
+    void record(int id, unsigned long us);
+
+    /**
+     * Count an event
+     *
+     * \param id the counter
+     */
+    void count(int id) { counters[id]++; }
+
+    /**
+     * Show the results, then clear them
+     */
+    void show(void);
+
+  private:
+    //! The timed probes
+    perfProbe probes[PERF_PROBES];
+    //! The event counters
+    unsigned long counters[PERF_COUNTERS];
+    //! halMillis() when the results have been cleared
+    unsigned long since;
+    //! Overhead of a probe in ns
+    unsigned long overhead;
+
+    /**
+     * Clear the results
+     */
+    void clear(void);
+};
+
+//! The probes and counters
+extern PerfCounters perf;
+
+/**
+ * Probe measuring the time to the end of its scope
+ */
+class PerfScope {
+
+  public:
+    PerfScope(int probe) : id(probe), start(halMicros()) { }
+    ~PerfScope() { perf.record(id, halMicros() - start); }
+
+  private:
+    int id;
+    unsigned long start;
+};
+
+#define PERF_JOIN(a, b) a##b
+#define PERF_NAME(line) PERF_JOIN(perfScope, line)
+//! Time the rest of the block
+#define PERF_SCOPE(id) PerfScope PERF_NAME(__LINE__)(id)
+//! Add a time measured by the caller
+#define PERF_RECORD(id, us) perf.record(id, us)
+//! Count an event
+#define PERF_COUNT(id) perf.count(id)
+
+#else
+
+#define PERF_SCOPE(id) ((void)0)
+#define PERF_RECORD(id, us) ((void)0)
+#define PERF_COUNT(id) ((void)0)
+
+#endif
+
+#endif
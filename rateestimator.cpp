@@ -0,0 +1,77 @@
+/**
+ *  \file rateestimator.cpp
+ *  \brief Online estimation of the filament consumption rate
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "rateestimator.h"
+
+void RateEstimator::reset(void) {
+  slope = 0;
+  valid = false;
+  head = 0;
+  count = 0;
+  bucketSum = 0;
+  bucketCount = 0;
+}
+
+void RateEstimator::update(measure_t value, unsigned long timestamp) {
+  if(bucketCount == 0) {
+    bucketStart = timestamp;
+    if(count == 0)
+      origin = timestamp;
+  }
+  bucketSum += value;
+  bucketCount++;
+
+  // Bucket completed: the average becomes a new window point,
+  // timed in the middle of the bucket
+  if((timestamp - bucketStart) >= RATE_BUCKET_TIME) {
+    points[head] = (measure_t)(bucketSum / bucketCount);
+    times[head] = (bucketStart - origin) + (timestamp - bucketStart) / 2;
+    head = (head + 1) % RATE_WINDOW;
+    if(count < RATE_WINDOW)
+      count++;
+    bucketSum = 0;
+    bucketCount = 0;
+    regression();
+  }
+}
+
+void RateEstimator::regression(void) {
+  measure_sum_t sumV = 0, sTV = 0, sTT = 0;
+  measure_t meanV;
+  long long sumT = 0;
+  long meanT, t;
+  int j;
+
+  if(count < RATE_MIN_POINTS) {
+    valid = false;
+    return;
+  }
+
+  // The times are in ms, the sums of the products are wide
+  // enough for the window span
+  for(j = 0; j < count; j++) {
+    sumT += times[j];
+    sumV += points[j];
+  }
+  meanT = (long)(sumT / count);
+  meanV = (measure_t)(sumV / count);
+
+  for(j = 0; j < count; j++) {
+    t = times[j] - meanT;
+    sTV += (measure_sum_t)t * (points[j] - meanV);
+    sTT += (measure_sum_t)t * t;
+  }
+
+  if(sTT > 0) {
+    slope = (measure_t)(sTV * 1000 / sTT);
+    valid = true;
+  }
+}
@@ -0,0 +1,80 @@
+/**
+ *  \file rateestimator.h
+ *  \brief Online estimation of the filament consumption rate
+ *  
+ *  The readings are averaged in buckets of RATE_BUCKET_TIME ms; the
+ *  rate is the least-squares slope of the last RATE_WINDOW buckets.
+ *  Averaging before the regression keeps the memory footprint and the
+ *  calculation cost fixed, independently of the readings frequency, and
+ *  smooths out the tension variations around the setpoint.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _RATEESTIMATOR
+#define _RATEESTIMATOR
+
+#include "hal.h"
+#include "fixedpoint.h"
+
+//! ms of readings averaged in a single window point
+#define RATE_BUCKET_TIME 8000
+//! Number of points of the regression window
+#define RATE_WINDOW 16
+//! Minimum number of points for a valid estimation
+#define RATE_MIN_POINTS 4
+
+/**
+ * Class estimating the variation rate of a value
+ */
+class RateEstimator {
+
+  public:
+    /**
+     * Clear the window, the rate is not valid until RATE_MIN_POINTS
+     * buckets have been collected
+     */
+    void reset(void);
+
+    /**
+     * Add a new reading
+     * 
+     * \param value the reading
+     * \param timestamp halMillis() of the reading
+     */
+    void update(measure_t value, unsigned long timestamp);
+
+    //! Variation of the value per second
+    measure_t slope;
+    //! True when the slope has been calculated on enough points
+    boolean valid;
+
+  private:
+    //! Average value of every window point
+    measure_t points[RATE_WINDOW];
+    //! Timestamp of every window point (ms, from the first bucket)
+    unsigned long times[RATE_WINDOW];
+    //! Next point to be written
+    int head;
+    //! Points in the window
+    int count;
+    //! Sum of the readings in the current bucket
+    measure_sum_t bucketSum;
+    //! Readings in the current bucket
+    int bucketCount;
+    //! halMillis() of the first reading of the current bucket
+    unsigned long bucketStart;
+    //! halMillis() of the first bucket, time origin of the points
+    unsigned long origin;
+
+    /**
+     * Calculate the least-squares slope of the window points
+     */
+    void regression(void);
+};
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ *  \file runout.cpp
+ *  \brief Spool runout forecast of the running job
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "runout.h"
+
+void RunoutForecaster::reset(measure_t initial, measure_t weight, unsigned long timestamp) {
+  start = initial;
+  net = pointNet = weight;
+  pointTime = timestamp;
+  rate = 0;
+  spread = 0;
+  points = 0;
+  valid = false;
+  warned = false;
+  pending = false;
+  running = true;
+  check();
+}
+
+void RunoutForecaster::stop(void) {
+  running = false;
+  job = 0;
+  rate = 0;
+  spread = 0;
+  points = 0;
+  valid = false;
+  warned = false;
+  pending = false;
+}
+
+void RunoutForecaster::update(measure_t weight, unsigned long timestamp) {
+  unsigned long elapsed = timestamp - pointTime;
+  long point, deviation, limit;
+
+  net = weight;
+  if(elapsed < RUNOUT_PERIOD)
+    return;
+
+  point = (long)((long long)MEASURE_MILLI(pointNet - net) * 1000000 / elapsed);
+  pointNet = net;
+  pointTime = timestamp;
+
+  // The first points are averaged, then they are clipped to the
+  // deviation so a single transient does not move the rate
+  if(points < RUNOUT_MIN_POINTS) {
+    points++;
+    rate += (point - rate) / points;
+    spread += (abs(point - rate) - spread) / points;
+    valid = (points == RUNOUT_MIN_POINTS);
+  }
+  else {
+    deviation = point - rate;
+    limit = max(spread * RUNOUT_CLIP / 10, RUNOUT_MIN_RATE);
+    spread += (abs(deviation) - spread) / RUNOUT_SPREAD_DIV;
+    rate += constrain(deviation, -limit, limit) / RUNOUT_RATE_DIV;
+  }
+  check();
+}
+
+void RunoutForecaster::setJob(measure_t weight) {
+  job = weight;
+  warned = false;
+  check();
+}
+
+long RunoutForecaster::timeToEmpty(void) {
+  if(!valid || (rate < RUNOUT_MIN_RATE))
+    return -1;
+  return (long)((long long)MEASURE_MILLI(max(net, 0)) * 1000 / rate);
+}
+
+measure_t RunoutForecaster::leftAtEnd(void) {
+  return start - job;
+}
+
+boolean RunoutForecaster::alert(void) {
+  if(!pending)
+    return false;
+  pending = false;
+  return true;
+}
+
+void RunoutForecaster::check(void) {
+  long empty = timeToEmpty();
+
+  if(warned || !running)
+    return;
+  if( ((empty >= 0) && (empty < RUNOUT_WARNING)) ||
+      ((job > 0) && (leftAtEnd() < MEASURE(RUNOUT_RESERVE))) ) {
+    warned = true;
+    pending = true;
+  }
+}
+
+void RunoutForecaster::show(void) {
+  long empty = timeToEmpty();
+
+  halSerial.print("Runout: ");
+  halSerial.print(rate * 3.6 / 1000.0);
+  halSerial.print(" gr/h, empty in ");
+  if(empty < 0)
+    halSerial.print("--");
+  else
+    halSerial.print(empty / 60);
+  halSerial.print(" min");
+  if( running && (job > 0) ) {
+    halSerial.print(", job ");
+    halSerial.print(MEASURE_FLOAT(job));
+    halSerial.print(" gr leaves ");
+    halSerial.print(MEASURE_FLOAT(leftAtEnd()));
+    halSerial.print(" gr");
+  }
+  halSerial.println("");
+}
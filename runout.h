@@ -0,0 +1,150 @@
+/**
+ *  \file runout.h
+ *  \brief Spool runout forecast of the running job
+ *  
+ *  Every RUNOUT_PERIOD ms the weight lost since the previous point gives
+ *  a consumption rate point. The rate follows the points as an average
+ *  with weight 1 / RUNOUT_RATE_DIV, but every point is first clipped to
+ *  RUNOUT_CLIP times the average deviation of the points: a tension
+ *  transient or a bump on the scale moves the rate only a little, while
+ *  a real change of the consumption is followed as the deviation grows.
+ *  The state is a few integer values, updated in constant time; the
+ *  rate is in ug/s so a slow job keeps its resolution.\n
+ *  The remaining weight divided by the rate is the time to empty; when
+ *  the filament needed by the job is known the weight left at the job
+ *  end is the weight at the job start less the job weight.
+ *  A single warning is raised when the spool is expected to be empty in
+ *  less than RUNOUT_WARNING s or the job would leave less than
+ *  RUNOUT_RESERVE gr. Nothing is checked while no job is running.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _RUNOUT
+#define _RUNOUT
+
+#include "hal.h"
+#include "fixedpoint.h"
+
+//! ms between two rate points
+#define RUNOUT_PERIOD 30000
+//! Rate points averaged before the rate is valid
+#define RUNOUT_MIN_POINTS 4
+//! The rate moves of 1 / RUNOUT_RATE_DIV of the clipped deviation of a point
+#define RUNOUT_RATE_DIV 4
+//! The deviation average moves of 1 / RUNOUT_SPREAD_DIV of a point deviation
+#define RUNOUT_SPREAD_DIV 8
+//! Points clipped to this number of tenths of the average deviation
+//! from the rate
+#define RUNOUT_CLIP 25
+//! Min consumption rate (ug/s) the time to empty is calculated for,
+//! and min clip of the points
+#define RUNOUT_MIN_RATE 500
+//! Warning when the spool is expected to be empty in less than this (s)
+#define RUNOUT_WARNING 900
+//! Warning when the job is expected to leave less than this (gr)
+#define RUNOUT_RESERVE 5
+
+/**
+ * Class forecasting the spool runout
+ */
+class RunoutForecaster {
+
+  public:
+    /**
+     * Clear the rate and the warning, should be called at the job start
+     * or when a job is resumed
+     * 
+     * \param initial the net weight of the roll at the job start
+     * \param weight the current net weight of the roll
+     * \param timestamp halMillis() of the weight
+     */
+    void reset(measure_t initial, measure_t weight, unsigned long timestamp);
+
+    /**
+     * End of the job: the rate, the job weight and the warning are
+     * cleared and the forecast is stopped until the next reset()
+     */
+    void stop(void);
+
+    /**
+     * Update the forecast with a new net weight of the running job
+     * 
+     * \param weight the net weight of the roll without the tension
+     * \param timestamp halMillis() of the weight
+     */
+    void update(measure_t weight, unsigned long timestamp);
+
+    /**
+     * Set the filament needed by the job. It can be set before the job
+     * starts, it is kept until the job ends
+     * 
+     * \param weight the job weight, 0 if not known
+     */
+    void setJob(measure_t weight);
+
+    /**
+     * Time to empty the spool at the current rate
+     * 
+     * \return the time in s, -1 if the rate is not known
+     */
+    long timeToEmpty(void);
+
+    /**
+     * Weight left on the spool at the end of the job
+     * 
+     * \return the weight, only valid if a job is running and its
+     * weight is set
+     */
+    measure_t leftAtEnd(void);
+
+    /**
+     * Check the warning, it is notified only once
+     * 
+     * \return true if the warning has been raised since the last call
+     */
+    boolean alert(void);
+
+    /**
+     * Show the rate, the time to empty and the job forecast
+     */
+    void show(void);
+
+    //! Consumption rate (ug/s)
+    long rate;
+    //! True when the rate has been averaged on enough points
+    boolean valid;
+    //! Filament needed by the job, 0 if not known
+    measure_t job;
+    //! A job is running, the start weight is valid
+    boolean running;
+
+  private:
+    //! Net weight at the job start
+    measure_t start;
+    //! Last net weight
+    measure_t net;
+    //! Net weight of the last rate point
+    measure_t pointNet;
+    //! halMillis() of the last rate point
+    unsigned long pointTime;
+    //! Average deviation of the points from the rate (ug/s)
+    long spread;
+    //! Points since the job start, up to RUNOUT_MIN_POINTS
+    int points;
+    //! The warning has been raised for this job
+    boolean warned;
+    //! The warning has not yet been notified
+    boolean pending;
+
+    /**
+     * Raise the warning if the runout is close
+     */
+    void check(void);
+};
+
+#endif
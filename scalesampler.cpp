@@ -0,0 +1,150 @@
+/**
+ *  \file scalesampler.cpp
+ *  \brief Interrupt-driven acquisition of the HX711 load cell amplifier
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "scalesampler.h"
+#include "perf.h"
+
+//! The samplers served by the interrupts
+static ScaleSampler* activeSamplers[SAMPLER_INTERRUPTS] = { NULL, NULL };
+
+//! Data ready interrupt service routine of the first slot
+static void dataReadyISR0(void) {
+  if(activeSamplers[0] != NULL)
+    activeSamplers[0]->acquire();
+}
+
+//! Data ready interrupt service routine of the second slot
+static void dataReadyISR1(void) {
+  if(activeSamplers[1] != NULL)
+    activeSamplers[1]->acquire();
+}
+
+//! Interrupt service routines by slot
+static void (* const dataReadyISRs[SAMPLER_INTERRUPTS])(void) = { dataReadyISR0, dataReadyISR1 };
+
+void ScaleSampler::begin(int doutPin, int clkPin) {
+  dout = doutPin;
+  clk = clkPin;
+  halPinInput(dout);
+  halPinOutput(clk);
+  // Clock low keeps the HX711 powered up
+  halPinWrite(clk, LOW);
+
+  head = tail = 0;
+  acquired = overruns = 0;
+  rate = 0;
+  rateSamples = 0;
+  rateTimer = halMillis();
+
+  // Search a free interrupt slot, the sensor is polled if there is
+  // none or the pin has no interrupt
+  polled = true;
+  for(slot = 0; slot < SAMPLER_INTERRUPTS; slot++) {
+    if( (activeSamplers[slot] == NULL) || (activeSamplers[slot] == this) )
+      break;
+  }
+  if(slot < SAMPLER_INTERRUPTS) {
+    activeSamplers[slot] = this;
+    if(halAdcAttach(dout, dataReadyISRs[slot]))
+      polled = false;
+    else
+      activeSamplers[slot] = NULL;
+  }
+  if(polled)
+    slot = -1;
+}
+
+void ScaleSampler::end(void) {
+  if(slot >= 0) {
+    halAdcDetach(dout);
+    activeSamplers[slot] = NULL;
+    slot = -1;
+  }
+}
+
+void ScaleSampler::poll(void) {
+  if(polled)
+    acquire();
+}
+
+void ScaleSampler::flush(void) {
+  tail = head;
+}
+
+int ScaleSampler::available(void) {
+  return (uint8_t)(head - tail) & SAMPLE_RING_MASK;
+}
+
+boolean ScaleSampler::read(scaleSample &sample) {
+  uint8_t t = tail;
+
+  if(t == head)
+    return false;
+
+  sample.raw = ringRaw[t];
+  sample.timestamp = ringTime[t];
+  // Release the slot only after it has been copied
+  tail = (t + 1) & SAMPLE_RING_MASK;
+  return true;
+}
+
+void ScaleSampler::acquire(void) {
+  unsigned long value = 0;
+  uint8_t next;
+  int j;
+
+  // The falling edges generated by the data bits while shifting
+  // retrigger the interrupt; DOUT is high again after the read
+  if(halPinRead(dout) != LOW)
+    return;
+  PERF_SCOPE(PERF_ACQUIRE);
+
+  // Shift in the 24 bits, MSB first
+  for(j = 0; j < 24; j++) {
+    halPinWrite(clk, HIGH);
+    halDelayMicros(1);
+    value = (value << 1) | halPinRead(dout);
+    halPinWrite(clk, LOW);
+    halDelayMicros(1);
+  }
+  // Select the gain for the next conversion
+  for(j = 0; j < HX711_GAIN_PULSES; j++) {
+    halPinWrite(clk, HIGH);
+    halDelayMicros(1);
+    halPinWrite(clk, LOW);
+    halDelayMicros(1);
+  }
+  // Sign extension of the 24 bits two's complement value
+  if(value & 0x800000)
+    value |= ~0xFFFFFFUL;
+
+  acquired++;
+  next = (head + 1) & SAMPLE_RING_MASK;
+  if(next == tail) {
+    // Buffer full, the main loop is not consuming fast enough
+    overruns++;
+    return;
+  }
+  ringRaw[head] = (long)value;
+  ringTime[head] = halMicros();
+  head = next;
+}
+
+void ScaleSampler::updateRate(void) {
+  unsigned long elapsed = halMillis() - rateTimer;
+
+  if(elapsed >= SAMPLE_RATE_WINDOW) {
+    unsigned long count = acquired;
+    rate = (float)(count - rateSamples) * 1000 / elapsed;
+    rateSamples = count;
+    rateTimer += elapsed;
+  }
+}
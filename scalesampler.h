@@ -0,0 +1,134 @@
+/**
+ *  \file scalesampler.h
+ *  \brief Interrupt-driven acquisition of the HX711 load cell amplifier
+ *  
+ *  The HX711 pulls DOUT low when a conversion is ready. The falling edge
+ *  triggers an interrupt reading the 24 bits sample in a ring buffer with
+ *  the acquisition timestamp, so the main loop never waits for the sensor.
+ *  The ring is single producer (the interrupt) and single consumer (the
+ *  main loop) and does not need locks.\n
+ *  SAMPLER_INTERRUPTS samplers can use the interrupt, the others (or a
+ *  data pin without interrupt) are polled by the main loop with poll().
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SCALESAMPLER
+#define _SCALESAMPLER
+
+#include "hal.h"
+
+//! Number of samples in the ring buffer, must be a power of 2
+#define SAMPLE_RING_SIZE 32
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+
+//! Clock pulses after the 24 data bits selecting channel A gain 128
+#define HX711_GAIN_PULSES 1
+
+//! Window in ms to calculate the acquisition rate
+#define SAMPLE_RATE_WINDOW 1000
+
+//! Max number of samplers served by the data ready interrupt
+#define SAMPLER_INTERRUPTS 2
+
+/**
+ * Single raw sample read from the HX711
+ */
+struct scaleSample {
+  //! Raw 24 bits conversion value, sign extended
+  long raw;
+  //! micros() when the sample has been read
+  unsigned long timestamp;
+};
+
+/**
+ * Class acquiring the HX711 samples from the data ready interrupt
+ */
+class ScaleSampler {
+
+  public:
+    /**
+     * Setup the pins and attach the data ready interrupt
+     * 
+     * \param doutPin HX711 data pin, polled if it does not support the
+     * external interrupts
+     * \param clkPin HX711 clock pin
+     */
+    void begin(int doutPin, int clkPin);
+
+    /**
+     * Detach the interrupt. Should be called before any other access
+     * to the sensor pins
+     */
+    void end(void);
+
+    /**
+     * Discard all the samples already in the buffer
+     */
+    void flush(void);
+
+    /**
+     * Return the number of samples ready to be read
+     */
+    int available(void);
+
+    /**
+     * Get the oldest sample from the buffer
+     * 
+     * \param sample the structure receiving the sample
+     * \return false if the buffer is empty
+     */
+    boolean read(scaleSample &sample);
+
+    /**
+     * Read a sample from the sensor and store it in the buffer.
+     * Called by the interrupt service routine
+     */
+    void acquire(void);
+
+    /**
+     * Read the sample if the sensor is polled and a conversion is ready.
+     * Should be called every loop cycle
+     */
+    void poll(void);
+
+    /**
+     * Update the acquisition rate. Should be called every loop cycle
+     */
+    void updateRate(void);
+
+    //! Samples read from the sensor
+    volatile unsigned long acquired;
+    //! Samples discarded because the buffer was full
+    volatile unsigned long overruns;
+    //! Acquisition rate in samples per second in the last window
+    float rate;
+    //! The sensor is read by poll() instead of the interrupt
+    boolean polled;
+
+  private:
+    //! Raw values
+    volatile long ringRaw[SAMPLE_RING_SIZE];
+    //! Timestamps of the raw values
+    volatile unsigned long ringTime[SAMPLE_RING_SIZE];
+    //! Next position written by the interrupt
+    volatile uint8_t head;
+    //! Next position read by the main loop
+    volatile uint8_t tail;
+    //! Data pin
+    int dout;
+    //! Clock pin
+    int clk;
+    //! Interrupt slot used, -1 if polled
+    int slot;
+    //! Acquired samples at the start of the rate window
+    unsigned long rateSamples;
+    //! millis() at the start of the rate window
+    unsigned long rateTimer;
+};
+
+#endif
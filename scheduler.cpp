@@ -0,0 +1,115 @@
+/**
+ *  \file scheduler.cpp
+ *  \brief Cooperative scheduler of the main loop tasks
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "scheduler.h"
+#include "perf.h"
+
+void Scheduler::begin(void) {
+  count = 0;
+}
+
+int Scheduler::add(const char* name, taskHandler handler, unsigned int period,
+                   unsigned int deadline, int priority) {
+  if(count >= SCHED_TASKS)
+    return -1;
+
+  task& t = tasks[count];
+  t.name = name;
+  t.handler = handler;
+  t.period = period;
+  t.deadline = deadline;
+  t.priority = priority;
+  t.release = halMillis();
+  t.pending = false;
+  t.runs = 0;
+  t.wcet = 0;
+  t.misses = 0;
+  return count++;
+}
+
+void Scheduler::signal(int id) {
+  if(tasks[id].pending)
+    return;
+  tasks[id].pending = true;
+  tasks[id].release = halMillis();
+}
+
+boolean Scheduler::released(task& t, unsigned long now) {
+  if(t.period == TASK_EVENT)
+    return t.pending;
+  return (long)(now - t.release) >= 0;
+}
+
+boolean Scheduler::run(void) {
+  unsigned long now = halMillis();
+  unsigned long start, elapsed;
+  int j, next = -1;
+
+  // The first released task with the highest priority
+  for(j = 0; j < count; j++) {
+    if( released(tasks[j], now) && 
+        ((next < 0) || (tasks[j].priority < tasks[next].priority)) )
+      next = j;
+  }
+  if(next < 0)
+    return false;
+
+  task& t = tasks[next];
+  t.pending = false;
+  start = halMicros();
+  t.handler();
+  elapsed = halMicros() - start;
+  now = halMillis();
+  // The loop cycles without a task are not timed, a probe on every
+  // cycle would take a large part of the CPU
+  PERF_RECORD(PERF_LOOP, elapsed);
+
+  t.runs++;
+  if(elapsed > t.wcet)
+    t.wcet = elapsed;
+  if((now - t.release) > t.deadline)
+    t.misses++;
+
+  if(t.period != TASK_EVENT) {
+    t.release += t.period;
+    // The releases already expired are lost
+    while((long)(now - t.release) >= (long)t.period) {
+      t.release += t.period;
+      t.misses++;
+    }
+  }
+  return true;
+}
+
+void Scheduler::show(void) {
+  int j;
+
+  halSerial.println("task\tperiod\tdeadline\tprio\truns\twcet us\tmisses");
+  for(j = 0; j < count; j++) {
+    halSerial.print(tasks[j].name);
+    halSerial.print("\t");
+    if(tasks[j].period == TASK_EVENT)
+      halSerial.print("event");
+    else
+      halSerial.print(tasks[j].period);
+    halSerial.print("\t");
+    halSerial.print(tasks[j].deadline);
+    halSerial.print("\t");
+    halSerial.print(tasks[j].priority);
+    halSerial.print("\t");
+    halSerial.print(tasks[j].runs);
+    halSerial.print("\t");
+    halSerial.print(tasks[j].wcet);
+    halSerial.print("\t");
+    halSerial.println(tasks[j].misses);
+    tasks[j].wcet = 0;
+  }
+}
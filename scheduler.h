@@ -0,0 +1,121 @@
+/**
+ *  \file scheduler.h
+ *  \brief Cooperative scheduler of the main loop tasks
+ *
+ *  Every task is a function returning as soon as its job is done, never
+ *  waiting. A periodic task is released every period ms, an event task
+ *  when it is signalled. Every call to run() executes the released task
+ *  with the highest priority, so the latency of a task is bounded by the
+ *  longest execution time of the others.\n
+ *  A task completed later than its deadline from the release, or
+ *  released again before running, is a deadline miss.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SCHEDULER
+#define _SCHEDULER
+
+#include "hal.h"
+
+//! Max number of tasks
+#define SCHED_TASKS 8
+//! Period of the tasks released by signal()
+#define TASK_EVENT 0
+
+//! Task function
+typedef void (*taskHandler)(void);
+
+/**
+ * Task descriptor and statistics
+ */
+struct task {
+  //! Name shown by the tasks command
+  const char* name;
+  //! Function executing the task
+  taskHandler handler;
+  //! ms between two releases, TASK_EVENT if released by signal()
+  unsigned int period;
+  //! Max ms from the release to the completion
+  unsigned int deadline;
+  //! 0 is the highest priority
+  int priority;
+  //! halMillis() of the next (periodic) or last (event) release
+  unsigned long release;
+  //! Event task signalled and not yet executed
+  boolean pending;
+  //! Number of executions
+  unsigned long runs;
+  //! Worst case execution time in us
+  unsigned long wcet;
+  //! Deadline misses
+  unsigned long misses;
+};
+
+/**
+ * Class scheduling the tasks
+ */
+class Scheduler {
+
+  public:
+    /**
+     * Clear the task table
+     */
+    void begin(void);
+
+    /**
+     * Add a task, the tasks with the same priority are executed in
+     * the order they have been added
+     *
+     * \param name the task name
+     * \param handler the task function
+     * \param period ms between two releases or TASK_EVENT
+     * \param deadline max ms from the release to the completion
+     * \param priority 0 is the highest priority
+     * \return the task ID, -1 if the table is full
+     */
+    int add(const char* name, taskHandler handler, unsigned int period,
+            unsigned int deadline, int priority);
+
+    /**
+     * Release an event task, a signal while the task is already
+     * pending is merged with the previous one
+     *
+     * \param id the task ID
+     */
+    void signal(int id);
+
+    /**
+     * Execute the released task with the highest priority
+     *
+     * \return false if no task was released
+     */
+    boolean run(void);
+
+    /**
+     * Show the tasks and their statistics, then clear the worst case
+     * execution times
+     */
+    void show(void);
+
+  private:
+    //! Tasks, index is the task ID
+    task tasks[SCHED_TASKS];
+    //! Number of tasks
+    int count;
+
+    /**
+     * Check if a task is released
+     *
+     * \param t the task
+     * \param now halMillis()
+     * \return true if the task should be executed
+     */
+    boolean released(task& t, unsigned long now);
+};
+
+#endif
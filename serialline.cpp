@@ -0,0 +1,76 @@
+/**
+ *  \file serialline.cpp
+ *  \brief Non-blocking assembler of the command lines from the serial port
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "serialline.h"
+
+void SerialLine::begin(Stream &port) {
+  stream = &port;
+  length = 0;
+  buffer[0] = '\0';
+  ready = false;
+  discarding = false;
+  overflows = 0;
+  lastChar = halMillis();
+}
+
+int SerialLine::poll(void) {
+  int c;
+
+  // The line returned by the previous call has been used
+  if(ready) {
+    ready = false;
+    length = 0;
+  }
+
+  while(stream->available() > 0) {
+    c = stream->read();
+    lastChar = halMillis();
+
+    if( (c == '\n') || (c == '\r') ) {
+      // Skip the empty lines (e.g. '\n' after '\r')
+      if( (length > 0) || discarding )
+        return endLine();
+    }
+    else if(!discarding) {
+      if(length < (SERIAL_LINE_SIZE - 1)) {
+        buffer[length++] = (char)c;
+      }
+      else {
+        // Line too long, skip until the line end
+        discarding = true;
+      }
+    }
+  }
+
+  // No line ending received
+  if( ((length > 0) || discarding) && 
+      ((halMillis() - lastChar) >= SERIAL_LINE_TIMEOUT) )
+    return endLine();
+
+  return SERIAL_LINE_NONE;
+}
+
+const char* SerialLine::line(void) {
+  return buffer;
+}
+
+int SerialLine::endLine(void) {
+  if(discarding) {
+    discarding = false;
+    length = 0;
+    overflows++;
+    return SERIAL_LINE_OVERFLOW;
+  }
+
+  buffer[length] = '\0';
+  ready = true;
+  return SERIAL_LINE_READY;
+}
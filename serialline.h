@@ -0,0 +1,83 @@
+/**
+ *  \file serialline.h
+ *  \brief Non-blocking assembler of the command lines from the serial port
+ *  
+ *  The available bytes are collected every loop cycle in a fixed buffer.
+ *  A line is complete when a '\n' or '\r' is received or when no more 
+ *  characters arrive for SERIAL_LINE_TIMEOUT ms (terminals sending
+ *  without line ending). Lines longer than the buffer are discarded.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SERIALLINE
+#define _SERIALLINE
+
+#include "hal.h"
+
+//! Max line length including the string terminator
+#define SERIAL_LINE_SIZE 32
+//! ms without new characters completing a line with no line ending
+#define SERIAL_LINE_TIMEOUT 50
+
+// Line assembler results
+#define SERIAL_LINE_NONE 0      ///< No complete line yet
+#define SERIAL_LINE_READY 1     ///< A line is ready, see line()
+#define SERIAL_LINE_OVERFLOW 2  ///< A too long line has been discarded
+
+/**
+ * Class assembling the serial characters in command lines
+ */
+class SerialLine {
+
+  public:
+    /**
+     * Initialize the assembler
+     * 
+     * \param port the serial stream to read
+     */
+    void begin(Stream &port);
+
+    /**
+     * Read the available characters without waiting
+     * 
+     * \return SERIAL_LINE_READY if a line is complete, SERIAL_LINE_OVERFLOW
+     * if a line has been discarded, else SERIAL_LINE_NONE
+     */
+    int poll(void);
+
+    /**
+     * Return the last complete line, valid until the next poll()
+     */
+    const char* line(void);
+
+    //! Number of discarded lines
+    unsigned long overflows;
+
+  private:
+    //! Serial port
+    Stream* stream;
+    //! Line characters
+    char buffer[SERIAL_LINE_SIZE];
+    //! Number of characters in the buffer
+    int length;
+    //! True when the buffer holds a line returned by the last poll()
+    boolean ready;
+    //! True while the rest of a too long line is skipped
+    boolean discarding;
+    //! millis() of the last received character
+    unsigned long lastChar;
+
+    /**
+     * Terminate the current line
+     * 
+     * \return the poll() result for the line
+     */
+    int endLine(void);
+};
+
+#endif
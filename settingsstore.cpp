@@ -0,0 +1,97 @@
+/**
+ *  \file settingsstore.cpp
+ *  \brief Calibration, tare and filament settings kept in the persistent storage
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "settingsstore.h"
+#include "crc16.h"
+
+boolean SettingsStore::begin(int channel) {
+  storedSettings record;
+  int j;
+
+  writes = 0;
+  bytesWritten = 0;
+  lastSlot = -1;
+  slots = (halStorageSize() - STORE_BASE) / (int)sizeof(storedSettings) / SPOOL_CHANNELS;
+  if(slots > STORE_SLOTS)
+    slots = STORE_SLOTS;
+  base = STORE_BASE + channel * slots * sizeof(storedSettings);
+
+  for(j = 0; j < slots; j++) {
+    halStorageRead(base + j * sizeof(storedSettings), &record, sizeof(record));
+    if(!valid(record))
+      continue;
+    // The sequence wraps, the newest record is ahead of the others
+    if( (lastSlot < 0) || ((int16_t)(record.sequence - last.sequence) > 0) ) {
+      last = record;
+      lastSlot = j;
+    }
+  }
+  return lastSlot >= 0;
+}
+
+boolean SettingsStore::load(storedSettings& settings) {
+  if(lastSlot < 0)
+    return false;
+  settings = last;
+  return true;
+}
+
+boolean SettingsStore::save(storedSettings& settings) {
+  int slot;
+
+  if(slots <= 0)
+    return false;
+
+  settings.version = STORE_VERSION;
+  if(lastSlot >= 0) {
+    // Nothing changed since the last save
+    settings.sequence = last.sequence;
+    settings.crc = checksum(settings);
+    if(memcmp(&settings, &last, sizeof(settings)) == 0)
+      return false;
+    settings.sequence = last.sequence + 1;
+    slot = (lastSlot + 1) % slots;
+  }
+  else {
+    settings.sequence = 0;
+    slot = 0;
+  }
+  settings.crc = checksum(settings);
+
+  bytesWritten += halStorageWrite(base + slot * sizeof(storedSettings), 
+                                  &settings, sizeof(settings));
+  writes++;
+  last = settings;
+  lastSlot = slot;
+  return true;
+}
+
+void SettingsStore::show(void) {
+  halSerial.print("Store slot: ");
+  if(lastSlot < 0)
+    halSerial.print("--");
+  else
+    halSerial.print(lastSlot);
+  halSerial.print("/");
+  halSerial.print(slots);
+  halSerial.print(" writes: ");
+  halSerial.print(writes);
+  halSerial.print(" bytes: ");
+  halSerial.println(bytesWritten);
+}
+
+boolean SettingsStore::valid(const storedSettings& settings) {
+  return (settings.version == STORE_VERSION) && (settings.crc == checksum(settings));
+}
+
+uint16_t SettingsStore::checksum(const storedSettings& settings) {
+  return crc16((const uint8_t*)&settings, sizeof(settings) - sizeof(settings.crc));
+}
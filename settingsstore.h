@@ -0,0 +1,115 @@
+/**
+ *  \file settingsstore.h
+ *  \brief Calibration, tare and filament settings kept in the persistent storage
+ *  
+ *  The settings are saved as a versioned record protected by a CRC.
+ *  STORE_SLOTS records are written in rotation (wear levelling): every
+ *  save goes to the slot following the last one with an increased
+ *  sequence number, and at startup the valid record with the highest
+ *  sequence is restored. A power loss while saving corrupts only the
+ *  slot being written, the previous record is still valid.\n
+ *  Every spool channel has its own slots, the storage is divided
+ *  between the SPOOL_CHANNELS channels.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SETTINGSSTORE
+#define _SETTINGSSTORE
+
+#include "hal.h"
+#include "channels.h"
+
+//! Record layout version, records of different versions are ignored
+#define STORE_VERSION 2
+//! Number of records written in rotation
+#define STORE_SLOTS 8
+//! Storage address of the first slot
+#define STORE_BASE 0
+
+//! Settings record. The weights are in thousandths of gram
+struct storedSettings {
+  uint16_t version;         ///< STORE_VERSION
+  uint16_t sequence;        ///< Incremented at every save
+  float scaleCalibration;   ///< Raw counts per gram
+  float quadratic;          ///< Load cell nonlinearity (1 / gram)
+  int32_t scaleOffset;      ///< Raw value of the tare
+  int32_t initialWeight;    ///< Net weight when the job started
+  int32_t lastConsumedGrams;  ///< Consumed weight at the save
+  uint8_t materialID;       ///< Catalogue material
+  uint8_t diameterID;       ///< Catalogue diameter
+  uint8_t wID;              ///< Catalogue spool
+  uint8_t statID;           ///< Status (STAT_NONE ... STAT_RUN)
+  uint8_t units;            ///< Consumption units (_GR or _CM)
+  uint8_t reserved;
+  uint16_t crc;             ///< CRC-16 of the previous fields
+} __attribute__((packed));
+
+/**
+ * Class saving and restoring the settings record
+ */
+class SettingsStore {
+
+  public:
+    /**
+     * Search the most recent valid record of the channel
+     * 
+     * \param channel the spool channel
+     * \return true if a valid record has been found
+     */
+    boolean begin(int channel);
+
+    /**
+     * Return the most recent valid record
+     * 
+     * \param settings the record destination
+     * \return false if no valid record is stored
+     */
+    boolean load(storedSettings& settings);
+
+    /**
+     * Write the record to the next slot. The sequence, version and CRC
+     * are set by the store; a record equal to the last saved one is not
+     * written
+     * 
+     * \param settings the record to save
+     * \return true if the record has been written
+     */
+    boolean save(storedSettings& settings);
+
+    /**
+     * Show the last saved slot and the write counters
+     */
+    void show(void);
+
+    //! Records written since the startup
+    unsigned int writes;
+    //! Bytes changed in the storage since the startup
+    unsigned long bytesWritten;
+
+  private:
+    //! Slots of the channel fitting in the storage, at most STORE_SLOTS
+    int slots;
+    //! Storage address of the first slot of the channel
+    int base;
+    //! Slot of the last valid record, -1 if none
+    int lastSlot;
+    //! Last valid record
+    storedSettings last;
+
+    /**
+     * Check the version and the CRC of a record
+     */
+    boolean valid(const storedSettings& settings);
+
+    /**
+     * Calculate the CRC of a record
+     */
+    uint16_t checksum(const storedSettings& settings);
+};
+
+#endif
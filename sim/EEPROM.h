@@ -0,0 +1,54 @@
+/**
+ *  \file EEPROM.h
+ *  \brief Simulated EEPROM emulation of the XMC1100 flash
+ *
+ *  The same interface of the EEPROM library. The memory is shared with
+ *  the processes started by simSpawn(), so a board can boot with the
+ *  flash written by the previous one; a new board starts with the flash
+ *  erased (0xFF). The writes cost SIM_FLASH_WRITE_COST us and are
+ *  counted, in total and for every byte.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SIM_EEPROM
+#define _SIM_EEPROM
+
+#include <stdint.h>
+
+//! Size of the emulated EEPROM
+#define SIM_EEPROM_SIZE 1024
+
+/**
+ * Emulated EEPROM
+ */
+class EEPROMClass {
+
+  public:
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length(void);
+
+    // Simulation
+
+    //! Erase the memory and clear the counters
+    void erase(void);
+    //! Memory content
+    uint8_t* data(void);
+    //! Byte writes since the erase
+    unsigned long writes(void);
+    //! Writes of a byte since the erase, its wear
+    unsigned long writes(int address);
+    //! Byte reads since the erase
+    unsigned long reads(void);
+};
+
+//! The emulated EEPROM of the board
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ *  \file TLE94112.h
+ *  \brief Simulated Infineon TLE94112 half bridges driver
+ *
+ *  The same interface of the Infineon Tle94112 Arduino library, on a
+ *  model of the driver registers. As the library, every register update
+ *  is a read-modify-write of two SPI frames; the frames cost SIM_SPI_COST
+ *  us of virtual time and are counted for every register. The faults can
+ *  be injected: the diagnosis bits stay set until clearErrors(), a power
+ *  on reset also restores the registers reset values.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SIM_TLE94112
+#define _SIM_TLE94112
+
+#include <stdint.h>
+
+// Registers of the model
+#define TLE_REG_HB_ACT_1 0      ///< Half bridges 1 ... 4 low side and high side switches
+#define TLE_REG_HB_ACT_2 1      ///< Half bridges 5 ... 8
+#define TLE_REG_HB_ACT_3 2      ///< Half bridges 9 ... 12
+#define TLE_REG_HB_MODE_1 3     ///< Half bridges 1 ... 4 PWM channel
+#define TLE_REG_HB_MODE_2 4     ///< Half bridges 5 ... 8
+#define TLE_REG_HB_MODE_3 5     ///< Half bridges 9 ... 12
+#define TLE_REG_PWM_FREQ 6      ///< PWM channels frequency
+#define TLE_REG_PWM1_DC 7       ///< PWM channel 1 duty cycle
+#define TLE_REG_PWM2_DC 8       ///< PWM channel 2 duty cycle
+#define TLE_REG_PWM3_DC 9       ///< PWM channel 3 duty cycle
+#define TLE_REG_FW_CTRL 10      ///< Active free wheeling
+#define TLE_REG_SYS_DIAG 11     ///< System diagnosis
+#define TLE_REG_OP_ERROR 12     ///< Overcurrent and open load errors, cleared with the diagnosis
+//! Registers of the model
+#define TLE_REGISTERS 13
+//! Registers cleared by clearErrors()
+#define TLE_ERROR_REGISTERS 7
+
+//! Max register writes logged
+#define TLE_LOG_SIZE 100000
+
+/**
+ * A register write
+ */
+struct tleWrite {
+  unsigned long long time;  ///< Virtual time (us)
+  uint8_t reg;              ///< TLE_REG_*
+  uint8_t value;            ///< New value
+};
+
+/**
+ * The driver
+ */
+class Tle94112 {
+
+  public:
+    enum HalfBridge {
+      TLE_NOHB = 0,
+      TLE_HB1, TLE_HB2, TLE_HB3, TLE_HB4, TLE_HB5, TLE_HB6,
+      TLE_HB7, TLE_HB8, TLE_HB9, TLE_HB10, TLE_HB11, TLE_HB12
+    };
+
+    enum HBState {
+      TLE_FLOATING = 0,
+      TLE_LOW,
+      TLE_HIGH
+    };
+
+    enum PWMChannel {
+      TLE_NOPWM = 0,
+      TLE_PWM1,
+      TLE_PWM2,
+      TLE_PWM3
+    };
+
+    enum PWMFreq {
+      TLE_NOFREQ = 0,
+      TLE_FREQ80HZ,
+      TLE_FREQ100HZ,
+      TLE_FREQ200HZ,
+      TLE_FREQ2KHZ
+    };
+
+    enum DiagFlag {
+      TLE_SPI_ERROR = 0x80,
+      TLE_LOAD_ERROR = 0x40,
+      TLE_UNDER_VOLTAGE = 0x20,
+      TLE_OVER_VOLTAGE = 0x10,
+      TLE_POWER_ON_RESET = 0x08,
+      TLE_TEMP_SHUTDOWN = 0x04,
+      TLE_TEMP_WARNING = 0x02
+    };
+
+    //! System diagnosis without errors
+    static const uint8_t TLE_STATUS_OK = 0;
+
+    Tle94112();
+
+    // Library interface
+    void begin(void);
+    void end(void);
+    void configHB(HalfBridge hb, HBState state, PWMChannel pwm);
+    void configHB(HalfBridge hb, HBState state, PWMChannel pwm, uint8_t activeFW);
+    void configPWM(PWMChannel pwm, PWMFreq freq, uint8_t dutyCycle);
+    uint8_t getSysDiagnosis(void);
+    uint8_t getSysDiagnosis(uint8_t mask);
+    void clearErrors(void);
+
+    // Model
+
+    //! State of a half bridge, TLE_FLOATING, TLE_LOW or TLE_HIGH
+    int bridgeState(int hb);
+    //! PWM channel modulating a half bridge, TLE_NOPWM if none
+    int bridgePwm(int hb);
+    //! Duty cycle of a PWM channel, 0 if the frequency is not set
+    int pwmDuty(int pwm);
+
+    /**
+     * Inject a fault
+     *
+     * \param flags the DiagFlag bits
+     * \param holdUs the time (us) the fault persists, clearErrors() does
+     * not clear it in the meantime
+     */
+    void inject(uint8_t flags, unsigned long long holdUs = 0);
+
+    //! Clear the counters and the write log
+    void clearCounters(void);
+
+    //! Register values
+    uint8_t reg[TLE_REGISTERS];
+    //! Writes of every register
+    unsigned long writes[TLE_REGISTERS];
+    //! Reads of every register
+    unsigned long reads[TLE_REGISTERS];
+    //! SPI frames
+    unsigned long frames;
+    //! Library calls
+    unsigned long calls;
+    //! Write log, NULL if not enabled
+    tleWrite* log;
+    //! Writes in the log
+    unsigned long logged;
+
+  private:
+    //! Faults latched until cleared
+    uint8_t latched;
+    //! Faults held until holdUntil
+    uint8_t held;
+    //! End of the held faults
+    unsigned long long holdUntil;
+
+    //! Register reset values
+    void reset(void);
+    //! Read-modify-write of a register field
+    void update(int r, uint8_t mask, uint8_t value);
+    //! Read a register
+    uint8_t read(int r);
+};
+
+//! The driver of the board
+extern Tle94112 tle94112;
+
+#endif
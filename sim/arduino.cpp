@@ -0,0 +1,485 @@
+/**
+ *  \file arduino.cpp
+ *  \brief Simulated Arduino core: virtual clock, pins, interrupts and
+ *  serial port
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <deque>
+#include <string>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "sim.h"
+
+unsigned long long simNow = 0;
+
+// ==============================================
+// Interrupts
+// ==============================================
+
+//! External interrupts of the board, on the pins 2 and 3
+#define SIM_INTERRUPTS 2
+
+//! Interrupt service routines, NULL if detached
+static void (*isrs[SIM_INTERRUPTS])(void);
+//! Interrupt requested and not yet served
+static bool isrPending[SIM_INTERRUPTS];
+//! An interrupt service routine is running
+static bool inIsr = false;
+//! Interrupts enabled
+static bool isrEnabled = true;
+
+int digitalPinToInterrupt(int pin) {
+  if(pin == 2)
+    return 0;
+  if(pin == 3)
+    return 1;
+  return NOT_AN_INTERRUPT;
+}
+
+void attachInterrupt(int interrupt, void (*isr)(void), int mode) {
+  if( (interrupt < 0) || (interrupt >= SIM_INTERRUPTS) )
+    return;
+  isrs[interrupt] = isr;
+  isrPending[interrupt] = false;
+}
+
+void detachInterrupt(int interrupt) {
+  if( (interrupt < 0) || (interrupt >= SIM_INTERRUPTS) )
+    return;
+  isrs[interrupt] = NULL;
+  isrPending[interrupt] = false;
+}
+
+void interrupts(void) {
+  isrEnabled = true;
+}
+
+void noInterrupts(void) {
+  isrEnabled = false;
+}
+
+/**
+ * Falling edge on a pin, called by the simulated devices
+ *
+ * \param pin the pin
+ */
+void simPinFalling(int pin) {
+  int interrupt = digitalPinToInterrupt(pin);
+
+  if( (interrupt != NOT_AN_INTERRUPT) && (isrs[interrupt] != NULL) )
+    isrPending[interrupt] = true;
+}
+
+//! Serve the pending interrupts, one at a time as the NVIC does
+static void serveInterrupts(void) {
+  bool served = true;
+  int j;
+
+  if(inIsr || !isrEnabled)
+    return;
+  while(served) {
+    served = false;
+    for(j = 0; j < SIM_INTERRUPTS; j++) {
+      if(isrPending[j] && (isrs[j] != NULL)) {
+        isrPending[j] = false;
+        inIsr = true;
+        isrs[j]();
+        inIsr = false;
+        served = true;
+      }
+    }
+  }
+}
+
+// ==============================================
+// Clock
+// ==============================================
+
+void simAdvance(unsigned long long us) {
+  unsigned long long end = simNow + us;
+  unsigned long long next;
+
+  // The device events are processed in time order, the interrupts
+  // they request are served as soon as possible
+  for(;;) {
+    next = world.nextEvent();
+    if(next > end)
+      break;
+    if(next > simNow)
+      simNow = next;
+    world.event(simNow);
+    serveInterrupts();
+    // The interrupts delay the interrupted code
+    if(simNow > end)
+      end = simNow;
+  }
+  simNow = end;
+  serveInterrupts();
+}
+
+unsigned long millis(void) {
+  simAdvance(SIM_CLOCK_COST);
+  return (unsigned long)(simNow / 1000);
+}
+
+unsigned long micros(void) {
+  simAdvance(SIM_CLOCK_COST);
+  return (unsigned long)simNow;
+}
+
+void delay(unsigned long ms) {
+  simAdvance((unsigned long long)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  simAdvance(us);
+}
+
+// ==============================================
+// GPIO
+// ==============================================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  simAdvance(SIM_PIN_COST);
+  world.pinWrite(pin, level);
+}
+
+int digitalRead(uint8_t pin) {
+  simAdvance(SIM_PIN_COST);
+  return world.pinRead(pin);
+}
+
+// ==============================================
+// Serial port
+// ==============================================
+
+HardwareSerial Serial;
+
+std::string simOutput;
+bool simEcho = (getenv("SIM_VERBOSE") != NULL);
+unsigned long long simSerialBytes = 0;
+unsigned long long simSerialBlocked = 0;
+unsigned long simSerialOverruns = 0;
+void (*simSerialTap)(uint8_t c, unsigned long long us) = NULL;
+
+//! us to send a character, 10 bits
+static unsigned long long byteTime = 260;
+//! Time the last character in the transmit buffer is sent
+static unsigned long long txBusyUntil = 0;
+
+//! A character coming from the host
+struct simRxChar {
+  unsigned long long arrival;
+  uint8_t c;
+};
+//! Characters sent by the host and not yet arrived
+static std::deque<simRxChar> rxLine;
+//! Receive buffer of the core
+static std::deque<uint8_t> rxBuffer;
+//! Time the last character sent by the host arrives
+static unsigned long long rxBusyUntil = 0;
+
+void simSerialInput(const char* text) {
+  simRxChar rx;
+
+  if(rxBusyUntil < simNow)
+    rxBusyUntil = simNow;
+  for(; *text != '\0'; text++) {
+    rxBusyUntil += byteTime;
+    rx.arrival = rxBusyUntil;
+    rx.c = (uint8_t)*text;
+    rxLine.push_back(rx);
+  }
+}
+
+//! Move the characters arrived to the receive buffer. The firmware
+//! does not read the buffer in the meantime, so the overruns are the
+//! same as with the interrupt of the UART
+static void rxUpdate(void) {
+  SimDeviceHeap device;
+
+  while( !rxLine.empty() && (rxLine.front().arrival <= simNow) ) {
+    if(rxBuffer.size() < SIM_SERIAL_BUFFER)
+      rxBuffer.push_back(rxLine.front().c);
+    else
+      simSerialOverruns++;
+    rxLine.pop_front();
+  }
+}
+
+//! Characters in the transmit buffer
+static unsigned long long txQueued(void) {
+  if(txBusyUntil <= simNow)
+    return 0;
+  return (txBusyUntil - simNow + byteTime - 1) / byteTime;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  byteTime = 10000000ULL / baud;
+}
+
+int HardwareSerial::available(void) {
+  simAdvance(SIM_CLOCK_COST);
+  rxUpdate();
+  return rxBuffer.size();
+}
+
+int HardwareSerial::read(void) {
+  SimDeviceHeap device;
+  int c;
+
+  simAdvance(SIM_CLOCK_COST);
+  rxUpdate();
+  if(rxBuffer.empty())
+    return -1;
+  c = rxBuffer.front();
+  rxBuffer.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek(void) {
+  rxUpdate();
+  if(rxBuffer.empty())
+    return -1;
+  return rxBuffer.front();
+}
+
+void HardwareSerial::flush(void) {
+  if(txBusyUntil > simNow)
+    simAdvance(txBusyUntil - simNow);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  unsigned long long start = simNow;
+
+  simAdvance(SIM_CLOCK_COST);
+  // Buffer full: wait for a character to be sent
+  if(txQueued() >= SIM_SERIAL_BUFFER) {
+    simAdvance(txBusyUntil - (SIM_SERIAL_BUFFER - 1) * byteTime - simNow);
+    simSerialBlocked += simNow - start;
+  }
+  if(txBusyUntil < simNow)
+    txBusyUntil = simNow;
+  txBusyUntil += byteTime;
+
+  simSerialBytes++;
+  // The interrupts served above are the firmware, the output is not
+  SimDeviceHeap device;
+  simOutput += (char)c;
+  if(simEcho)
+    putchar(c);
+  if(simSerialTap != NULL)
+    simSerialTap(c, txBusyUntil);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  size_t j;
+
+  for(j = 0; j < size; j++)
+    write(buffer[j]);
+  return size;
+}
+
+int HardwareSerial::availableForWrite(void) {
+  return SIM_SERIAL_BUFFER - (int)txQueued();
+}
+
+// ==============================================
+// Print, same formatting as the Arduino core
+// ==============================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+
+  while(size--)
+    n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper* s) {
+  return print(reinterpret_cast<const char*>(s));
+}
+
+size_t Print::print(const char* s) {
+  return write(s);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(int n, int base) {
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+  // The target long is 32 bits
+  int32_t value = (int32_t)n;
+
+  if(base == 0)
+    return write((uint8_t)value);
+  if( (base == 10) && (value < 0) )
+    return print('-') + printNumber((uint32_t)(-(int64_t)value), 10);
+  if(base == 10)
+    return printNumber((uint32_t)value, 10);
+  return printNumber((uint32_t)value, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  if(base == 0)
+    return write((uint8_t)n);
+  return printNumber((uint32_t)n, base);
+}
+
+size_t Print::print(double n, int digits) {
+  return printFloat(n, digits);
+}
+
+size_t Print::println(const __FlashStringHelper* s) {
+  return print(s) + println();
+}
+
+size_t Print::println(const char* s) {
+  return print(s) + println();
+}
+
+size_t Print::println(char c) {
+  return print(c) + println();
+}
+
+size_t Print::println(unsigned char n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits) {
+  return print(n, digits) + println();
+}
+
+size_t Print::println(void) {
+  return write("\r\n");
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char* str = &buf[sizeof(buf) - 1];
+
+  *str = '\0';
+  if(base < 2)
+    base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while(n);
+  return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+  size_t n = 0;
+  double rounding = 0.5;
+  unsigned long intPart;
+  double remainder;
+  uint8_t j;
+
+  if(isnan(number))
+    return print("nan");
+  if(isinf(number))
+    return print("inf");
+  if(number > 4294967040.0)
+    return print("ovf");
+  if(number < -4294967040.0)
+    return print("ovf");
+
+  if(number < 0.0) {
+    n += print('-');
+    number = -number;
+  }
+  for(j = 0; j < digits; j++)
+    rounding /= 10.0;
+  number += rounding;
+
+  intPart = (unsigned long)number;
+  remainder = number - (double)intPart;
+  n += print(intPart);
+  if(digits > 0)
+    n += print('.');
+  while(digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)remainder;
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+// ==============================================
+// Processes
+// ==============================================
+
+void* simShared(size_t size) {
+  void* area = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+  if(area == MAP_FAILED) {
+    perror("mmap");
+    exit(2);
+  }
+  return area;
+}
+
+int simSpawn(int (*fn)(void*), void* arg) {
+  int status;
+  pid_t pid;
+
+  fflush(stdout);
+  pid = fork();
+  if(pid < 0) {
+    perror("fork");
+    return -1;
+  }
+  if(pid == 0) {
+    status = fn(arg);
+    fflush(stdout);
+    _exit(status);
+  }
+  if(waitpid(pid, &status, 0) < 0)
+    return -1;
+  if(WIFEXITED(status))
+    return WEXITSTATUS(status);
+  return 128 + WTERMSIG(status);
+}
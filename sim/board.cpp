@@ -0,0 +1,61 @@
+/**
+ *  \file board.cpp
+ *  \brief Simulated board running a firmware variant
+ *
+ *  Built with every firmware variant (see CMakeLists.txt), connects the
+ *  dispensers to the pins and the half bridges of its channel table.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "channels.h"
+
+void setup(void);
+void loop(void);
+
+unsigned long simLoopCost = SIM_LOOP_COST;
+unsigned long long simLoopMax = 0;
+
+void simBoot(void) {
+  int ch;
+
+  for(ch = 0; ch < SPOOL_CHANNELS; ch++) {
+    world.connect(ch, channelTable[ch].dout, channelTable[ch].clk,
+                  channelTable[ch].feedHB, channelTable[ch].loadHB);
+  }
+  simHeapTrace = true;
+  setup();
+  simHeapTrace = false;
+}
+
+void simRun(unsigned long ms) {
+  unsigned long long end = simNow + (unsigned long long)ms * 1000;
+  unsigned long long start;
+
+  simLoopMax = 0;
+  while(simNow < end) {
+    start = simNow;
+    simHeapTrace = true;
+    loop();
+    simHeapTrace = false;
+    simAdvance(simLoopCost);
+    if(simNow - start > simLoopMax)
+      simLoopMax = simNow - start;
+  }
+}
+
+std::string simCommand(const char* line, unsigned long ms) {
+  std::string command(line);
+
+  simOutput.clear();
+  command += "\n";
+  simSerialInput(command.c_str());
+  simRun(ms);
+  return simOutput;
+}
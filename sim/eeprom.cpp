@@ -0,0 +1,93 @@
+/**
+ *  \file eeprom.cpp
+ *  \brief Simulated EEPROM emulation of the XMC1100 flash
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+/**
+ * Memory and counters, shared with the child processes
+ */
+struct simFlash {
+  uint8_t bytes[SIM_EEPROM_SIZE];
+  unsigned long writes;
+  unsigned long reads;
+  unsigned long cellWrites[SIM_EEPROM_SIZE];
+};
+
+//! Allocated at the first access, before any fork
+static simFlash* flash = NULL;
+
+static simFlash* flashArea(void) {
+  if(flash == NULL) {
+    flash = (simFlash*)simShared(sizeof(simFlash));
+    memset(flash->bytes, 0xFF, SIM_EEPROM_SIZE);
+  }
+  return flash;
+}
+
+//! The flash exists from the program start
+static struct simFlashInit {
+  simFlashInit() { flashArea(); }
+} flashInit;
+
+uint8_t EEPROMClass::read(int address) {
+  simAdvance(SIM_FLASH_READ_COST);
+  flashArea()->reads++;
+  if( (address < 0) || (address >= SIM_EEPROM_SIZE) )
+    return 0xFF;
+  return flashArea()->bytes[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  simAdvance(SIM_FLASH_WRITE_COST);
+  if( (address < 0) || (address >= SIM_EEPROM_SIZE) )
+    return;
+  flashArea()->writes++;
+  flashArea()->cellWrites[address]++;
+  flashArea()->bytes[address] = value;
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+  if(read(address) != value)
+    write(address, value);
+}
+
+uint16_t EEPROMClass::length(void) {
+  return SIM_EEPROM_SIZE;
+}
+
+void EEPROMClass::erase(void) {
+  memset(flashArea()->bytes, 0xFF, SIM_EEPROM_SIZE);
+  flashArea()->writes = 0;
+  flashArea()->reads = 0;
+  memset(flashArea()->cellWrites, 0, sizeof(flashArea()->cellWrites));
+}
+
+uint8_t* EEPROMClass::data(void) {
+  return flashArea()->bytes;
+}
+
+unsigned long EEPROMClass::writes(void) {
+  return flashArea()->writes;
+}
+
+unsigned long EEPROMClass::writes(int address) {
+  if( (address < 0) || (address >= SIM_EEPROM_SIZE) )
+    return 0;
+  return flashArea()->cellWrites[address];
+}
+
+unsigned long EEPROMClass::reads(void) {
+  return flashArea()->reads;
+}
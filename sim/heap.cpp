@@ -0,0 +1,60 @@
+/**
+ *  \file heap.cpp
+ *  \brief Heap use of the firmware on the simulated board
+ *
+ *  The C library allocator is replaced by one counting the calls made
+ *  while the firmware runs (setup(), loop() and the interrupt service
+ *  routines). operator new and the standard containers allocate with
+ *  malloc(), so they are counted too. The simulated devices suspend the
+ *  count while they run (SimDeviceHeap).
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <stdlib.h>
+#include "sim.h"
+
+bool simHeapTrace = false;
+unsigned long simHeapAllocs = 0;
+unsigned long simHeapFrees = 0;
+unsigned long long simHeapBytes = 0;
+
+// The allocator of the C library (glibc)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* area, size_t size);
+extern "C" void __libc_free(void* area);
+
+//! Count an allocation of the firmware
+static inline void heapAlloc(size_t size) {
+  if(simHeapTrace) {
+    simHeapAllocs++;
+    simHeapBytes += size;
+  }
+}
+
+extern "C" void* malloc(size_t size) {
+  heapAlloc(size);
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  heapAlloc(count * size);
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* area, size_t size) {
+  heapAlloc(size);
+  return __libc_realloc(area, size);
+}
+
+extern "C" void free(void* area) {
+  if(simHeapTrace && (area != NULL))
+    simHeapFrees++;
+  __libc_free(area);
+}
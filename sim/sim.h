@@ -0,0 +1,163 @@
+/**
+ *  \file sim.h
+ *  \brief Simulated board for the host build
+ *
+ *  The firmware runs unmodified on a virtual clock. The simulated
+ *  devices (Arduino.h serial port and pins, TLE94112.h register model,
+ *  EEPROM.h emulated flash and the dispensers of world.h) advance with
+ *  the clock: every core call, SPI frame and flash write costs the time
+ *  it takes on the XMC1100, and the HX711 data ready interrupts are
+ *  served when the conversions complete. Nothing depends on the host
+ *  speed, so the tests and the benchmarks are repeatable.\n
+ *  The standard headers must be included before this file, as the
+ *  Arduino min() and max() macros conflict with them.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SIM
+#define _SIM
+
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "world.h"
+
+// Cost in us of the core calls on the XMC1100 at 32 MHz
+#define SIM_CLOCK_COST 1      ///< millis(), micros()
+#define SIM_PIN_COST 1        ///< digitalRead(), digitalWrite()
+#define SIM_SPI_COST 20       ///< 16 bits SPI frame to the TLE94112 at 1 MHz
+#define SIM_FLASH_READ_COST 1 ///< Emulated EEPROM byte read
+#define SIM_FLASH_WRITE_COST 100  ///< Emulated EEPROM byte write
+//! Default cost in us of a loop() pass with no task released
+#define SIM_LOOP_COST 20
+
+//! Size of the serial buffers of the core
+#define SIM_SERIAL_BUFFER 64
+
+// ==============================================
+// Clock
+// ==============================================
+
+//! Virtual time in us since the power on
+extern unsigned long long simNow;
+
+/**
+ * Advance the virtual clock, the simulated devices run in the meantime
+ * and the interrupts are served
+ *
+ * \param us the time to advance
+ */
+void simAdvance(unsigned long long us);
+
+// ==============================================
+// Firmware runner (board.cpp, built with every firmware variant)
+// ==============================================
+
+//! us charged to every loop() pass, SIM_LOOP_COST by default. The long
+//! runs can use a coarser step
+extern unsigned long simLoopCost;
+
+//! Max duration in us of a loop() pass since the last simRun()
+extern unsigned long long simLoopMax;
+
+/**
+ * Connect the simulated dispensers to the channel pins and half bridges
+ * of the firmware, then run setup()
+ */
+void simBoot(void);
+
+/**
+ * Run loop() for a time
+ *
+ * \param ms the virtual time to run
+ */
+void simRun(unsigned long ms);
+
+/**
+ * Send a command line and run loop() for a time
+ *
+ * \param line the command, without line end
+ * \param ms the virtual time to run after the line has been sent
+ * \return the serial output in the meantime
+ */
+std::string simCommand(const char* line, unsigned long ms = 100);
+
+// ==============================================
+// Serial port
+// ==============================================
+
+/**
+ * Send characters to the board, they arrive at the baud rate after the
+ * characters already sent
+ *
+ * \param text the characters
+ */
+void simSerialInput(const char* text);
+
+//! Serial output of the board since the last clear
+extern std::string simOutput;
+//! Echo the serial output on stdout (environment SIM_VERBOSE)
+extern bool simEcho;
+//! Serial bytes sent since the power on
+extern unsigned long long simSerialBytes;
+//! us the firmware waited for the serial buffer
+extern unsigned long long simSerialBlocked;
+//! Characters lost as the receive buffer was full
+extern unsigned long simSerialOverruns;
+//! Called with every byte written by the firmware and the time
+extern void (*simSerialTap)(uint8_t c, unsigned long long us);
+
+// ==============================================
+// Heap (heap.cpp)
+// ==============================================
+
+//! The firmware is running: set by the runner around setup() and loop()
+extern bool simHeapTrace;
+//! Allocations of the firmware since the power on
+extern unsigned long simHeapAllocs;
+//! Releases of the firmware since the power on
+extern unsigned long simHeapFrees;
+//! Bytes allocated by the firmware since the power on
+extern unsigned long long simHeapBytes;
+
+/**
+ * Heap use of a simulated device, called by the firmware: the count is
+ * suspended while the object exists
+ */
+struct SimDeviceHeap {
+  bool saved;
+
+  SimDeviceHeap() : saved(simHeapTrace) { simHeapTrace = false; }
+  ~SimDeviceHeap() { simHeapTrace = saved; }
+};
+
+// ==============================================
+// Processes
+// ==============================================
+
+/**
+ * Memory shared with the processes started by simSpawn(), allocated
+ * before the fork
+ *
+ * \param size bytes, zero filled
+ */
+void* simShared(size_t size);
+
+/**
+ * Run a function in a new process, started from the state of the
+ * caller. Every scenario runs on a fresh board this way; the emulated
+ * flash is shared, so a process can boot with the flash written by the
+ * previous one
+ *
+ * \param fn the function, returns the exit status of the process
+ * \param arg its argument
+ * \return the exit status of the process
+ */
+int simSpawn(int (*fn)(void*), void* arg);
+
+#endif
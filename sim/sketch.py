@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+ \\file sketch.py
+ \\brief Prepare a firmware variant for the host build
+
+ Copies the firmware sources changing the configuration flags, e.g.
+ --define _FIXED_POINT turns "#undef _FIXED_POINT" into
+ "#define _FIXED_POINT" and --set SPOOL_CHANNELS=2 changes the value of
+ "#define SPOOL_CHANNELS" ("{}" in the new value is the previous one), then converts the sketch to C++ as the Arduino
+ IDE does: the prototypes of the functions are inserted before the first
+ function. Only the changed files are written, so make rebuilds only
+ what depends on them.
+
+ \\author Enrico Miglino <balearicdynamics@gmail.com> \\n
+ Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ \\date July 2017
+ \\version 1.0 Release Candidate
+ Licensed under GNU LGPL 3.0
+"""
+
+import argparse
+import glob
+import os
+import re
+import sys
+
+
+def write_if_changed(path, text):
+    """Write a file only if its content is different"""
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def apply_flags(sources, defines, undefines, values):
+    """Change the flag lines, every flag must be found in a file"""
+    found = set()
+    for name, text in sources.items():
+        lines = text.split("\n")
+        for j, line in enumerate(lines):
+            m = re.match(r"^#(define|undef)\s+(\w+)\b(.*)$", line)
+            if m is None:
+                continue
+            flag = m.group(2)
+            if flag in defines and m.group(1) == "undef":
+                lines[j] = "#define " + flag + m.group(3)
+                found.add(flag)
+            elif flag in undefines and m.group(1) == "define":
+                comment = re.search(r"\s*//.*$", m.group(3))
+                lines[j] = "#undef " + flag + (comment.group(0) if comment else "")
+                found.add(flag)
+            elif flag in values and m.group(1) == "define":
+                comment = re.search(r"\s*(//.*)?$", m.group(3))
+                previous = m.group(3)[:comment.start()].strip()
+                value = values[flag].replace("{}", previous)
+                lines[j] = "#define " + flag + " " + value + comment.group(0)
+                found.add(flag)
+        sources[name] = "\n".join(lines)
+    missing = (set(defines) | set(undefines) | set(values)) - found
+    if missing:
+        sys.exit("sketch.py: flags not found: " + " ".join(sorted(missing)))
+
+
+def strip_code(text):
+    """Replace the comments, strings and characters with spaces, keeping
+    the line ends, so the braces can be counted"""
+    out = []
+    j = 0
+    n = len(text)
+    while j < n:
+        c = text[j]
+        if text.startswith("//", j):
+            while j < n and text[j] != "\n":
+                out.append(" ")
+                j += 1
+        elif text.startswith("/*", j):
+            end = text.find("*/", j + 2)
+            end = n if end < 0 else end + 2
+            out.append(re.sub(r"[^\n]", " ", text[j:end]))
+            j = end
+        elif c in "\"'":
+            k = j + 1
+            while k < n and text[k] != c:
+                k += 2 if text[k] == "\\" else 1
+            out.append(" " * (k + 1 - j))
+            j = k + 1
+        else:
+            out.append(c)
+            j += 1
+    return "".join(out)
+
+
+def prototypes(text):
+    """Return the prototypes of the functions defined in the sketch with
+    the preprocessor conditions they are defined in, and the line of the
+    first function"""
+    code = strip_code(text)
+    lines = code.split("\n")
+    found = []
+    first = None
+    depth = 0
+    conditions = []
+    statement = ""
+    start = None
+    for number, line in enumerate(lines, 1):
+        if depth == 0 and line.lstrip().startswith("#"):
+            directive = line.strip()
+            if re.match(r"#\s*if", directive):
+                conditions.append([directive, False])
+            elif re.match(r"#\s*(else|elif)", directive) and conditions:
+                conditions[-1][1] = True
+            elif re.match(r"#\s*endif", directive) and conditions:
+                conditions.pop()
+            continue
+        for c in line:
+            if depth == 0:
+                if c == "{":
+                    signature = " ".join(statement.split())
+                    m = re.match(r"^[\w\s\*&:<>,]+\([^;=]*\)$", signature)
+                    if m and not re.match(r"^(struct|class|enum|union|namespace)\b", signature):
+                        found.append((signature, [list(x) for x in conditions]))
+                        if first is None:
+                            first = start
+                    statement = ""
+                    depth += 1
+                    continue
+                if c in ";}":
+                    statement = ""
+                    continue
+                if not statement.strip() and not c.isspace():
+                    start = number
+                statement += c
+            else:
+                if c == "{":
+                    depth += 1
+                elif c == "}":
+                    depth -= 1
+                    if depth == 0:
+                        statement = ""
+        if depth == 0:
+            statement += " "
+    return found, first
+
+
+def convert_sketch(path):
+    """The sketch as a C++ file with the prototypes"""
+    with open(path) as f:
+        text = f.read()
+    found, first = prototypes(text)
+    lines = text.split("\n")
+    decl = ["// Prototypes generated by sketch.py"]
+    for signature, conditions in found:
+        for directive, inElse in conditions:
+            decl.append(directive)
+            if inElse:
+                decl.append("#else")
+        decl.append(signature + ";")
+        decl.extend(["#endif"] * len(conditions))
+    head = lines[:first - 1]
+    tail = lines[first - 1:]
+    return "\n".join(['#line 1 "%s"' % path] + head + decl +
+                     ['#line %d "%s"' % (first, path)] + tail)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Prepare a firmware variant for the host build")
+    parser.add_argument("--source", required=True, help="firmware directory")
+    parser.add_argument("--sketch", required=True, help="sketch file (.ino)")
+    parser.add_argument("--output", required=True, help="variant directory")
+    parser.add_argument("--define", action="append", default=[], help="flag to define")
+    parser.add_argument("--undefine", action="append", default=[], help="flag to undefine")
+    parser.add_argument("--set", action="append", default=[], help="NAME=VALUE of a define")
+    args = parser.parse_args()
+
+    values = dict(item.split("=", 1) for item in args.set)
+    sources = {}
+    for path in sorted(glob.glob(os.path.join(args.source, "*.h")) +
+                       glob.glob(os.path.join(args.source, "*.cpp"))):
+        with open(path) as f:
+            sources[os.path.basename(path)] = f.read()
+    apply_flags(sources, args.define, args.undefine, values)
+
+    os.makedirs(args.output, exist_ok=True)
+    for name, text in sources.items():
+        write_if_changed(os.path.join(args.output, name), text)
+
+    # The sketch reads the copied headers
+    sketch = convert_sketch(os.path.abspath(args.sketch))
+    write_if_changed(os.path.join(args.output, "sketch.cpp"), sketch)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,181 @@
+/**
+ *  \file tle94112.cpp
+ *  \brief Simulated Infineon TLE94112 half bridges driver
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "TLE94112.h"
+
+Tle94112 tle94112;
+
+//! Switches field of a half bridge in the HB_ACT registers
+#define ACT_LS 0x01
+#define ACT_HS 0x02
+
+//! Faults switching off all the half bridges
+#define TLE_OUTPUTS_OFF (TLE_TEMP_SHUTDOWN | TLE_UNDER_VOLTAGE | TLE_OVER_VOLTAGE)
+
+Tle94112::Tle94112() {
+  log = NULL;
+  latched = held = 0;
+  holdUntil = 0;
+  memset(reg, 0, sizeof(reg));
+  clearCounters();
+}
+
+void Tle94112::reset(void) {
+  int j;
+
+  world.integrate(simNow);
+  for(j = 0; j < TLE_REGISTERS; j++)
+    reg[j] = 0;
+}
+
+void Tle94112::clearCounters(void) {
+  int j;
+
+  for(j = 0; j < TLE_REGISTERS; j++)
+    writes[j] = reads[j] = 0;
+  frames = 0;
+  calls = 0;
+  logged = 0;
+}
+
+void Tle94112::update(int r, uint8_t mask, uint8_t value) {
+  // Read, then write the modified register
+  frames += 2;
+  reads[r]++;
+  simAdvance(2 * SIM_SPI_COST);
+
+  // The outputs change at the end of the write frame
+  world.integrate(simNow);
+  reg[r] = (reg[r] & ~mask) | (value & mask);
+  writes[r]++;
+  if( (log != NULL) && (logged < TLE_LOG_SIZE) ) {
+    log[logged].time = simNow;
+    log[logged].reg = r;
+    log[logged].value = reg[r];
+    logged++;
+  }
+}
+
+uint8_t Tle94112::read(int r) {
+  frames++;
+  reads[r]++;
+  simAdvance(SIM_SPI_COST);
+  return reg[r];
+}
+
+void Tle94112::begin(void) {
+  int j;
+
+  calls++;
+  // The control registers are written with their reset values
+  for(j = TLE_REG_HB_ACT_1; j <= TLE_REG_FW_CTRL; j++)
+    update(j, 0xFF, 0);
+  clearErrors();
+}
+
+void Tle94112::end(void) {
+  calls++;
+  reset();
+}
+
+void Tle94112::configHB(HalfBridge hb, HBState state, PWMChannel pwm) {
+  configHB(hb, state, pwm, 0);
+}
+
+void Tle94112::configHB(HalfBridge hb, HBState state, PWMChannel pwm, uint8_t activeFW) {
+  int index = (hb - 1) / 4;
+  int shift = ((hb - 1) % 4) * 2;
+  uint8_t act = (state == TLE_HIGH) ? ACT_HS : ((state == TLE_LOW) ? ACT_LS : 0);
+
+  if( (hb < TLE_HB1) || (hb > TLE_HB12) )
+    return;
+  calls++;
+  update(TLE_REG_HB_ACT_1 + index, 0x03 << shift, act << shift);
+  update(TLE_REG_HB_MODE_1 + index, 0x03 << shift, pwm << shift);
+  update(TLE_REG_FW_CTRL, 1 << ((hb - 1) % 8), activeFW ? (1 << ((hb - 1) % 8)) : 0);
+}
+
+void Tle94112::configPWM(PWMChannel pwm, PWMFreq freq, uint8_t dutyCycle) {
+  int shift = (pwm - 1) * 2;
+  // Two bits for every channel, the 2 kHz frequency is not modelled
+  uint8_t code = (freq == TLE_FREQ2KHZ) ? TLE_FREQ200HZ : freq;
+
+  if( (pwm < TLE_PWM1) || (pwm > TLE_PWM3) )
+    return;
+  calls++;
+  update(TLE_REG_PWM_FREQ, 0x03 << shift, code << shift);
+  update(TLE_REG_PWM1_DC + pwm - 1, 0xFF, dutyCycle);
+}
+
+uint8_t Tle94112::getSysDiagnosis(void) {
+  calls++;
+  reg[TLE_REG_SYS_DIAG] = latched | ((simNow < holdUntil) ? held : 0);
+  return read(TLE_REG_SYS_DIAG);
+}
+
+uint8_t Tle94112::getSysDiagnosis(uint8_t mask) {
+  return getSysDiagnosis() & mask;
+}
+
+void Tle94112::clearErrors(void) {
+  calls++;
+  // The library clears the system diagnosis and all the error registers
+  frames += TLE_ERROR_REGISTERS;
+  writes[TLE_REG_SYS_DIAG]++;
+  writes[TLE_REG_OP_ERROR] += TLE_ERROR_REGISTERS - 1;
+  simAdvance(TLE_ERROR_REGISTERS * SIM_SPI_COST);
+  world.integrate(simNow);
+  latched = 0;
+  reg[TLE_REG_OP_ERROR] = 0;
+  reg[TLE_REG_SYS_DIAG] = (simNow < holdUntil) ? held : 0;
+}
+
+void Tle94112::inject(uint8_t flags, unsigned long long holdUs) {
+  world.integrate(simNow);
+  latched |= flags;
+  if(holdUs != 0) {
+    held = flags;
+    holdUntil = simNow + holdUs;
+  }
+  if(flags & TLE_POWER_ON_RESET)
+    reset();
+}
+
+int Tle94112::bridgeState(int hb) {
+  uint8_t faults = latched | ((simNow < holdUntil) ? held : 0);
+  int act;
+
+  if( (hb < TLE_HB1) || (hb > TLE_HB12) || (faults & TLE_OUTPUTS_OFF) )
+    return TLE_FLOATING;
+  act = (reg[TLE_REG_HB_ACT_1 + (hb - 1) / 4] >> (((hb - 1) % 4) * 2)) & 0x03;
+  if(act == ACT_HS)
+    return TLE_HIGH;
+  if(act == ACT_LS)
+    return TLE_LOW;
+  // Both switches closed are a short circuit, the driver opens them
+  return TLE_FLOATING;
+}
+
+int Tle94112::bridgePwm(int hb) {
+  if( (hb < TLE_HB1) || (hb > TLE_HB12) )
+    return TLE_NOPWM;
+  return (reg[TLE_REG_HB_MODE_1 + (hb - 1) / 4] >> (((hb - 1) % 4) * 2)) & 0x03;
+}
+
+int Tle94112::pwmDuty(int pwm) {
+  if( (pwm < TLE_PWM1) || (pwm > TLE_PWM3) )
+    return 0;
+  if(((reg[TLE_REG_PWM_FREQ] >> ((pwm - 1) * 2)) & 0x03) == 0)
+    return 0;
+  return reg[TLE_REG_PWM1_DC + pwm - 1];
+}
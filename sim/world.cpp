@@ -0,0 +1,323 @@
+/**
+ *  \file world.cpp
+ *  \brief Simulated dispensers: HX711 load cell amplifier, spool mass,
+ *  DC motor, filament path and extruder
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "TLE94112.h"
+
+SimWorld world;
+
+//! HX711 clock pulses of a read: 24 data bits and the gain selection
+#define HX711_PULSES 25
+
+SimWorld::SimWorld() {
+  int ch;
+
+  channels = 0;
+  integrated = 0;
+  for(ch = 0; ch < SIM_CHANNELS; ch++) {
+    SimHX711& adc = hx711[ch];
+    SimDispenser& d = spool[ch];
+
+    memset(&adc, 0, sizeof(adc));
+    adc.dout = adc.clk = -1;
+    adc.sps = SIM_HX711_SPS;
+    adc.calibration = SIM_HX711_CALIBRATION;
+    adc.offset = SIM_HX711_OFFSET;
+    adc.noise = SIM_HX711_NOISE;
+    adc.bit = -1;
+    adc.next = SIM_NEVER;
+    adc.rng = 0x9E3779B9u * (ch + 1);
+
+    memset(&d, 0, sizeof(d));
+    d.holder = SIM_HOLDER;
+    d.spoolTare = SIM_SPOOL_TARE;
+    d.gr1cm = SIM_GR1CM;
+    d.vmax = SIM_MOTOR_VMAX;
+    d.deadzone = SIM_MOTOR_DEADZONE;
+    d.stiffness = SIM_STIFFNESS;
+    d.maxTension = SIM_MAX_TENSION;
+    d.pullLevel = 100;
+  }
+}
+
+void SimWorld::connect(int ch, int dout, int clk, int feedHB, int loadHB) {
+  SimHX711& adc = hx711[ch];
+
+  adc.dout = dout;
+  adc.clk = clk;
+  // The converters are not synchronised
+  adc.next = simNow + (unsigned long long)(1e6 / adc.sps) + ch * 1700;
+  spool[ch].feedHB = feedHB;
+  spool[ch].loadHB = loadHB;
+  if(ch >= channels)
+    channels = ch + 1;
+}
+
+void SimWorld::mount(int ch, double filament) {
+  integrate(simNow);
+  spool[ch].mounted = true;
+  spool[ch].filament = filament;
+}
+
+void SimWorld::unmount(int ch) {
+  integrate(simNow);
+  spool[ch].mounted = false;
+}
+
+void SimWorld::setRate(int ch, double rate) {
+  integrate(simNow);
+  spool[ch].rate = rate;
+}
+
+double SimWorld::weight(int ch) {
+  const SimDispenser& d = spool[ch];
+  double w = d.extra;
+
+  if(d.mounted)
+    w += d.holder + d.spoolTare + d.filament - d.tension;
+  return w;
+}
+
+void SimWorld::clearStats(int ch) {
+  SimDispenser& d = spool[ch];
+
+  integrate(simNow);
+  d.fed = d.consumed = d.dragged = 0;
+  d.maxSlack = d.slack;
+  d.tensionSum = d.tension2Sum = d.time = 0;
+  d.maxTensionSeen = d.tension;
+  d.pulls = 0;
+  d.pullTime = 0;
+  hx711[ch].conversions = hx711[ch].reads = hx711[ch].lost = 0;
+  hx711[ch].latencySum = hx711[ch].latencyMax = 0;
+}
+
+/**
+ * Voltage applied by a half bridge, as a fraction of the supply
+ *
+ * \param hb the half bridge
+ * \param floating set if the half bridge is floating
+ */
+static double bridgeLevel(int hb, bool &floating) {
+  int state = tle94112.bridgeState(hb);
+  int pwm = tle94112.bridgePwm(hb);
+
+  if(state == Tle94112::TLE_FLOATING) {
+    floating = true;
+    return 0;
+  }
+  if(state == Tle94112::TLE_LOW)
+    return 0;
+  if(pwm != Tle94112::TLE_NOPWM)
+    return tle94112.pwmDuty(pwm) / 255.0;
+  return 1;
+}
+
+void SimWorld::step(int ch, double dt) {
+  SimDispenser& d = spool[ch];
+  bool floating = false;
+  double u, target, tau, free, pull;
+
+  // Motor speed
+  u = bridgeLevel(d.feedHB, floating) - bridgeLevel(d.loadHB, floating);
+  if(floating) {
+    target = 0;
+    tau = SIM_MOTOR_TAU_COAST;
+  }
+  else if(fabs(u) <= d.deadzone) {
+    target = 0;
+    tau = (u == 0) ? SIM_MOTOR_TAU_BRAKE : SIM_MOTOR_TAU;
+  }
+  else {
+    target = d.vmax * (fabs(u) - d.deadzone) / (1 - d.deadzone);
+    if(u < 0)
+      target = -target;
+    tau = SIM_MOTOR_TAU;
+  }
+  d.speed += (target - d.speed) * (1 - exp(-dt / tau));
+
+  // Filament released by the motor, then consumed by the extruder
+  d.fed += d.speed * dt;
+  d.slack += d.speed * dt;
+  d.consumed += d.rate * dt;
+  d.slack -= d.rate * dt;
+  d.filament -= d.speed * dt * d.gr1cm;
+
+  // The stretched filament pulls the spool, over the max tension the
+  // extruder unwinds it
+  free = -d.maxTension / d.stiffness;
+  if(d.slack < free) {
+    pull = free - d.slack;
+    d.dragged += pull;
+    d.filament -= pull * d.gr1cm;
+    d.slack = free;
+  }
+  d.tension = (d.slack < 0) ? -d.slack * d.stiffness : 0;
+  if(d.filament < 0)
+    d.filament = 0;
+
+  // Statistics
+  if(d.slack > d.maxSlack)
+    d.maxSlack = d.slack;
+  if(d.tension > d.maxTensionSeen)
+    d.maxTensionSeen = d.tension;
+  if(!d.pulling && (d.tension >= d.pullLevel)) {
+    d.pulling = true;
+    d.pulls++;
+  }
+  else if(d.pulling && (d.tension < d.pullLevel / 2)) {
+    d.pulling = false;
+  }
+  if(d.pulling)
+    d.pullTime += dt;
+  d.tensionSum += d.tension * dt;
+  d.tension2Sum += d.tension * d.tension * dt;
+  d.time += dt;
+}
+
+void SimWorld::integrate(unsigned long long now) {
+  unsigned long long dt;
+  int ch;
+
+  while(integrated < now) {
+    dt = now - integrated;
+    if(dt > SIM_STEP)
+      dt = SIM_STEP;
+    for(ch = 0; ch < channels; ch++)
+      step(ch, dt / 1e6);
+    integrated += dt;
+  }
+  if(integrated > now)
+    integrated = now;
+}
+
+double SimWorld::gauss(uint32_t &state) {
+  double u, v;
+
+  // xorshift32, the same sequence at every run
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  u = (state + 1.0) / 4294967297.0;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  v = (state + 1.0) / 4294967297.0;
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+void SimWorld::convert(int ch, unsigned long long now) {
+  SimHX711& adc = hx711[ch];
+  double grams, counts;
+  long raw = 0;
+
+  // The replayed conversions do not sample the model
+  if(adc.replay != NULL)
+    raw = adc.replay(ch, adc.next);
+  else {
+    integrate(now);
+    adc.next += (unsigned long long)(1e6 / adc.sps);
+  }
+  adc.conversions++;
+
+  // The output register is not updated while shifting
+  if(adc.bit >= 0) {
+    adc.lost++;
+    return;
+  }
+  if(adc.ready)
+    adc.lost++;
+
+  if(adc.replay == NULL) {
+    grams = weight(ch) + adc.drift + adc.driftRate * now / 3.6e9;
+    grams += adc.noise * gauss(adc.rng);
+    counts = adc.offset - adc.calibration * (grams + adc.nonlinearity * grams * grams);
+    raw = (long)floor(counts + 0.5);
+  }
+  adc.value = raw & 0xFFFFFF;
+  adc.readyAt = now;
+  if(!adc.ready) {
+    adc.ready = true;
+    simPinFalling(adc.dout);
+  }
+}
+
+unsigned long long SimWorld::nextEvent(void) {
+  unsigned long long next = SIM_NEVER;
+  int ch;
+
+  for(ch = 0; ch < channels; ch++) {
+    if(hx711[ch].next < next)
+      next = hx711[ch].next;
+  }
+  return next;
+}
+
+void SimWorld::event(unsigned long long now) {
+  int ch;
+
+  for(ch = 0; ch < channels; ch++) {
+    if(hx711[ch].next <= now)
+      convert(ch, hx711[ch].next);
+  }
+}
+
+int SimWorld::pinRead(int pin) {
+  int ch;
+
+  for(ch = 0; ch < channels; ch++) {
+    SimHX711& adc = hx711[ch];
+    if(adc.dout != pin)
+      continue;
+    if(adc.bit < 0)
+      return adc.ready ? LOW : HIGH;
+    // Data bit shifted out by the last rising edge of the clock
+    if( (adc.bit >= 1) && (adc.bit <= 24) )
+      return (adc.value >> (24 - adc.bit)) & 1;
+    return HIGH;
+  }
+  return LOW;
+}
+
+void SimWorld::pinWrite(int pin, int level) {
+  int ch, before, after;
+
+  for(ch = 0; ch < channels; ch++) {
+    SimHX711& adc = hx711[ch];
+    if( (adc.clk != pin) || (adc.clock == (level == HIGH)) )
+      continue;
+    adc.clock = (level == HIGH);
+    if(!adc.clock || !adc.ready)
+      continue;
+
+    // Rising edge: the next bit is shifted out
+    before = pinRead(adc.dout);
+    if(adc.bit < 0) {
+      adc.bit = 0;
+      unsigned long long latency = simNow - adc.readyAt;
+      adc.latencySum += latency;
+      if(latency > adc.latencyMax)
+        adc.latencyMax = latency;
+    }
+    adc.bit++;
+    if(adc.bit >= HX711_PULSES) {
+      // DOUT high until the next conversion
+      adc.bit = -1;
+      adc.ready = false;
+      adc.reads++;
+    }
+    after = pinRead(adc.dout);
+    if( (before == HIGH) && (after == LOW) )
+      simPinFalling(adc.dout);
+  }
+}
@@ -0,0 +1,227 @@
+/**
+ *  \file world.h
+ *  \brief Simulated dispensers: HX711 load cell amplifier, spool mass,
+ *  DC motor, filament path and extruder
+ *
+ *  Every spool channel of the board is connected to a dispenser:
+ *  - the HX711 converts the weight on the scale at its data rate and
+ *    shifts the result out MSB first on the clock pulses, DOUT falls when
+ *    a conversion is ready;
+ *  - the scale holds the motor group, the empty spool and the filament
+ *    wound on it. The extruder pull reduces the weight by the filament
+ *    tension;
+ *  - the motor follows the voltage applied by the two half bridges of
+ *    the channel (TLE94112.h) with a first order response and a dead zone;
+ *  - the filament between the spool and the extruder is fed by the motor
+ *    and consumed by the extruder at a programmable rate. Without slack
+ *    the filament is stretched and the tension grows until the extruder
+ *    drags the spool.
+ *
+ *  The model is integrated only when its inputs change or its output is
+ *  sampled, in steps of SIM_STEP us at most. An HX711 can also replay
+ *  recorded conversions in place of the model (SimHX711::replay).
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SIM_WORLD
+#define _SIM_WORLD
+
+#include <stdint.h>
+
+//! Max dispensers of the world, one for every spool channel of the board
+#define SIM_CHANNELS 6
+//! Max integration step in us
+#define SIM_STEP 1000
+//! No event scheduled
+#define SIM_NEVER 0xFFFFFFFFFFFFFFFFULL
+
+// Defaults, the dispenser used to tune the firmware
+#define SIM_HX711_SPS 80            ///< HX711 data rate (RATE pin high)
+#define SIM_HX711_OFFSET 100000     ///< Raw value with no weight
+#define SIM_HX711_CALIBRATION 434.5 ///< Counts for one gram
+#define SIM_HX711_NOISE 0.3         ///< Noise standard deviation in grams
+#define SIM_HOLDER 158.5            ///< Motor group on the scale (gr)
+#define SIM_SPOOL_TARE 225.0        ///< Empty 1 Kg spool (gr)
+#define SIM_SPOOL_NET 1000.0        ///< Filament wound on a new spool (gr)
+#define SIM_GR1CM 0.02982           ///< PLA 1.75 mm, gr for 1 cm
+#define SIM_MOTOR_VMAX 5.0          ///< Filament speed at full voltage (cm/s)
+#define SIM_MOTOR_DEADZONE 0.188    ///< Voltage fraction starting the motor (48 / 255)
+#define SIM_MOTOR_TAU 0.08          ///< Driven speed time constant (s)
+#define SIM_MOTOR_TAU_BRAKE 0.02    ///< Braked speed time constant (s)
+#define SIM_MOTOR_TAU_COAST 0.3     ///< Floating speed time constant (s)
+#define SIM_STIFFNESS 50.0          ///< Tension of the stretched filament (gr / cm)
+#define SIM_MAX_TENSION 300.0       ///< Tension dragging the spool (gr)
+
+/**
+ * HX711 load cell amplifier
+ */
+struct SimHX711 {
+  int dout;                 ///< Data pin, -1 if not connected
+  int clk;                  ///< Clock pin
+  double sps;               ///< Conversions per second
+  double calibration;       ///< Counts for one gram
+  double nonlinearity;      ///< Quadratic error of the cell (1 / gram)
+  long offset;              ///< Raw value with no weight
+  double noise;             ///< Noise standard deviation (gr)
+  double drift;             ///< Zero drift (gr)
+  double driftRate;         ///< Zero drift speed (gr / hour)
+
+  unsigned long long next;  ///< Time of the next conversion
+  long value;               ///< Last conversion, 24 bits
+  bool ready;               ///< Conversion ready, DOUT low
+  int bit;                  ///< Bits shifted out, -1 if not shifting
+  bool clock;               ///< Clock pin level
+  unsigned long long readyAt;   ///< Time the last conversion has been ready
+  uint32_t rng;             ///< Noise generator state
+  //! Conversions replayed instead of the model, NULL if none: returns
+  //! the raw value of the conversion due and sets the time of the next
+  //! one, SIM_NEVER after the last
+  long (*replay)(int ch, unsigned long long& next);
+
+  unsigned long conversions;    ///< Conversions since the power on
+  unsigned long reads;          ///< Conversions read
+  unsigned long lost;           ///< Conversions overwritten before the read
+  unsigned long long latencySum;  ///< Sum of the ready to read times (us)
+  unsigned long long latencyMax;  ///< Max ready to read time (us)
+};
+
+/**
+ * Spool, motor, filament and extruder of a channel
+ */
+struct SimDispenser {
+  bool mounted;             ///< Motor group and spool on the scale
+  double holder;            ///< Motor group (gr)
+  double spoolTare;         ///< Empty spool (gr)
+  double filament;          ///< Filament on the spool (gr)
+  double extra;             ///< Other weight on the scale (gr)
+  double gr1cm;             ///< Filament gr for 1 cm
+
+  int feedHB;               ///< Half bridge of the pole high when feeding
+  int loadHB;               ///< Half bridge of the pole high when loading
+  double vmax;              ///< Filament speed at full voltage (cm/s)
+  double deadzone;          ///< Voltage fraction starting the motor
+  double speed;             ///< Filament speed released by the motor (cm/s)
+
+  double rate;              ///< Extruder consumption (cm/s)
+  double stiffness;         ///< Tension of the stretched filament (gr / cm)
+  double maxTension;        ///< Tension dragging the spool (gr)
+  double slack;             ///< Filament between the spool and the extruder (cm), negative if stretched
+  double tension;           ///< Filament tension (gr)
+
+  double fed;               ///< Filament released by the motor (cm)
+  double consumed;          ///< Filament consumed by the extruder (cm)
+  double dragged;           ///< Filament unwound by the extruder pull (cm)
+  double maxSlack;          ///< Max slack (cm)
+  double tensionSum;        ///< Integral of the tension (gr s)
+  double tension2Sum;       ///< Integral of the squared tension (gr^2 s)
+  double time;              ///< Time integrated by the statistics (s)
+  double maxTensionSeen;    ///< Max tension (gr)
+  unsigned long pulls;      ///< Times the tension exceeded pullLevel
+  double pullTime;          ///< Time from pullLevel exceeded to the tension halved (s)
+  double pullLevel;         ///< Tension counted as a pull event (gr)
+  bool pulling;             ///< Tension over pullLevel
+};
+
+/**
+ * The dispensers connected to the board
+ */
+class SimWorld {
+
+  public:
+    SimHX711 hx711[SIM_CHANNELS];
+    SimDispenser spool[SIM_CHANNELS];
+    //! Dispensers connected
+    int channels;
+
+    SimWorld();
+
+    /**
+     * Connect a dispenser to the board
+     *
+     * \param ch the channel
+     * \param dout the HX711 data pin
+     * \param clk the HX711 clock pin
+     * \param feedHB the half bridge of the motor pole high when feeding
+     * \param loadHB the half bridge of the motor pole high when loading
+     */
+    void connect(int ch, int dout, int clk, int feedHB, int loadHB);
+
+    /**
+     * Place the motor group and a full spool on the scale of a channel
+     *
+     * \param ch the channel
+     * \param filament the filament on the spool (gr)
+     */
+    void mount(int ch, double filament = SIM_SPOOL_NET);
+
+    //! Remove everything from the scale of a channel
+    void unmount(int ch);
+
+    /**
+     * Set the extruder consumption
+     *
+     * \param ch the channel
+     * \param rate the filament speed (cm/s), 0 stops the extruder
+     */
+    void setRate(int ch, double rate);
+
+    /**
+     * Weight on the scale
+     *
+     * \param ch the channel
+     * \return grams
+     */
+    double weight(int ch);
+
+    //! Clear the statistics of a channel
+    void clearStats(int ch);
+
+    /**
+     * Advance the model to a time. Called before the inputs of the
+     * model are changed and before its outputs are sampled
+     *
+     * \param now the time in us
+     */
+    void integrate(unsigned long long now);
+
+    //! Time of the next event (HX711 conversion), SIM_NEVER if none
+    unsigned long long nextEvent(void);
+
+    //! Process the events due at the time
+    void event(unsigned long long now);
+
+    //! Level of an input pin
+    int pinRead(int pin);
+
+    //! New level of an output pin
+    void pinWrite(int pin, int level);
+
+  private:
+    //! Time the model has been integrated to
+    unsigned long long integrated;
+
+    //! Gaussian noise
+    double gauss(uint32_t &state);
+
+    //! New conversion of an HX711
+    void convert(int ch, unsigned long long now);
+
+    //! Integrate a channel for a step
+    void step(int ch, double dt);
+};
+
+//! The world of the simulated board
+extern SimWorld world;
+
+/**
+ * Falling edge on a pin, requests the interrupt of the pin if attached
+ * (arduino.cpp)
+ */
+void simPinFalling(int pin);
+
+#endif
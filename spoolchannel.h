@@ -0,0 +1,53 @@
+/**
+ *  \file spoolchannel.h
+ *  \brief Scale and dispenser of a spool channel
+ *  
+ *  The state of every spool channel driven by the board (channels.h):
+ *  the scale, the motor and its regulation. The channels are defined by
+ *  the sketch.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SPOOLCHANNEL
+#define _SPOOLCHANNEL
+
+#include "hal.h"
+#include "filament.h"
+#include "filamentweight.h"
+#include "channels.h"
+#ifdef _USE_MOTOR
+#include "motorcontrol.h"
+#include "tensioncontrol.h"
+#include "feedplan.h"
+#endif
+
+//! Scale and dispenser of a filament spool
+struct spoolChannel {
+  //! The weight control class
+  FilamentWeight scale;
+  //! The load command waits for a new reading
+  boolean loadPending;
+#ifdef _USE_MOTOR
+  MotorControl motor;
+  //! operating mode
+  boolean modeAuto;
+  //! Filament tension regulator for the automatic mode
+  TensionControl regulator;
+  //! New reading not yet used by the regulator
+  boolean newReading;
+  //! Filament demand schedule sent by the host
+  FeedPlan plan;
+#endif
+};
+
+//! The spool channels (see channels.h)
+extern spoolChannel spools[SPOOL_CHANNELS];
+//! Channel of the command being executed
+extern spoolChannel* spool;
+
+#endif
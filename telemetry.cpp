@@ -0,0 +1,77 @@
+/**
+ *  \file telemetry.cpp
+ *  \brief Binary telemetry stream on the serial port
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "telemetry.h"
+
+void Telemetry::begin(Print &p) {
+  port = &p;
+  period = 0;
+  frames = 0;
+  bytes = 0;
+  lastSend = halMillis();
+}
+
+void Telemetry::setPeriod(unsigned long ms) {
+  if( (ms != 0) && (ms < TELEMETRY_MIN_PERIOD) )
+    ms = TELEMETRY_MIN_PERIOD;
+  period = ms;
+  lastSend = halMillis();
+}
+
+boolean Telemetry::due(void) {
+  if(period == 0)
+    return false;
+  if((halMillis() - lastSend) < period)
+    return false;
+
+  lastSend += period;
+  // Do not send a burst of late records
+  if((halMillis() - lastSend) >= period)
+    lastSend = halMillis();
+  return true;
+}
+
+void Telemetry::send(const void* record, int length) {
+  uint8_t data[TELEMETRY_RECORD_MAX + 2];
+  uint8_t frame[TELEMETRY_FRAME_MAX];
+  uint16_t crc;
+  int code, codePos, out, j;
+
+  if(length > TELEMETRY_RECORD_MAX)
+    return;
+
+  memcpy(data, record, length);
+  crc = crc16(data, length);
+  data[length++] = crc & 0xff;
+  data[length++] = crc >> 8;
+
+  // COBS encoding: every 0x00 is replaced by the distance to the next one
+  codePos = 0;
+  out = 1;
+  code = 1;
+  for(j = 0; j < length; j++) {
+    if(data[j] == 0) {
+      frame[codePos] = code;
+      codePos = out++;
+      code = 1;
+    }
+    else {
+      frame[out++] = data[j];
+      code++;
+    }
+  }
+  frame[codePos] = code;
+  frame[out++] = 0;
+
+  port->write(frame, out);
+  frames++;
+  bytes += out;
+}
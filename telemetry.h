@@ -0,0 +1,143 @@
+/**
+ *  \file telemetry.h
+ *  \brief Binary telemetry stream on the serial port
+ *  
+ *  Every record is sent as a frame: the record bytes followed by the
+ *  CRC-16/CCITT (polynomial 0x1021, init 0xFFFF, little endian) of the
+ *  record, COBS encoded and terminated by a 0x00 byte. As the text 
+ *  messages never contain 0x00 the host can receive both on the same
+ *  port: the bytes between two 0x00 are a frame if the decoding and the
+ *  CRC are valid.
+ *  
+ *  All the record fields are little endian. A sample record is sent
+ *  for every spool channel, a capture record for every raw sample of
+ *  the channels capturing (see capture.h). tools/telemetrydecoder.h
+ *  decodes the stream on the host.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _TELEMETRY
+#define _TELEMETRY
+
+#include "hal.h"
+#include "crc16.h"
+#include "channels.h"
+
+//! Default period in ms between two records
+#define TELEMETRY_DEFAULT_PERIOD 100
+//! us to send a byte at 38400 baud (10 bits)
+#define TELEMETRY_BYTE_TIME 260
+//! Bytes of a framed sample record
+#define TELEMETRY_SAMPLE_FRAME 21
+//! Min period in ms: the sample frames of all the channels take at most
+//! half of the serial bandwidth, the rest is left to the messages and
+//! the captures (11 ms with one channel, 66 ms with six)
+#define TELEMETRY_MIN_PERIOD \
+  ((2 * TELEMETRY_SAMPLE_FRAME * TELEMETRY_BYTE_TIME * SPOOL_CHANNELS + 999) / 1000)
+//! Period in ms of the task sending the records
+#define TELEMETRY_TASK_PERIOD 10
+//! Max record size in bytes
+#define TELEMETRY_RECORD_MAX 32
+//! Max frame size: record, CRC, COBS overhead and delimiter
+#define TELEMETRY_FRAME_MAX (TELEMETRY_RECORD_MAX + 2 + 2 + 1)
+
+// Record types, first byte of every record
+#define TELEMETRY_SAMPLE 1    ///< telemetrySample record
+#define TELEMETRY_CAPTURE 2   ///< telemetryCapture record
+
+/**
+ * Sample record, 17 bytes (21 bytes framed)
+ */
+struct telemetrySample {
+  //! TELEMETRY_SAMPLE
+  uint8_t type;
+  //! millis() when the record has been sent
+  uint32_t timestamp;
+  //! Last raw sensor value
+  int32_t raw;
+  //! Filtered weight in mg
+  int32_t weight;
+  //! Spool channel (high nibble) and status ID (low nibble, STAT_NONE ... STAT_RUN)
+  uint8_t statID;
+  //! Motor duty cycle (0 when not running)
+  uint8_t duty;
+  //! Motor direction (high nibble) and motion state (low nibble)
+  uint8_t motion;
+  //! Last TLE94112 diagnosis (HAL_DIAG_* bits)
+  uint8_t diagnosis;
+} __attribute__((packed));
+
+/**
+ * Raw sample capture record, 12 bytes (16 bytes framed)
+ */
+struct telemetryCapture {
+  //! TELEMETRY_CAPTURE
+  uint8_t type;
+  //! micros() when the sample has been read
+  uint32_t timestamp;
+  //! Raw sensor value
+  int32_t raw;
+  //! Spool channel (high nibble) and status ID (low nibble, STAT_NONE ... STAT_RUN)
+  uint8_t statID;
+  //! Motor duty cycle (0 when not running) when the record is sent
+  uint8_t duty;
+  //! Motor direction (high nibble) and motion state (low nibble)
+  uint8_t motion;
+} __attribute__((packed));
+
+/**
+ * Class sending the telemetry records
+ */
+class Telemetry {
+
+  public:
+    /**
+     * Initialize the telemetry, disabled by default
+     * 
+     * \param port the output stream
+     */
+    void begin(Print &port);
+
+    /**
+     * Set the period between two records
+     * 
+     * \param ms the period in ms, 0 disables the telemetry,
+     * raised to TELEMETRY_MIN_PERIOD
+     */
+    void setPeriod(unsigned long ms);
+
+    /**
+     * Check if it is time to send a new record
+     * 
+     * \return true if a record should be sent
+     */
+    boolean due(void);
+
+    /**
+     * Send a record as a frame
+     * 
+     * \param record the record bytes
+     * \param length the record size
+     */
+    void send(const void* record, int length);
+
+    //! Period between two records, 0 if disabled
+    unsigned long period;
+    //! Frames sent
+    unsigned long frames;
+    //! Bytes sent
+    unsigned long bytes;
+
+  private:
+    //! Output stream
+    Print* port;
+    //! millis() of the last record
+    unsigned long lastSend;
+};
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ *  \file tensioncontrol.cpp
+ *  \brief PI regulator of the filament tension for the automatic feeding
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "tensioncontrol.h"
+
+void TensionControl::begin(void) {
+  setpoint = MEASURE(TENSION_SETPOINT);
+  kp = MEASURE(TENSION_KP);
+  ki = MEASURE(TENSION_KI);
+  reset();
+}
+
+void TensionControl::reset(void) {
+  duty = 0;
+  integral = 0;
+  tension = 0;
+  feedForward = 0;
+  relax = RELAX_NONE;
+  lastUpdate = relaxStart = halMillis();
+}
+
+int TensionControl::update(measure_t t, measure_t feedRate) {
+  measure_t error, output, base, dt;
+  unsigned long now = halMillis();
+  int previous;
+
+  dt = MEASURE_FROM_MILLI(now - lastUpdate);
+  lastUpdate = now;
+  tension = t;
+
+  // Positive error: too much tension, more filament is needed
+  error = tension - setpoint;
+#ifdef _FEED_FORWARD
+  // The motor starts turning at MOTOR_DEAD_ZONE, the rate is mapped above it
+  if(feedRate > 0)
+    feedForward = MEASURE(MOTOR_DEAD_ZONE) +
+                  MEASURE_MUL(feedRate, MEASURE((DC_FULL - MOTOR_DEAD_ZONE) / MOTOR_FEED_RATE));
+  else
+    feedForward = 0;
+#else
+  feedForward = 0;
+#endif
+
+  // The release runs the motor at the steady output of the regulator,
+  // faster while feeding the slack. The filament is not released if
+  // the motor can not run enough faster than the extruder
+  base = max(feedForward + integral, MEASURE(DC_MIN_EXTRUDER));
+  if( ((relax == RELAX_NONE) && (now - relaxStart >= TENSION_RELAX_PERIOD) &&
+       (base + MEASURE(TENSION_RELAX_DUTY / 2) <= MEASURE(TENSION_MAX_DUTY))) ||
+      ((relax == RELAX_FEED) && (now - relaxStart >= TENSION_RELAX_FEED)) ||
+      ((relax == RELAX_LOOSE) && (now - relaxStart >= TENSION_RELAX_TIME - TENSION_RELAX_FEED)) ) {
+    relax = (relax + 1) % (RELAX_LOOSE + 1);
+    relaxStart = now;
+    // The regulation starts again from the output of the release, the
+    // filament is still loose
+    if(relax == RELAX_NONE)
+      integral = base - feedForward - MEASURE_MUL(kp, error);
+  }
+
+  if(relax != RELAX_NONE) {
+    output = base;
+    if(relax == RELAX_FEED)
+      output += MEASURE(TENSION_RELAX_DUTY);
+  }
+  else {
+    output = feedForward + MEASURE_MUL(kp, error) + integral + MEASURE_MUL(MEASURE_MUL(ki, error), dt);
+    // Anti-windup: integrate only if the output is not saturated
+    // or the error is bringing it back in range
+    if( ((output < MEASURE(TENSION_MAX_DUTY)) || (error < 0)) && ((output > 0) || (error > 0)) )
+      integral += MEASURE_MUL(MEASURE_MUL(ki, error), dt);
+  }
+  output = constrain(output, 0, MEASURE(TENSION_MAX_DUTY));
+
+  // Limit the duty cycle variation. A stopped motor starts from the
+  // min duty cycle, the steps below it would not move it
+  previous = max(duty, DC_MIN_EXTRUDER);
+  if(output > MEASURE(previous + TENSION_MAX_SLEW))
+    output = MEASURE(previous + TENSION_MAX_SLEW);
+  else if(output < MEASURE(duty - TENSION_MAX_SLEW))
+    output = MEASURE(duty - TENSION_MAX_SLEW);
+  duty = MEASURE_INT(output);
+
+  // Below the minimum duty cycle the motor does not move
+  if(duty < DC_MIN_EXTRUDER)
+    return 0;
+  return duty;
+}
+
+void TensionControl::showTuning(void) {
+  halSerial.print("Kp: ");
+  halSerial.print(MEASURE_FLOAT(kp));
+  halSerial.print("\tKi: ");
+  halSerial.println(MEASURE_FLOAT(ki));
+  halSerial.print("Tension: ");
+  halSerial.print(MEASURE_FLOAT(tension));
+  halSerial.print(" / ");
+  halSerial.print(MEASURE_FLOAT(setpoint));
+  halSerial.println(" gr");
+  halSerial.print("Duty: ");
+  halSerial.print(duty);
+  halSerial.print(" (feed-forward ");
+  halSerial.print(MEASURE_FLOAT(feedForward));
+  halSerial.println(")");
+  halSerial.println("");
+}
@@ -0,0 +1,90 @@
+/**
+ *  \file tensioncontrol.h
+ *  \brief PI regulator of the filament tension for the automatic feeding
+ *  
+ *  The extruder pulling the filament changes the weight read by the scale.
+ *  The regulator modulates the motor duty cycle to keep this deviation
+ *  (the tension) at the setpoint, instead of a fixed feed burst every time
+ *  a pull is detected. The duty cycle corresponding to the estimated
+ *  consumption rate is added as feed-forward, so the roll unwinds at the
+ *  printer speed before the tension builds up. The integral term is frozen when the output is
+ *  saturated (anti-windup) and the output change is rate limited.\n
+ *  Every TENSION_RELAX_PERIOD ms the filament is released: the motor
+ *  feeds TENSION_RELAX_FEED ms faster than the extruder, then follows it
+ *  with the filament loose, when the scale reads the roll weight without
+ *  tension.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _TENSIONCONTROL
+#define _TENSIONCONTROL
+
+#include "hal.h"
+#include "motor.h"
+#include "fixedpoint.h"
+
+// Release phases
+#define RELAX_NONE 0    ///< Regulating the tension
+#define RELAX_FEED 1    ///< Feeding the slack
+#define RELAX_LOOSE 2   ///< Filament loose
+
+/**
+ * Class regulating the filament tension
+ */
+class TensionControl {
+
+  public:
+    /**
+     * Initialize the regulator with the default parameters
+     */
+    void begin(void);
+
+    /**
+     * Reset the regulator state, e.g. when the automatic mode starts
+     */
+    void reset(void);
+
+    /**
+     * Calculate the new motor duty cycle
+     * 
+     * \param tension the measured tension (weight)
+     * \param feedRate the estimated consumption (length per second)
+     * \return the duty cycle, 0 if the motor should be stopped
+     */
+    int update(measure_t tension, measure_t feedRate);
+
+    /**
+     * Show the regulator parameters and status
+     */
+    void showTuning(void);
+
+    //! Tension setpoint (weight)
+    measure_t setpoint;
+    //! Proportional gain (duty cycle / gr)
+    measure_t kp;
+    //! Integral gain (duty cycle / gr / s)
+    measure_t ki;
+    //! Last duty cycle calculated
+    int duty;
+    //! Integral term (duty cycle)
+    measure_t integral;
+    //! Last measured tension
+    measure_t tension;
+    //! Last feed-forward duty cycle
+    measure_t feedForward;
+    //! Release phase, RELAX_NONE while regulating
+    int relax;
+
+  private:
+    //! halMillis() of the last update
+    unsigned long lastUpdate;
+    //! halMillis() of the last release phase change
+    unsigned long relaxStart;
+};
+
+#endif
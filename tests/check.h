@@ -0,0 +1,59 @@
+/**
+ *  \file check.h
+ *  \brief Minimal checks for the host tests
+ *
+ *  A test is a program returning 0 if all its checks passed. The failed
+ *  checks are shown with their position, the test goes on so all the
+ *  failures are listed.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CHECK
+#define _CHECK
+
+#include <stdio.h>
+
+//! Failed checks of the test
+static int checkFailures = 0;
+
+//! Check a condition
+#define CHECK(condition) \
+  do { \
+    if(!(condition)) { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      checkFailures++; \
+    } \
+  } while(0)
+
+//! Check a condition, showing the values compared
+#define CHECK_NEAR(value, expected, tolerance) \
+  do { \
+    double v_ = (value), e_ = (expected); \
+    if(!((v_ >= e_ - (tolerance)) && (v_ <= e_ + (tolerance)))) { \
+      printf("%s:%d: CHECK_NEAR(%s) failed: %g, expected %g +/- %g\n", \
+             __FILE__, __LINE__, #value, v_, e_, (double)(tolerance)); \
+      checkFailures++; \
+    } \
+  } while(0)
+
+//! Check that a text contains a string
+#define CHECK_CONTAINS(text, part) \
+  do { \
+    if(std::string(text).find(part) == std::string::npos) { \
+      printf("%s:%d: \"%s\" not found in:\n%s\n", __FILE__, __LINE__, \
+             (const char*)(part), std::string(text).c_str()); \
+      checkFailures++; \
+    } \
+  } while(0)
+
+//! Result of the test, returned by main()
+#define CHECK_RESULT() \
+  (printf("%s: %d failures\n", (checkFailures == 0) ? "PASS" : "FAIL", checkFailures), \
+   (checkFailures == 0) ? 0 : 1)
+
+#endif
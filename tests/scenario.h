@@ -0,0 +1,109 @@
+/**
+ *  \file scenario.h
+ *  \brief Common steps of the host tests and benchmarks
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _SCENARIO
+#define _SCENARIO
+
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+/**
+ * A print job: the extruder consumes at a rate for a time
+ */
+struct jobSegment {
+  double seconds;   ///< Duration
+  double rate;      ///< Consumption (gr/s), 0 for a pause
+};
+
+//! Prefix "<channel>:" of a command
+static inline std::string channelCommand(int ch, const char* command) {
+  return std::to_string(ch) + ":" + command;
+}
+
+/**
+ * Mount a full spool on a channel, load it and start the job. Called
+ * after the startup, the spool is mounted when the startup tare is done
+ *
+ * \param ch the channel
+ */
+static inline void startJob(int ch = 0) {
+  simRun(500);
+  world.mount(ch);
+  simRun(2000);
+  simCommand(channelCommand(ch, "load").c_str(), 1500);
+  simCommand(channelCommand(ch, "run").c_str(), 500);
+}
+
+/**
+ * Value of a field of the last status line of a channel in a text
+ *
+ * \param text the serial output
+ * \param ch the channel
+ * \param key the field name, e.g. "pull"
+ * \return the value, NAN if not found
+ */
+static inline double statField(const std::string& text, int ch, const char* key) {
+  std::string line = "@stat ch=" + std::to_string(ch) + " ";
+  std::string field = std::string(" ") + key + "=";
+  size_t start = text.rfind(line);
+  size_t end, pos;
+
+  if(start == std::string::npos)
+    return NAN;
+  end = text.find('\n', start);
+  pos = text.find(field, start);
+  if( (pos == std::string::npos) || (pos > end) )
+    return NAN;
+  return strtod(text.c_str() + pos + field.size(), NULL);
+}
+
+/**
+ * Value following a label in a text, e.g. "remain: "
+ *
+ * \param text the serial output
+ * \param label the label
+ * \return the value, NAN if not found
+ */
+static inline double labelValue(const std::string& text, const char* label) {
+  size_t pos = text.rfind(label);
+
+  if(pos == std::string::npos)
+    return NAN;
+  return strtod(text.c_str() + pos + strlen(label), NULL);
+}
+
+/**
+ * Column of a task row of the tasks command
+ *
+ * \param text the command output
+ * \param task the task name
+ * \param column the column, 0 is the name
+ * \return the value, -1 if not found
+ */
+static inline long taskColumn(const std::string& text, const char* task, int column) {
+  size_t pos = text.find(std::string("\n") + task + "\t");
+  const char* p;
+
+  if(pos == std::string::npos)
+    return -1;
+  p = text.c_str() + pos + 1;
+  while( (column-- > 0) && (p != NULL) ) {
+    p = strchr(p, '\t');
+    if(p != NULL)
+      p++;
+  }
+  return (p != NULL) ? atol(p) : -1;
+}
+
+#endif
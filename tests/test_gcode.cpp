@@ -0,0 +1,60 @@
+/**
+ *  \file test_gcode.cpp
+ *  \brief Filament demand of the G-code analyzer: the retractions pull
+ *  nothing, E absolute and relative, G92, dwells and the bins of the
+ *  moves across the bin limits
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <string.h>
+#include "gcodeanalyzer.h"
+#include "check.h"
+
+static const char job[] =
+  "G21\n"
+  "M82 ; absolute E\n"
+  "G92 E0\n"
+  "G1 F600 X10 E1\n"        // 1 s, 1 mm
+  "G1 E0 F2400\n"           // retraction, 25 ms
+  "G0 X20 F6000\n"          // travel, 100 ms
+  "g1 e1\n"                 // unretraction, 10 ms at 6000 mm/min
+  "G1 X30 E2 F600\n"        // 1 s, 1 mm
+  "G4 P500\n"
+  "G92 E0\n"
+  "M83\n"
+  "G1 X40 E1 ; relative\n"  // 1 s, 1 mm
+  "G4 S1\n";
+
+int main() {
+  GcodeAnalyzer analyzer(500);
+  double total = 0;
+
+  analyzer.parse(job, strlen(job));
+  for(double mg : analyzer.bins)
+    total += mg;
+  printf("%lu lines, %lu moves, %.3f s, %.3f mm, %zu bins\n", analyzer.lines, analyzer.moves,
+         analyzer.time, analyzer.filament, analyzer.bins.size());
+
+  CHECK(analyzer.lines == 13);
+  CHECK(analyzer.moves == 6);
+  CHECK_NEAR(analyzer.time, 4.635, 1e-9);
+  CHECK_NEAR(analyzer.filament, 3, 1e-9);
+  CHECK_NEAR(total, 3 * analyzer.mgPerMm, 1e-9);
+  CHECK_NEAR(analyzer.mgPerMm, 2.9825, 0.0001);
+  // The last bin has the dwell only
+  CHECK(analyzer.bins.size() == 10);
+  // The first move fills the first two bins
+  CHECK_NEAR(analyzer.bins[0], analyzer.mgPerMm / 2, 1e-9);
+  CHECK_NEAR(analyzer.bins[1], analyzer.mgPerMm / 2, 1e-9);
+  // The second move from 1.135 s to 2.135 s
+  CHECK_NEAR(analyzer.bins[2], analyzer.mgPerMm * 0.365, 1e-9);
+  CHECK_NEAR(analyzer.bins[4], analyzer.mgPerMm * 0.135, 1e-9);
+  CHECK(analyzer.bins[9] == 0);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,62 @@
+/**
+ *  \file test_heap.cpp
+ *  \brief No heap allocation by the firmware after setup()
+ *
+ *  The board runs the commands of a whole job, the status lines, the
+ *  telemetry and a print job in automatic mode; the allocator of the
+ *  simulated board counts the calls made by the firmware (heap.cpp).
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Commands of a job, every one runs for 500 ms
+static const char* commands[] = {
+  "help", "info", "conf", "stat", "weight", "acq", "tasks", "diag", "material",
+  "diameter", "spool", "gr", "cm", "man", "feed", "pull", "feedc", "stop", "pullc",
+  "stop", "kp", "ki", "tension", "job", "mstat 1000", "telemetry 500", "history",
+  "nothing", "auto", "plan 100", "plango 0"
+};
+
+int main() {
+  unsigned long allocs, frees;
+  void* area;
+  unsigned int j;
+
+  // The count works
+  simHeapTrace = true;
+  area = malloc(16);
+  __asm__ volatile("" : : "g"(area) : "memory");
+  free(area);
+  simHeapTrace = false;
+  CHECK( (simHeapAllocs == 1) && (simHeapFrees == 1) );
+  simHeapAllocs = simHeapFrees = 0;
+  simHeapBytes = 0;
+
+  simBoot();
+  printf("setup: %lu allocations, %llu bytes\n", simHeapAllocs, simHeapBytes);
+  allocs = simHeapAllocs;
+  frees = simHeapFrees;
+
+  startJob();
+  for(j = 0; j < sizeof(commands) / sizeof(commands[0]); j++)
+    simCommand(commands[j], 500);
+  world.setRate(0, 0.03 / SIM_GR1CM);
+  simRun(600000);
+  simCommand("load", 1500);
+  simCommand("reset", 1500);
+
+  printf("after setup: %lu allocations, %lu releases\n", simHeapAllocs - allocs,
+         simHeapFrees - frees);
+  CHECK(simHeapAllocs == allocs);
+  CHECK(simHeapFrees == frees);
+  return CHECK_RESULT();
+}
@@ -0,0 +1,39 @@
+/**
+ *  \file test_load.cpp
+ *  \brief The load command shows the roll weight read after the command
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "commands.h"
+#include "check.h"
+
+int main() {
+  std::string out;
+
+  simBoot();
+  simRun(1000);
+
+  // No reading is made before the load command at the startup
+  world.mount(0);
+  simRun(2000);
+  out = simCommand("load", 500);
+  printf("%s", out.c_str());
+  CHECK_CONTAINS(out, "remain: 99");
+  CHECK(out.find("remain: -") == std::string::npos);
+
+  // The job can not start before the roll weight is read
+  simCommand("reset", 500);
+  out = simCommand("load\nrun", 20);
+  CHECK_CONTAINS(out, CMD_WRONGSTATE);
+  out = simCommand("stat", 500);
+  CHECK_CONTAINS(out, "remain: 99");
+
+  return CHECK_RESULT();
+}
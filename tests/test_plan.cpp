@@ -0,0 +1,46 @@
+/**
+ *  \file test_plan.cpp
+ *  \brief The demand schedule accepts only the bins in the range of its
+ *  queue (0 ... PLAN_MAX_DEMAND mg), the other values are refused with
+ *  an error instead of being wrapped or clamped
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "commands.h"
+#include "check.h"
+
+int main() {
+  std::string out;
+
+  simBoot();
+  simRun(500);
+
+  out = simCommand("plan -1");
+  CHECK_CONTAINS(out, CMD_WRONGCMD);
+  out = simCommand("plan 65536");
+  CHECK_CONTAINS(out, CMD_WRONGCMD);
+  out = simCommand("plan 4294967326");
+  CHECK_CONTAINS(out, CMD_WRONGCMD);
+  out = simCommand("plango -1000");
+  CHECK_CONTAINS(out, CMD_WRONGCMD);
+  out = simCommand("plan");
+  CHECK_CONTAINS(out, "Plan: stopped, 0 bins queued");
+
+  // The limits are queued
+  out = simCommand("plan 0");
+  CHECK(out.find(CMD_WRONGCMD) == std::string::npos);
+  out = simCommand("plan 65535");
+  CHECK(out.find(CMD_WRONGCMD) == std::string::npos);
+  out = simCommand("plan");
+  printf("%s", out.c_str());
+  CHECK_CONTAINS(out, "Plan: stopped, 2 bins queued");
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,63 @@
+/**
+ *  \file test_runout.cpp
+ *  \brief Runout warning only for the running job, the job weight does
+ *  not outlive its job
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "filament.h"
+#include "check.h"
+
+int main() {
+  std::string out;
+
+  // The spool is mounted after the startup tare
+  simBoot();
+  simRun(500);
+  world.mount(0);
+  simRun(2000);
+  simCommand("load", 1500);
+
+  // The job weight can be sent before the job starts, no warning yet
+  out = simCommand("job 200");
+  CHECK(out.find(MSG_RUNOUT) == std::string::npos);
+  CHECK(out.find("leaves") == std::string::npos);
+
+  // The 1 Kg spool is enough for the job
+  out = simCommand("run", 500);
+  CHECK(out.find(MSG_RUNOUT) == std::string::npos);
+  out = simCommand("job");
+  CHECK_CONTAINS(out, "job 200.00 gr leaves");
+
+  // The job ends, its weight is cleared
+  out = simCommand("reset", 500);
+  out = simCommand("job");
+  CHECK(out.find("job 200") == std::string::npos);
+
+  // A job larger than the spool warns once it is started
+  simCommand("load", 1500);
+  simCommand("job 1200");
+  out = simCommand("run", 500);
+  CHECK_CONTAINS(out, MSG_RUNOUT);
+  simRun(2000);
+  out = simCommand("default", 500);
+  CHECK(out.find(MSG_RUNOUT) == std::string::npos);
+  out = simCommand("job");
+  CHECK(out.find("job 1200") == std::string::npos);
+
+  // The next job starts without the previous job weight
+  simCommand("load", 1500);
+  out = simCommand("run", 500);
+  simRun(2000);
+  out += simOutput;
+  CHECK(out.find(MSG_RUNOUT) == std::string::npos);
+
+  return CHECK_RESULT();
+}
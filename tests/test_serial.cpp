@@ -0,0 +1,131 @@
+/**
+ *  \file test_serial.cpp
+ *  \brief The command lines are assembled from the serial bytes in any
+ *  chunks, the too long lines are discarded, the bursts of short lines
+ *  are not lost and the commands are executed as soon as the line ends
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <stdlib.h>
+#include "sim.h"
+#include "serialline.h"
+#include "commands.h"
+#include "filament.h"
+#include "check.h"
+
+//! Serial speed of the firmware
+#define SERIAL_BAUD 38400
+//! us to receive a character
+#define BYTE_TIME (10000000ULL / SERIAL_BAUD)
+//! Commands sent in random chunks
+#define CHUNKED_COMMANDS 200
+//! Schedule bins sent in a burst
+#define BURST_LINES 40
+
+//! Time of the first character written by the firmware, 0 if none
+static unsigned long long firstOutput = 0;
+
+static void tap(uint8_t c, unsigned long long us) {
+  if(firstOutput == 0)
+    firstOutput = us;
+}
+
+//! Occurrences of a string in a text
+static int count(const std::string& text, const char* part) {
+  size_t pos = 0;
+  int n = 0;
+
+  while( (pos = text.find(part, pos)) != std::string::npos ) {
+    n++;
+    pos++;
+  }
+  return n;
+}
+
+int main() {
+  std::string stream, chunk;
+  unsigned long long arrival, latency, maxLatency = 0, sumLatency = 0;
+  size_t pos, size;
+  int j;
+
+  simBoot();
+  simRun(1000);
+
+  // Many commands in chunks of random size, sent at random intervals
+  // shorter than SERIAL_LINE_TIMEOUT
+  srand(1);
+  for(j = 0; j < CHUNKED_COMMANDS; j++)
+    stream += (j % 3 == 0) ? "weight\r\n" : (j % 3 == 1) ? "weight\n" : "0:weight\n";
+  simOutput.clear();
+  for(pos = 0; pos < stream.size(); pos += size) {
+    size = 1 + rand() % 12;
+    chunk = stream.substr(pos, size);
+    simSerialInput(chunk.c_str());
+    simRun(rand() % (SERIAL_LINE_TIMEOUT / 2));
+  }
+  simRun(500);
+  CHECK(count(simOutput, CMD_WEIGHT) == CHUNKED_COMMANDS);
+  CHECK(count(simOutput, CMD_NOCMD) == 0);
+  CHECK(simSerialOverruns == 0);
+
+  // A line with no line ending is complete after SERIAL_LINE_TIMEOUT
+  simOutput.clear();
+  simSerialInput("weight");
+  simRun(SERIAL_LINE_TIMEOUT / 2);
+  CHECK(count(simOutput, CMD_WEIGHT) == 0);
+  simRun(SERIAL_LINE_TIMEOUT * 2);
+  CHECK(count(simOutput, CMD_WEIGHT) == 1);
+
+  // A too long line is discarded with the characters up to its end,
+  // the next line is executed
+  simOutput.clear();
+  simSerialInput((std::string(3 * SERIAL_LINE_SIZE, 'x') + "weight\nweight\n").c_str());
+  simRun(500);
+  CHECK(count(simOutput, CMD_TOOLONG) == 1);
+  CHECK(count(simOutput, CMD_WEIGHT) == 1);
+  CHECK(count(simOutput, CMD_NOCMD) == 0);
+  // The longest line fitting the buffer is a command
+  simOutput.clear();
+  simSerialInput((std::string("weight") + std::string(SERIAL_LINE_SIZE - 7, ' ') + "\n").c_str());
+  simRun(500);
+  CHECK(count(simOutput, CMD_TOOLONG) == 0);
+  CHECK(count(simOutput, CMD_WEIGHT) == 1);
+
+  // A burst of short lines, as the streamed schedule bins: more lines
+  // than one a task period arrive and none is lost
+  stream.clear();
+  for(j = 0; j < BURST_LINES; j++)
+    stream += "plan 1\n";
+  simSerialInput(stream.c_str());
+  simRun(500);
+  CHECK(simSerialOverruns == 0);
+  CHECK_CONTAINS(simCommand("plan"), ("Plan: stopped, " + std::to_string(BURST_LINES)).c_str());
+  simCommand("plango 0");
+
+  // Latency from the line end to the first character of the answer
+  simSerialTap = tap;
+  for(j = 0; j < 100; j++) {
+    firstOutput = 0;
+    arrival = simNow + 7 * BYTE_TIME;
+    simSerialInput("weight\n");
+    simRun(20 + j % 10);
+    CHECK(firstOutput > arrival);
+    latency = firstOutput - arrival;
+    sumLatency += latency;
+    if(latency > maxLatency)
+      maxLatency = latency;
+  }
+  simSerialTap = NULL;
+  printf("command latency: mean %.2f ms, max %.2f ms\n", sumLatency / 100000.0,
+         maxLatency / 1000.0);
+  // The lines are polled every TASK_RX_PERIOD ms
+  CHECK(maxLatency < (TASK_RX_PERIOD + 1) * 1000ULL);
+
+  return CHECK_RESULT();
+}
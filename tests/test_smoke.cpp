@@ -0,0 +1,56 @@
+/**
+ *  \file test_smoke.cpp
+ *  \brief Boot the firmware on the simulated board, load a spool and
+ *  feed a running job in automatic mode
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "check.h"
+
+int main() {
+  std::string out;
+
+  // Blank flash: the empty scale is tared at the startup
+  simBoot();
+  CHECK_CONTAINS(simOutput, "Filament Control");
+  simRun(1000);
+
+  out = simCommand("help");
+  CHECK_CONTAINS(out, "load\troll loaded");
+  CHECK_CONTAINS(out, "PLA");
+  out = simCommand("nothing");
+  CHECK_CONTAINS(out, "nothing");
+
+  // A full 1 Kg spool
+  world.mount(0);
+  simRun(1000);
+  out = simCommand("load", 500);
+  printf("%s", out.c_str());
+  out = simCommand("stat", 500);
+  printf("%s", out.c_str());
+  CHECK_CONTAINS(out, "remain: 99");
+  out = simCommand("run", 500);
+  printf("%s", out.c_str());
+  out = simCommand("auto");
+  CHECK_CONTAINS(out, "auto");
+
+  // The extruder pulls 60 s at 0.02 gr/s, the motor follows
+  world.clearStats(0);
+  world.setRate(0, 0.02 / SIM_GR1CM);
+  simRun(60000);
+  printf("fed %.1f cm consumed %.1f cm dragged %.1f cm max tension %.0f gr\n",
+         world.spool[0].fed, world.spool[0].consumed, world.spool[0].dragged,
+         world.spool[0].maxTensionSeen);
+  CHECK(world.spool[0].fed > 0.8 * world.spool[0].consumed);
+  out = simCommand("stat", 500);
+  printf("%s", out.c_str());
+
+  return CHECK_RESULT();
+}
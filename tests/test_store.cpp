@@ -0,0 +1,68 @@
+/**
+ *  \file test_store.cpp
+ *  \brief The newest stored settings are restored across the wrap of the
+ *  sequence: no tare at the startup with the spool on the scale, the
+ *  next save goes to the slot following the restored one
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <string.h>
+#include "sim.h"
+#include "EEPROM.h"
+#include "scenario.h"
+#include "check.h"
+#include "filament.h"
+#include "crc16.h"
+#include "settingsstore.h"
+
+//! Write a record of the first channel to a slot
+static void writeRecord(int slot, uint16_t sequence, long offset) {
+  storedSettings record;
+
+  memset(&record, 0, sizeof(record));
+  record.version = STORE_VERSION;
+  record.sequence = sequence;
+  record.scaleCalibration = SIM_HX711_CALIBRATION;
+  record.scaleOffset = offset;
+  record.statID = STAT_READY;
+  record.units = _GR;
+  record.crc = crc16((const uint8_t*)&record, sizeof(record) - sizeof(record.crc));
+  memcpy(EEPROM.data() + STORE_BASE + slot * sizeof(record), &record, sizeof(record));
+}
+
+int main() {
+  storedSettings record;
+  double full = SIM_HOLDER + SIM_SPOOL_TARE + SIM_SPOOL_NET;
+
+  // The newest record has the zero of the empty scale, the wrap of the
+  // sequence is newer than the older record
+  writeRecord(0, 0xFFFF, SIM_HX711_OFFSET + 5000);
+  writeRecord(1, 0, SIM_HX711_OFFSET);
+  writeRecord(2, 0xFFFE, SIM_HX711_OFFSET - 5000);
+  world.mount(0);
+  simBoot();
+  simRun(1000);
+  CHECK_NEAR(labelValue(simCommand("weight", 200), "Weight "), full, 2);
+  CHECK_CONTAINS(simCommand("conf", 200), "Offset: 100000");
+
+  // The save follows the newest record
+  simCommand("cm");
+  memcpy(&record, EEPROM.data() + STORE_BASE + 2 * sizeof(record), sizeof(record));
+  CHECK(record.version == STORE_VERSION);
+  CHECK(record.sequence == 1);
+  CHECK(record.scaleOffset == SIM_HX711_OFFSET);
+  CHECK(record.units == _CM);
+
+  // and it is restored
+  simBoot();
+  simRun(1000);
+  CHECK_NEAR(labelValue(simCommand("weight", 200), "Weight "), full, 2);
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,47 @@
+/**
+ *  \file test_tare.cpp
+ *  \brief The tare does not stop the main loop: at the startup with a
+ *  blank flash and with the tare command
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+
+int main() {
+  unsigned long long boot;
+  std::string out;
+
+  // Blank flash, the tare is made by the sensor task
+  simBoot();
+  boot = simNow;
+  simRun(1000);
+  printf("setup %.1f ms, max loop %.1f ms\n", boot / 1000.0, simLoopMax / 1000.0);
+  CHECK(boot < 50000);
+  CHECK(simLoopMax < 10000);
+  CHECK_NEAR(labelValue(simCommand("weight", 200), "Weight "), 0, 1);
+
+  // Something on the scale is the new zero
+  world.spool[0].extra = 50;
+  simRun(1000);
+  CHECK_NEAR(labelValue(simCommand("weight", 200), "Weight "), 50, 1);
+  simCommand("tare", 1000);
+  printf("tare command: max loop %.1f ms\n", simLoopMax / 1000.0);
+  CHECK(simLoopMax < 10000);
+  simRun(2000);
+  CHECK_NEAR(labelValue(simCommand("weight", 200), "Weight "), 0, 1);
+
+  // The zero is saved
+  simBoot();
+  simRun(1000);
+  CHECK_NEAR(labelValue(simCommand("weight", 200), "Weight "), 0, 1);
+
+  return CHECK_RESULT();
+}
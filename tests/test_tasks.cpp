@@ -0,0 +1,49 @@
+/**
+ *  \file test_tasks.cpp
+ *  \brief Task scheduling of a running job in automatic mode: no sample
+ *  is lost, the sensor task does not wait and the regulator runs on every
+ *  reading within its deadline
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include "sim.h"
+#include "scenario.h"
+#include "check.h"
+
+int main() {
+  std::string before, after;
+  long runs, misses;
+
+  simBoot();
+  startJob();
+  simCommand("auto");
+  world.setRate(0, 0.03 / SIM_GR1CM);
+  simRun(5000);
+
+  // A minute of job without commands
+  world.clearStats(0);
+  before = simCommand("tasks", 500);
+  simRun(60000);
+  after = simCommand("tasks", 500);
+  printf("%s", after.c_str());
+
+  runs = taskColumn(after, "feed", 4) - taskColumn(before, "feed", 4);
+  misses = taskColumn(after, "feed", 6) - taskColumn(before, "feed", 6);
+  printf("%lu conversions, %lu lost, %ld regulator runs, %ld misses\n",
+         world.hx711[0].conversions, world.hx711[0].lost, runs, misses);
+  CHECK(world.hx711[0].lost == 0);
+  // A reading every SCALE_SAMPLES conversions
+  CHECK_NEAR(runs, world.hx711[0].conversions / 10.0, 5);
+  CHECK(misses == 0);
+  // The sensor task does not wait for the samples
+  CHECK(taskColumn(after, "sensor", 5) < 1000);
+  CHECK(taskColumn(after, "led", 6) == 0);
+
+  return CHECK_RESULT();
+}
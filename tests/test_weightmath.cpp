@@ -0,0 +1,83 @@
+/**
+ *  \file test_weightmath.cpp
+ *  \brief The weight, length and percentage calculations match the
+ *  exact values within SCALE_RESOLUTION
+ *
+ *  Built with the float and with the fixed point (_FIXED_POINT) weights.
+ *  The consumption, its length and the remaining percentage are
+ *  calculated for every material, diameter and spool of the catalogue
+ *  and compared with the same formulas in double precision. The
+ *  readings of the load cell are compared with the weight on the scale.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string>
+#include <math.h>
+#include "sim.h"
+#include "spoolchannel.h"
+#include "commands.h"
+#include "scenario.h"
+#include "check.h"
+
+//! Weight steps of the sweep (gr)
+#define SWEEP_STEP 0.37
+
+int main() {
+  FilamentWeight& scale = spools[0].scale;
+  double grams, used, maxGrams = 0, maxCm = 0, maxPerc = 0, w;
+  int m, d, s;
+
+  world.hx711[0].noise = 0;
+  simBoot();
+  simRun(1000);
+
+  for(m = 0; m < MATERIALS; m++)
+    for(d = 0; d < DIAMETERS; d++)
+      for(s = 0; s < SPOOLS; s++) {
+        double net = spoolTable[s].net;
+        double length1gr = filamentTable[m][d].length1gr;
+
+        scale.materialID = m;
+        scale.diameterID = d;
+        scale.wID = s;
+        scale.calcMaterialCharacteristics();
+        scale.statID = STAT_LOAD;
+        scale.initialWeight = scale.rollWeight;
+
+        for(grams = 0; grams <= net; grams += SWEEP_STEP) {
+          // The filament left on the roll is the reading less the tare
+          scale.lastRead = scale.rollTare + MEASURE(grams);
+          used = net - grams;
+
+          w = fabs(MEASURE_FLOAT(scale.calcConsumedGrams()) - used);
+          maxGrams = fmax(maxGrams, w);
+          w = fabs(MEASURE_FLOAT(scale.calcGgramsToCentimeters(MEASURE(grams))) -
+                   grams * length1gr);
+          maxCm = fmax(maxCm, w / length1gr);
+          w = fabs(MEASURE_FLOAT(scale.calcRemainingPerc(MEASURE(grams))) - grams * 100 / net);
+          maxPerc = fmax(maxPerc, w * net / 100);
+        }
+      }
+
+  // The errors in grams of the result
+  printf("max error: consumed %.4f gr, length %.4f gr, percentage %.4f gr\n", maxGrams,
+         maxCm, maxPerc);
+  CHECK(maxGrams < SCALE_RESOLUTION);
+  CHECK(maxCm < SCALE_RESOLUTION);
+  CHECK(maxPerc < SCALE_RESOLUTION);
+
+  // The readings of the load cell
+  scale.setDefaults();
+  for(w = 0; w <= 2000; w += 250) {
+    world.spool[0].extra = w;
+    simRun(1000);
+    CHECK_NEAR(labelValue(simCommand("weight", 200), CMD_WEIGHT), w, SCALE_RESOLUTION);
+  }
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,153 @@
+/**
+ *  \file capturefile.cpp
+ *  \brief Binary file of the raw samples captured by the capture command
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "capturefile.h"
+
+// ==============================================
+// Writer
+// ==============================================
+
+CaptureWriter::CaptureWriter() {
+  memset(&header, 0, sizeof(header));
+  samples = 0;
+  calibrated = false;
+  file = NULL;
+  failed = false;
+}
+
+bool CaptureWriter::open(const char* path, int channel) {
+  file = fopen(path, "wb");
+  if(file == NULL)
+    return false;
+  header.magic = CAPTURE_FILE_MAGIC;
+  header.version = CAPTURE_FILE_VERSION;
+  header.sampleSize = sizeof(captureFileSample);
+  header.channel = channel;
+  samples = 0;
+  failed = false;
+  // Rewritten by close() with the calibration
+  if(fwrite(&header, sizeof(header), 1, file) != 1)
+    failed = true;
+  return true;
+}
+
+void CaptureWriter::add(const telemetryRecord& record, uint8_t flags) {
+  captureFileSample sample;
+
+  if( (file == NULL) || (record.type != TELEMETRY_DECODER_CAPTURE) ||
+      (record.channel != header.channel) )
+    return;
+  sample.timestamp = record.timestamp;
+  sample.raw = record.raw;
+  sample.statID = record.statID;
+  sample.duty = record.duty;
+  sample.motion = (record.direction << 4) | record.motion;
+  sample.flags = flags;
+  if(fwrite(&sample, sizeof(sample), 1, file) != 1)
+    failed = true;
+  samples++;
+}
+
+void CaptureWriter::scanText(const std::string& text) {
+  size_t j;
+
+  for(j = 0; j < text.size(); j++) {
+    if( (text[j] != '\n') && (text[j] != '\r') ) {
+      line += text[j];
+      continue;
+    }
+    // The calibration is printed with two decimals
+    if(line.compare(0, 7, "Calib.:") == 0) {
+      header.calibration = strtof(line.c_str() + 7, NULL);
+      calibrated = true;
+    }
+    else if(line.compare(0, 13, "Nonlinearity:") == 0)
+      header.quadratic = strtof(line.c_str() + 13, NULL) / 1000000.0f;
+    else if(line.compare(0, 7, "Offset:") == 0)
+      header.offset = strtol(line.c_str() + 7, NULL, 10);
+    line.clear();
+  }
+}
+
+bool CaptureWriter::close(void) {
+  if(file == NULL)
+    return false;
+  if( (fseek(file, 0, SEEK_SET) != 0) || (fwrite(&header, sizeof(header), 1, file) != 1) )
+    failed = true;
+  if(fclose(file) != 0)
+    failed = true;
+  file = NULL;
+  return !failed;
+}
+
+// ==============================================
+// Mapped file
+// ==============================================
+
+CaptureFile::CaptureFile() {
+  header = NULL;
+  samples = NULL;
+  count = 0;
+  data = NULL;
+  size = 0;
+}
+
+CaptureFile::~CaptureFile() {
+  close();
+}
+
+bool CaptureFile::open(const char* path) {
+  struct stat info;
+  int fd;
+
+  close();
+  fd = ::open(path, O_RDONLY);
+  if(fd < 0)
+    return false;
+  if( (fstat(fd, &info) != 0) || ((size_t)info.st_size < sizeof(captureFileHeader)) ) {
+    ::close(fd);
+    return false;
+  }
+  size = info.st_size;
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(data == MAP_FAILED) {
+    data = NULL;
+    return false;
+  }
+  header = (const captureFileHeader*)data;
+  if( (header->magic != CAPTURE_FILE_MAGIC) || (header->version != CAPTURE_FILE_VERSION) ||
+      (header->sampleSize != sizeof(captureFileSample)) ) {
+    close();
+    return false;
+  }
+  samples = (const captureFileSample*)(header + 1);
+  count = (size - sizeof(captureFileHeader)) / sizeof(captureFileSample);
+  // The samples are read in order
+  madvise(data, size, MADV_SEQUENTIAL);
+  return true;
+}
+
+void CaptureFile::close(void) {
+  if(data != NULL)
+    munmap(data, size);
+  header = NULL;
+  samples = NULL;
+  count = 0;
+  data = NULL;
+  size = 0;
+}
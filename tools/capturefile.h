@@ -0,0 +1,154 @@
+/**
+ *  \file capturefile.h
+ *  \brief Binary file of the raw samples captured by the capture command
+ *  (capture.h)
+ *
+ *  The file is a captureFileHeader followed by a captureFileSample for
+ *  every raw sample of one spool channel, in the order they have been
+ *  read, little endian. The header keeps the calibration of the scale
+ *  read from the conf output, so the samples can be converted to grams
+ *  by a board with a different one. The number of samples is the size
+ *  of the file, a capture interrupted is still valid.\n
+ *  CaptureWriter builds the file from the decoded telemetry records,
+ *  CaptureFile maps it in memory for the replay.\n
+ *  The library does not depend on the firmware sources.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CAPTURE_FILE
+#define _CAPTURE_FILE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "telemetrydecoder.h"
+
+//! "FDCP" at the start of the file
+#define CAPTURE_FILE_MAGIC 0x50434446u
+//! Version of the layout
+#define CAPTURE_FILE_VERSION 1
+
+//! Reference flag of a sample: the extruder is pulling the filament,
+//! set by the tool that knows it (e.g. the simulated dispenser)
+#define CAPTURE_FLAG_PULL 0x01
+
+//! Start of the file
+struct captureFileHeader {
+  uint32_t magic;       ///< CAPTURE_FILE_MAGIC
+  uint16_t version;     ///< CAPTURE_FILE_VERSION
+  uint16_t sampleSize;  ///< sizeof(captureFileSample)
+  uint8_t channel;      ///< Spool channel of the samples
+  uint8_t reserved[3];  ///< Zero
+  int32_t offset;       ///< Raw value with no weight on the scale
+  float calibration;    ///< Counts for one gram
+  float quadratic;      ///< Nonlinearity correction (1 / gram)
+} __attribute__((packed));
+
+//! A raw sample
+struct captureFileSample {
+  uint32_t timestamp;   ///< micros() of the board when the sample has been read
+  int32_t raw;          ///< Raw sensor value
+  uint8_t statID;       ///< Status ID (STAT_NONE ... STAT_RUN)
+  uint8_t duty;         ///< Motor duty cycle, 0 when not running
+  uint8_t motion;       ///< Motor direction (high nibble) and motion state (low nibble)
+  uint8_t flags;        ///< CAPTURE_FLAG_PULL
+} __attribute__((packed));
+
+/**
+ * Writer of a capture file
+ */
+class CaptureWriter {
+
+  public:
+    CaptureWriter();
+
+    /**
+     * Create the file
+     *
+     * \param path the file
+     * \param channel the spool channel whose samples are written
+     * \return false if the file can not be created
+     */
+    bool open(const char* path, int channel);
+
+    /**
+     * Write a capture record, the records of the other channels and
+     * types are ignored
+     *
+     * \param record the decoded record
+     * \param flags the reference flags of the sample
+     */
+    void add(const telemetryRecord& record, uint8_t flags = 0);
+
+    /**
+     * Read the calibration of the scale from the text of the serial
+     * port: the "Calib.:", "Nonlinearity:" and "Offset:" lines of the
+     * conf command. The text can be split anywhere
+     *
+     * \param text the text received
+     */
+    void scanText(const std::string& text);
+
+    /**
+     * Write the header and close the file
+     *
+     * \return false if the file has not been written
+     */
+    bool close(void);
+
+    //! The header written by close(), the calibration can be set by the caller
+    captureFileHeader header;
+    //! Samples written
+    unsigned long samples;
+    //! The calibration has been read by scanText()
+    bool calibrated;
+
+  private:
+    FILE* file;
+    //! Text line not yet ended
+    std::string line;
+    //! Write errors
+    bool failed;
+};
+
+/**
+ * Capture file mapped in memory, read only
+ */
+class CaptureFile {
+
+  public:
+    CaptureFile();
+    ~CaptureFile();
+
+    /**
+     * Map a file
+     *
+     * \param path the file
+     * \return false if the file can not be read or is not a capture
+     */
+    bool open(const char* path);
+
+    //! Unmap the file
+    void close(void);
+
+    //! The header, NULL if no file is open
+    const captureFileHeader* header;
+    //! The samples
+    const captureFileSample* samples;
+    //! Number of samples
+    unsigned long count;
+
+  private:
+    //! The mapped file
+    void* data;
+    //! Bytes mapped
+    size_t size;
+};
+
+#endif
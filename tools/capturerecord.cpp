@@ -0,0 +1,60 @@
+/**
+ *  \file capturerecord.cpp
+ *  \brief Write the raw samples captured by the board to a capture file
+ *  (capturefile.h)
+ *
+ *  The bytes of the serial port are read from the standard input until
+ *  its end, e.g. cat /dev/ttyUSB0 | capturerecord spool.cap while the
+ *  board runs with "capture 1". The samples of a spool channel, 0 by
+ *  default, are written to the file. The conf command sent during the
+ *  capture adds the calibration of the scale to the file; the text
+ *  messages are printed as they are.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "telemetrydecoder.h"
+#include "capturefile.h"
+
+int main(int argc, char** argv) {
+  TelemetryDecoder telemetry;
+  CaptureWriter writer;
+  uint8_t data[256];
+  size_t length;
+
+  if( (argc < 2) || (argc > 3) ) {
+    fprintf(stderr, "usage: %s <capture file> [channel]\n", argv[0]);
+    return 2;
+  }
+  if(!writer.open(argv[1], (argc > 2) ? atoi(argv[2]) : 0)) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  while( (length = fread(data, 1, sizeof(data), stdin)) > 0 ) {
+    telemetry.receive(data, length);
+    for(const telemetryRecord& r : telemetry.records)
+      writer.add(r);
+    telemetry.records.clear();
+    writer.scanText(telemetry.text);
+    fputs(telemetry.text.c_str(), stdout);
+    telemetry.text.clear();
+  }
+  if(!writer.close()) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  fprintf(stderr, "%lu samples written\n", writer.samples);
+  if(telemetry.errors > 0)
+    fprintf(stderr, "%lu frames not valid\n", telemetry.errors);
+  if(!writer.calibrated)
+    fprintf(stderr, "no calibration (conf) received, the raw values are replayed as they are\n");
+  return 0;
+}
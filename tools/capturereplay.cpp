@@ -0,0 +1,251 @@
+/**
+ *  \file capturereplay.cpp
+ *  \brief Replay of a capture file through the firmware readings
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "sim.h"
+#include "filament.h"
+#include "spoolchannel.h"
+#include "capturereplay.h"
+
+//! The run command handler of the sketch
+void cmdRun(const char* arg);
+
+//! Replay running in this process
+static CaptureReplay* replaying;
+//! Next sample converted
+static unsigned long replayIndex;
+//! simNow of the first sample
+static unsigned long long replayStart;
+//! us from the first sample to the next one
+static unsigned long long replayElapsed;
+
+long CaptureReplay::replaySample(int ch, unsigned long long& next) {
+  const CaptureFile* capture = replaying->capture;
+  const captureFileSample& sample = capture->samples[replayIndex];
+
+  if(++replayIndex < capture->count) {
+    // The timestamps wrap around every 71 minutes
+    replayElapsed += (uint32_t)(capture->samples[replayIndex].timestamp - sample.timestamp);
+    next = replayStart + replayElapsed;
+  }
+  else
+    next = SIM_NEVER;
+  return replaying->convert(sample.raw);
+}
+
+CaptureReplay::CaptureReplay() {
+  referenced = false;
+  seconds = 0;
+  capture = NULL;
+  shared = target = NULL;
+  calibration = 0;
+  boardOffset = 0;
+  boardCalibration = 0;
+}
+
+bool CaptureReplay::begin(const CaptureFile* file) {
+  FilamentWeight& scale = spools[0].scale;
+  unsigned long j;
+
+  capture = file;
+  if(capture->count == 0)
+    return false;
+  referenced = false;
+  for(j = 0; j < capture->count; j++) {
+    if(capture->samples[j].flags & CAPTURE_FLAG_PULL)
+      referenced = true;
+  }
+  seconds = (uint32_t)(capture->samples[capture->count - 1].timestamp -
+                       capture->samples[0].timestamp) / 1e6;
+
+  shared = (replayResult*)simShared(sizeof(replayResult));
+  simBoot();
+  simRun(REPLAY_BOOT_TIME);
+  calibration = capture->header->calibration;
+  boardOffset = scale.scaleOffset;
+  boardCalibration = scale.scaleCalibration;
+
+  // The filter settles on the first sample, then the HX711 of channel 0
+  // converts only the samples of the capture
+  replaying = this;
+  world.hx711[0].replay = settleSample;
+  simRun(REPLAY_SETTLE_TIME);
+  world.integrate(simNow);
+  world.hx711[0].next = SIM_NEVER;
+  world.hx711[0].replay = NULL;
+  scale.sampler.flush();
+  simOutput.clear();
+  return true;
+}
+
+long CaptureReplay::settleSample(int ch, unsigned long long& next) {
+  next += (unsigned long long)(1e6 / world.hx711[ch].sps);
+  return replaying->convert(replaying->capture->samples[0].raw);
+}
+
+long CaptureReplay::convert(long raw) {
+  double grams;
+
+  if(calibration == 0)
+    return raw;
+  // The load cell is mounted upside down (FilamentWeight::countsToWeight())
+  grams = (capture->header->offset - raw) / calibration;
+  grams += capture->header->quadratic * grams * grams;
+  return boardOffset - (long)floor(grams * boardCalibration + 0.5);
+}
+
+double CaptureReplay::firmwareValue(int id) {
+  switch(id) {
+    case REPLAY_MIN_TENSION:
+      return MIN_EXTRUDER_TENSION;
+    case REPLAY_MAX_DELTA:
+      return MAX_DELTA_WEIGHT_IN_RANGE;
+    case REPLAY_SAMPLES:
+      return SCALE_SAMPLES;
+    default:
+      return SCALE_RESOLUTION;
+  }
+}
+
+void CaptureReplay::spawn(const double* values, replayResult* result) {
+  memcpy(tuning, values, sizeof(tuning));
+  memset(result, 0, sizeof(replayResult));
+  target = result;
+  if(simSpawn(replayProcess, this) != 0)
+    result->readings = 0;
+}
+
+replayResult CaptureReplay::run(const double* values) {
+  spawn(values, shared);
+  return *shared;
+}
+
+void CaptureReplay::sweep(const double* tunings, unsigned long count, replayResult* results,
+                          int workers) {
+  replayResult* area;
+  unsigned long j;
+  pid_t pid;
+  int w;
+
+  if(count == 0)
+    return;
+  if(workers <= 0)
+    workers = sysconf(_SC_NPROCESSORS_ONLN);
+  if(workers > (long)count)
+    workers = count;
+  area = (replayResult*)mmap(NULL, count * sizeof(replayResult), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(area == MAP_FAILED) {
+    for(j = 0; j < count; j++)
+      results[j] = run(tunings + j * REPLAY_PARAMETERS);
+    return;
+  }
+  memset(area, 0, count * sizeof(replayResult));
+
+  // Every worker replays one combination every workers, each on a
+  // fresh copy of the board
+  fflush(stdout);
+  for(w = 0; w < workers; w++) {
+    pid = (w == workers - 1) ? 0 : fork();
+    if(pid != 0)
+      continue;
+    for(j = w; j < count; j += workers)
+      spawn(tunings + j * REPLAY_PARAMETERS, area + j);
+    if(w < workers - 1)
+      _exit(0);
+  }
+  while(wait(NULL) > 0)
+    ;
+  memcpy(results, area, count * sizeof(replayResult));
+  munmap(area, count * sizeof(replayResult));
+}
+
+int CaptureReplay::replayProcess(void* arg) {
+  CaptureReplay& r = *(CaptureReplay*)arg;
+  FilamentWeight& scale = spools[0].scale;
+  SimHX711& adc = world.hx711[0];
+  replayResult& result = *r.target;
+  unsigned long now, pullEnd = 0;
+  unsigned long lost = adc.lost, overruns = scale.sampler.overruns;
+  boolean pulling = false, matched = false, starting = false;
+  int j, status;
+
+  for(j = 0; j < REPLAY_PARAMETERS; j++)
+    replayTuning()[j] = r.tuning[j];
+  // The gate is set by the calibration
+  scale.filter.setGate((long)(MAX_DELTA_WEIGHT_IN_RANGE * scale.scaleCalibration));
+
+  replaying = &r;
+  replayIndex = 0;
+  replayElapsed = 0;
+  replayStart = adc.next = simNow;
+  adc.replay = replaySample;
+  while(adc.next != SIM_NEVER) {
+    // The sample is converted and read by the sampler
+    simAdvance(adc.next - simNow);
+    const captureFileSample& sample = r.capture->samples[replayIndex - 1];
+    now = (unsigned long)((simNow - replayStart) / 1000);
+
+    // The job starts at the first reading while running
+    status = sample.statID & 0x0F;
+    if( (status == STAT_RUN) && (scale.statID != STAT_RUN) ) {
+      if(scale.statID == STAT_NONE)
+        scale.statID = STAT_READY;
+      starting = true;
+    }
+    else if(status != STAT_RUN) {
+      scale.statID = status;
+      starting = false;
+    }
+    scale.motorActive = sample.duty != 0;
+
+    if(sample.flags & CAPTURE_FLAG_PULL) {
+      if(!pulling) {
+        result.pulls++;
+        matched = false;
+      }
+      pulling = true;
+      pullEnd = now;
+    }
+    else
+      pulling = false;
+
+    if(!scale.readScale())
+      continue;
+    result.readings++;
+    if(starting) {
+      cmdRun("");
+      starting = false;
+      continue;
+    }
+    if( (scale.statID != STAT_RUN) || !scale.currentStatus.filamentNeededFromExtruder )
+      continue;
+    result.detections++;
+    if(!r.referenced)
+      continue;
+    if( (result.pulls > 0) && (pulling || (now - pullEnd <= REPLAY_MATCH_WINDOW)) ) {
+      if(!matched)
+        result.detected++;
+      matched = true;
+    }
+    else
+      result.falseTriggers++;
+  }
+
+  // The consumption as shown by the stat command
+  scale.showStat();
+  result.consumed = MEASURE_FLOAT(scale.lastConsumedGrams);
+  result.lost = (adc.lost - lost) + (scale.sampler.overruns - overruns);
+  return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ *  \file capturereplay.h
+ *  \brief Replay of a capture file through the firmware readings
+ *
+ *  The firmware replay variant runs on the simulated board with no
+ *  dispenser model on channel 0: its HX711 converts the samples of the
+ *  capture at their time, the sampler reads them from the pins and
+ *  FilamentWeight::readScale() filters them as on the real board. The
+ *  capture status is followed: the job starts with the run command
+ *  handler at the first reading of the capture made while running. The
+ *  motor state of the samples tells readScale() when the filament
+ *  moves; the regulator does not run, so the filament is never loose.\n
+ *  Every replay runs in a new process started from the board booted by
+ *  begin() with a set of parameters (replaytuning.h), no real time is
+ *  waited. A sweep shares the combinations among a process for every
+ *  processor. The replay counts the readings with the extruder pull
+ *  detected and, if the capture has the reference flags, matches them
+ *  with the reference pulls: a detection out of a pull (or
+ *  REPLAY_MATCH_WINDOW ms after its end) is a false trigger.\n
+ *  The samples are converted to the calibration of the replay board
+ *  when the capture has its own. The board tares the empty scale at the
+ *  boot, then the filter settles on the first sample before the replays.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _CAPTURE_REPLAY
+#define _CAPTURE_REPLAY
+
+#include "capturefile.h"
+#include "replaytuning.h"
+
+//! ms after the end of a reference pull a detection still belongs to it
+#define REPLAY_MATCH_WINDOW 500
+//! ms the board runs after the boot, the empty scale is tared
+#define REPLAY_BOOT_TIME 3000
+//! ms the board reads the first sample of the capture before the replay
+#define REPLAY_SETTLE_TIME 2000
+
+//! Results of a replay
+struct replayResult {
+  unsigned long readings;       ///< Readings made by readScale()
+  unsigned long detections;     ///< Readings with the extruder pull detected
+  unsigned long pulls;          ///< Reference pulls of the capture
+  unsigned long detected;       ///< Reference pulls with a detection
+  unsigned long falseTriggers;  ///< Detections out of the reference pulls
+  unsigned long lost;           ///< Samples not read by the sampler
+  double consumed;              ///< Consumption shown at the end (gr)
+};
+
+/**
+ * Replay of a capture with different parameters
+ */
+class CaptureReplay {
+
+  public:
+    CaptureReplay();
+
+    /**
+     * Boot the board the replays start from. Called once
+     *
+     * \param file the capture, mapped until the last replay
+     * \return false if the capture has no samples
+     */
+    bool begin(const CaptureFile* file);
+
+    /**
+     * Replay the capture
+     *
+     * \param values REPLAY_PARAMETERS values, NAN keeps the firmware one
+     * \return the results, no readings if the replay failed
+     */
+    replayResult run(const double* values);
+
+    /**
+     * Replay the capture with a set of parameter combinations, shared
+     * by processes replaying at the same time
+     *
+     * \param tunings REPLAY_PARAMETERS values for every combination
+     * \param count the number of combinations
+     * \param results the results of every combination
+     * \param workers the processes, 0 for one on every processor
+     */
+    void sweep(const double* tunings, unsigned long count, replayResult* results, int workers = 0);
+
+    /**
+     * Value of a parameter in the firmware
+     *
+     * \param id the parameter, REPLAY_MIN_TENSION ... REPLAY_RESOLUTION
+     */
+    static double firmwareValue(int id);
+
+    //! The capture has reference pulls
+    bool referenced;
+    //! Duration of the capture (s)
+    double seconds;
+
+  private:
+    /**
+     * Replay the capture in a new process
+     *
+     * \param values the parameters
+     * \param result shared memory receiving the results
+     */
+    void spawn(const double* values, replayResult* result);
+
+    //! Replay process
+    static int replayProcess(void* arg);
+
+    //! HX711 conversion of the next sample (SimHX711::replay)
+    static long replaySample(int ch, unsigned long long& next);
+
+    //! HX711 conversion of the first sample, at the HX711 rate
+    static long settleSample(int ch, unsigned long long& next);
+
+    //! Raw value of a sample on the replay board
+    long convert(long raw);
+
+    //! The capture
+    const CaptureFile* capture;
+    //! Parameters of the running replay
+    double tuning[REPLAY_PARAMETERS];
+    //! Results of run()
+    replayResult* shared;
+    //! Results written by the replay process
+    replayResult* target;
+    //! Capture counts of one gram, 0 to replay the raw values as they are
+    double calibration;
+    //! Board raw value with no weight
+    long boardOffset;
+    //! Board counts of one gram
+    double boardCalibration;
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ *  \file capturesweep.cpp
+ *  \brief Replay a capture file with every combination of a set of
+ *  parameter values (capturereplay.h)
+ *
+ *  capturesweep spool.cap tension=20:100:10 samples=5,10 gate=10\n
+ *  The parameters are tension (MIN_EXTRUDER_TENSION), gate
+ *  (MAX_DELTA_WEIGHT_IN_RANGE), samples (SCALE_SAMPLES) and resolution
+ *  (SCALE_RESOLUTION), as a list of values or a range from:to:step; a
+ *  parameter not given keeps the firmware value. A line is printed for
+ *  every combination: the readings, the pull detections and, if the
+ *  capture has the reference pulls, the pulls detected and the false
+ *  triggers, then the consumption shown at the end. The best combination
+ *  detects the most pulls with the least false triggers. The combinations
+ *  are replayed by a process for every processor.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "capturereplay.h"
+
+//! Names of the parameters on the command line, in REPLAY_* order
+static const char* names[REPLAY_PARAMETERS] = { "tension", "gate", "samples", "resolution" };
+
+/**
+ * Parse the values of a parameter
+ *
+ * \param text a list v1,v2,... or a range from:to:step
+ * \param values the values
+ * \return false if the text is not valid
+ */
+static bool parseValues(const char* text, std::vector<double>& values) {
+  double from, to, step, v;
+  char* end;
+
+  if(sscanf(text, "%lf:%lf:%lf", &from, &to, &step) == 3) {
+    if( (step <= 0) || (to < from) )
+      return false;
+    for(v = from; v <= to + step / 1000; v += step)
+      values.push_back(v);
+    return true;
+  }
+  for(;;) {
+    values.push_back(strtod(text, &end));
+    if(end == text)
+      return false;
+    if(*end == 0)
+      return true;
+    if(*end != ',')
+      return false;
+    text = end + 1;
+  }
+}
+
+int main(int argc, char** argv) {
+  std::vector<double> values[REPLAY_PARAMETERS], tunings;
+  std::vector<replayResult> results;
+  size_t position[REPLAY_PARAMETERS] = { 0 };
+  CaptureFile capture;
+  CaptureReplay replay;
+  long j, best = -1, score, bestScore = 0;
+  unsigned long combinations;
+  const char* equal;
+  int k;
+
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <capture file> [tension|gate|samples|resolution=<v1,v2,...|from:to:step>]...\n",
+            argv[0]);
+    return 2;
+  }
+  for(j = 2; j < argc; j++) {
+    equal = strchr(argv[j], '=');
+    for(k = 0; k < REPLAY_PARAMETERS; k++) {
+      if( (equal != NULL) && (strncmp(argv[j], names[k], equal - argv[j]) == 0) &&
+          (names[k][equal - argv[j]] == 0) )
+        break;
+    }
+    if( (k == REPLAY_PARAMETERS) || !values[k].empty() || !parseValues(equal + 1, values[k]) ) {
+      fprintf(stderr, "%s: parameter not valid\n", argv[j]);
+      return 2;
+    }
+  }
+  if(!capture.open(argv[1])) {
+    fprintf(stderr, "%s: not a capture file\n", argv[1]);
+    return 1;
+  }
+  if(!replay.begin(&capture)) {
+    fprintf(stderr, "%s: no samples\n", argv[1]);
+    return 1;
+  }
+  for(k = 0; k < REPLAY_PARAMETERS; k++) {
+    if(values[k].empty())
+      values[k].push_back(CaptureReplay::firmwareValue(k));
+  }
+
+  printf("%lu samples, %.1f s, channel %d, %s\n", capture.count, replay.seconds,
+         capture.header->channel, replay.referenced ? "reference pulls" : "no reference pulls");
+  // Every combination of the values
+  for(;;) {
+    for(k = 0; k < REPLAY_PARAMETERS; k++)
+      tunings.push_back(values[k][position[k]]);
+    for(k = 0; k < REPLAY_PARAMETERS; k++) {
+      if(++position[k] < values[k].size())
+        break;
+      position[k] = 0;
+    }
+    if(k == REPLAY_PARAMETERS)
+      break;
+  }
+  combinations = tunings.size() / REPLAY_PARAMETERS;
+  results.resize(combinations);
+
+  auto start = std::chrono::steady_clock::now();
+  replay.sweep(tunings.data(), combinations, results.data());
+  auto end = std::chrono::steady_clock::now();
+
+  printf("%8s %8s %8s %10s %8s %8s %8s %8s %10s\n", "tension", "gate", "samples", "resolution",
+         "readings", "detect", "pulls", "false", "consumed");
+  for(j = 0; j < (long)combinations; j++) {
+    const double* tuning = &tunings[j * REPLAY_PARAMETERS];
+    const replayResult& result = results[j];
+
+    if(result.readings == 0)
+      printf("%8g %8g %8g %10g replay failed\n", tuning[0], tuning[1], tuning[2], tuning[3]);
+    else if(replay.referenced)
+      printf("%8g %8g %8g %10g %8lu %8lu %4lu/%-3lu %8lu %10.2f\n", tuning[0], tuning[1], tuning[2],
+             tuning[3], result.readings, result.detections, result.detected, result.pulls,
+             result.falseTriggers, result.consumed);
+    else
+      printf("%8g %8g %8g %10g %8lu %8lu %8s %8s %10.2f\n", tuning[0], tuning[1], tuning[2],
+             tuning[3], result.readings, result.detections, "-", "-", result.consumed);
+
+    score = (long)result.detected - (long)result.falseTriggers;
+    if( (result.readings > 0) && ((best < 0) || (score > bestScore)) ) {
+      best = j;
+      bestScore = score;
+    }
+  }
+
+  printf("%lu combinations in %.2f s\n", combinations,
+         std::chrono::duration<double>(end - start).count());
+  if(replay.referenced && (best >= 0))
+    printf("best: tension %g gate %g samples %g resolution %g\n", tunings[best * REPLAY_PARAMETERS],
+           tunings[best * REPLAY_PARAMETERS + 1], tunings[best * REPLAY_PARAMETERS + 2],
+           tunings[best * REPLAY_PARAMETERS + 3]);
+  return 0;
+}
@@ -0,0 +1,83 @@
+/**
+ *  \file fleetd.cpp
+ *  \brief Daemon monitoring many dispensers (fleetmonitor.h)
+ *
+ *  fleetd [-p ms] [-s snapshot] [-q socket] /dev/ttyUSB0 /dev/ttyUSB1 ...\n
+ *  Every port is a dispenser, the status lines are requested every
+ *  -p ms (FLEET_PERIOD by default). The snapshot is the shared memory
+ *  object read by fleetstat (FLEET_SNAPSHOT_NAME by default), the query
+ *  socket is created only with -q, e.g. queried by
+ *  echo totals | nc -U /run/fleetd.sock. The daemon runs in the
+ *  foreground until SIGINT or SIGTERM, then removes the snapshot and
+ *  the socket.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include "fleetmonitor.h"
+
+//! Set by the signals ending the daemon
+static volatile sig_atomic_t stopped = 0;
+
+static void stop(int) {
+  stopped = 1;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> ports;
+  const char* snapshot = FLEET_SNAPSHOT_NAME;
+  const char* socket = NULL;
+  unsigned long period = FLEET_PERIOD;
+  FleetMonitor monitor;
+  struct sigaction action = {};
+  int option;
+
+  while( (option = getopt(argc, argv, "p:s:q:")) != -1 ) {
+    switch(option) {
+      case 'p':
+        period = strtoul(optarg, NULL, 10);
+        break;
+      case 's':
+        snapshot = optarg;
+        break;
+      case 'q':
+        socket = optarg;
+        break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if( (optind >= argc) || (period == 0) ) {
+    fprintf(stderr, "usage: %s [-p ms] [-s snapshot] [-q socket] <port>...\n", argv[0]);
+    return 2;
+  }
+  for(; optind < argc; optind++)
+    ports.push_back(argv[optind]);
+
+  action.sa_handler = stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  if(!monitor.begin(ports, period, snapshot, socket)) {
+    perror("fleetd");
+    return 1;
+  }
+  fprintf(stderr, "%lu ports, status every %lu ms, snapshot %s\n", (unsigned long)ports.size(),
+          period, snapshot);
+
+  while(!stopped)
+    monitor.poll();
+
+  fprintf(stderr, "%llu lines, %llu not valid, %llu bytes, %lu queries\n", monitor.lines,
+          monitor.errors, monitor.bytes, monitor.queries);
+  monitor.end();
+  return 0;
+}
@@ -0,0 +1,654 @@
+/**
+ *  \file fleetmonitor.cpp
+ *  \brief Monitor of many dispensers, every one on its own serial port
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "fleetmonitor.h"
+
+// Sources of the epoll events, in the high word of the event data
+#define FLEET_SOURCE_PORT 1     ///< A serial port, the index in the low word
+#define FLEET_SOURCE_LISTENER 2 ///< The query socket
+#define FLEET_SOURCE_CLIENT 3   ///< A client, the slot in the low word
+
+//! Names of the device states in the query answers
+static const char* stateNames[] = { "closed", "starting", "streaming", "stale" };
+
+unsigned long long fleetNow(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//! Event data of a source
+static uint64_t source(int kind, int index) {
+  return ((uint64_t)kind << 32) | (uint32_t)index;
+}
+
+FleetMonitor::FleetMonitor() {
+  int c;
+
+  lines = errors = bytes = 0;
+  queries = 0;
+  epoll = listener = -1;
+  period = FLEET_PERIOD;
+  checked = 0;
+  totalsChanged = false;
+  header = NULL;
+  size = 0;
+  for(c = 0; c < FLEET_CLIENTS_MAX; c++)
+    clients[c].fd = -1;
+}
+
+FleetMonitor::~FleetMonitor() {
+  end();
+}
+
+bool FleetMonitor::begin(const std::vector<std::string>& paths, unsigned long ms,
+                         const char* snapshot, const char* socket) {
+  struct epoll_event event;
+  struct sockaddr_un address;
+  void* area;
+  size_t j;
+  int fd;
+
+  end();
+  period = ms;
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll < 0)
+    return false;
+
+  // The snapshot, every device closed
+  snapshotName = snapshot;
+  size = fleetSnapshotSize(paths.size());
+  fd = shm_open(snapshot, O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if(fd < 0) {
+    end();
+    return false;
+  }
+  if(ftruncate(fd, size) < 0) {
+    ::close(fd);
+    end();
+    return false;
+  }
+  area = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(area == MAP_FAILED) {
+    end();
+    return false;
+  }
+  header = (fleetSnapshotHeader*)area;
+  header->version = FLEET_SNAPSHOT_VERSION;
+  header->deviceSize = sizeof(fleetDevice);
+  header->devices = paths.size();
+  header->period = period;
+  header->totals.minPct = 100;
+  header->totals.minDevice = -1;
+  ports.resize(paths.size());
+  for(j = 0; j < paths.size(); j++) {
+    fleetDevice& d = device(j);
+    int k;
+
+    ports[j].path = paths[j];
+    ports[j].fd = -1;
+    ports[j].length = 0;
+    ports[j].requests = 0;
+    ports[j].changed = ports[j].seen = 0;
+    strncpy(d.path, paths[j].c_str(), FLEET_PATH_SIZE - 1);
+    d.state = FLEET_DEVICE_CLOSED;
+    for(k = 0; k < FLEET_CHANNELS; k++) {
+      d.channel[k].state = -1;
+      d.channel[k].tte = -1;
+    }
+  }
+  // The readers check the magic number last
+  __atomic_store_n(&header->magic, FLEET_SNAPSHOT_MAGIC, __ATOMIC_RELEASE);
+
+  if(socket != NULL) {
+    socketPath = socket;
+    if(strlen(socket) >= sizeof(address.sun_path)) {
+      end();
+      return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket);
+    unlink(socket);
+    listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if( (listener < 0) || (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0) ||
+        (listen(listener, FLEET_CLIENTS_MAX) < 0) ) {
+      end();
+      return false;
+    }
+    event.events = EPOLLIN;
+    event.data.u64 = source(FLEET_SOURCE_LISTENER, 0);
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+  }
+
+  for(j = 0; j < ports.size(); j++)
+    openPort(j);
+  checked = fleetNow();
+  updateTotals();
+  return true;
+}
+
+void FleetMonitor::end(void) {
+  size_t j;
+  int c;
+
+  for(c = 0; c < FLEET_CLIENTS_MAX; c++) {
+    if(clients[c].fd >= 0)
+      closeClient(c);
+  }
+  for(j = 0; j < ports.size(); j++) {
+    if(ports[j].fd >= 0)
+      ::close(ports[j].fd);
+  }
+  ports.clear();
+  if(listener >= 0) {
+    ::close(listener);
+    unlink(socketPath.c_str());
+  }
+  listener = -1;
+  socketPath.clear();
+  if(header != NULL) {
+    munmap(header, size);
+    shm_unlink(snapshotName.c_str());
+  }
+  header = NULL;
+  size = 0;
+  if(epoll >= 0)
+    ::close(epoll);
+  epoll = -1;
+}
+
+int FleetMonitor::poll(int timeout) {
+  struct epoll_event events[FLEET_EVENTS];
+  int count, j, index, processed = 0;
+  unsigned long long now;
+
+  count = epoll_wait(epoll, events, FLEET_EVENTS, timeout);
+  for(j = 0; j < count; j++) {
+    index = (int)(events[j].data.u64 & 0xFFFFFFFF);
+    switch(events[j].data.u64 >> 32) {
+      case FLEET_SOURCE_PORT:
+        // The port can be closed by an event of the same wait
+        if(ports[index].fd >= 0)
+          processed += readPort(index);
+        break;
+      case FLEET_SOURCE_LISTENER:
+        acceptClients();
+        break;
+      case FLEET_SOURCE_CLIENT:
+        if(clients[index].fd >= 0)
+          serve(index, (events[j].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0);
+        break;
+    }
+  }
+
+  now = fleetNow();
+  if(now - checked >= FLEET_CHECK_TIME * 1000000ULL) {
+    checked = now;
+    checkTimers();
+  }
+  if( (processed > 0) || totalsChanged )
+    updateTotals();
+  return processed;
+}
+
+void FleetMonitor::openPort(int j) {
+  fleetPort& p = ports[j];
+  struct epoll_event event;
+  struct termios options;
+
+  p.changed = fleetNow();
+  p.fd = open(p.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if(p.fd < 0)
+    return;
+  // Raw characters at the baud rate of the board, the port can also be
+  // a pipe or a pseudo terminal
+  if(tcgetattr(p.fd, &options) == 0) {
+    cfmakeraw(&options);
+    cfsetispeed(&options, B38400);
+    cfsetospeed(&options, B38400);
+    options.c_cflag |= CLOCAL | CREAD;
+    options.c_cc[VMIN] = 1;
+    options.c_cc[VTIME] = 0;
+    tcsetattr(p.fd, TCSANOW, &options);
+    tcflush(p.fd, TCIFLUSH);
+  }
+  event.events = EPOLLIN;
+  event.data.u64 = source(FLEET_SOURCE_PORT, j);
+  epoll_ctl(epoll, EPOLL_CTL_ADD, p.fd, &event);
+  p.length = 0;
+  p.requests = 0;
+  setState(j, FLEET_DEVICE_STARTING);
+  request(j);
+}
+
+void FleetMonitor::closePort(int j) {
+  fleetPort& p = ports[j];
+
+  epoll_ctl(epoll, EPOLL_CTL_DEL, p.fd, NULL);
+  ::close(p.fd);
+  p.fd = -1;
+  p.changed = fleetNow();
+  setState(j, FLEET_DEVICE_CLOSED);
+}
+
+void FleetMonitor::request(int j) {
+  fleetPort& p = ports[j];
+  fleetDevice& d = device(j);
+  char command[32];
+  int length;
+
+  length = snprintf(command, sizeof(command), "mstat %lu\n", period);
+  p.requests++;
+  p.changed = fleetNow();
+  // A request not sent counts as one with no answer
+  if(write(p.fd, command, length) < 0)
+    return;
+  beginWrite(d);
+  d.connects++;
+  endWrite(d);
+}
+
+int FleetMonitor::readPort(int j) {
+  fleetPort& p = ports[j];
+  char data[512];
+  ssize_t count, k;
+  int processed = 0;
+  char c;
+
+  for(;;) {
+    count = read(p.fd, data, sizeof(data));
+    if( (count < 0) && (errno == EINTR) )
+      continue;
+    if( (count < 0) && (errno == EAGAIN) )
+      break;
+    if(count <= 0) {
+      // The device is gone, e.g. the adapter has been unplugged
+      closePort(j);
+      break;
+    }
+    bytes += count;
+
+    for(k = 0; k < count; k++) {
+      c = data[k];
+      if(c == '\n') {
+        if(p.length > 0) {
+          if(p.line[p.length - 1] == '\r')
+            p.length--;
+          p.line[p.length] = 0;
+          if(parseLine(j, p.line))
+            processed++;
+        }
+        p.length = 0;
+      }
+      // A telemetry frame delimiter, the bytes before it are not a line
+      else if(c == 0)
+        p.length = 0;
+      else if(p.length < 0)
+        continue;
+      else if(p.length == FLEET_LINE_MAX - 1) {
+        if(p.line[0] == '@') {
+          fleetDevice& d = device(j);
+
+          errors++;
+          beginWrite(d);
+          d.errors++;
+          endWrite(d);
+        }
+        p.length = -1;
+      }
+      else
+        p.line[p.length++] = c;
+    }
+    // Nothing left to read
+    if(count < (ssize_t)sizeof(data))
+      break;
+  }
+  return processed;
+}
+
+bool FleetMonitor::parseLine(int j, char* line) {
+  static const int STAT = 1, FAULT = 2, RUNOUT = 3;
+  fleetPort& p = ports[j];
+  fleetDevice& d = device(j);
+  fleetChannel c;
+  char* save;
+  char* token;
+  char* value;
+  long ch = -1, newFaults = -1, faults = -1;
+  bool timed = false;
+  int kind;
+
+  if(strncmp(line, "@stat ", 6) == 0)
+    kind = STAT;
+  else if(strncmp(line, "@fault ", 7) == 0)
+    kind = FAULT;
+  else if(strncmp(line, "@runout ", 8) == 0)
+    kind = RUNOUT;
+  else
+    return false;
+
+  // Fields key=value, the unknown ones are skipped
+  memset(&c, 0, sizeof(c));
+  c.state = -1;
+  c.tte = -1;
+  token = strtok_r(line, " ", &save);
+  while( (token = strtok_r(NULL, " ", &save)) != NULL ) {
+    value = strchr(token, '=');
+    if(value == NULL)
+      continue;
+    *value++ = 0;
+    if(strcmp(token, "ch") == 0)
+      ch = strtol(value, NULL, 10);
+    else if(strcmp(token, "t") == 0) {
+      c.t = strtoul(value, NULL, 10);
+      timed = true;
+    }
+    else if(strcmp(token, "state") == 0)
+      c.state = strtol(value, NULL, 10);
+    else if(strcmp(token, "net") == 0)
+      c.net = strtof(value, NULL);
+    else if(strcmp(token, "used") == 0)
+      c.used = strtof(value, NULL);
+    else if(strcmp(token, "pct") == 0)
+      c.pct = strtof(value, NULL);
+    else if(strcmp(token, "rate") == 0)
+      c.rate = strtof(value, NULL);
+    else if(strcmp(token, "pull") == 0)
+      c.pull = strtol(value, NULL, 10) != 0;
+    else if(strcmp(token, "drift") == 0)
+      c.drift = strtof(value, NULL);
+    else if(strcmp(token, "tte") == 0)
+      c.tte = strtol(value, NULL, 10);
+    else if(strcmp(token, "endleft") == 0)
+      c.endLeft = strtof(value, NULL);
+    else if(strcmp(token, "duty") == 0)
+      c.duty = strtol(value, NULL, 10);
+    else if(strcmp(token, "motion") == 0)
+      c.motion = strtol(value, NULL, 10);
+    else if(strcmp(token, "new") == 0)
+      newFaults = strtol(value, NULL, 16);
+    else if(strcmp(token, "faults") == 0)
+      faults = c.faults = strtol(value, NULL, 16);
+  }
+
+  beginWrite(d);
+  if( !timed || ((kind == STAT) && (c.state < 0)) ||
+      ((kind != FAULT) && ((ch < 0) || (ch >= FLEET_CHANNELS))) ||
+      ((kind == FAULT) && ((newFaults < 0) || (faults < 0))) ) {
+    d.errors++;
+    endWrite(d);
+    errors++;
+    return false;
+  }
+  c.updated = fleetNow();
+  switch(kind) {
+    case STAT:
+      d.channel[ch] = c;
+      if(ch >= d.channels)
+        d.channels = ch + 1;
+      d.faults = c.faults;
+      break;
+    case FAULT:
+      d.faults = faults;
+      d.faultEvents++;
+      break;
+    case RUNOUT:
+      d.channel[ch].tte = c.tte;
+      d.channel[ch].endLeft = c.endLeft;
+      d.runouts++;
+      break;
+  }
+  d.lines++;
+  d.updated = c.updated;
+  if(d.state != FLEET_DEVICE_STREAMING) {
+    d.state = FLEET_DEVICE_STREAMING;
+    totalsChanged = true;
+  }
+  endWrite(d);
+
+  p.seen = c.updated;
+  p.requests = 0;
+  lines++;
+  return true;
+}
+
+void FleetMonitor::checkTimers(void) {
+  unsigned long long now = fleetNow();
+  unsigned long long stale;
+  size_t j;
+
+  stale = (period > FLEET_MIN_PERIOD) ? period : FLEET_MIN_PERIOD;
+  stale *= FLEET_STALE_PERIODS * 1000000ULL;
+  for(j = 0; j < ports.size(); j++) {
+    fleetPort& p = ports[j];
+
+    if(p.fd < 0) {
+      if(now - p.changed >= FLEET_REOPEN_TIME * 1000000ULL)
+        openPort(j);
+    }
+    else if(device(j).state == FLEET_DEVICE_STREAMING) {
+      if(now - p.seen >= stale) {
+        setState(j, FLEET_DEVICE_STALE);
+        request(j);
+      }
+    }
+    else if(now - p.changed >= stale) {
+      // The device does not answer, the port is opened again
+      if(p.requests >= FLEET_STALE_RETRIES)
+        closePort(j);
+      else
+        request(j);
+    }
+  }
+}
+
+void FleetMonitor::updateTotals(void) {
+  fleetTotals totals;
+  size_t j;
+  int k;
+
+  memset(&totals, 0, sizeof(totals));
+  totals.minPct = 100;
+  totals.minDevice = -1;
+  for(j = 0; j < ports.size(); j++) {
+    const fleetDevice& d = device(j);
+
+    totals.faultEvents += d.faultEvents;
+    if(d.state != FLEET_DEVICE_STREAMING)
+      continue;
+    totals.streaming++;
+    if(d.faults != 0)
+      totals.faulty++;
+    for(k = 0; k < d.channels; k++) {
+      const fleetChannel& c = d.channel[k];
+
+      if(c.state != FLEET_STAT_RUN)
+        continue;
+      totals.running++;
+      totals.used += c.used;
+      totals.rate += c.rate;
+      if(c.pct < totals.minPct) {
+        totals.minPct = c.pct;
+        totals.minDevice = j;
+      }
+    }
+  }
+
+  __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  header->totals = totals;
+  __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELEASE);
+  totalsChanged = false;
+}
+
+void FleetMonitor::beginWrite(fleetDevice& d) {
+  __atomic_store_n(&d.sequence, d.sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void FleetMonitor::endWrite(fleetDevice& d) {
+  __atomic_store_n(&d.sequence, d.sequence + 1, __ATOMIC_RELEASE);
+}
+
+void FleetMonitor::setState(int j, int state) {
+  fleetDevice& d = device(j);
+
+  if(d.state == state)
+    return;
+  beginWrite(d);
+  d.state = state;
+  endWrite(d);
+  totalsChanged = true;
+}
+
+void FleetMonitor::acceptClients(void) {
+  struct epoll_event event;
+  int fd, c;
+
+  while( (fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0 ) {
+    for(c = 0; (c < FLEET_CLIENTS_MAX) && (clients[c].fd >= 0); c++)
+      ;
+    if(c == FLEET_CLIENTS_MAX) {
+      ::close(fd);
+      continue;
+    }
+    clients[c].fd = fd;
+    clients[c].input.clear();
+    clients[c].output.clear();
+    event.events = EPOLLIN;
+    event.data.u64 = source(FLEET_SOURCE_CLIENT, c);
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+  }
+}
+
+void FleetMonitor::serve(int c, bool readable) {
+  fleetClient& client = clients[c];
+  struct epoll_event event;
+  char data[256];
+  ssize_t count;
+  size_t end;
+
+  while(readable) {
+    count = read(client.fd, data, sizeof(data));
+    if( (count < 0) && (errno == EINTR) )
+      continue;
+    if( (count < 0) && (errno == EAGAIN) )
+      break;
+    if(count <= 0) {
+      closeClient(c);
+      return;
+    }
+    client.input.append(data, count);
+  }
+  while( (end = client.input.find('\n')) != std::string::npos ) {
+    client.input[end] = 0;
+    if( (end > 0) && (client.input[end - 1] == '\r') )
+      client.input[end - 1] = 0;
+    client.output += query(client.input.c_str());
+    client.input.erase(0, end + 1);
+  }
+  if(client.input.size() > FLEET_LINE_MAX) {
+    closeClient(c);
+    return;
+  }
+
+  if(!client.output.empty()) {
+    count = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+    if( (count < 0) && (errno != EAGAIN) ) {
+      closeClient(c);
+      return;
+    }
+    if(count > 0)
+      client.output.erase(0, count);
+  }
+  // The rest of the answer is sent when the socket is writable
+  event.events = EPOLLIN | (client.output.empty() ? 0 : EPOLLOUT);
+  event.data.u64 = source(FLEET_SOURCE_CLIENT, c);
+  epoll_ctl(epoll, EPOLL_CTL_MOD, client.fd, &event);
+}
+
+void FleetMonitor::closeClient(int c) {
+  epoll_ctl(epoll, EPOLL_CTL_DEL, clients[c].fd, NULL);
+  ::close(clients[c].fd);
+  clients[c].fd = -1;
+  clients[c].input.clear();
+  clients[c].output.clear();
+}
+
+std::string FleetMonitor::query(const char* command) {
+  const fleetTotals& totals = header->totals;
+  unsigned long long now = fleetNow();
+  std::string answer;
+  char line[256];
+  char* end;
+  size_t j;
+  long n;
+  int k;
+
+  queries++;
+  if(strcmp(command, "totals") == 0) {
+    snprintf(line, sizeof(line),
+             "devices=%u streaming=%u running=%u used=%.2f rate=%.4f minpct=%.1f mindev=%d "
+             "faults=%u faulty=%u\n", header->devices, totals.streaming, totals.running,
+             totals.used, totals.rate, totals.minPct, totals.minDevice, totals.faultEvents,
+             totals.faulty);
+    answer = line;
+  }
+  else if(strcmp(command, "devices") == 0) {
+    for(j = 0; j < ports.size(); j++) {
+      const fleetDevice& d = device(j);
+
+      snprintf(line, sizeof(line), "%u %s state=%s ch=%d lines=%u errors=%u faults=%X events=%u\n",
+               (unsigned int)j, d.path, stateNames[d.state], d.channels, d.lines, d.errors,
+               d.faults, d.faultEvents);
+      answer += line;
+    }
+  }
+  else if( (strncmp(command, "device ", 7) == 0) &&
+           ((n = strtol(command + 7, &end, 10)) >= 0) && (*end == 0) && (end != command + 7) &&
+           (n < (long)ports.size()) ) {
+    const fleetDevice& d = device(n);
+
+    snprintf(line, sizeof(line), "%ld %s state=%s connects=%u runouts=%u\n", n, d.path,
+             stateNames[d.state], d.connects, d.runouts);
+    answer = line;
+    for(k = 0; k < d.channels; k++) {
+      const fleetChannel& c = d.channel[k];
+
+      if(c.state < 0)
+        continue;
+      snprintf(line, sizeof(line),
+               "ch=%d t=%u state=%d net=%.2f used=%.2f pct=%.1f rate=%.4f pull=%d drift=%.2f "
+               "tte=%d endleft=%.2f duty=%d motion=%d faults=%X age=%llu\n", k, c.t, c.state,
+               c.net, c.used, c.pct, c.rate, c.pull, c.drift, c.tte, c.endLeft, c.duty, c.motion,
+               c.faults, (now - c.updated) / 1000000ULL);
+      answer += line;
+    }
+  }
+  else
+    answer = "error: unknown command, totals, devices or device <n>\n";
+  return answer + "\n";
+}
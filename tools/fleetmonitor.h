@@ -0,0 +1,190 @@
+/**
+ *  \file fleetmonitor.h
+ *  \brief Monitor of many dispensers, every one on its own serial port
+ *
+ *  The ports are opened at 38400 baud and multiplexed by a single epoll
+ *  loop with the query socket. Every port has its state machine
+ *  (FLEET_DEVICE_*): when it is open the monitor requests the machine
+ *  readable stream with "mstat <period>" and parses the \@stat, \@fault
+ *  and \@runout lines; the text messages of the firmware (showStat(),
+ *  showInfo() and the others) are skipped, as the bytes of the binary
+ *  telemetry frames. A device with no line for FLEET_STALE_PERIODS is
+ *  stale and the stream is requested again; after FLEET_STALE_RETRIES
+ *  requests with no answer, or an error of the port (e.g. the USB
+ *  adapter unplugged), the port is closed and opened again every
+ *  FLEET_REOPEN_TIME ms.\n
+ *  Every line updates the record of its device in the shared memory
+ *  snapshot (fleetsnapshot.h), the totals are updated once for all the
+ *  lines read by a poll. The query socket is a local stream socket: a
+ *  client sends a command a line, the answer is a block of lines
+ *  ended by an empty line:
+ *  - totals: the totals of the fleet
+ *  - devices: a line for every device
+ *  - device <n>: the last status line of every channel of a device
+ *
+ *  The library does not depend on the firmware sources.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _FLEET_MONITOR
+#define _FLEET_MONITOR
+
+#include <string>
+#include <vector>
+#include "fleetsnapshot.h"
+
+//! Status ID of a channel running a job (STAT_RUN of filament.h)
+#define FLEET_STAT_RUN 3
+//! ms of the status lines requested by default
+#define FLEET_PERIOD 1000
+//! Shortest period of a device with all the channels (MSTAT_MIN_PERIOD of filament.h)
+#define FLEET_MIN_PERIOD 600
+//! Periods with no line before a device is stale
+#define FLEET_STALE_PERIODS 3
+//! Requests of the stream with no answer before the port is closed
+#define FLEET_STALE_RETRIES 3
+//! ms between two attempts to open a closed port
+#define FLEET_REOPEN_TIME 1000
+//! ms between two checks of the device timers
+#define FLEET_CHECK_TIME 100
+//! Longest line, the longer ones are skipped
+#define FLEET_LINE_MAX 192
+//! Clients of the query socket at the same time
+#define FLEET_CLIENTS_MAX 16
+//! Events read by an epoll_wait()
+#define FLEET_EVENTS 64
+
+/**
+ * Monitor of the dispensers
+ */
+class FleetMonitor {
+
+  public:
+    FleetMonitor();
+    ~FleetMonitor();
+
+    /**
+     * Create the snapshot and the query socket, open the ports
+     *
+     * \param paths the serial ports, a port that can not be opened is
+     * retried later
+     * \param ms period of the status lines
+     * \param snapshot the shared memory object
+     * \param socket the path of the query socket, NULL for none
+     * \return false if the snapshot or the socket can not be created
+     */
+    bool begin(const std::vector<std::string>& paths, unsigned long ms = FLEET_PERIOD,
+               const char* snapshot = FLEET_SNAPSHOT_NAME, const char* socket = NULL);
+
+    /**
+     * Wait for the ports and the clients, then process what they sent
+     *
+     * \param timeout ms to wait at most, -1 for no limit
+     * \return the machine readable lines processed
+     */
+    int poll(int timeout = FLEET_CHECK_TIME);
+
+    //! Close the ports, remove the snapshot and the socket
+    void end(void);
+
+    /**
+     * Answer a command of the query socket
+     *
+     * \param command totals, devices or device <n>
+     * \return the answer, ended by an empty line
+     */
+    std::string query(const char* command);
+
+    //! Machine readable lines processed
+    unsigned long long lines;
+    //! Lines not valid or too long
+    unsigned long long errors;
+    //! Bytes read from the ports
+    unsigned long long bytes;
+    //! Commands of the query socket
+    unsigned long queries;
+
+  private:
+    //! State of a serial port
+    struct fleetPort {
+      std::string path;         ///< The port
+      int fd;                   ///< -1 if closed
+      char line[FLEET_LINE_MAX];  ///< Line being received
+      int length;               ///< Characters of the line, -1 while skipping a long one
+      int requests;             ///< Stream requests with no answer
+      unsigned long long changed;  ///< ns of the last state change or request
+      unsigned long long seen;  ///< ns of the last machine readable line
+    };
+
+    //! Client of the query socket
+    struct fleetClient {
+      int fd;                   ///< -1 if the slot is free
+      std::string input;        ///< Command being received
+      std::string output;       ///< Answer not sent yet
+    };
+
+    //! Open a port and request the stream
+    void openPort(int j);
+    //! Close a port after an error
+    void closePort(int j);
+    //! Send the stream request to a port
+    void request(int j);
+    //! Read the bytes of a port, return the lines processed
+    int readPort(int j);
+    //! Parse a complete line of a port, return false if it is not machine readable
+    bool parseLine(int j, char* line);
+    //! Move the devices through the states with no line in time
+    void checkTimers(void);
+    //! Update the totals of the snapshot
+    void updateTotals(void);
+
+    //! Accept the clients of the socket
+    void acceptClients(void);
+    //! Read the commands of a client and send the answers
+    void serve(int c, bool readable);
+    //! Close the connection of a client
+    void closeClient(int c);
+
+    //! Start writing a device record of the snapshot
+    void beginWrite(fleetDevice& device);
+    //! End writing a device record of the snapshot
+    void endWrite(fleetDevice& device);
+    //! Change the state of a device
+    void setState(int j, int state);
+
+    //! Device record of the snapshot
+    fleetDevice& device(int j) {
+      return ((fleetDevice*)(header + 1))[j];
+    }
+
+    std::vector<fleetPort> ports;
+    fleetClient clients[FLEET_CLIENTS_MAX];
+    //! The epoll instance
+    int epoll;
+    //! The query socket, -1 if none
+    int listener;
+    //! ms of the status lines
+    unsigned long period;
+    //! ns of the last timer check
+    unsigned long long checked;
+    //! The totals have to be updated
+    bool totalsChanged;
+    //! The snapshot
+    fleetSnapshotHeader* header;
+    //! Snapshot bytes
+    size_t size;
+    //! Shared memory object name
+    std::string snapshotName;
+    //! Query socket path
+    std::string socketPath;
+};
+
+//! CLOCK_MONOTONIC time (ns)
+unsigned long long fleetNow(void);
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ *  \file fleetsnapshot.cpp
+ *  \brief Shared memory snapshot of the dispensers read by the fleet
+ *  monitor (fleetmonitor.h)
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fleetsnapshot.h"
+
+/**
+ * Copy a record written by the monitor
+ *
+ * \param sequence the sequence of the record
+ * \param copy the copy
+ * \param record the record
+ * \param size its bytes
+ * \return the retries
+ */
+static unsigned int readRecord(const uint32_t* sequence, void* copy, const void* record,
+                               size_t size) {
+  unsigned int retries = 0;
+  uint32_t before;
+
+  for(;;) {
+    before = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+    if( (before & 1) == 0 ) {
+      memcpy(copy, record, size);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if(__atomic_load_n(sequence, __ATOMIC_RELAXED) == before)
+        return retries;
+    }
+    // The monitor can be waiting for the processor in the middle of
+    // the write
+    if(++retries % FLEET_READ_SPINS == 0)
+      sched_yield();
+  }
+}
+
+FleetSnapshot::FleetSnapshot() {
+  devices = 0;
+  period = 0;
+  header = NULL;
+  size = 0;
+}
+
+FleetSnapshot::~FleetSnapshot() {
+  close();
+}
+
+bool FleetSnapshot::open(const char* name) {
+  struct stat info;
+  void* area;
+  int fd;
+
+  close();
+  fd = shm_open(name, O_RDONLY, 0);
+  if(fd < 0)
+    return false;
+  if( (fstat(fd, &info) < 0) || ((size_t)info.st_size < sizeof(fleetSnapshotHeader)) ) {
+    ::close(fd);
+    return false;
+  }
+  area = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(area == MAP_FAILED)
+    return false;
+  header = (const fleetSnapshotHeader*)area;
+  size = info.st_size;
+  if( (header->magic != FLEET_SNAPSHOT_MAGIC) || (header->version != FLEET_SNAPSHOT_VERSION) ||
+      (header->deviceSize != sizeof(fleetDevice)) || (fleetSnapshotSize(header->devices) > size) ) {
+    close();
+    return false;
+  }
+  devices = header->devices;
+  period = header->period;
+  return true;
+}
+
+void FleetSnapshot::close(void) {
+  if(header != NULL)
+    munmap((void*)header, size);
+  header = NULL;
+  size = 0;
+  devices = 0;
+}
+
+bool FleetSnapshot::read(uint32_t j, fleetDevice& device, unsigned int* retries) const {
+  const fleetDevice* record;
+  unsigned int count;
+
+  if( (header == NULL) || (j >= devices) )
+    return false;
+  record = (const fleetDevice*)(header + 1) + j;
+  count = readRecord(&record->sequence, &device, record, sizeof(fleetDevice));
+  if(retries != NULL)
+    *retries = count;
+  return true;
+}
+
+bool FleetSnapshot::read(fleetTotals& totals, unsigned int* retries) const {
+  unsigned int count;
+
+  if(header == NULL)
+    return false;
+  count = readRecord(&header->sequence, &totals, &header->totals, sizeof(fleetTotals));
+  if(retries != NULL)
+    *retries = count;
+  return true;
+}
@@ -0,0 +1,162 @@
+/**
+ *  \file fleetsnapshot.h
+ *  \brief Shared memory snapshot of the dispensers read by the fleet
+ *  monitor (fleetmonitor.h)
+ *
+ *  The snapshot is a POSIX shared memory object: a fleetSnapshotHeader
+ *  with the totals of the fleet followed by a fleetDevice for every
+ *  serial port, in the order of the monitor command line. The monitor
+ *  is the only writer. Every device and the totals have their own
+ *  sequence number, odd while the monitor writes them: a reader copies
+ *  the record and retries if the sequence was odd or has changed, so
+ *  it never waits for the monitor nor sees a record half written.\n
+ *  The fields are the ones of the \@stat and \@fault lines of the mstat
+ *  command (commands.h), the library does not depend on the firmware
+ *  sources.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _FLEET_SNAPSHOT
+#define _FLEET_SNAPSHOT
+
+#include <stdint.h>
+#include <stddef.h>
+
+//! "FDFL" at the start of the snapshot
+#define FLEET_SNAPSHOT_MAGIC 0x4C464446u
+//! Version of the layout
+#define FLEET_SNAPSHOT_VERSION 1
+//! Shared memory object of the monitor by default
+#define FLEET_SNAPSHOT_NAME "/fleetd"
+//! Channels of a device, CHANNELS_MAX of the firmware
+#define FLEET_CHANNELS 6
+//! Size of the port path, with the terminator
+#define FLEET_PATH_SIZE 64
+//! Retries of a read before the reader leaves the processor to the monitor
+#define FLEET_READ_SPINS 100
+
+// Connection states of a device
+#define FLEET_DEVICE_CLOSED 0     ///< The port is not open, retried every FLEET_REOPEN_TIME
+#define FLEET_DEVICE_STARTING 1   ///< The stream has been requested, no status line yet
+#define FLEET_DEVICE_STREAMING 2  ///< Status lines received in time
+#define FLEET_DEVICE_STALE 3      ///< No status line for FLEET_STALE_PERIODS, requested again
+
+//! Last status line of a channel (\@stat)
+struct fleetChannel {
+  int32_t state;        ///< Status ID (STAT_NONE ... STAT_RUN), -1 if never received
+  uint32_t t;           ///< millis() of the device
+  float net;            ///< Net weight on the scale (gr)
+  float used;           ///< Filament used by the job (gr)
+  float pct;            ///< Filament left on the spool (%)
+  float rate;           ///< Consumption rate (gr/s)
+  float drift;          ///< Zero drift of the scale (gr)
+  float endLeft;        ///< Filament left at the end of the job (gr), 0 if not known
+  int32_t tte;          ///< Seconds to the end of the spool, -1 if not known
+  uint8_t pull;         ///< The extruder is pulling the filament
+  uint8_t duty;         ///< Motor duty cycle
+  uint8_t motion;       ///< Motion state of the motor
+  uint8_t faults;       ///< HAL_DIAG_* bits of the driver
+  uint64_t updated;     ///< CLOCK_MONOTONIC ns of the host when the line has been read
+};
+
+//! A dispenser
+struct fleetDevice {
+  uint32_t sequence;    ///< Odd while the monitor writes the record
+  int32_t state;        ///< FLEET_DEVICE_*
+  char path[FLEET_PATH_SIZE];   ///< The serial port
+  int32_t channels;     ///< Channels seen in the status lines
+  uint32_t faults;      ///< HAL_DIAG_* bits of the last \@fault line
+  uint32_t faultEvents; ///< \@fault lines, every one with new driver faults
+  uint32_t runouts;     ///< \@runout lines
+  uint32_t lines;       ///< Machine readable lines
+  uint32_t errors;      ///< Lines not valid or too long
+  uint32_t connects;    ///< Times the stream has been requested
+  uint64_t updated;     ///< CLOCK_MONOTONIC ns of the last machine readable line
+  fleetChannel channel[FLEET_CHANNELS];
+};
+
+//! Totals of the channels running a job of the devices streaming
+struct fleetTotals {
+  uint32_t streaming;   ///< Devices streaming
+  uint32_t running;     ///< Channels running a job
+  double used;          ///< Filament used (gr)
+  double rate;          ///< Consumption rate (gr/s)
+  float minPct;         ///< Lowest filament left (%), 100 if none running
+  int32_t minDevice;    ///< Device with the lowest filament left, -1 if none running
+  uint32_t faultEvents; ///< \@fault lines of all the devices
+  uint32_t faulty;      ///< Devices with driver faults
+};
+
+//! Start of the snapshot
+struct fleetSnapshotHeader {
+  uint32_t magic;       ///< FLEET_SNAPSHOT_MAGIC
+  uint16_t version;     ///< FLEET_SNAPSHOT_VERSION
+  uint16_t deviceSize;  ///< sizeof(fleetDevice)
+  uint32_t devices;     ///< Devices following the header
+  uint32_t period;      ///< ms of the status lines requested
+  uint32_t sequence;    ///< Odd while the monitor writes the totals
+  fleetTotals totals;
+};
+
+//! Size of a snapshot
+static inline size_t fleetSnapshotSize(uint32_t devices) {
+  return sizeof(fleetSnapshotHeader) + devices * sizeof(fleetDevice);
+}
+
+/**
+ * Reader of the snapshot of a running monitor
+ */
+class FleetSnapshot {
+
+  public:
+    FleetSnapshot();
+    ~FleetSnapshot();
+
+    /**
+     * Map the snapshot read only
+     *
+     * \param name the shared memory object
+     * \return false if it does not exist or it is not a snapshot
+     */
+    bool open(const char* name = FLEET_SNAPSHOT_NAME);
+
+    //! Unmap the snapshot
+    void close(void);
+
+    /**
+     * Copy a device
+     *
+     * \param j the device, 0 ... devices - 1
+     * \param device the copy
+     * \param retries if not NULL, the retries as the monitor was writing it
+     * \return false if the snapshot is not open or there is no such device
+     */
+    bool read(uint32_t j, fleetDevice& device, unsigned int* retries = NULL) const;
+
+    /**
+     * Copy the totals
+     *
+     * \param totals the copy
+     * \param retries if not NULL, the retries as the monitor was writing them
+     * \return false if the snapshot is not open
+     */
+    bool read(fleetTotals& totals, unsigned int* retries = NULL) const;
+
+    //! Devices of the snapshot
+    uint32_t devices;
+    //! ms of the status lines
+    uint32_t period;
+
+  private:
+    //! The mapped snapshot
+    const fleetSnapshotHeader* header;
+    //! Mapped bytes
+    size_t size;
+};
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ *  \file fleetstat.cpp
+ *  \brief Show the snapshot of a running fleet monitor (fleetsnapshot.h)
+ *
+ *  fleetstat [snapshot]\n
+ *  The totals of the fleet, then a line for every channel of the
+ *  devices: state, filament used and left, consumption rate, driver
+ *  faults and the age of the last status line. The snapshot is read
+ *  without stopping the monitor.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "fleetsnapshot.h"
+
+//! Names of the device states
+static const char* stateNames[] = { "closed", "starting", "streaming", "stale" };
+
+int main(int argc, char** argv) {
+  const char* name = (argc > 1) ? argv[1] : FLEET_SNAPSHOT_NAME;
+  FleetSnapshot snapshot;
+  fleetTotals totals;
+  fleetDevice device;
+  struct timespec now;
+  unsigned long long ns;
+  uint32_t j;
+  int k;
+
+  if(argc > 2) {
+    fprintf(stderr, "usage: %s [snapshot]\n", argv[0]);
+    return 2;
+  }
+  if(!snapshot.open(name)) {
+    fprintf(stderr, "%s: no fleet monitor running\n", name);
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+  snapshot.read(totals);
+  printf("%u devices, %u streaming, %u channels running, %u with driver faults\n",
+         snapshot.devices, totals.streaming, totals.running, totals.faulty);
+  printf("used %.2f gr, rate %.4f gr/s, lowest spool %.1f%%", totals.used, totals.rate,
+         totals.minPct);
+  if(totals.minDevice >= 0)
+    printf(" (device %d)", totals.minDevice);
+  printf(", %u fault events\n\n", totals.faultEvents);
+
+  printf("%4s %-24s %-9s %3s %5s %9s %6s %8s %6s %6s %8s\n", "dev", "port", "state", "ch", "stat",
+         "used gr", "left%", "gr/s", "faults", "events", "age ms");
+  for(j = 0; j < snapshot.devices; j++) {
+    snapshot.read(j, device);
+    if(device.channels == 0)
+      printf("%4u %-24s %s\n", j, device.path, stateNames[device.state]);
+    for(k = 0; k < device.channels; k++) {
+      const fleetChannel& c = device.channel[k];
+
+      if(c.state < 0)
+        continue;
+      printf("%4u %-24s %-9s %3d %5d %9.2f %6.1f %8.4f %6X %6u %8llu\n", j, device.path,
+             stateNames[device.state], k, c.state, c.used, c.pct, c.rate, c.faults,
+             device.faultEvents, (ns - c.updated) / 1000000ULL);
+    }
+  }
+  return 0;
+}
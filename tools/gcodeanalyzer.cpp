@@ -0,0 +1,259 @@
+/**
+ *  \file gcodeanalyzer.cpp
+ *  \brief Filament demand of a G-code job in time bins
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <math.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gcodeanalyzer.h"
+
+//! Axes of the position
+enum { AXIS_X, AXIS_Y, AXIS_Z, AXIS_E };
+
+//! Powers of ten of the decimal digits
+static const double decimals[] = {
+  1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+  1e16, 1e17, 1e18
+};
+
+/**
+ * Parse a decimal number, faster than strtod() as the G-code numbers
+ * have no exponent
+ *
+ * \param p the first character
+ * \param end the line end
+ * \param value the number, 0 if there are no digits
+ * \return the character following the number
+ */
+static const char* parseNumber(const char* p, const char* end, double& value) {
+  unsigned long long digits = 0;
+  bool negative = false, point = false;
+  int scale = 0, count = 0;
+
+  if( (p < end) && ((*p == '-') || (*p == '+')) ) {
+    negative = (*p == '-');
+    p++;
+  }
+  for(; p < end; p++) {
+    if( (*p >= '0') && (*p <= '9') ) {
+      // Longer numbers lose the last digits
+      if(count < 18) {
+        digits = digits * 10 + (*p - '0');
+        count++;
+        if(point)
+          scale++;
+      }
+    }
+    else if( (*p == '.') && !point ) {
+      point = true;
+    }
+    else {
+      break;
+    }
+  }
+  value = digits / decimals[scale];
+  if(negative)
+    value = -value;
+  return p;
+}
+
+GcodeAnalyzer::GcodeAnalyzer(unsigned long binTime, double diameter, double density) {
+  this->binTime = binTime;
+  // mm2 of the section by g/cm3 = mg/mm
+  mgPerMm = M_PI * diameter * diameter / 4 * density;
+  lines = 0;
+  moves = 0;
+  filament = 0;
+  time = 0;
+  bytes = 0;
+  memset(position, 0, sizeof(position));
+  eMax = 0;
+  feed = GCODE_DEFAULT_FEED / 60;
+  absolute = true;
+  absoluteE = true;
+}
+
+bool GcodeAnalyzer::parseFile(const char* path) {
+  struct stat info;
+  void* data;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if(fd < 0)
+    return false;
+  if(fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+  if(info.st_size == 0) {
+    close(fd);
+    return true;
+  }
+  data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+    return false;
+  // The file is read once, in order
+  madvise(data, info.st_size, MADV_SEQUENTIAL);
+  parse((const char*)data, info.st_size);
+  munmap(data, info.st_size);
+  return true;
+}
+
+void GcodeAnalyzer::parse(const char* text, size_t size) {
+  const char* end = text + size;
+  const char* eol;
+
+  bytes += size;
+  while(text < end) {
+    eol = (const char*)memchr(text, '\n', end - text);
+    if(eol == NULL)
+      eol = end;
+    line(text, eol);
+    lines++;
+    text = eol + 1;
+  }
+  // The bins of the last moves with no filament
+  if(bins.size() < ceil(time * 1000 / binTime))
+    bins.resize(ceil(time * 1000 / binTime), 0);
+}
+
+void GcodeAnalyzer::line(const char* p, const char* end) {
+  double words['Z' - 'A' + 1];
+  bool given['Z' - 'A' + 1];
+  double target[4], distance, value, mm;
+  char letter, code = 0;
+  int number = -1, axis;
+
+  memset(given, 0, sizeof(given));
+  while(p < end) {
+    letter = *p;
+    // Comment to the line end
+    if(letter == ';')
+      break;
+    if( (letter >= 'a') && (letter <= 'z') )
+      letter -= 'a' - 'A';
+    if( (letter < 'A') || (letter > 'Z') ) {
+      p++;
+      continue;
+    }
+    p = parseNumber(p + 1, end, value);
+    if( (code == 0) && ((letter == 'G') || (letter == 'M')) ) {
+      code = letter;
+      number = (int)value;
+    }
+    else {
+      words[letter - 'A'] = value;
+      given[letter - 'A'] = true;
+    }
+  }
+
+  if(code == 'M') {
+    if(number == 82)
+      absoluteE = true;
+    else if(number == 83)
+      absoluteE = false;
+    return;
+  }
+  if(code != 'G')
+    return;
+
+  switch(number) {
+    case 0:
+    case 1:
+      if(given['F' - 'A'] && (words['F' - 'A'] > 0))
+        feed = words['F' - 'A'] / 60;
+      for(axis = AXIS_X; axis <= AXIS_E; axis++) {
+        letter = (axis == AXIS_E) ? 'E' : 'X' + axis;
+        target[axis] = position[axis];
+        if(given[letter - 'A']) {
+          if( (axis == AXIS_E) ? absoluteE : absolute )
+            target[axis] = words[letter - 'A'];
+          else
+            target[axis] += words[letter - 'A'];
+        }
+      }
+      distance = sqrt((target[AXIS_X] - position[AXIS_X]) * (target[AXIS_X] - position[AXIS_X]) +
+                      (target[AXIS_Y] - position[AXIS_Y]) * (target[AXIS_Y] - position[AXIS_Y]) +
+                      (target[AXIS_Z] - position[AXIS_Z]) * (target[AXIS_Z] - position[AXIS_Z]));
+      // Extruder only moves, e.g. the retractions
+      if(distance == 0)
+        distance = fabs(target[AXIS_E] - position[AXIS_E]);
+      mm = 0;
+      if(target[AXIS_E] > eMax) {
+        mm = target[AXIS_E] - eMax;
+        eMax = target[AXIS_E];
+      }
+      memcpy(position, target, sizeof(position));
+      addMove(distance / feed, mm);
+      moves++;
+      break;
+
+    case 4:
+      if(given['P' - 'A'])
+        addMove(words['P' - 'A'] / 1000, 0);
+      else if(given['S' - 'A'])
+        addMove(words['S' - 'A'], 0);
+      break;
+
+    case 90:
+      absolute = absoluteE = true;
+      break;
+
+    case 91:
+      absolute = absoluteE = false;
+      break;
+
+    case 92:
+      for(axis = AXIS_X; axis <= AXIS_E; axis++) {
+        letter = (axis == AXIS_E) ? 'E' : 'X' + axis;
+        // No axis given: all of them are zeroed
+        if(given[letter - 'A'] || (!given['X' - 'A'] && !given['Y' - 'A'] &&
+                                   !given['Z' - 'A'] && !given['E' - 'A'])) {
+          value = given[letter - 'A'] ? words[letter - 'A'] : 0;
+          if(axis == AXIS_E)
+            eMax += value - position[AXIS_E];
+          position[axis] = value;
+        }
+      }
+      break;
+  }
+}
+
+void GcodeAnalyzer::addMove(double seconds, double mm) {
+  double start = time, end = time + seconds, binEnd, step;
+  size_t bin;
+
+  time = end;
+  filament += mm;
+  if(mm <= 0)
+    return;
+  bin = (size_t)(start * 1000 / binTime);
+  if(seconds <= 0) {
+    if(bins.size() <= bin)
+      bins.resize(bin + 1, 0);
+    bins[bin] += mm * mgPerMm;
+    return;
+  }
+  while(start < end) {
+    binEnd = (bin + 1) * binTime / 1000.0;
+    step = fmin(end, binEnd) - start;
+    if(step > 0) {
+      if(bins.size() <= bin)
+        bins.resize(bin + 1, 0);
+      bins[bin] += mm * mgPerMm * step / seconds;
+      start = fmin(end, binEnd);
+    }
+    bin++;
+  }
+}
@@ -0,0 +1,109 @@
+/**
+ *  \file gcodeanalyzer.h
+ *  \brief Filament demand of a G-code job in time bins, the schedule
+ *  followed by the dispenser (plan and plango commands)
+ *
+ *  The file is mapped in memory and parsed in a single pass, line by
+ *  line, with no copy. The moves (G0, G1) last their length at the
+ *  feed rate (F, mm/min), the dwells (G4 P<ms> or S<s>) their time; the
+ *  accelerations are not modelled. The filament pulled by the extruder
+ *  is the E position over the highest one reached, so a retraction and
+ *  the following unretraction pull nothing. E is absolute or relative
+ *  (M82, M83, G90, G91) and G92 sets the position. The filament of a
+ *  move is spread uniformly over its time, and summed in bins of
+ *  binTime ms.\n
+ *  The library does not depend on the firmware sources.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _GCODE_ANALYZER
+#define _GCODE_ANALYZER
+
+#include <stddef.h>
+#include <vector>
+
+//! Feed rate of the moves before the first F (mm/min)
+#define GCODE_DEFAULT_FEED 1500.0
+
+/**
+ * Analyzer of a G-code job
+ */
+class GcodeAnalyzer {
+
+  public:
+    /**
+     * \param binTime ms of a bin
+     * \param diameter filament diameter (mm)
+     * \param density filament density (g/cm3)
+     */
+    GcodeAnalyzer(unsigned long binTime = 1000, double diameter = 1.75, double density = 1.24);
+
+    /**
+     * Map a file and parse it
+     *
+     * \param path the file
+     * \return false if the file can not be read
+     */
+    bool parseFile(const char* path);
+
+    /**
+     * Parse G-code text after the text already parsed. The text ends at
+     * a line end
+     *
+     * \param text the text
+     * \param size its length
+     */
+    void parse(const char* text, size_t size);
+
+    //! Filament demand of every bin (mg)
+    std::vector<double> bins;
+    //! ms of a bin
+    unsigned long binTime;
+    //! Filament weight of one mm (mg)
+    double mgPerMm;
+    //! Lines parsed
+    unsigned long lines;
+    //! Moves parsed
+    unsigned long moves;
+    //! Filament pulled by the extruder (mm)
+    double filament;
+    //! Time of the job (s)
+    double time;
+    //! Bytes parsed
+    unsigned long long bytes;
+
+  private:
+    /**
+     * Parse a line
+     *
+     * \param p the first character
+     * \param end the line end
+     */
+    void line(const char* p, const char* end);
+
+    /**
+     * Spread the filament of a move over its time
+     *
+     * \param seconds the duration of the move
+     * \param mm the filament pulled
+     */
+    void addMove(double seconds, double mm);
+
+    //! Position of the axes X, Y, Z, E (mm)
+    double position[4];
+    //! Highest E position reached
+    double eMax;
+    //! Feed rate (mm/s)
+    double feed;
+    //! Absolute X, Y, Z
+    bool absolute;
+    //! Absolute E
+    bool absoluteE;
+};
+
+#endif
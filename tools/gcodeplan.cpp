@@ -0,0 +1,63 @@
+/**
+ *  \file gcodeplan.cpp
+ *  \brief Print the filament demand schedule of a G-code file as the
+ *  commands of the dispenser: a plan line for every bin, to be sent to
+ *  the board while the job is printed keeping the schedule queue ahead,
+ *  after a plango with the bin time when the job starts
+ *
+ *  gcodeplan <file> [bin ms] [diameter mm] [density g/cm3]
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gcodeanalyzer.h"
+
+//! Max demand of a bin accepted by the plan command (mg)
+#define PLAN_BIN_MAX 65535
+
+int main(int argc, char** argv) {
+  struct timespec start, end;
+  unsigned long binTime = (argc > 2) ? atol(argv[2]) : 1000;
+  double diameter = (argc > 3) ? atof(argv[3]) : 1.75;
+  double density = (argc > 4) ? atof(argv[4]) : 1.24;
+  double carry = 0, seconds;
+  unsigned long clamped = 0;
+  long mg;
+
+  if( (argc < 2) || (binTime == 0) || (diameter <= 0) || (density <= 0) ) {
+    fprintf(stderr, "gcodeplan <file> [bin ms] [diameter mm] [density g/cm3]\n");
+    return 2;
+  }
+  GcodeAnalyzer analyzer(binTime, diameter, density);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if(!analyzer.parseFile(argv[1])) {
+    perror(argv[1]);
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  // The rounding of every bin is carried to the next one
+  for(double demand : analyzer.bins) {
+    carry += demand;
+    mg = (long)(carry + 0.5);
+    if(mg > PLAN_BIN_MAX) {
+      mg = PLAN_BIN_MAX;
+      clamped++;
+    }
+    carry -= mg;
+    printf("plan %ld\n", mg);
+  }
+  fprintf(stderr, "%lu lines, %lu moves, %.1f s, %.1f mm (%.2f gr), %zu bins of %lu ms, "
+          "%lu clamped, parsed at %.0f MB/s\n", analyzer.lines, analyzer.moves, analyzer.time,
+          analyzer.filament, analyzer.filament * analyzer.mgPerMm / 1000, analyzer.bins.size(),
+          binTime, clamped, analyzer.bytes / seconds / 1e6);
+  return 0;
+}
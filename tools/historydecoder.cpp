@@ -0,0 +1,117 @@
+/**
+ *  \file historydecoder.cpp
+ *  \brief Host decoder of the consumption history streamed by the
+ *  history command (history.h)
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "historydecoder.h"
+
+HistoryDecoder::HistoryDecoder() {
+  clear();
+}
+
+void HistoryDecoder::clear(void) {
+  samples.clear();
+  declared = 0;
+  period = 0;
+  skipped = 0;
+  bytes = 0;
+  complete = false;
+  failed = false;
+  started = false;
+  token = 0;
+  shift = 0;
+}
+
+bool HistoryDecoder::line(const char* text) {
+  unsigned long firstTime;
+  long first;
+  uint8_t data[64];
+  int length = 0;
+  unsigned int b;
+
+  if(strncmp(text, "history", 7) == 0) {
+    if(strcmp(text, "history end") == 0) {
+      complete = started && (shift == 0);
+      failed |= !complete;
+      return true;
+    }
+    if(strcmp(text, "history empty") == 0) {
+      clear();
+      complete = true;
+      return true;
+    }
+    if(strcmp(text, "history overrun") == 0) {
+      failed = true;
+      return true;
+    }
+    clear();
+    if(sscanf(text, "history %lu %lu %lu %ld", &declared, &period, &firstTime, &first) != 4) {
+      failed = true;
+      return true;
+    }
+    started = true;
+    time = firstTime;
+    value = first;
+    samples.push_back({ time, value * HISTORY_DECODER_RESOLUTION });
+    return true;
+  }
+
+  if( (text[0] != ':') || !started || complete )
+    return false;
+  for(text++; (text[0] != 0) && (text[1] != 0); text += 2) {
+    if( (sscanf(text, "%2x", &b) != 1) || (length == (int)sizeof(data)) ) {
+      failed = true;
+      return true;
+    }
+    data[length++] = b;
+  }
+  decode(data, length);
+  return true;
+}
+
+void HistoryDecoder::decode(const uint8_t* data, int length) {
+  int j;
+
+  for(j = 0; j < length; j++) {
+    bytes++;
+    token |= (unsigned long)(data[j] & 0x7f) << shift;
+    shift += 7;
+    if(data[j] & 0x80)
+      continue;
+    add(token);
+    token = 0;
+    shift = 0;
+  }
+}
+
+void HistoryDecoder::add(unsigned long t) {
+  unsigned long zigzag;
+  long delta;
+  int run;
+
+  if(t & 1) {
+    // Periods without samples
+    time += (t >> 1) * period;
+    skipped += t >> 1;
+    return;
+  }
+  t >>= 1;
+  run = t % HISTORY_DECODER_RUN + 1;
+  zigzag = t / HISTORY_DECODER_RUN;
+  delta = (long)(zigzag >> 1) ^ -(long)(zigzag & 1);
+  while(run-- > 0) {
+    time += period;
+    value += delta;
+    samples.push_back({ time, value * HISTORY_DECODER_RESOLUTION });
+  }
+}
@@ -0,0 +1,95 @@
+/**
+ *  \file historydecoder.h
+ *  \brief Host decoder of the consumption history streamed by the
+ *  history command (history.h)
+ *  
+ *  The lines of the stream are passed one at a time, the other lines of
+ *  the serial output are ignored. The samples are rebuilt from the first
+ *  weight of the header and the ring tokens, every sample with its
+ *  timestamp: the periods skipped by the firmware have no sample.\n
+ *  The library does not depend on the firmware sources, the format
+ *  constants are the ones of history.h.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _HISTORY_DECODER
+#define _HISTORY_DECODER
+
+#include <stdint.h>
+#include <vector>
+
+//! Max number of equal deltas in a token (HISTORY_RUN)
+#define HISTORY_DECODER_RUN 16
+//! Weight units of the samples in mg (HISTORY_RESOLUTION)
+#define HISTORY_DECODER_RESOLUTION 500
+
+//! A sample of the history
+struct historySample {
+  unsigned long timestamp;  ///< halMillis() of the sample
+  long weight;              ///< Net weight (mg)
+};
+
+/**
+ * Decoder of a streamed history
+ */
+class HistoryDecoder {
+
+  public:
+    HistoryDecoder();
+
+    //! Clear the samples, waiting for a new stream
+    void clear(void);
+
+    /**
+     * Decode a line of the serial output
+     * 
+     * \param text the line, without the line end
+     * \return true if the line is part of a history stream
+     */
+    bool line(const char* text);
+
+    /**
+     * Decode ring bytes
+     * 
+     * \param data the bytes
+     * \param length the number of bytes
+     */
+    void decode(const uint8_t* data, int length);
+
+    //! Decoded samples
+    std::vector<historySample> samples;
+    //! Samples declared by the header
+    unsigned long declared;
+    //! ms between two samples
+    unsigned long period;
+    //! Periods skipped by the firmware
+    unsigned long skipped;
+    //! Ring bytes decoded
+    unsigned long bytes;
+    //! The end of the stream has been received
+    bool complete;
+    //! The stream has been interrupted or a line is not valid
+    bool failed;
+
+  private:
+    //! A header has been received
+    bool started;
+    //! Timestamp of the last sample or skip
+    unsigned long time;
+    //! Weight of the last sample (HISTORY_DECODER_RESOLUTION units)
+    long value;
+    //! Token being decoded
+    unsigned long token;
+    //! Bits of the token decoded
+    int shift;
+
+    //! Add a decoded token
+    void add(unsigned long t);
+};
+
+#endif
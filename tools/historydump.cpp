@@ -0,0 +1,37 @@
+/**
+ *  \file historydump.cpp
+ *  \brief Print the samples of a history stream read from the standard
+ *  input, e.g. the serial output captured while the history command was
+ *  running: a line for every sample with the timestamp (s) and the net
+ *  weight (gr)
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "historydecoder.h"
+
+int main() {
+  HistoryDecoder history;
+  char text[256];
+
+  while(fgets(text, sizeof(text), stdin) != NULL) {
+    text[strcspn(text, "\r\n")] = 0;
+    history.line(text);
+  }
+  if(!history.complete || history.failed) {
+    fprintf(stderr, "history stream not complete\n");
+    return 1;
+  }
+  for(const historySample& s : history.samples)
+    printf("%.3f %.3f\n", s.timestamp / 1000.0, s.weight / 1000.0);
+  fprintf(stderr, "%zu samples, %lu periods skipped, %.2f bytes/sample\n",
+          history.samples.size(), history.skipped,
+          history.samples.empty() ? 0.0 : (double)history.bytes / history.samples.size());
+  return 0;
+}
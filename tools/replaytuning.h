@@ -0,0 +1,48 @@
+/**
+ *  \file replaytuning.h
+ *  \brief Reading parameters of the replay firmware variant
+ *
+ *  The replay variant (CMakeLists.txt) reads the parameters of
+ *  filament.h below through replayParameter(), so the capture replay
+ *  (capturereplay.h) runs the unmodified readScale() with other values
+ *  without building the firmware again. A parameter not set keeps the
+ *  value of filament.h.\n
+ *  The header is included before every source of the variant.
+ *
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _REPLAY_TUNING
+#define _REPLAY_TUNING
+
+#include <math.h>
+
+#define REPLAY_MIN_TENSION 0  ///< MIN_EXTRUDER_TENSION (gr)
+#define REPLAY_MAX_DELTA 1    ///< MAX_DELTA_WEIGHT_IN_RANGE (gr)
+#define REPLAY_SAMPLES 2      ///< SCALE_SAMPLES
+#define REPLAY_RESOLUTION 3   ///< SCALE_RESOLUTION (gr)
+//! Number of parameters
+#define REPLAY_PARAMETERS 4
+
+//! Values of the parameters, NAN keeps the value of filament.h
+inline double* replayTuning(void) {
+  static double values[REPLAY_PARAMETERS] = { NAN, NAN, NAN, NAN };
+  return values;
+}
+
+/**
+ * Value of a parameter
+ *
+ * \param id the parameter, REPLAY_MIN_TENSION ... REPLAY_RESOLUTION
+ * \param value the value of filament.h
+ * \return the value set by the replay, if any
+ */
+inline double replayParameter(int id, double value) {
+  return isnan(replayTuning()[id]) ? value : replayTuning()[id];
+}
+
+#endif
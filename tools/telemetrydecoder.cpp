@@ -0,0 +1,135 @@
+/**
+ *  \file telemetrydecoder.cpp
+ *  \brief Host decoder of the binary telemetry stream (telemetry.h)
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "telemetrydecoder.h"
+
+//! Little endian field of a record
+static uint32_t field(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+uint16_t telemetryCrc(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xffff;
+  size_t j;
+  int k;
+
+  for(j = 0; j < length; j++) {
+    crc ^= (uint16_t)data[j] << 8;
+    for(k = 0; k < 8; k++) {
+      if(crc & 0x8000)
+        crc = (crc << 1) ^ 0x1021;
+      else
+        crc <<= 1;
+    }
+  }
+  return crc;
+}
+
+TelemetryDecoder::TelemetryDecoder() {
+  frameBytes = 0;
+  errors = 0;
+}
+
+int TelemetryDecoder::receive(const uint8_t* data, size_t length) {
+  size_t before = records.size(), j;
+
+  for(j = 0; j < length; j++) {
+    if(data[j] == 0)
+      endSegment();
+    else
+      segment += (char)data[j];
+  }
+  return records.size() - before;
+}
+
+void TelemetryDecoder::endSegment(void) {
+  static const size_t sizes[] = {
+    TELEMETRY_DECODER_SAMPLE_SIZE + 3, TELEMETRY_DECODER_CAPTURE_SIZE + 3
+  };
+  const uint8_t* bytes = (const uint8_t*)segment.data();
+  size_t j;
+  bool binary = false;
+
+  // The whole segment, or a frame after a text
+  if(!decode(bytes, segment.size())) {
+    for(j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+      if( (segment.size() > sizes[j]) && decode(bytes + segment.size() - sizes[j], sizes[j]) ) {
+        segment.resize(segment.size() - sizes[j]);
+        break;
+      }
+    }
+    // The text is printable, a binary segment is a corrupted frame
+    for(j = 0; j < segment.size(); j++) {
+      if( ((uint8_t)segment[j] < 0x20) && (segment[j] != '\r') && (segment[j] != '\n') &&
+          (segment[j] != '\t') )
+        binary = true;
+    }
+    if(binary)
+      errors++;
+    else
+      text += segment;
+  }
+  segment.clear();
+}
+
+bool TelemetryDecoder::decode(const uint8_t* frame, size_t length) {
+  uint8_t data[TELEMETRY_DECODER_FRAME_MAX];
+  telemetryRecord r;
+  size_t in = 0, out = 0, code, j;
+
+  if( (length < 2) || (length > TELEMETRY_DECODER_FRAME_MAX) )
+    return false;
+
+  // COBS: every code is followed by code - 1 bytes and stands for a 0x00
+  while(in < length) {
+    code = frame[in++];
+    if(in + code - 1 > length)
+      return false;
+    for(j = 1; j < code; j++)
+      data[out++] = frame[in++];
+    if(in < length)
+      data[out++] = 0;
+  }
+  if( (out < 3) || (telemetryCrc(data, out - 2) != (data[out - 2] | (data[out - 1] << 8))) )
+    return false;
+  out -= 2;
+
+  if( (data[0] == TELEMETRY_DECODER_SAMPLE) && (out == TELEMETRY_DECODER_SAMPLE_SIZE) ) {
+    r.type = TELEMETRY_DECODER_SAMPLE;
+    r.timestamp = field(data + 1);
+    r.raw = (int32_t)field(data + 5);
+    r.weight = (int32_t)field(data + 9);
+    r.channel = data[13] >> 4;
+    r.statID = data[13] & 0x0f;
+    r.duty = data[14];
+    r.direction = data[15] >> 4;
+    r.motion = data[15] & 0x0f;
+    r.diagnosis = data[16];
+  }
+  else if( (data[0] == TELEMETRY_DECODER_CAPTURE) && (out == TELEMETRY_DECODER_CAPTURE_SIZE) ) {
+    r.type = TELEMETRY_DECODER_CAPTURE;
+    r.timestamp = field(data + 1);
+    r.raw = (int32_t)field(data + 5);
+    r.weight = 0;
+    r.channel = data[9] >> 4;
+    r.statID = data[9] & 0x0f;
+    r.duty = data[10];
+    r.direction = data[11] >> 4;
+    r.motion = data[11] & 0x0f;
+    r.diagnosis = 0;
+  }
+  else
+    return false;
+
+  records.push_back(r);
+  frameBytes += length + 1;
+  return true;
+}
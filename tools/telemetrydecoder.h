@@ -0,0 +1,97 @@
+/**
+ *  \file telemetrydecoder.h
+ *  \brief Host decoder of the binary telemetry stream (telemetry.h)
+ *  
+ *  The bytes received from the serial port are split at the 0x00
+ *  delimiters. A frame is COBS decoded and its CRC-16 is checked. The
+ *  text messages of the firmware share the port: a frame can follow
+ *  the text of a message with no delimiter between them, so the bytes
+ *  before a delimiter are also tried as a frame of every record size.
+ *  The bytes that are not a frame are returned as text.\n
+ *  The library does not depend on the firmware sources, the record
+ *  layouts are the ones of telemetry.h.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _TELEMETRY_DECODER
+#define _TELEMETRY_DECODER
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Record types and sizes of telemetry.h
+#define TELEMETRY_DECODER_SAMPLE 1      ///< TELEMETRY_SAMPLE
+#define TELEMETRY_DECODER_CAPTURE 2     ///< TELEMETRY_CAPTURE
+#define TELEMETRY_DECODER_SAMPLE_SIZE 17  ///< sizeof(telemetrySample)
+#define TELEMETRY_DECODER_CAPTURE_SIZE 12 ///< sizeof(telemetryCapture)
+//! Max encoded frame without the delimiter (TELEMETRY_FRAME_MAX - 1)
+#define TELEMETRY_DECODER_FRAME_MAX 36
+
+//! A decoded record, sample or capture
+struct telemetryRecord {
+  int type;                 ///< TELEMETRY_DECODER_SAMPLE or TELEMETRY_DECODER_CAPTURE
+  unsigned long timestamp;  ///< millis() of a sample, micros() of a capture
+  long raw;                 ///< Raw sensor value
+  long weight;              ///< Filtered weight in mg, samples only
+  int channel;              ///< Spool channel
+  int statID;               ///< Status ID (STAT_NONE ... STAT_RUN)
+  int duty;                 ///< Motor duty cycle
+  int direction;            ///< Motor direction
+  int motion;               ///< Motion state
+  int diagnosis;            ///< TLE94112 diagnosis bits, samples only
+};
+
+/**
+ * Decoder of the serial port bytes
+ */
+class TelemetryDecoder {
+
+  public:
+    TelemetryDecoder();
+
+    /**
+     * Decode the bytes received
+     * 
+     * \param data the bytes
+     * \param length the number of bytes
+     * \return the number of records decoded
+     */
+    int receive(const uint8_t* data, size_t length);
+
+    //! Decoded records, cleared by the caller
+    std::vector<telemetryRecord> records;
+    //! Text received, cleared by the caller
+    std::string text;
+    //! Bytes of the decoded frames, with the delimiters
+    unsigned long frameBytes;
+    //! Segments between two delimiters that are neither frames nor text
+    unsigned long errors;
+
+  private:
+    //! Bytes received after the last delimiter
+    std::string segment;
+
+    /**
+     * Decode a frame
+     * 
+     * \param frame the encoded bytes, without the delimiter
+     * \param length the number of bytes
+     * \return true if the frame is a valid record
+     */
+    bool decode(const uint8_t* frame, size_t length);
+
+    //! Decode the segment ended by a delimiter
+    void endSegment(void);
+};
+
+//! CRC-16/CCITT of the records (crc16.h)
+uint16_t telemetryCrc(const uint8_t* data, size_t length);
+
+#endif
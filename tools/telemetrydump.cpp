@@ -0,0 +1,40 @@
+/**
+ *  \file telemetrydump.cpp
+ *  \brief Print the telemetry records of the bytes read from the
+ *  standard input, e.g. the serial port of the board: a line for every
+ *  record, the text messages are printed as they are
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include <stdio.h>
+#include "telemetrydecoder.h"
+
+int main() {
+  TelemetryDecoder telemetry;
+  uint8_t data[256];
+  size_t length;
+
+  while( (length = fread(data, 1, sizeof(data), stdin)) > 0 ) {
+    telemetry.receive(data, length);
+    for(const telemetryRecord& r : telemetry.records) {
+      if(r.type == TELEMETRY_DECODER_SAMPLE)
+        printf("sample ch=%d t=%lu raw=%ld weight=%.3f stat=%d duty=%d dir=%d motion=%d diag=0x%02x\n",
+               r.channel, r.timestamp, r.raw, r.weight / 1000.0, r.statID, r.duty,
+               r.direction, r.motion, r.diagnosis);
+      else
+        printf("capture ch=%d t=%lu raw=%ld stat=%d duty=%d dir=%d motion=%d\n",
+               r.channel, r.timestamp, r.raw, r.statID, r.duty, r.direction, r.motion);
+    }
+    telemetry.records.clear();
+    fputs(telemetry.text.c_str(), stdout);
+    telemetry.text.clear();
+  }
+  if(telemetry.errors > 0)
+    fprintf(stderr, "%lu frames not valid\n", telemetry.errors);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ *  \file weightfilter.cpp
+ *  \brief Streaming filter chain for the load cell raw samples
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#include "weightfilter.h"
+
+void WeightFilter::begin(int stages, long gate) {
+  stageMask = stages;
+  emaShift = (stages & FILTER_EMA_FAST) ? FILTER_EMA_FAST_SHIFT : FILTER_EMA_SHIFT;
+  gateLimit = gate;
+  rejected = 0;
+  value = 0;
+  seeded = false;
+}
+
+void WeightFilter::setStages(int stages) {
+  stageMask = stages;
+  emaShift = (stages & FILTER_EMA_FAST) ? FILTER_EMA_FAST_SHIFT : FILTER_EMA_SHIFT;
+  if(seeded)
+    reset(value);
+}
+
+void WeightFilter::setGate(long gate) {
+  gateLimit = gate;
+}
+
+void WeightFilter::reset(long v) {
+  int j;
+
+  for(j = 0; j < FILTER_MEDIAN_SIZE; j++)
+    medianWindow[j] = v;
+  medianPos = 0;
+  gateRef = v;
+  gateCount = 0;
+  emaAcc = v * (1L << emaShift);
+  kalmanX = v;
+  kalmanP = FILTER_KALMAN_R;
+  value = v;
+  seeded = true;
+}
+
+long WeightFilter::update(long raw) {
+  long v = raw;
+
+  // The first sample initializes the stages
+  if(!seeded)
+    reset(raw);
+
+  if(stageMask & FILTER_MEDIAN)
+    v = median(v);
+  if(stageMask & FILTER_GATE)
+    v = gate(v);
+  if(stageMask & (FILTER_EMA | FILTER_EMA_FAST))
+    v = ema(v);
+  if(stageMask & FILTER_KALMAN)
+    v = kalman(v);
+
+  value = v;
+  return v;
+}
+
+long WeightFilter::median(long raw) {
+  long sorted[FILTER_MEDIAN_SIZE];
+  long tmp;
+  int j, k;
+
+  medianWindow[medianPos] = raw;
+  medianPos = (medianPos + 1) % FILTER_MEDIAN_SIZE;
+
+  // Insertion sort of the (small, fixed size) window
+  for(j = 0; j < FILTER_MEDIAN_SIZE; j++) {
+    tmp = medianWindow[j];
+    for(k = j; (k > 0) && (sorted[k - 1] > tmp); k--)
+      sorted[k] = sorted[k - 1];
+    sorted[k] = tmp;
+  }
+
+  return sorted[FILTER_MEDIAN_SIZE / 2];
+}
+
+long WeightFilter::gate(long raw) {
+  if(abs(raw - gateRef) > gateLimit) {
+    // A persistent change is a real weight change, not noise
+    if(++gateCount < FILTER_GATE_HOLD) {
+      rejected++;
+      return gateRef;
+    }
+  }
+  gateCount = 0;
+  gateRef = raw;
+  return raw;
+}
+
+long WeightFilter::ema(long raw) {
+  // acc = acc - acc / 2^n + raw, the output is acc / 2^n
+  emaAcc += raw - (emaAcc >> emaShift);
+  return emaAcc >> emaShift;
+}
+
+long WeightFilter::kalman(long raw) {
+  long gain;
+
+  // Predict: the weight is a random walk
+  kalmanP += FILTER_KALMAN_Q;
+  // Update, the gain is in Q16 format
+  gain = (long)(((long long)kalmanP << 16) / (kalmanP + FILTER_KALMAN_R));
+  kalmanX += (long)(((long long)(raw - kalmanX) * gain) >> 16);
+  kalmanP = (long)(((long long)kalmanP * (65536 - gain)) >> 16);
+
+  return kalmanX;
+}
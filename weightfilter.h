@@ -0,0 +1,122 @@
+/**
+ *  \file weightfilter.h
+ *  \brief Streaming filter chain for the load cell raw samples
+ *  
+ *  The samples are processed one at a time by the enabled stages in the
+ *  order: median, outlier gate, exponential moving average, 1-D Kalman.
+ *  Every stage has a fixed memory footprint and a constant cost per
+ *  sample; all the calculations are on the raw integer counts.
+ *  
+ *  \author Enrico Miglino <balearicdynamics@gmail.com> \n
+ *  Balearic Dynamics sl <www.balearicdynamics.com> SPAIN
+ *  \date July 2017
+ *  \version 1.0 Release Candidate
+ *  Licensed under GNU LGPL 3.0
+ */
+
+#ifndef _WEIGHTFILTER
+#define _WEIGHTFILTER
+
+#include "hal.h"
+
+// Filter stages, can be combined
+#define FILTER_NONE 0x00      ///< Samples pass unchanged
+#define FILTER_MEDIAN 0x01    ///< Median of the last FILTER_MEDIAN_SIZE samples
+#define FILTER_GATE 0x02      ///< Discard the samples too far from the estimate
+#define FILTER_EMA 0x04       ///< Exponential moving average
+#define FILTER_KALMAN 0x08    ///< 1-D Kalman filter (random walk model)
+#define FILTER_EMA_FAST 0x10  ///< Exponential moving average with a short time constant
+
+//! Median window size in samples, should be odd
+#define FILTER_MEDIAN_SIZE 5
+//! EMA weight of the new sample as 1 / 2^FILTER_EMA_SHIFT (max 7)
+#define FILTER_EMA_SHIFT 3
+//! EMA weight of the new sample as 1 / 2^FILTER_EMA_FAST_SHIFT with FILTER_EMA_FAST
+#define FILTER_EMA_FAST_SHIFT 1
+//! Kalman process noise variance (raw counts^2)
+#define FILTER_KALMAN_Q 400
+//! Kalman measurement noise variance (raw counts^2)
+#define FILTER_KALMAN_R 40000
+//! Consecutive samples rejected by the gate before the new level is accepted
+#define FILTER_GATE_HOLD 8
+
+/**
+ * Class filtering the raw load cell samples
+ */
+class WeightFilter {
+
+  public:
+    /**
+     * Initialize the filter
+     * 
+     * \param stages the enabled stages (FILTER_* flags)
+     * \param gate max distance in raw counts accepted by the gate stage
+     */
+    void begin(int stages, long gate);
+
+    /**
+     * Change the enabled stages. The new stages start from the
+     * last filtered value to avoid transients.
+     * 
+     * \param stages the enabled stages (FILTER_* flags)
+     */
+    void setStages(int stages);
+
+    /**
+     * Change the gate stage threshold
+     * 
+     * \param gate max distance in raw counts accepted by the gate stage
+     */
+    void setGate(long gate);
+
+    /**
+     * Initialize all the stages to a constant value
+     * 
+     * \param value the raw value
+     */
+    void reset(long value);
+
+    /**
+     * Process a new sample through the enabled stages
+     * 
+     * \param raw the raw sample
+     * \return the filtered value
+     */
+    long update(long raw);
+
+    //! Last filtered value
+    long value;
+    //! Enabled stages
+    int stageMask;
+    //! Number of samples discarded by the gate stage
+    unsigned long rejected;
+
+  private:
+    //! True when the stages have been initialized with a sample
+    boolean seeded;
+    //! Median window
+    long medianWindow[FILTER_MEDIAN_SIZE];
+    //! Next position in the median window
+    int medianPos;
+    //! Gate threshold
+    long gateLimit;
+    //! Last value accepted by the gate
+    long gateRef;
+    //! Consecutive samples rejected
+    int gateCount;
+    //! EMA accumulator, scaled by 2^emaShift
+    long emaAcc;
+    //! EMA weight of the new sample as 1 / 2^emaShift
+    int emaShift;
+    //! Kalman estimate
+    long kalmanX;
+    //! Kalman estimate variance
+    long kalmanP;
+
+    long median(long raw);
+    long gate(long raw);
+    long ema(long raw);
+    long kalman(long raw);
+};
+
+#endif